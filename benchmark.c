@@ -0,0 +1,169 @@
+//
+//  benchmark.c
+//  vkProject
+//
+//  Fixed-frame benchmark settings and percentile reporting.
+//
+
+#include "benchmark.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+void defaultBenchmarkSettings(BenchmarkSettings *pSettings)
+{
+    pSettings->enabled = 0;
+    pSettings->warmupFrames = 100;
+    pSettings->measuredFrames = 1000;
+    pSettings->timestep = 1.0/60.0;
+    pSettings->instanceCount = 1;
+    pSettings->meshComplexity = 1;
+    pSettings->scene = BENCHMARK_SCENE_GRID;
+    pSettings->outputFile = NULL;
+}
+
+static int compareDouble(const void *a, const void *b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, uint32_t count, double p)//Nearest rank
+{
+    uint32_t rank = (uint32_t)ceil(p / 100.0 * count);
+    rank = rank == 0 ? 1 : rank;
+    return sorted[rank - 1];
+}
+
+void summariseTimings(double *values, uint32_t count, TimingSummary *pSummary)//Sorts values in place
+{
+    memset(pSummary, 0, sizeof(TimingSummary));
+    if(count == 0)
+    {
+        return;
+    }
+
+    qsort(values, count, sizeof(double), compareDouble);
+
+    double sum = 0.0;
+    for(uint32_t i = 0; i < count; i++)
+    {
+        sum += values[i];
+    }
+
+    pSummary->mean = sum / count;
+    pSummary->p50 = percentile(values, count, 50.0);
+    pSummary->p95 = percentile(values, count, 95.0);
+    pSummary->p99 = percentile(values, count, 99.0);
+    pSummary->max = values[count - 1];
+}
+
+void computeBenchmarkSummary(const FrameTimings *frames, uint32_t frameCount, uint64_t firstMeasuredFrame, BenchmarkSummary *pSummary)
+{
+    memset(pSummary, 0, sizeof(BenchmarkSummary));
+
+    double *values = malloc(sizeof(double) * (frameCount ? frameCount : 1));
+    if(values == NULL)
+    {
+        printf("Failed to allocate benchmark samples!\n");
+        exit(1);
+    }
+
+    uint32_t count = 0;
+    for(uint32_t i = 0; i < frameCount; i++)
+    {
+        if(frames[i].frame >= firstMeasuredFrame)
+        {
+            values[count++] = frames[i].cpuFrame;
+            pSummary->wallSeconds += frames[i].cpuFrame / 1000.0;
+        }
+    }
+    pSummary->frameCount = count;
+    summariseTimings(values, count, &pSummary->cpuFrame);
+
+    count = 0;
+    for(uint32_t i = 0; i < frameCount; i++)
+    {
+        if(frames[i].frame >= firstMeasuredFrame && frames[i].gpuFrame >= 0.0)
+        {
+            values[count++] = frames[i].gpuFrame;
+        }
+    }
+    pSummary->gpuFrameCount = count;
+    summariseTimings(values, count, &pSummary->gpuFrame);
+
+    for(int stage = 0; stage < PROFILE_STAGE_COUNT; stage++)
+    {
+        count = 0;
+        for(uint32_t i = 0; i < frameCount; i++)
+        {
+            if(frames[i].frame >= firstMeasuredFrame)
+            {
+                values[count++] = frames[i].cpuStage[stage];
+            }
+        }
+        summariseTimings(values, count, &pSummary->cpuStage[stage]);
+    }
+
+    free(values);
+}
+
+static void writeTimingSummary(FILE *pFile, const char *name, const TimingSummary *pSummary, const char *separator)
+{
+    fprintf(pFile, "    \"%s\": {\"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f}%s\n",
+            name, pSummary->mean, pSummary->p50, pSummary->p95, pSummary->p99, pSummary->max, separator);
+}
+
+void writeBenchmarkSummary(FILE *pFile, const BenchmarkSettings *pSettings, const BenchmarkScene *pScene, const BenchmarkSummary *pSummary)
+{
+    fprintf(pFile, "{\n");
+    fprintf(pFile, "  \"device\": \"%s\",\n", pScene->deviceName);
+    fprintf(pFile, "  \"warmup_frames\": %u,\n", pSettings->warmupFrames);
+    fprintf(pFile, "  \"measured_frames\": %u,\n", pSummary->frameCount);
+    fprintf(pFile, "  \"gpu_frames\": %u,\n", pSummary->gpuFrameCount);
+    fprintf(pFile, "  \"timestep_s\": %.6f,\n", pSettings->timestep);
+    fprintf(pFile, "  \"instances\": %u,\n", pSettings->instanceCount);
+    fprintf(pFile, "  \"mesh_complexity\": %u,\n", pSettings->meshComplexity);
+    fprintf(pFile, "  \"scene\": \"%s\",\n", pSettings->scene == BENCHMARK_SCENE_OVERDRAW ? "overdraw" : "grid");
+    fprintf(pFile, "  \"vertices\": %" PRIu64 ",\n", pScene->vertexCount);
+    fprintf(pFile, "  \"triangles\": %" PRIu64 ",\n", pScene->triangleCount);
+    fprintf(pFile, "  \"vertex_format\": \"%s\",\n", pScene->vertexFormat);
+    fprintf(pFile, "  \"vertex_stride\": %u,\n", pScene->vertexStride);
+    fprintf(pFile, "  \"depth_sort\": \"%s\",\n", pScene->depthSort);
+    fprintf(pFile, "  \"animation\": \"%s\",\n", pScene->animation);
+    fprintf(pFile, "  \"culling\": \"%s\",\n", pScene->culling);
+    fprintf(pFile, "  \"visible_instances\": %u,\n", pScene->visibleInstances);
+    fprintf(pFile, "  \"occlusion\": %s,\n", pScene->occlusion ? "true" : "false");
+    fprintf(pFile, "  \"occluded_instances\": %u,\n", pScene->occludedInstances);
+    fprintf(pFile, "  \"gpu_budget_ms\": %.3f,\n", pScene->gpuBudget);
+    fprintf(pFile, "  \"resolution_scale_mean\": %.4f,\n", pScene->meanResolutionScale);
+    fprintf(pFile, "  \"resolution_scale_lowest\": %.4f,\n", pScene->lowestResolutionScale);
+    fprintf(pFile, "  \"bindless\": %s,\n", pScene->bindless ? "true" : "false");
+    fprintf(pFile, "  \"draws\": %llu,\n", (unsigned long long)pScene->draws);
+    fprintf(pFile, "  \"binds\": {\"pipeline\": %llu, \"descriptor_set\": %llu, \"vertex_buffers\": %llu},\n",
+            (unsigned long long)pScene->binds[RENDER_BIND_PIPELINE], (unsigned long long)pScene->binds[RENDER_BIND_DESCRIPTOR_SET], (unsigned long long)pScene->binds[RENDER_BIND_VERTEX_BUFFERS]);
+    fprintf(pFile, "  \"skipped_binds\": {\"pipeline\": %llu, \"descriptor_set\": %llu, \"vertex_buffers\": %llu},\n",
+            (unsigned long long)pScene->skippedBinds[RENDER_BIND_PIPELINE], (unsigned long long)pScene->skippedBinds[RENDER_BIND_DESCRIPTOR_SET], (unsigned long long)pScene->skippedBinds[RENDER_BIND_VERTEX_BUFFERS]);
+    fprintf(pFile, "  \"drift\": %.3f,\n", pScene->drift);
+    fprintf(pFile, "  \"bvh\": {\"builds\": %llu, \"refits\": %llu, \"subtree_rebuilds\": %llu, \"cost_ratio\": %.3f},\n",
+            (unsigned long long)pScene->bvhBuilds, (unsigned long long)pScene->bvhRefits, (unsigned long long)pScene->bvhSubtreeRebuilds, pScene->bvhCostRatio);
+    fprintf(pFile, "  \"particles\": %u,\n", pScene->particles);
+    fprintf(pFile, "  \"particle_updates\": %llu,\n", (unsigned long long)pScene->particleUpdates);
+    fprintf(pFile, "  \"particles_per_second\": %.0f,\n", pSummary->wallSeconds > 0.0 ? pScene->particleUpdates / pSummary->wallSeconds : 0.0);
+    fprintf(pFile, "  \"wall_s\": %.4f,\n", pSummary->wallSeconds);
+    fprintf(pFile, "  \"fps\": %.2f,\n", pSummary->wallSeconds > 0.0 ? pSummary->frameCount / pSummary->wallSeconds : 0.0);
+    fprintf(pFile, "  \"frame_ms\": {\n");
+    writeTimingSummary(pFile, "cpu", &pSummary->cpuFrame, ",");
+    writeTimingSummary(pFile, "gpu", &pSummary->gpuFrame, "");
+    fprintf(pFile, "  },\n");
+    fprintf(pFile, "  \"cpu_stage_ms\": {\n");
+    for(int stage = 0; stage < PROFILE_STAGE_COUNT; stage++)
+    {
+        writeTimingSummary(pFile, profilerStageNames[stage], &pSummary->cpuStage[stage], stage + 1 < PROFILE_STAGE_COUNT ? "," : "");
+    }
+    fprintf(pFile, "  }\n");
+    fprintf(pFile, "}\n");
+}
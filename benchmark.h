@@ -0,0 +1,82 @@
+//
+//  benchmark.h
+//  vkProject
+//
+//  Fixed-frame benchmark settings and percentile reporting.
+//
+
+#ifndef benchmark_h
+#define benchmark_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include "profiler.h"
+#include "renderQueue.h"
+
+enum benchmarkScene{BENCHMARK_SCENE_GRID, BENCHMARK_SCENE_OVERDRAW};
+
+typedef struct {
+    uint32_t enabled;
+    uint32_t warmupFrames;
+    uint32_t measuredFrames;
+    double timestep;//Simulated seconds per frame, makes the animation independent of how fast frames are produced
+    uint32_t instanceCount;
+    uint32_t meshComplexity;//Grid subdivisions of the benchmark mesh
+    uint32_t scene;//How instances are laid out
+    const char *outputFile;//Summary is written to stdout if not given, with everything else printed moved to stderr
+} BenchmarkSettings;
+
+typedef struct {
+    double mean;
+    double p50;
+    double p95;
+    double p99;
+    double max;
+} TimingSummary;
+
+typedef struct {
+    uint32_t frameCount;
+    uint32_t gpuFrameCount;
+    double wallSeconds;
+    TimingSummary cpuFrame;
+    TimingSummary gpuFrame;
+    TimingSummary cpuStage[PROFILE_STAGE_COUNT];
+} BenchmarkSummary;
+
+typedef struct {
+    const char *deviceName;
+    uint64_t vertexCount;//Totals over every instance, past 32 bits with enough of them
+    uint64_t triangleCount;
+    const char *vertexFormat;
+    const char *depthSort;
+    const char *animation;//Where instance matrices were computed
+    const char *culling;
+    uint32_t visibleInstances;//Passed culling in the last measured frame
+    uint32_t occlusion;//Two-phase occlusion culling ran after frustum culling
+    uint32_t occludedInstances;//Passed frustum culling but were hidden, in the last frame read back
+    float gpuBudget;//Milliseconds dynamic resolution aimed for, 0 when rendering at the swap chain extent
+    float meanResolutionScale;//Over every frame measured, warmup included
+    float lowestResolutionScale;
+    uint32_t vertexStride;//Bytes fetched per vertex, compare runs with different --vertex-format
+    uint32_t bindless;//Descriptor indexing was used instead of per-frame descriptor sets
+    uint64_t draws;//Render queue totals over the measured frames
+    uint64_t binds[RENDER_BIND_COUNT];
+    uint64_t skippedBinds[RENDER_BIND_COUNT];
+    float drift;//Distance entities bobbed, 0 when they stayed in place
+    uint64_t bvhBuilds;//Over the measured frames, full rebuilds after refits degraded the tree
+    uint64_t bvhRefits;
+    uint64_t bvhSubtreeRebuilds;
+    float bvhCostRatio;//SAH cost after the last refit over the cost after the last full build
+    uint32_t particles;//Capacity of the particle system, 0 when disabled
+    uint64_t particleUpdates;//Live particles simulated over the measured frames
+} BenchmarkScene;
+
+void defaultBenchmarkSettings(BenchmarkSettings *pSettings);
+
+void summariseTimings(double *values, uint32_t count, TimingSummary *pSummary);
+
+void computeBenchmarkSummary(const FrameTimings *frames, uint32_t frameCount, uint64_t firstMeasuredFrame, BenchmarkSummary *pSummary);
+
+void writeBenchmarkSummary(FILE *pFile, const BenchmarkSettings *pSettings, const BenchmarkScene *pScene, const BenchmarkSummary *pSummary);
+
+#endif /* benchmark_h */
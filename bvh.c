@@ -0,0 +1,619 @@
+//
+//  bvh.c
+//  vkProject
+//
+//  Bounding volume hierarchy over entity bounds, for frustum culling and picking.
+//
+
+#include "bvh.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+typedef struct {
+    Bvh *pBvh;
+    uint32_t nextNode;
+    uint32_t endNode;
+} BvhBuild;
+
+typedef struct {
+    uint32_t node;
+    uint32_t planeMask;//Planes the node is not yet known to be fully inside of
+} CullEntry;
+
+void frustumFromCamera(Frustum *pFrustum, float view[4][4], float projection[4][4])//Planes of clip space pulled back to world space, depth runs from 0 to w as perspectiveMatrix sets it up
+{
+    float m[4][4];
+    matcpy(view, m);
+    matmul(projection, m);
+
+    for(uint32_t c = 0; c < 4; c++)
+    {
+        pFrustum->planes[0][c] = m[3][c] + m[0][c];
+        pFrustum->planes[1][c] = m[3][c] - m[0][c];
+        pFrustum->planes[2][c] = m[3][c] + m[1][c];
+        pFrustum->planes[3][c] = m[3][c] - m[1][c];
+        pFrustum->planes[4][c] = m[2][c];
+        pFrustum->planes[5][c] = m[3][c] - m[2][c];
+    }
+
+    for(uint32_t p = 0; p < 6; p++)
+    {
+        float *plane = pFrustum->planes[p];
+        float length = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        for(uint32_t c = 0; c < 4; c++)
+        {
+            plane[c] /= length;
+        }
+    }
+}
+
+uint32_t frustumContainsSphere(const Frustum *pFrustum, const EntityBounds *pBounds)//Conservative, spheres near a corner may pass although they are outside
+{
+    for(uint32_t p = 0; p < 6; p++)
+    {
+        const float *plane = pFrustum->planes[p];
+        float distance = plane[0] * pBounds->centre[0] + plane[1] * pBounds->centre[1] + plane[2] * pBounds->centre[2] + plane[3];
+        if(distance < -pBounds->radius)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void sphereBounds(const EntityBounds *pSphere, BvhBounds *pBounds)
+{
+    for(uint32_t c = 0; c < 3; c++)
+    {
+        pBounds->min[c] = pSphere->centre[c] - pSphere->radius;
+        pBounds->max[c] = pSphere->centre[c] + pSphere->radius;
+    }
+}
+
+static void growBounds(float min[3], float max[3], const float otherMin[3], const float otherMax[3])
+{
+    for(uint32_t c = 0; c < 3; c++)
+    {
+        min[c] = otherMin[c] < min[c] ? otherMin[c] : min[c];
+        max[c] = otherMax[c] > max[c] ? otherMax[c] : max[c];
+    }
+}
+
+static float boundsArea(const float min[3], const float max[3])//Half the surface area, only ratios are ever compared
+{
+    float x = max[0] - min[0];
+    float y = max[1] - min[1];
+    float z = max[2] - min[2];
+    return x < 0.0f ? 0.0f : x * y + y * z + z * x;
+}
+
+static void setNodeBounds(Bvh *pBvh, BvhNode *pNode)
+{
+    for(uint32_t c = 0; c < 3; c++)
+    {
+        pNode->min[c] = INFINITY;
+        pNode->max[c] = -INFINITY;
+    }
+    for(uint32_t i = pNode->first; i < pNode->first + pNode->count; i++)
+    {
+        const BvhBounds *pBounds = &pBvh->entityBounds[pBvh->entityIndices[i]];
+        growBounds(pNode->min, pNode->max, pBounds->min, pBounds->max);
+    }
+}
+
+static float centroid(const BvhBounds *pBounds, uint32_t axis)
+{
+    return 0.5f * (pBounds->min[axis] + pBounds->max[axis]);
+}
+
+static uint32_t partitionNode(Bvh *pBvh, const BvhNode *pNode, uint32_t depth)//Returns how many entities went to the left child, 0 when the node stays a leaf
+{
+    uint32_t first = pNode->first;
+    uint32_t count = pNode->count;
+    if(count <= BVH_LEAF_SIZE)
+    {
+        return 0;
+    }
+
+    float centroidMin[3] = {INFINITY, INFINITY, INFINITY};
+    float centroidMax[3] = {-INFINITY, -INFINITY, -INFINITY};
+    for(uint32_t i = first; i < first + count; i++)
+    {
+        const BvhBounds *pBounds = &pBvh->entityBounds[pBvh->entityIndices[i]];
+        for(uint32_t c = 0; c < 3; c++)
+        {
+            float centre = centroid(pBounds, c);
+            centroidMin[c] = centre < centroidMin[c] ? centre : centroidMin[c];
+            centroidMax[c] = centre > centroidMax[c] ? centre : centroidMax[c];
+        }
+    }
+
+    int32_t bestAxis = -1;
+    uint32_t bestBin = 0;
+    float bestCost = INFINITY;
+    for(uint32_t axis = 0; axis < 3 && depth < BVH_MAX_DEPTH; axis++)
+    {
+        float extent = centroidMax[axis] - centroidMin[axis];
+        if(extent <= 0.0f)
+        {
+            continue;
+        }
+
+        uint32_t binCounts[BVH_BINS] = {0};
+        float binMin[BVH_BINS][3];
+        float binMax[BVH_BINS][3];
+        for(uint32_t b = 0; b < BVH_BINS; b++)
+        {
+            for(uint32_t c = 0; c < 3; c++)
+            {
+                binMin[b][c] = INFINITY;
+                binMax[b][c] = -INFINITY;
+            }
+        }
+
+        float scale = BVH_BINS / extent;
+        for(uint32_t i = first; i < first + count; i++)
+        {
+            const BvhBounds *pBounds = &pBvh->entityBounds[pBvh->entityIndices[i]];
+            uint32_t bin = (uint32_t)((centroid(pBounds, axis) - centroidMin[axis]) * scale);
+            bin = bin < BVH_BINS ? bin : BVH_BINS - 1;
+            binCounts[bin]++;
+            growBounds(binMin[bin], binMax[bin], pBounds->min, pBounds->max);
+        }
+
+        float rightCosts[BVH_BINS];//Cost of everything right of each plane, swept from the right
+        float sweepMin[3] = {INFINITY, INFINITY, INFINITY};
+        float sweepMax[3] = {-INFINITY, -INFINITY, -INFINITY};
+        uint32_t sweepCount = 0;
+        for(uint32_t b = BVH_BINS - 1; b > 0; b--)
+        {
+            sweepCount += binCounts[b];
+            growBounds(sweepMin, sweepMax, binMin[b], binMax[b]);
+            rightCosts[b] = sweepCount * boundsArea(sweepMin, sweepMax);
+        }
+
+        for(uint32_t c = 0; c < 3; c++)
+        {
+            sweepMin[c] = INFINITY;
+            sweepMax[c] = -INFINITY;
+        }
+        sweepCount = 0;
+        for(uint32_t b = 0; b + 1 < BVH_BINS; b++)//Plane between bin b and b + 1
+        {
+            sweepCount += binCounts[b];
+            growBounds(sweepMin, sweepMax, binMin[b], binMax[b]);
+            if(sweepCount == 0 || sweepCount == count)
+            {
+                continue;
+            }
+            float cost = sweepCount * boundsArea(sweepMin, sweepMax) + rightCosts[b + 1];
+            if(cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = (int32_t)axis;
+                bestBin = b + 1;
+            }
+        }
+    }
+
+    if(bestAxis < 0)//Every centroid coincides or the tree is too deep, halving by index keeps the depth logarithmic
+    {
+        return count / 2;
+    }
+
+    float scale = BVH_BINS / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+    uint32_t i = first;
+    uint32_t j = first + count;
+    while(i < j)
+    {
+        uint32_t bin = (uint32_t)((centroid(&pBvh->entityBounds[pBvh->entityIndices[i]], bestAxis) - centroidMin[bestAxis]) * scale);
+        if(bin < bestBin)
+        {
+            i++;
+        }
+        else
+        {
+            uint32_t swap = pBvh->entityIndices[i];
+            pBvh->entityIndices[i] = pBvh->entityIndices[--j];
+            pBvh->entityIndices[j] = swap;
+        }
+    }
+    return i - first;
+}
+
+static uint32_t allocateChildren(BvhBuild *pBuild, BvhNode *pNode, uint32_t leftCount)//Turns the node into an interior node over two new children holding its entities
+{
+    if(pBuild->nextNode + 2 > pBuild->endNode)
+    {
+        printf("BVH node range exhausted!\n");
+        exit(1);
+    }
+
+    uint32_t left = pBuild->nextNode;
+    pBuild->nextNode += 2;
+    BvhNode *nodes = pBuild->pBvh->nodes;
+    nodes[left].first = pNode->first;
+    nodes[left].count = leftCount;
+    nodes[left + 1].first = pNode->first + leftCount;
+    nodes[left + 1].count = pNode->count - leftCount;
+    pNode->first = left;
+    pNode->count = 0;
+    return left;
+}
+
+static void buildNode(BvhBuild *pBuild, uint32_t nodeIndex, uint32_t depth)
+{
+    BvhNode *pNode = &pBuild->pBvh->nodes[nodeIndex];
+    setNodeBounds(pBuild->pBvh, pNode);
+    uint32_t leftCount = partitionNode(pBuild->pBvh, pNode, depth);
+    if(leftCount == 0)
+    {
+        return;
+    }
+
+    uint32_t left = allocateChildren(pBuild, pNode, leftCount);
+    buildNode(pBuild, left, depth + 1);
+    buildNode(pBuild, left + 1, depth + 1);
+}
+
+static void splitTop(BvhBuild *pBuild, uint32_t nodeIndex, uint32_t depth)//Splits down to subtrees without building them, so they can be built independently
+{
+    Bvh *pBvh = pBuild->pBvh;
+    BvhNode *pNode = &pBvh->nodes[nodeIndex];
+    setNodeBounds(pBvh, pNode);
+    if(pNode->count <= BVH_SUBTREE_SIZE)
+    {
+        if(pBvh->subtreeCount == pBvh->entityCapacity)
+        {
+            printf("BVH subtree list exhausted!\n");
+            exit(1);
+        }
+        pBvh->subtrees[pBvh->subtreeCount++] = (BvhSubtree){nodeIndex, pNode->first, pNode->count, 0};
+        return;
+    }
+
+    uint32_t left = allocateChildren(pBuild, pNode, partitionNode(pBvh, pNode, depth));
+    splitTop(pBuild, left, depth + 1);
+    splitTop(pBuild, left + 1, depth + 1);
+}
+
+static void buildSubtree(Bvh *pBvh, uint32_t subtree)
+{
+    BvhSubtree *pSubtree = &pBvh->subtrees[subtree];
+    BvhBuild build = {pBvh, pSubtree->nodeOffset, pSubtree->nodeOffset + 2 * pSubtree->count - 2};
+    pBvh->nodes[pSubtree->root].first = pSubtree->first;
+    pBvh->nodes[pSubtree->root].count = pSubtree->count;
+    buildNode(&build, pSubtree->root, 0);
+
+    for(uint32_t i = build.nextNode; i < build.endNode; i++)
+    {
+        pBvh->nodes[i].count = BVH_UNUSED_NODE;
+    }
+}
+
+static void buildSubtreeJob(void *pData, uint32_t subtree)
+{
+    buildSubtree(pData, subtree);
+}
+
+static float bvhCost(const Bvh *pBvh)//Expected node visits plus entity tests of a random ray, relative to hitting the root
+{
+    if(pBvh->nodeCount == 0)
+    {
+        return 0.0f;
+    }
+
+    float rootArea = boundsArea(pBvh->nodes[0].min, pBvh->nodes[0].max);
+    float cost = 0.0f;
+    for(uint32_t i = 0; i < pBvh->nodeCount; i++)
+    {
+        const BvhNode *pNode = &pBvh->nodes[i];
+        if(pNode->count != BVH_UNUSED_NODE)
+        {
+            cost += boundsArea(pNode->min, pNode->max) * (pNode->count > 0 ? pNode->count : 1);
+        }
+    }
+    return rootArea > 0.0f ? cost / rootArea : cost;
+}
+
+static void buildAll(Bvh *pBvh)//Keeps the current entity order, a rebuild starts from where refits left it
+{
+    pBvh->subtreeCount = 0;
+    pBvh->nextRebuild = 0;
+    pBvh->nodeCount = 0;
+    pBvh->topNodeCount = 0;
+    if(pBvh->entityCount == 0)
+    {
+        pBvh->cost = pBvh->buildCost = 0.0f;
+        return;
+    }
+
+    pBvh->nodes[0].first = 0;
+    pBvh->nodes[0].count = pBvh->entityCount;
+    BvhBuild top = {pBvh, 1, 2 * pBvh->entityCount - 1};
+    splitTop(&top, 0, 0);
+    pBvh->topNodeCount = top.nextNode;
+
+    uint32_t offset = pBvh->topNodeCount;//Top levels take 2s - 1 nodes and a subtree of n entities at most 2n - 2 more, so everything fits in 2N - 1
+    for(uint32_t i = 0; i < pBvh->subtreeCount; i++)
+    {
+        pBvh->subtrees[i].nodeOffset = offset;
+        offset += 2 * pBvh->subtrees[i].count - 2;
+    }
+    pBvh->nodeCount = offset;
+
+    if(pBvh->pJobs != NULL && pBvh->pJobs->threadCount > 0 && pBvh->entityCount >= BVH_PARALLEL_THRESHOLD)
+    {
+        jobSystemRun(pBvh->pJobs, pBvh->subtreeCount, buildSubtreeJob, pBvh);
+    }
+    else
+    {
+        for(uint32_t i = 0; i < pBvh->subtreeCount; i++)
+        {
+            buildSubtree(pBvh, i);
+        }
+    }
+
+    pBvh->cost = pBvh->buildCost = bvhCost(pBvh);
+    pBvh->builds++;
+}
+
+void buildBvh(Bvh *pBvh, const EntityBounds *bounds, uint32_t count, JobSystem *pJobs)//Rebuild whenever entities are created or destroyed, their dense indices change
+{
+    pBvh->pJobs = pJobs;
+    if(count > pBvh->entityCapacity)
+    {
+        pBvh->entityCapacity = count;
+        pBvh->entityIndices = realloc(pBvh->entityIndices, sizeof(uint32_t) * count);
+        pBvh->entityBounds = realloc(pBvh->entityBounds, sizeof(BvhBounds) * count);
+        pBvh->nodes = realloc(pBvh->nodes, sizeof(BvhNode) * 2 * count);
+        pBvh->subtrees = realloc(pBvh->subtrees, sizeof(BvhSubtree) * count);
+        if(pBvh->entityIndices == NULL || pBvh->entityBounds == NULL || pBvh->nodes == NULL || pBvh->subtrees == NULL)
+        {
+            printf("Failed to allocate BVH!\n");
+            exit(1);
+        }
+    }
+
+    pBvh->entityCount = count;
+    for(uint32_t i = 0; i < count; i++)
+    {
+        pBvh->entityIndices[i] = i;
+        sphereBounds(&bounds[i], &pBvh->entityBounds[i]);
+    }
+    buildAll(pBvh);
+}
+
+void bvhRefit(Bvh *pBvh, const EntityBounds *bounds)//After entities moved, keeps the topology so the tree degrades as they drift apart
+{
+    for(uint32_t i = 0; i < pBvh->entityCount; i++)
+    {
+        sphereBounds(&bounds[i], &pBvh->entityBounds[i]);
+    }
+
+    for(uint32_t i = pBvh->nodeCount; i-- > 0;)
+    {
+        BvhNode *pNode = &pBvh->nodes[i];
+        if(pNode->count == BVH_UNUSED_NODE)
+        {
+            continue;
+        }
+        if(pNode->count > 0)
+        {
+            setNodeBounds(pBvh, pNode);
+            continue;
+        }
+        BvhNode *pLeft = &pBvh->nodes[pNode->first];
+        memcpy(pNode->min, pLeft->min, sizeof(pNode->min));
+        memcpy(pNode->max, pLeft->max, sizeof(pNode->max));
+        growBounds(pNode->min, pNode->max, pLeft[1].min, pLeft[1].max);
+    }
+
+    pBvh->cost = bvhCost(pBvh);
+    pBvh->refits++;
+}
+
+void bvhRebuildStep(Bvh *pBvh)//Call after refitting, rebuilds one subtree per call and everything once the cost has degraded too far
+{
+    if(pBvh->subtreeCount == 0)
+    {
+        return;
+    }
+
+    if(pBvh->cost > BVH_REBUILD_RATIO * pBvh->buildCost)
+    {
+        buildAll(pBvh);
+        return;
+    }
+
+    buildSubtree(pBvh, pBvh->nextRebuild);//Covers the same entities, so the bounds above it stay valid
+    pBvh->nextRebuild = (pBvh->nextRebuild + 1) % pBvh->subtreeCount;
+    pBvh->subtreeRebuilds++;
+}
+
+static uint32_t boundsOutside(const float min[3], const float max[3], const Frustum *pFrustum, uint32_t *pPlaneMask)//Also clears the planes the box is fully inside of
+{
+    for(uint32_t p = 0; p < 6; p++)
+    {
+        if(!(*pPlaneMask & (1u << p)))
+        {
+            continue;
+        }
+        const float *plane = pFrustum->planes[p];
+        float farthest = plane[3];
+        float nearest = plane[3];
+        for(uint32_t c = 0; c < 3; c++)
+        {
+            farthest += plane[c] * (plane[c] > 0.0f ? max[c] : min[c]);
+            nearest += plane[c] * (plane[c] > 0.0f ? min[c] : max[c]);
+        }
+        if(farthest < 0.0f)
+        {
+            return 1;
+        }
+        if(nearest >= 0.0f)
+        {
+            *pPlaneMask &= ~(1u << p);
+        }
+    }
+    return 0;
+}
+
+uint32_t bvhCullFrustum(Bvh *pBvh, const Frustum *pFrustum, uint32_t *visible)//Writes the dense indices of entities whose boxes touch the frustum, returns how many
+{
+    if(pBvh->nodeCount == 0)
+    {
+        return 0;
+    }
+
+    CullEntry stack[BVH_STACK_SIZE];
+    uint32_t stackSize = 0;
+    uint32_t visibleCount = 0;
+    uint64_t visitedNodes = 0;
+    stack[stackSize++] = (CullEntry){0, 0x3F};
+    while(stackSize > 0)
+    {
+        CullEntry entry = stack[--stackSize];
+        const BvhNode *pNode = &pBvh->nodes[entry.node];
+        visitedNodes++;
+        if(entry.planeMask && boundsOutside(pNode->min, pNode->max, pFrustum, &entry.planeMask))
+        {
+            continue;
+        }
+
+        if(pNode->count > 0)
+        {
+            for(uint32_t i = pNode->first; i < pNode->first + pNode->count; i++)
+            {
+                uint32_t entity = pBvh->entityIndices[i];
+                uint32_t planeMask = entry.planeMask;
+                if(!planeMask || !boundsOutside(pBvh->entityBounds[entity].min, pBvh->entityBounds[entity].max, pFrustum, &planeMask))
+                {
+                    visible[visibleCount++] = entity;
+                }
+            }
+            continue;
+        }
+
+        if(stackSize + 2 > BVH_STACK_SIZE)
+        {
+            printf("BVH too deep to traverse!\n");
+            exit(1);
+        }
+        stack[stackSize++] = (CullEntry){pNode->first + 1, entry.planeMask};//Children inherit only the planes that still cut their parent
+        stack[stackSize++] = (CullEntry){pNode->first, entry.planeMask};
+    }
+
+    pBvh->visitedNodes = visitedNodes;
+    return visibleCount;
+}
+
+static float rayBoxDistance(const BvhNode *pNode, const float origin[3], const float inverseDirection[3])//Entry distance along the ray, INFINITY when it misses
+{
+    float near = 0.0f;
+    float far = INFINITY;
+    for(uint32_t c = 0; c < 3; c++)
+    {
+        float t0 = (pNode->min[c] - origin[c]) * inverseDirection[c];
+        float t1 = (pNode->max[c] - origin[c]) * inverseDirection[c];
+        near = fmaxf(near, fminf(t0, t1));
+        far = fminf(far, fmaxf(t0, t1));
+    }
+    return near <= far ? near : INFINITY;
+}
+
+uint32_t bvhRaycast(const Bvh *pBvh, const EntityBounds *bounds, vector origin, vector direction, float *pDistance)//Nearest entity whose bounding sphere the ray hits, UINT32_MAX if none
+{
+    uint32_t hit = UINT32_MAX;
+    float best = INFINITY;
+    if(pBvh->nodeCount == 0)
+    {
+        return hit;
+    }
+
+    direction = normalise(direction);
+    float rayOrigin[3] = {origin.x, origin.y, origin.z};
+    float inverseDirection[3] = {1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z};
+
+    uint32_t stack[BVH_STACK_SIZE];
+    uint32_t stackSize = 0;
+    if(rayBoxDistance(&pBvh->nodes[0], rayOrigin, inverseDirection) < INFINITY)
+    {
+        stack[stackSize++] = 0;
+    }
+    while(stackSize > 0)
+    {
+        const BvhNode *pNode = &pBvh->nodes[stack[--stackSize]];
+        if(rayBoxDistance(pNode, rayOrigin, inverseDirection) >= best)//A nearer hit was found since it was pushed
+        {
+            continue;
+        }
+
+        if(pNode->count > 0)
+        {
+            for(uint32_t i = pNode->first; i < pNode->first + pNode->count; i++)
+            {
+                uint32_t entity = pBvh->entityIndices[i];
+                const EntityBounds *pSphere = &bounds[entity];
+                vector offset = v_sub(origin, (vector){pSphere->centre[0], pSphere->centre[1], pSphere->centre[2]});
+                float b = dot(offset, direction);
+                float discriminant = b * b - (dot(offset, offset) - pSphere->radius * pSphere->radius);
+                if(discriminant < 0.0f)
+                {
+                    continue;
+                }
+                float t = -b - sqrtf(discriminant);
+                t = t >= 0.0f ? t : -b + sqrtf(discriminant);//Origin inside the sphere
+                if(t >= 0.0f && t < best)
+                {
+                    best = t;
+                    hit = entity;
+                }
+            }
+            continue;
+        }
+
+        if(stackSize + 2 > BVH_STACK_SIZE)
+        {
+            printf("BVH too deep to traverse!\n");
+            exit(1);
+        }
+        const BvhNode *pLeft = &pBvh->nodes[pNode->first];
+        float leftDistance = rayBoxDistance(pLeft, rayOrigin, inverseDirection);
+        float rightDistance = rayBoxDistance(pLeft + 1, rayOrigin, inverseDirection);
+        uint32_t nearChild = leftDistance <= rightDistance ? pNode->first : pNode->first + 1;
+        float nearDistance = fminf(leftDistance, rightDistance);
+        float farDistance = fmaxf(leftDistance, rightDistance);
+        if(farDistance < best)//Pushed first so the nearer child is visited first
+        {
+            stack[stackSize++] = nearChild == pNode->first ? pNode->first + 1 : pNode->first;
+        }
+        if(nearDistance < best)
+        {
+            stack[stackSize++] = nearChild;
+        }
+    }
+
+    if(pDistance != NULL)
+    {
+        *pDistance = best;
+    }
+    return hit;
+}
+
+void printBvh(Bvh *pBvh)
+{
+    printf("BVH: %u entities, %u nodes, %u subtrees, SAH cost %.1f (%.1f when built), %llu builds, %llu refits, %llu subtree rebuilds\n",
+           pBvh->entityCount, pBvh->nodeCount, pBvh->subtreeCount, pBvh->cost, pBvh->buildCost, (unsigned long long)pBvh->builds, (unsigned long long)pBvh->refits, (unsigned long long)pBvh->subtreeRebuilds);
+}
+
+void destroyBvh(Bvh *pBvh)
+{
+    free(pBvh->nodes);
+    free(pBvh->entityIndices);
+    free(pBvh->entityBounds);
+    free(pBvh->subtrees);
+}
@@ -0,0 +1,87 @@
+//
+//  bvh.h
+//  vkProject
+//
+//  Bounding volume hierarchy over entity bounds, for frustum culling and picking.
+//
+
+#ifndef bvh_h
+#define bvh_h
+
+#include <stdint.h>
+#include "vkMath.h"
+#include "jobSystem.h"
+#include "entityStore.h"
+
+#define BVH_BINS 16//Candidate split planes per axis of the binned SAH build
+#define BVH_LEAF_SIZE 4//Nodes with at most this many entities always become leaves
+#define BVH_MAX_DEPTH 48//Deeper nodes split at the median, which bounds the depth of degenerate scenes
+#define BVH_SUBTREE_SIZE 16384//The top levels split until nodes hold at most this many entities, each of those subtrees is one build job and one incremental rebuild step
+#define BVH_PARALLEL_THRESHOLD 65536//Fewer entities build on the calling thread
+#define BVH_REBUILD_RATIO 1.5f//Refits that make the SAH cost this much worse than after the last build trigger a full rebuild
+#define BVH_UNUSED_NODE UINT32_MAX//Count of nodes reserved for a subtree that its build did not need
+#define BVH_STACK_SIZE 128
+
+typedef struct {
+    float min[3];
+    float max[3];
+} BvhBounds;
+
+typedef struct {
+    float min[3];
+    uint32_t first;//First entry of entityIndices for a leaf, left child for an interior node whose right child follows it
+    float max[3];
+    uint32_t count;//Entities of a leaf, 0 for interior nodes
+} BvhNode;
+
+typedef struct {
+    uint32_t root;//Node in the top levels
+    uint32_t first;//Range of entityIndices it covers
+    uint32_t count;
+    uint32_t nodeOffset;//Nodes below the root are allocated from [nodeOffset, nodeOffset + 2 * count - 2)
+} BvhSubtree;
+
+typedef struct {
+    float planes[6][4];//Left, right, bottom, top, near and far, normals point inwards and are unit length
+} Frustum;
+
+typedef struct {
+    BvhNode *nodes;//Children always come after their parent, so refitting walks the array backwards
+    uint32_t nodeCount;
+    uint32_t topNodeCount;
+    uint32_t *entityIndices;//Dense entity indices in leaf order
+    BvhBounds *entityBounds;//Per dense index
+    uint32_t entityCount;
+    uint32_t entityCapacity;
+    BvhSubtree *subtrees;
+    uint32_t subtreeCount;
+    uint32_t nextRebuild;//Subtree rebuilt by the next incremental step
+    float buildCost;//SAH cost right after the last full build
+    float cost;//After the last refit
+    JobSystem *pJobs;
+
+    uint64_t builds;
+    uint64_t refits;
+    uint64_t subtreeRebuilds;
+    uint64_t visitedNodes;//By the last frustum cull
+} Bvh;
+
+void frustumFromCamera(Frustum *pFrustum, float view[4][4], float projection[4][4]);
+
+uint32_t frustumContainsSphere(const Frustum *pFrustum, const EntityBounds *pBounds);
+
+void buildBvh(Bvh *pBvh, const EntityBounds *bounds, uint32_t count, JobSystem *pJobs);
+
+void bvhRefit(Bvh *pBvh, const EntityBounds *bounds);
+
+void bvhRebuildStep(Bvh *pBvh);
+
+uint32_t bvhCullFrustum(Bvh *pBvh, const Frustum *pFrustum, uint32_t *visible);
+
+uint32_t bvhRaycast(const Bvh *pBvh, const EntityBounds *bounds, vector origin, vector direction, float *pDistance);
+
+void printBvh(Bvh *pBvh);
+
+void destroyBvh(Bvh *pBvh);
+
+#endif /* bvh_h */
@@ -0,0 +1,173 @@
+//
+//  deletionQueue.c
+//  vkProject
+//
+//  Defers destruction of Vulkan objects until the GPU has passed a frame value.
+//
+
+#include "deletionQueue.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void createDeletionQueue(DeletionQueue *pQueue, uint32_t capacity)
+{
+    memset(pQueue, 0, sizeof(DeletionQueue));
+    pQueue->capacity = capacity;
+    pQueue->entries = malloc(sizeof(DeletionEntry) * capacity);
+    if(pQueue->entries == NULL)
+    {
+        printf("Failed to allocate deletion queue!\n");
+        exit(1);
+    }
+}
+
+static void growDeletionQueue(DeletionQueue *pQueue)
+{
+    uint32_t capacity = 2 * pQueue->capacity;
+    DeletionEntry *entries = malloc(sizeof(DeletionEntry) * capacity);
+    if(entries == NULL)
+    {
+        printf("Failed to grow deletion queue!\n");
+        exit(1);
+    }
+
+    for(uint32_t i = 0; i < pQueue->count; i++)//Unwraps the ring so the oldest entry ends up first
+    {
+        entries[i] = pQueue->entries[(pQueue->head + i) % pQueue->capacity];
+    }
+
+    free(pQueue->entries);
+    pQueue->entries = entries;
+    pQueue->capacity = capacity;
+    pQueue->head = 0;
+}
+
+void deletionQueuePush(DeletionQueue *pQueue, DeletionEntry entry)
+{
+    if(pQueue->count == pQueue->capacity)
+    {
+        growDeletionQueue(pQueue);
+    }
+
+    pQueue->entries[(pQueue->head + pQueue->count) % pQueue->capacity] = entry;
+    pQueue->count++;
+}
+
+void deleteBufferLater(DeletionQueue *pQueue, VkBuffer buffer, uint64_t value)
+{
+    deletionQueuePush(pQueue, (DeletionEntry){.type = DELETE_BUFFER, .value = value, .handle.buffer = buffer});
+}
+
+void deleteMemoryLater(DeletionQueue *pQueue, VkDeviceMemory memory, uint64_t value)
+{
+    deletionQueuePush(pQueue, (DeletionEntry){.type = DELETE_MEMORY, .value = value, .handle.memory = memory});
+}
+
+void deleteImageLater(DeletionQueue *pQueue, VkImage image, uint64_t value)
+{
+    deletionQueuePush(pQueue, (DeletionEntry){.type = DELETE_IMAGE, .value = value, .handle.image = image});
+}
+
+void deleteImageViewLater(DeletionQueue *pQueue, VkImageView imageView, uint64_t value)
+{
+    deletionQueuePush(pQueue, (DeletionEntry){.type = DELETE_IMAGE_VIEW, .value = value, .handle.imageView = imageView});
+}
+
+void deleteFramebufferLater(DeletionQueue *pQueue, VkFramebuffer framebuffer, uint64_t value)
+{
+    deletionQueuePush(pQueue, (DeletionEntry){.type = DELETE_FRAMEBUFFER, .value = value, .handle.framebuffer = framebuffer});
+}
+
+void deletePipelineLater(DeletionQueue *pQueue, VkPipeline pipeline, uint64_t value)
+{
+    deletionQueuePush(pQueue, (DeletionEntry){.type = DELETE_PIPELINE, .value = value, .handle.pipeline = pipeline});
+}
+
+void deletePipelineLayoutLater(DeletionQueue *pQueue, VkPipelineLayout pipelineLayout, uint64_t value)
+{
+    deletionQueuePush(pQueue, (DeletionEntry){.type = DELETE_PIPELINE_LAYOUT, .value = value, .handle.pipelineLayout = pipelineLayout});
+}
+
+void deleteSwapChainLater(DeletionQueue *pQueue, VkSwapchainKHR swapChain, uint64_t value)
+{
+    deletionQueuePush(pQueue, (DeletionEntry){.type = DELETE_SWAPCHAIN, .value = value, .handle.swapChain = swapChain});
+}
+
+void deleteCommandBufferLater(DeletionQueue *pQueue, VkCommandPool pool, VkCommandBuffer commandBuffer, uint64_t value)
+{
+    deletionQueuePush(pQueue, (DeletionEntry){.type = DELETE_COMMAND_BUFFER, .value = value, .handle.command = {pool, commandBuffer}});
+}
+
+void deleteLater(DeletionQueue *pQueue, DeletionCallback function, void *pData, uint64_t value)//For anything without a dedicated entry, including host memory that has to outlive the GPU work
+{
+    deletionQueuePush(pQueue, (DeletionEntry){.type = DELETE_CALLBACK, .value = value, .handle.callback = {function, pData}});
+}
+
+static void destroyEntry(VkDevice device, DeletionEntry *pEntry)
+{
+    switch(pEntry->type)
+    {
+        case DELETE_BUFFER:
+            vkDestroyBuffer(device, pEntry->handle.buffer, NULL);
+            break;
+        case DELETE_MEMORY:
+            vkFreeMemory(device, pEntry->handle.memory, NULL);
+            break;
+        case DELETE_IMAGE:
+            vkDestroyImage(device, pEntry->handle.image, NULL);
+            break;
+        case DELETE_IMAGE_VIEW:
+            vkDestroyImageView(device, pEntry->handle.imageView, NULL);
+            break;
+        case DELETE_FRAMEBUFFER:
+            vkDestroyFramebuffer(device, pEntry->handle.framebuffer, NULL);
+            break;
+        case DELETE_PIPELINE:
+            vkDestroyPipeline(device, pEntry->handle.pipeline, NULL);
+            break;
+        case DELETE_PIPELINE_LAYOUT:
+            vkDestroyPipelineLayout(device, pEntry->handle.pipelineLayout, NULL);
+            break;
+        case DELETE_SWAPCHAIN:
+            vkDestroySwapchainKHR(device, pEntry->handle.swapChain, NULL);
+            break;
+        case DELETE_COMMAND_BUFFER:
+            vkFreeCommandBuffers(device, pEntry->handle.command.pool, 1, &pEntry->handle.command.commandBuffer);
+            break;
+        case DELETE_CALLBACK:
+            pEntry->handle.callback.function(device, pEntry->handle.callback.pData);
+            break;
+    }
+}
+
+uint32_t deletionQueueDrain(DeletionQueue *pQueue, VkDevice device, uint64_t completedValue, uint32_t maxDeletions)//Destroys up to maxDeletions entries the GPU is done with, 0 for no limit. Returns how many were destroyed
+{
+    uint32_t deleted = 0;
+    while(pQueue->count > 0 && (maxDeletions == 0 || deleted < maxDeletions))
+    {
+        DeletionEntry *pEntry = &pQueue->entries[pQueue->head];
+        if(pEntry->value > completedValue)//Values never decrease, nothing behind this entry is ready either
+        {
+            break;
+        }
+
+        destroyEntry(device, pEntry);
+        pQueue->head = (pQueue->head + 1) % pQueue->capacity;
+        pQueue->count--;
+        deleted++;
+    }
+    return deleted;
+}
+
+void deletionQueueFlush(DeletionQueue *pQueue, VkDevice device)//Only valid once the device is idle
+{
+    deletionQueueDrain(pQueue, device, UINT64_MAX, 0);
+}
+
+void destroyDeletionQueue(DeletionQueue *pQueue, VkDevice device)
+{
+    deletionQueueFlush(pQueue, device);
+    free(pQueue->entries);
+}
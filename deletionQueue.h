@@ -0,0 +1,89 @@
+//
+//  deletionQueue.h
+//  vkProject
+//
+//  Defers destruction of Vulkan objects until the GPU has passed a frame value.
+//
+
+#ifndef deletionQueue_h
+#define deletionQueue_h
+
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+
+enum deletionType {
+    DELETE_BUFFER,
+    DELETE_MEMORY,
+    DELETE_IMAGE,
+    DELETE_IMAGE_VIEW,
+    DELETE_FRAMEBUFFER,
+    DELETE_PIPELINE,
+    DELETE_PIPELINE_LAYOUT,
+    DELETE_SWAPCHAIN,
+    DELETE_COMMAND_BUFFER,
+    DELETE_CALLBACK
+};
+
+typedef void (*DeletionCallback)(VkDevice device, void *pData);
+
+typedef struct {
+    uint32_t type;
+    uint64_t value;//Safe to destroy once the GPU has completed this frame value
+    union {
+        VkBuffer buffer;
+        VkDeviceMemory memory;
+        VkImage image;
+        VkImageView imageView;
+        VkFramebuffer framebuffer;
+        VkPipeline pipeline;
+        VkPipelineLayout pipelineLayout;
+        VkSwapchainKHR swapChain;
+        struct {
+            VkCommandPool pool;
+            VkCommandBuffer commandBuffer;
+        } command;
+        struct {
+            DeletionCallback function;
+            void *pData;
+        } callback;
+    } handle;
+} DeletionEntry;
+
+typedef struct {
+    DeletionEntry *entries;//Ring buffer, entries are pushed with non-decreasing values
+    uint32_t capacity;
+    uint32_t head;
+    uint32_t count;
+} DeletionQueue;
+
+void createDeletionQueue(DeletionQueue *pQueue, uint32_t capacity);
+
+void deletionQueuePush(DeletionQueue *pQueue, DeletionEntry entry);
+
+void deleteBufferLater(DeletionQueue *pQueue, VkBuffer buffer, uint64_t value);
+
+void deleteMemoryLater(DeletionQueue *pQueue, VkDeviceMemory memory, uint64_t value);
+
+void deleteImageLater(DeletionQueue *pQueue, VkImage image, uint64_t value);
+
+void deleteImageViewLater(DeletionQueue *pQueue, VkImageView imageView, uint64_t value);
+
+void deleteFramebufferLater(DeletionQueue *pQueue, VkFramebuffer framebuffer, uint64_t value);
+
+void deletePipelineLater(DeletionQueue *pQueue, VkPipeline pipeline, uint64_t value);
+
+void deletePipelineLayoutLater(DeletionQueue *pQueue, VkPipelineLayout pipelineLayout, uint64_t value);
+
+void deleteSwapChainLater(DeletionQueue *pQueue, VkSwapchainKHR swapChain, uint64_t value);
+
+void deleteCommandBufferLater(DeletionQueue *pQueue, VkCommandPool pool, VkCommandBuffer commandBuffer, uint64_t value);
+
+void deleteLater(DeletionQueue *pQueue, DeletionCallback function, void *pData, uint64_t value);
+
+uint32_t deletionQueueDrain(DeletionQueue *pQueue, VkDevice device, uint64_t completedValue, uint32_t maxDeletions);
+
+void deletionQueueFlush(DeletionQueue *pQueue, VkDevice device);
+
+void destroyDeletionQueue(DeletionQueue *pQueue, VkDevice device);
+
+#endif /* deletionQueue_h */
@@ -0,0 +1,314 @@
+//
+//  descriptorAllocator.c
+//  vkProject
+//
+//  Growable descriptor pools per set layout, and a bindless table of buffers and images indexed from push constants.
+//
+
+#include "descriptorAllocator.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void createDescriptorAllocator(DescriptorAllocator *pAllocator, VkDescriptorSetLayout layout, const VkDescriptorSetLayoutBinding *bindings, uint32_t bindingCount)//Pools are sized from the layout, so they only ever serve sets of that layout
+{
+    memset(pAllocator, 0, sizeof(DescriptorAllocator));
+    pAllocator->layout = layout;
+    pAllocator->setsPerPool = DESCRIPTOR_POOL_INITIAL_SETS;
+
+    for(uint32_t i = 0; i < bindingCount; i++)
+    {
+        uint32_t size = 0;
+        while(size < pAllocator->sizeCount && pAllocator->sizesPerSet[size].type != bindings[i].descriptorType)
+        {
+            size++;
+        }
+        if(size == DESCRIPTOR_MAX_POOL_SIZES)
+        {
+            printf("Too many descriptor types in one set layout!\n");
+            exit(1);
+        }
+        if(size == pAllocator->sizeCount)
+        {
+            pAllocator->sizesPerSet[size] = (VkDescriptorPoolSize){bindings[i].descriptorType, 0};
+            pAllocator->sizeCount++;
+        }
+        pAllocator->sizesPerSet[size].descriptorCount += bindings[i].descriptorCount;
+    }
+}
+
+static void addDescriptorPool(DescriptorAllocator *pAllocator, VkDevice device)
+{
+    if(pAllocator->poolCount == pAllocator->poolCapacity)
+    {
+        pAllocator->poolCapacity = pAllocator->poolCapacity ? 2 * pAllocator->poolCapacity : 4;
+        pAllocator->pools = realloc(pAllocator->pools, sizeof(VkDescriptorPool) * pAllocator->poolCapacity);
+        if(pAllocator->pools == NULL)
+        {
+            printf("Failed to allocate descriptor pool list!\n");
+            exit(1);
+        }
+    }
+
+    VkDescriptorPoolSize poolSizes[DESCRIPTOR_MAX_POOL_SIZES];
+    for(uint32_t i = 0; i < pAllocator->sizeCount; i++)
+    {
+        poolSizes[i].type = pAllocator->sizesPerSet[i].type;
+        poolSizes[i].descriptorCount = pAllocator->sizesPerSet[i].descriptorCount * pAllocator->setsPerPool;
+    }
+
+    VkDescriptorPoolCreateInfo poolInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .flags = 0,//Sets are never freed one by one, the whole pool is reset
+        .maxSets = pAllocator->setsPerPool,
+        .poolSizeCount = pAllocator->sizeCount,
+        .pPoolSizes = poolSizes
+    };
+
+    if(vkCreateDescriptorPool(device, &poolInfo, NULL, &pAllocator->pools[pAllocator->poolCount]) != VK_SUCCESS)
+    {
+        printf("Failed to create descriptor pool!\n");
+        exit(1);
+    }
+    pAllocator->poolCount++;
+
+    pAllocator->setsPerPool = 2 * pAllocator->setsPerPool < DESCRIPTOR_POOL_MAX_SETS ? 2 * pAllocator->setsPerPool : DESCRIPTOR_POOL_MAX_SETS;
+}
+
+VkDescriptorSet descriptorAllocatorAllocate(DescriptorAllocator *pAllocator, VkDevice device)//Moves on to the next pool, or creates one, when the current pool is exhausted
+{
+    while(1)
+    {
+        uint32_t created = 0;
+        if(pAllocator->currentPool == pAllocator->poolCount)
+        {
+            addDescriptorPool(pAllocator, device);
+            created = 1;
+        }
+
+        VkDescriptorSetAllocateInfo allocInfo = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .descriptorPool = pAllocator->pools[pAllocator->currentPool],
+            .descriptorSetCount = 1,
+            .pSetLayouts = &pAllocator->layout
+        };
+
+        VkDescriptorSet set;
+        VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+        if(result == VK_SUCCESS)
+        {
+            pAllocator->allocatedSets++;
+            return set;
+        }
+
+        if((result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) || created)//A fresh pool that cannot hold one set never will
+        {
+            printf("Failed to allocate descriptor set!\n");
+            exit(1);
+        }
+        pAllocator->currentPool++;
+    }
+}
+
+void resetDescriptorAllocator(DescriptorAllocator *pAllocator, VkDevice device)//Only once the GPU has finished with every set allocated since the last reset
+{
+    for(uint32_t i = 0; i <= pAllocator->currentPool && i < pAllocator->poolCount; i++)
+    {
+        vkResetDescriptorPool(device, pAllocator->pools[i], 0);
+    }
+    pAllocator->currentPool = 0;
+    pAllocator->allocatedSets = 0;
+}
+
+void destroyDescriptorAllocator(DescriptorAllocator *pAllocator, VkDevice device)
+{
+    for(uint32_t i = 0; i < pAllocator->poolCount; i++)
+    {
+        vkDestroyDescriptorPool(device, pAllocator->pools[i], NULL);
+    }
+    free(pAllocator->pools);
+    memset(pAllocator, 0, sizeof(DescriptorAllocator));
+}
+
+static void initBindlessSlots(BindlessSlots *pSlots, uint32_t capacity)
+{
+    pSlots->capacity = capacity;
+    pSlots->count = 0;
+    pSlots->freeCount = 0;
+    pSlots->freeSlots = malloc(sizeof(uint32_t) * capacity);
+    if(pSlots->freeSlots == NULL)
+    {
+        printf("Failed to allocate bindless slots!\n");
+        exit(1);
+    }
+}
+
+static uint32_t takeBindlessSlot(BindlessSlots *pSlots)
+{
+    if(pSlots->freeCount > 0)
+    {
+        return pSlots->freeSlots[--pSlots->freeCount];
+    }
+    if(pSlots->count == pSlots->capacity)
+    {
+        return BINDLESS_INVALID_INDEX;
+    }
+    return pSlots->count++;
+}
+
+void createBindlessTable(BindlessTable *pTable, VkDevice device, uint32_t maxBuffers, uint32_t maxImages)//One set holding every buffer and image, written while bound and only partially filled
+{
+    memset(pTable, 0, sizeof(BindlessTable));
+    initBindlessSlots(&pTable->buffers, maxBuffers);
+    initBindlessSlots(&pTable->images, maxImages);
+
+    VkDescriptorSetLayoutBinding bindings[2] = {
+        {
+            .binding = BINDLESS_BUFFER_BINDING,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = maxBuffers,
+            .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT
+        },
+        {
+            .binding = BINDLESS_IMAGE_BINDING,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = maxImages,
+            .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
+        }
+    };
+
+    VkDescriptorBindingFlags bindingFlags[2] = {
+        VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT,
+        VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT
+    };
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+        .bindingCount = 2,
+        .pBindingFlags = bindingFlags
+    };
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = &bindingFlagsInfo,
+        .flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+        .bindingCount = 2,
+        .pBindings = bindings
+    };
+
+    if(vkCreateDescriptorSetLayout(device, &layoutInfo, NULL, &pTable->layout) != VK_SUCCESS)
+    {
+        printf("Failed to create bindless descriptor set layout!\n");
+        exit(1);
+    }
+
+    VkDescriptorPoolSize poolSizes[2] = {
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, maxBuffers},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, maxImages}
+    };
+
+    VkDescriptorPoolCreateInfo poolInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+        .maxSets = 1,
+        .poolSizeCount = 2,
+        .pPoolSizes = poolSizes
+    };
+
+    if(vkCreateDescriptorPool(device, &poolInfo, NULL, &pTable->pool) != VK_SUCCESS)
+    {
+        printf("Failed to create bindless descriptor pool!\n");
+        exit(1);
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = pTable->pool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &pTable->layout
+    };
+
+    if(vkAllocateDescriptorSets(device, &allocInfo, &pTable->set) != VK_SUCCESS)
+    {
+        printf("Failed to allocate bindless descriptor set!\n");
+        exit(1);
+    }
+}
+
+uint32_t bindlessAddBuffer(BindlessTable *pTable, VkDevice device, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)//Returns the array index to push, the buffer needs storage buffer usage
+{
+    uint32_t index = takeBindlessSlot(&pTable->buffers);
+    if(index == BINDLESS_INVALID_INDEX)
+    {
+        printf("Bindless buffer table is full!\n");
+        exit(1);
+    }
+
+    VkDescriptorBufferInfo bufferInfo = {
+        .buffer = buffer,
+        .offset = offset,
+        .range = range
+    };
+
+    VkWriteDescriptorSet write = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = pTable->set,
+        .dstBinding = BINDLESS_BUFFER_BINDING,
+        .dstArrayElement = index,
+        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .descriptorCount = 1,
+        .pBufferInfo = &bufferInfo
+    };
+
+    vkUpdateDescriptorSets(device, 1, &write, 0, NULL);
+    return index;
+}
+
+uint32_t bindlessAddImage(BindlessTable *pTable, VkDevice device, VkImageView imageView, VkSampler sampler)//The image must be in shader read only layout when sampled
+{
+    uint32_t index = takeBindlessSlot(&pTable->images);
+    if(index == BINDLESS_INVALID_INDEX)
+    {
+        printf("Bindless image table is full!\n");
+        exit(1);
+    }
+
+    VkDescriptorImageInfo imageInfo = {
+        .sampler = sampler,
+        .imageView = imageView,
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+    };
+
+    VkWriteDescriptorSet write = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = pTable->set,
+        .dstBinding = BINDLESS_IMAGE_BINDING,
+        .dstArrayElement = index,
+        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .descriptorCount = 1,
+        .pImageInfo = &imageInfo
+    };
+
+    vkUpdateDescriptorSets(device, 1, &write, 0, NULL);
+    return index;
+}
+
+void bindlessReleaseBuffer(BindlessTable *pTable, uint32_t index)//Only once no frame in flight can still index the slot, e.g. from a deletion queue callback
+{
+    pTable->buffers.freeSlots[pTable->buffers.freeCount++] = index;
+}
+
+void bindlessReleaseImage(BindlessTable *pTable, uint32_t index)
+{
+    pTable->images.freeSlots[pTable->images.freeCount++] = index;
+}
+
+void destroyBindlessTable(BindlessTable *pTable, VkDevice device)
+{
+    vkDestroyDescriptorPool(device, pTable->pool, NULL);
+    vkDestroyDescriptorSetLayout(device, pTable->layout, NULL);
+    free(pTable->buffers.freeSlots);
+    free(pTable->images.freeSlots);
+    memset(pTable, 0, sizeof(BindlessTable));
+}
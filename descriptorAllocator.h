@@ -0,0 +1,76 @@
+//
+//  descriptorAllocator.h
+//  vkProject
+//
+//  Growable descriptor pools per set layout, and a bindless table of buffers and images indexed from push constants.
+//
+
+#ifndef descriptorAllocator_h
+#define descriptorAllocator_h
+
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+
+#define DESCRIPTOR_POOL_INITIAL_SETS 16
+#define DESCRIPTOR_POOL_MAX_SETS 4096//Each new pool doubles the sets of the previous one up to this
+#define DESCRIPTOR_MAX_POOL_SIZES 8
+
+#define BINDLESS_MAX_BUFFERS 1024//Clamped to the device update-after-bind limits
+#define BINDLESS_MAX_IMAGES 4096
+#define BINDLESS_BUFFER_BINDING 0
+#define BINDLESS_IMAGE_BINDING 1
+#define BINDLESS_INVALID_INDEX UINT32_MAX
+
+typedef struct {
+    VkDescriptorSetLayout layout;
+    VkDescriptorPoolSize sizesPerSet[DESCRIPTOR_MAX_POOL_SIZES];//Descriptors of each type one set of the layout needs
+    uint32_t sizeCount;
+    VkDescriptorPool *pools;
+    uint32_t poolCount;
+    uint32_t poolCapacity;
+    uint32_t currentPool;//Pools before this one ran out since the last reset
+    uint32_t setsPerPool;//Of the next pool created
+    uint32_t allocatedSets;//Since the last reset
+} DescriptorAllocator;
+
+typedef struct {
+    uint32_t uniformIndex;//Slot of the frame uniforms in the bindless buffer array
+    uint32_t textureIndex;//Slot in the bindless image array
+} BindlessPushConstants;
+
+typedef struct {
+    uint32_t capacity;
+    uint32_t count;//Slots handed out so far, released slots are reused first
+    uint32_t *freeSlots;
+    uint32_t freeCount;
+} BindlessSlots;
+
+typedef struct {
+    VkDescriptorSetLayout layout;
+    VkDescriptorPool pool;
+    VkDescriptorSet set;//Bound once per command buffer, every draw indexes into it
+    BindlessSlots buffers;
+    BindlessSlots images;
+} BindlessTable;
+
+void createDescriptorAllocator(DescriptorAllocator *pAllocator, VkDescriptorSetLayout layout, const VkDescriptorSetLayoutBinding *bindings, uint32_t bindingCount);
+
+VkDescriptorSet descriptorAllocatorAllocate(DescriptorAllocator *pAllocator, VkDevice device);
+
+void resetDescriptorAllocator(DescriptorAllocator *pAllocator, VkDevice device);
+
+void destroyDescriptorAllocator(DescriptorAllocator *pAllocator, VkDevice device);
+
+void createBindlessTable(BindlessTable *pTable, VkDevice device, uint32_t maxBuffers, uint32_t maxImages);
+
+uint32_t bindlessAddBuffer(BindlessTable *pTable, VkDevice device, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+
+uint32_t bindlessAddImage(BindlessTable *pTable, VkDevice device, VkImageView imageView, VkSampler sampler);
+
+void bindlessReleaseBuffer(BindlessTable *pTable, uint32_t index);
+
+void bindlessReleaseImage(BindlessTable *pTable, uint32_t index);
+
+void destroyBindlessTable(BindlessTable *pTable, VkDevice device);
+
+#endif /* descriptorAllocator_h */
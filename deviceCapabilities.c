@@ -0,0 +1,128 @@
+//
+//  deviceCapabilities.c
+//  vkProject
+//
+//  Snapshot of everything queried from a physical device and its surface.
+//
+
+#include "deviceCapabilities.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void *allocOrExit(size_t size)
+{
+    void *pMemory = malloc(size ? size : 1);//Zero counts still get a valid pointer, so freeing stays uniform
+    if(pMemory == NULL)
+    {
+        printf("Failed to allocate device capabilities!\n");
+        exit(1);
+    }
+    return pMemory;
+}
+
+void queryDeviceCapabilities(DeviceCapabilities *pCapabilities, VkPhysicalDevice physicalDevice, VkSurfaceKHR surface)
+{
+    memset(pCapabilities, 0, sizeof(DeviceCapabilities));
+    pCapabilities->physicalDevice = physicalDevice;
+
+    vkGetPhysicalDeviceProperties(physicalDevice, &pCapabilities->properties);
+    vkGetPhysicalDeviceFeatures(physicalDevice, &pCapabilities->features);
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &pCapabilities->memoryProperties);
+
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &pCapabilities->queueFamilyCount, NULL);
+    pCapabilities->queueFamilies = allocOrExit(sizeof(VkQueueFamilyProperties) * pCapabilities->queueFamilyCount);
+    pCapabilities->presentSupport = allocOrExit(sizeof(VkBool32) * pCapabilities->queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &pCapabilities->queueFamilyCount, pCapabilities->queueFamilies);
+
+    for(uint32_t i = 0; i < pCapabilities->queueFamilyCount; i++)
+    {
+        pCapabilities->presentSupport[i] = VK_FALSE;
+        vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &pCapabilities->presentSupport[i]);
+    }
+
+    vkEnumerateDeviceExtensionProperties(physicalDevice, NULL, &pCapabilities->extensionCount, NULL);
+    pCapabilities->extensions = allocOrExit(sizeof(VkExtensionProperties) * pCapabilities->extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, NULL, &pCapabilities->extensionCount, pCapabilities->extensions);
+
+    if(pCapabilities->properties.apiVersion >= VK_API_VERSION_1_1)//vkGetPhysicalDeviceFeatures2 is core from 1.1
+    {
+        uint32_t hasTimeline = deviceHasExtension(pCapabilities, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+        uint32_t hasIndexing = deviceHasExtension(pCapabilities, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) && deviceHasExtension(pCapabilities, VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+
+        VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR
+        };
+
+        VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT,
+            .pNext = hasTimeline ? &timelineFeatures : NULL
+        };
+
+        VkPhysicalDeviceFeatures2 features = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+            .pNext = hasIndexing ? (void *)&indexingFeatures : (hasTimeline ? (void *)&timelineFeatures : NULL)
+        };
+
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+        pCapabilities->timelineSemaphore = hasTimeline && timelineFeatures.timelineSemaphore == VK_TRUE;
+        pCapabilities->descriptorIndexing = hasIndexing && indexingFeatures.runtimeDescriptorArray && indexingFeatures.descriptorBindingPartiallyBound &&
+                                            indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind && indexingFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+                                            indexingFeatures.shaderSampledImageArrayNonUniformIndexing;
+
+        if(pCapabilities->descriptorIndexing)
+        {
+            VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties = {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT
+            };
+
+            VkPhysicalDeviceProperties2 properties = {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+                .pNext = &indexingProperties
+            };
+
+            vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+            pCapabilities->maxBindlessBuffers = indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers < indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers ? indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers : indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers;
+            pCapabilities->maxBindlessImages = indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages < indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages ? indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages : indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages;
+        }
+    }
+
+    pCapabilities->memoryBudget = pCapabilities->properties.apiVersion >= VK_API_VERSION_1_1 && deviceHasExtension(pCapabilities, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &pCapabilities->surfaceCapabilities);
+
+    vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface, &pCapabilities->formatCount, NULL);
+    pCapabilities->formats = allocOrExit(sizeof(VkSurfaceFormatKHR) * pCapabilities->formatCount);
+    vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface, &pCapabilities->formatCount, pCapabilities->formats);
+
+    vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &pCapabilities->presentModeCount, NULL);
+    pCapabilities->presentModes = allocOrExit(sizeof(VkPresentModeKHR) * pCapabilities->presentModeCount);
+    vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &pCapabilities->presentModeCount, pCapabilities->presentModes);
+}
+
+void refreshSurfaceCapabilities(DeviceCapabilities *pCapabilities, VkSurfaceKHR surface)//Formats and present modes stay fixed for a surface, only the extent and transform follow the window
+{
+    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(pCapabilities->physicalDevice, surface, &pCapabilities->surfaceCapabilities);
+}
+
+uint32_t deviceHasExtension(DeviceCapabilities *pCapabilities, const char *extensionName)
+{
+    for(uint32_t i = 0; i < pCapabilities->extensionCount; i++)
+    {
+        if(strcmp(pCapabilities->extensions[i].extensionName, extensionName) == 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void freeDeviceCapabilities(DeviceCapabilities *pCapabilities)
+{
+    free(pCapabilities->queueFamilies);
+    free(pCapabilities->presentSupport);
+    free(pCapabilities->extensions);
+    free(pCapabilities->formats);
+    free(pCapabilities->presentModes);
+}
@@ -0,0 +1,47 @@
+//
+//  deviceCapabilities.h
+//  vkProject
+//
+//  Snapshot of everything queried from a physical device and its surface.
+//
+
+#ifndef deviceCapabilities_h
+#define deviceCapabilities_h
+
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+
+typedef struct {
+    VkPhysicalDevice physicalDevice;
+    VkPhysicalDeviceProperties properties;//Includes the device limits
+    VkPhysicalDeviceFeatures features;
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+
+    uint32_t queueFamilyCount;
+    VkQueueFamilyProperties *queueFamilies;
+    VkBool32 *presentSupport;//Per queue family, for the surface the snapshot was taken with
+
+    uint32_t extensionCount;
+    VkExtensionProperties *extensions;
+    uint32_t timelineSemaphore;//Extension and feature both present
+    uint32_t memoryBudget;//VK_EXT_memory_budget, queried through vkGetPhysicalDeviceMemoryProperties2
+    uint32_t descriptorIndexing;//VK_EXT_descriptor_indexing with partially bound, update-after-bind runtime arrays of buffers and images, images indexed non-uniformly
+    uint32_t maxBindlessBuffers;//Update-after-bind limits, only valid with descriptorIndexing
+    uint32_t maxBindlessImages;
+
+    VkSurfaceCapabilitiesKHR surfaceCapabilities;//Extent changes with the window, refreshed before each swap chain creation
+    uint32_t formatCount;
+    VkSurfaceFormatKHR *formats;
+    uint32_t presentModeCount;
+    VkPresentModeKHR *presentModes;
+} DeviceCapabilities;
+
+void queryDeviceCapabilities(DeviceCapabilities *pCapabilities, VkPhysicalDevice physicalDevice, VkSurfaceKHR surface);
+
+void refreshSurfaceCapabilities(DeviceCapabilities *pCapabilities, VkSurfaceKHR surface);
+
+uint32_t deviceHasExtension(DeviceCapabilities *pCapabilities, const char *extensionName);
+
+void freeDeviceCapabilities(DeviceCapabilities *pCapabilities);
+
+#endif /* deviceCapabilities_h */
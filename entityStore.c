@@ -0,0 +1,157 @@
+//
+//  entityStore.c
+//  vkProject
+//
+//  Entities with dense per-component arrays, addressed through generational handles.
+//
+
+#include "entityStore.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void growDense(EntityStore *pStore, uint32_t capacity)
+{
+    pStore->capacity = capacity;
+    pStore->entities = realloc(pStore->entities, sizeof(Entity) * capacity);
+    pStore->transforms = realloc(pStore->transforms, sizeof(InstanceAnimation) * capacity);
+    pStore->bounds = realloc(pStore->bounds, sizeof(EntityBounds) * capacity);
+    pStore->meshes = realloc(pStore->meshes, sizeof(uint32_t) * capacity);
+    pStore->materials = realloc(pStore->materials, sizeof(uint32_t) * capacity);
+    if(pStore->entities == NULL || pStore->transforms == NULL || pStore->bounds == NULL || pStore->meshes == NULL || pStore->materials == NULL)
+    {
+        printf("Failed to allocate entity store!\n");
+        exit(1);
+    }
+}
+
+static void growSlots(EntityStore *pStore, uint32_t capacity)
+{
+    pStore->slotCapacity = capacity;
+    pStore->denseIndices = realloc(pStore->denseIndices, sizeof(uint32_t) * capacity);
+    pStore->generations = realloc(pStore->generations, capacity);
+    if(pStore->denseIndices == NULL || pStore->generations == NULL)
+    {
+        printf("Failed to allocate entity slots!\n");
+        exit(1);
+    }
+}
+
+void createEntityStore(EntityStore *pStore, uint32_t capacity, JobSystem *pJobs)
+{
+    memset(pStore, 0, sizeof(EntityStore));
+    pStore->pJobs = pJobs;
+    growDense(pStore, capacity ? capacity : 64);
+    growSlots(pStore, capacity ? capacity : 64);
+}
+
+Entity createEntity(EntityStore *pStore)//Components start zeroed, the caller fills them in through the dense index
+{
+    uint32_t slot = pStore->freeSlot;
+    if(slot == pStore->slotCount)//Free list empty
+    {
+        if(pStore->slotCount > ENTITY_INDEX_MASK)
+        {
+            printf("At most %u entities can exist at once!\n", ENTITY_INDEX_MASK + 1);
+            exit(1);
+        }
+        if(pStore->slotCount == pStore->slotCapacity)
+        {
+            growSlots(pStore, 2 * pStore->slotCapacity);
+        }
+        pStore->generations[slot] = 1;
+        pStore->slotCount++;
+        pStore->freeSlot = pStore->slotCount;
+    }
+    else
+    {
+        pStore->freeSlot = pStore->denseIndices[slot];
+    }
+
+    if(pStore->count == pStore->capacity)
+    {
+        growDense(pStore, 2 * pStore->capacity);
+    }
+
+    uint32_t dense = pStore->count++;
+    Entity entity = ((Entity)pStore->generations[slot] << ENTITY_INDEX_BITS) | slot;
+    pStore->denseIndices[slot] = dense;
+    pStore->entities[dense] = entity;
+    memset(&pStore->transforms[dense], 0, sizeof(InstanceAnimation));
+    memset(&pStore->bounds[dense], 0, sizeof(EntityBounds));
+    pStore->meshes[dense] = 0;
+    pStore->materials[dense] = 0;
+    return entity;
+}
+
+uint32_t entityDenseIndex(const EntityStore *pStore, Entity entity)//UINT32_MAX once the entity has been destroyed, dense indices change when others are
+{
+    uint32_t slot = entity & ENTITY_INDEX_MASK;
+    if(slot >= pStore->slotCount || pStore->generations[slot] != entity >> ENTITY_INDEX_BITS)
+    {
+        return UINT32_MAX;
+    }
+    return pStore->denseIndices[slot];
+}
+
+void destroyEntity(EntityStore *pStore, Entity entity)//Moves the last entity into the hole, so the arrays stay dense but their order is not kept
+{
+    uint32_t dense = entityDenseIndex(pStore, entity);
+    if(dense == UINT32_MAX)
+    {
+        printf("Destroyed a stale entity handle!\n");
+        exit(1);
+    }
+
+    uint32_t last = --pStore->count;
+    if(dense != last)
+    {
+        Entity moved = pStore->entities[last];
+        pStore->entities[dense] = moved;
+        pStore->transforms[dense] = pStore->transforms[last];
+        pStore->bounds[dense] = pStore->bounds[last];
+        pStore->meshes[dense] = pStore->meshes[last];
+        pStore->materials[dense] = pStore->materials[last];
+        pStore->denseIndices[moved & ENTITY_INDEX_MASK] = dense;
+    }
+
+    uint32_t slot = entity & ENTITY_INDEX_MASK;
+    uint8_t generation = pStore->generations[slot] + 1;
+    pStore->generations[slot] = generation ? generation : 1;//Skips zero so no handle ever equals ENTITY_NONE
+    pStore->denseIndices[slot] = pStore->freeSlot;
+    pStore->freeSlot = slot;
+}
+
+static void chunkJob(void *pData, uint32_t chunk)
+{
+    EntityStore *pStore = pData;
+    uint32_t first = chunk * ENTITY_CHUNK;
+    uint32_t last = first + ENTITY_CHUNK < pStore->chunkCount ? first + ENTITY_CHUNK : pStore->chunkCount;
+    pStore->chunkFunction(pStore->pChunkData, first, last);
+}
+
+void entityStoreForEachChunk(EntityStore *pStore, uint32_t count, EntityChunkFunction function, void *pData)//Calls function on consecutive ranges of [0, count), in parallel when there are enough, and returns once all are done. count is the entity count or the length of a list of dense indices the function looks up
+{
+    if(pStore->pJobs == NULL || pStore->pJobs->threadCount == 0 || count < ENTITY_PARALLEL_THRESHOLD)
+    {
+        function(pData, 0, count);
+        return;
+    }
+
+    pStore->chunkFunction = function;
+    pStore->pChunkData = pData;
+    pStore->chunkCount = count;
+    jobSystemRun(pStore->pJobs, (count + ENTITY_CHUNK - 1) / ENTITY_CHUNK, chunkJob, pStore);
+}
+
+void destroyEntityStore(EntityStore *pStore)
+{
+    free(pStore->entities);
+    free(pStore->transforms);
+    free(pStore->bounds);
+    free(pStore->meshes);
+    free(pStore->materials);
+    free(pStore->denseIndices);
+    free(pStore->generations);
+}
@@ -0,0 +1,64 @@
+//
+//  entityStore.h
+//  vkProject
+//
+//  Entities with dense per-component arrays, addressed through generational handles.
+//
+
+#ifndef entityStore_h
+#define entityStore_h
+
+#include <stdint.h>
+#include "jobSystem.h"
+#include "transformStage.h"
+
+#define ENTITY_INDEX_BITS 24//Low bits of a handle pick the slot, the rest hold its generation
+#define ENTITY_INDEX_MASK ((1u << ENTITY_INDEX_BITS) - 1)
+#define ENTITY_NONE 0//Never handed out, generations start at one
+#define ENTITY_CHUNK 4096//Entities per job of chunked iteration
+#define ENTITY_PARALLEL_THRESHOLD 16384//Below this chunks run on the calling thread
+
+typedef uint32_t Entity;
+
+typedef struct {
+    float centre[3];//World space, follows the transform's translation
+    float radius;
+} EntityBounds;
+
+typedef void (*EntityChunkFunction)(void *pData, uint32_t first, uint32_t last);
+
+typedef struct {
+    uint32_t count;//Live entities, dense arrays hold them in [0, count)
+    uint32_t capacity;
+
+    Entity *entities;//Handle of each dense element
+    InstanceAnimation *transforms;//Rest transform and spin, laid out as the transform stage uploads them
+    EntityBounds *bounds;
+    uint32_t *meshes;//Index of the mesh drawn
+    uint32_t *materials;//Index of the texture attributes sampled
+
+    uint32_t *denseIndices;//Per slot, the dense element of a live entity or the next free slot of a dead one
+    uint8_t *generations;//Per slot, bumped whenever its entity is destroyed so stale handles stop resolving
+    uint32_t slotCount;
+    uint32_t slotCapacity;
+    uint32_t freeSlot;//Head of the free list, slotCount when empty
+
+    JobSystem *pJobs;
+    EntityChunkFunction chunkFunction;//Of the running chunked iteration
+    void *pChunkData;
+    uint32_t chunkCount;
+} EntityStore;
+
+void createEntityStore(EntityStore *pStore, uint32_t capacity, JobSystem *pJobs);
+
+Entity createEntity(EntityStore *pStore);
+
+uint32_t entityDenseIndex(const EntityStore *pStore, Entity entity);
+
+void destroyEntity(EntityStore *pStore, Entity entity);
+
+void entityStoreForEachChunk(EntityStore *pStore, uint32_t count, EntityChunkFunction function, void *pData);
+
+void destroyEntityStore(EntityStore *pStore);
+
+#endif /* entityStore_h */
@@ -0,0 +1,238 @@
+//
+//  frameSync.c
+//  vkProject
+//
+//  Frame pacing with a timeline semaphore, falling back to per-frame fences.
+//
+
+#include "frameSync.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void createFrameSync(FrameSync *pSync, VkDevice device, VkQueue queue, uint32_t framesInFlight, uint32_t useTimeline)
+{
+    memset(pSync, 0, sizeof(FrameSync));
+
+    pSync->framesInFlight = framesInFlight;
+    pSync->queue = queue;
+    pSync->imageAvailableSemaphores = malloc(sizeof(VkSemaphore) * framesInFlight);
+    pSync->renderFinishedSemaphores = malloc(sizeof(VkSemaphore) * framesInFlight);
+    pSync->frameValues = calloc(framesInFlight, sizeof(uint64_t));
+
+    VkSemaphoreCreateInfo semaphoreInfo = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO
+    };
+
+    for(uint32_t i = 0; i < framesInFlight; i++)
+    {
+        if(vkCreateSemaphore(device, &semaphoreInfo, NULL, &pSync->imageAvailableSemaphores[i]) != VK_SUCCESS ||
+        vkCreateSemaphore(device, &semaphoreInfo, NULL, &pSync->renderFinishedSemaphores[i]) != VK_SUCCESS){
+            printf("Failed to create sync objects!");
+            exit(1);
+        }
+    }
+
+    if(useTimeline)
+    {
+        pSync->waitSemaphores = (PFN_vkWaitSemaphoresKHR)vkGetDeviceProcAddr(device, "vkWaitSemaphoresKHR");
+        pSync->getSemaphoreCounterValue = (PFN_vkGetSemaphoreCounterValueKHR)vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValueKHR");
+    }
+
+    if(pSync->waitSemaphores != NULL && pSync->getSemaphoreCounterValue != NULL)
+    {
+        VkSemaphoreTypeCreateInfoKHR typeInfo = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR,
+            .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR,
+            .initialValue = 0
+        };
+
+        VkSemaphoreCreateInfo timelineInfo = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+            .pNext = &typeInfo
+        };
+
+        if(vkCreateSemaphore(device, &timelineInfo, NULL, &pSync->timeline) != VK_SUCCESS)
+        {
+            printf("Failed to create timeline semaphore!");
+            exit(1);
+        }
+
+        pSync->timelineEnabled = 1;
+        printf("Frame pacing: timeline semaphore, %u frames in flight\n", framesInFlight);
+        return;
+    }
+
+    pSync->inFlightFences = malloc(sizeof(VkFence) * framesInFlight);
+
+    VkFenceCreateInfo fenceInfo = {
+        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+        .flags = VK_FENCE_CREATE_SIGNALED_BIT
+    };
+
+    for(uint32_t i = 0; i < framesInFlight; i++)
+    {
+        if(vkCreateFence(device, &fenceInfo, NULL, &pSync->inFlightFences[i]) != VK_SUCCESS)
+        {
+            printf("Failed to create sync objects!");
+            exit(1);
+        }
+    }
+
+    printf("Frame pacing: fences, %u frames in flight\n", framesInFlight);
+}
+
+void frameSyncWaitFrame(FrameSync *pSync, VkDevice device, uint32_t slot)//Blocks until the previous frame that used this slot has finished on the GPU
+{
+    if(pSync->timelineEnabled)
+    {
+        frameSyncWaitValue(pSync, device, pSync->frameValues[slot]);
+        return;
+    }
+
+    vkWaitForFences(device, 1, &pSync->inFlightFences[slot], VK_TRUE, UINT64_MAX);
+    if(pSync->frameValues[slot] > pSync->completedValue)//A signalled fence also covers everything submitted before it on the queue
+    {
+        pSync->completedValue = pSync->frameValues[slot];
+    }
+}
+
+VkResult frameSyncSubmitFrame(FrameSync *pSync, VkDevice device, VkSubmitInfo *pSubmitInfo, uint32_t slot)//Submits the frame's command buffer, signalling the slot's binary semaphore and the next frame value
+{
+    pSync->frameValues[slot] = ++pSync->submittedValue;
+
+    if(!pSync->timelineEnabled)
+    {
+        vkResetFences(device, 1, &pSync->inFlightFences[slot]);//Only reset right before submitting, returning early would otherwise leave it unsignalled
+        return vkQueueSubmit(pSync->queue, 1, pSubmitInfo, pSync->inFlightFences[slot]);
+    }
+
+    VkSemaphore signalSemaphores[pSubmitInfo->signalSemaphoreCount + 1];
+    uint64_t signalValues[pSubmitInfo->signalSemaphoreCount + 1];
+    for(uint32_t i = 0; i < pSubmitInfo->signalSemaphoreCount; i++)
+    {
+        signalSemaphores[i] = pSubmitInfo->pSignalSemaphores[i];
+        signalValues[i] = 0;//Ignored for binary semaphores
+    }
+    signalSemaphores[pSubmitInfo->signalSemaphoreCount] = pSync->timeline;
+    signalValues[pSubmitInfo->signalSemaphoreCount] = pSync->submittedValue;
+
+    uint64_t waitValues[pSubmitInfo->waitSemaphoreCount + 1];
+    memset(waitValues, 0, sizeof(waitValues));
+
+    VkTimelineSemaphoreSubmitInfoKHR timelineInfo = {
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR,
+        .pNext = pSubmitInfo->pNext,
+        .waitSemaphoreValueCount = pSubmitInfo->waitSemaphoreCount,
+        .pWaitSemaphoreValues = waitValues,
+        .signalSemaphoreValueCount = pSubmitInfo->signalSemaphoreCount + 1,
+        .pSignalSemaphoreValues = signalValues
+    };
+
+    VkSubmitInfo submitInfo = *pSubmitInfo;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.signalSemaphoreCount = pSubmitInfo->signalSemaphoreCount + 1;
+    submitInfo.pSignalSemaphores = signalSemaphores;
+
+    return vkQueueSubmit(pSync->queue, 1, &submitInfo, VK_NULL_HANDLE);
+}
+
+uint64_t frameSyncSubmit(FrameSync *pSync, VkSubmitInfo *pSubmitInfo)//Submits work outside of a frame, such as uploads, and returns the value that marks its completion
+{
+    uint64_t value = ++pSync->submittedValue;
+
+    if(!pSync->timelineEnabled)
+    {
+        if(vkQueueSubmit(pSync->queue, 1, pSubmitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+        {
+            printf("Failed to submit command buffer!");
+            exit(1);
+        }
+        return value;
+    }
+
+    VkTimelineSemaphoreSubmitInfoKHR timelineInfo = {
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR,
+        .pNext = pSubmitInfo->pNext,
+        .signalSemaphoreValueCount = 1,
+        .pSignalSemaphoreValues = &value
+    };
+
+    VkSubmitInfo submitInfo = *pSubmitInfo;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &pSync->timeline;
+
+    if(vkQueueSubmit(pSync->queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+    {
+        printf("Failed to submit command buffer!");
+        exit(1);
+    }
+    return value;
+}
+
+void frameSyncWaitValue(FrameSync *pSync, VkDevice device, uint64_t value)
+{
+    if(value <= pSync->completedValue)
+    {
+        return;
+    }
+
+    if(!pSync->timelineEnabled)
+    {
+        vkQueueWaitIdle(pSync->queue);//No way to wait for a single value with fences alone
+        pSync->completedValue = pSync->submittedValue;
+        return;
+    }
+
+    VkSemaphoreWaitInfoKHR waitInfo = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR,
+        .semaphoreCount = 1,
+        .pSemaphores = &pSync->timeline,
+        .pValues = &value
+    };
+
+    if(pSync->waitSemaphores(device, &waitInfo, UINT64_MAX) != VK_SUCCESS)
+    {
+        printf("Failed to wait for timeline semaphore!");
+        exit(1);
+    }
+    pSync->completedValue = value;
+}
+
+uint64_t frameSyncCompletedValue(FrameSync *pSync, VkDevice device)//Everything submitted with a value at or below this has finished executing
+{
+    if(pSync->timelineEnabled)
+    {
+        uint64_t value;
+        if(pSync->getSemaphoreCounterValue(device, pSync->timeline, &value) == VK_SUCCESS && value > pSync->completedValue)
+        {
+            pSync->completedValue = value;
+        }
+    }
+    return pSync->completedValue;
+}
+
+void destroyFrameSync(FrameSync *pSync, VkDevice device)
+{
+    for(uint32_t i = 0; i < pSync->framesInFlight; i++)
+    {
+        vkDestroySemaphore(device, pSync->imageAvailableSemaphores[i], NULL);
+        vkDestroySemaphore(device, pSync->renderFinishedSemaphores[i], NULL);
+        if(!pSync->timelineEnabled)
+        {
+            vkDestroyFence(device, pSync->inFlightFences[i], NULL);
+        }
+    }
+
+    if(pSync->timelineEnabled)
+    {
+        vkDestroySemaphore(device, pSync->timeline, NULL);
+    }
+
+    free(pSync->imageAvailableSemaphores);
+    free(pSync->renderFinishedSemaphores);
+    free(pSync->inFlightFences);
+    free(pSync->frameValues);
+}
@@ -0,0 +1,46 @@
+//
+//  frameSync.h
+//  vkProject
+//
+//  Frame pacing with a timeline semaphore, falling back to per-frame fences.
+//
+
+#ifndef frameSync_h
+#define frameSync_h
+
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+
+typedef struct {
+    uint32_t framesInFlight;
+    uint32_t timelineEnabled;
+    VkQueue queue;//Every submission that advances the frame value goes through this queue
+
+    VkSemaphore *imageAvailableSemaphores;//Binary, presentation can not use timeline semaphores
+    VkSemaphore *renderFinishedSemaphores;
+    VkFence *inFlightFences;//Only used without timeline semaphores
+
+    VkSemaphore timeline;
+    uint64_t submittedValue;//Value signalled by the most recent submission
+    uint64_t completedValue;//Highest value known to be reached by the GPU
+    uint64_t *frameValues;//Value each frame slot has to reach before it can be reused
+
+    PFN_vkWaitSemaphoresKHR waitSemaphores;
+    PFN_vkGetSemaphoreCounterValueKHR getSemaphoreCounterValue;
+} FrameSync;
+
+void createFrameSync(FrameSync *pSync, VkDevice device, VkQueue queue, uint32_t framesInFlight, uint32_t useTimeline);
+
+void frameSyncWaitFrame(FrameSync *pSync, VkDevice device, uint32_t slot);
+
+VkResult frameSyncSubmitFrame(FrameSync *pSync, VkDevice device, VkSubmitInfo *pSubmitInfo, uint32_t slot);
+
+uint64_t frameSyncSubmit(FrameSync *pSync, VkSubmitInfo *pSubmitInfo);
+
+void frameSyncWaitValue(FrameSync *pSync, VkDevice device, uint64_t value);
+
+uint64_t frameSyncCompletedValue(FrameSync *pSync, VkDevice device);
+
+void destroyFrameSync(FrameSync *pSync, VkDevice device);
+
+#endif /* frameSync_h */
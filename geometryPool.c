@@ -0,0 +1,179 @@
+//
+//  geometryPool.c
+//  vkProject
+//
+//  One vertex and one index buffer shared by every mesh, sub-allocated through free-lists.
+//
+
+#include "geometryPool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void initFreeList(FreeList *pList, uint32_t capacity)
+{
+    pList->blockCapacity = 16;
+    pList->blocks = malloc(sizeof(FreeBlock) * pList->blockCapacity);
+    if(pList->blocks == NULL)
+    {
+        printf("Failed to allocate geometry pool free list!\n");
+        exit(1);
+    }
+    pList->blocks[0] = (FreeBlock){0, capacity};
+    pList->blockCount = capacity > 0;
+    pList->capacity = capacity;
+    pList->used = 0;
+}
+
+static uint32_t freeListAllocate(FreeList *pList, uint32_t count, uint32_t *pOffset)//Best fit, so large holes survive for large meshes
+{
+    if(count == 0)
+    {
+        *pOffset = 0;
+        return 1;
+    }
+
+    uint32_t best = UINT32_MAX;
+    for(uint32_t i = 0; i < pList->blockCount; i++)
+    {
+        if(pList->blocks[i].count >= count && (best == UINT32_MAX || pList->blocks[i].count < pList->blocks[best].count))
+        {
+            best = i;
+            if(pList->blocks[i].count == count)
+            {
+                break;
+            }
+        }
+    }
+    if(best == UINT32_MAX)
+    {
+        return 0;
+    }
+
+    FreeBlock *pBlock = &pList->blocks[best];
+    *pOffset = pBlock->offset;
+    pBlock->offset += count;
+    pBlock->count -= count;
+    if(pBlock->count == 0)
+    {
+        memmove(pBlock, pBlock + 1, sizeof(FreeBlock) * (pList->blockCount - best - 1));
+        pList->blockCount--;
+    }
+    pList->used += count;
+    return 1;
+}
+
+static void freeListFree(FreeList *pList, uint32_t offset, uint32_t count)//Inserts in offset order and merges with the neighbours it touches
+{
+    if(count == 0)
+    {
+        return;
+    }
+
+    uint32_t low = 0;
+    uint32_t high = pList->blockCount;
+    while(low < high)
+    {
+        uint32_t middle = (low + high) / 2;
+        if(pList->blocks[middle].offset < offset)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    uint32_t mergesPrevious = low > 0 && pList->blocks[low - 1].offset + pList->blocks[low - 1].count == offset;
+    uint32_t mergesNext = low < pList->blockCount && offset + count == pList->blocks[low].offset;
+    if(mergesPrevious && mergesNext)
+    {
+        pList->blocks[low - 1].count += count + pList->blocks[low].count;
+        memmove(&pList->blocks[low], &pList->blocks[low + 1], sizeof(FreeBlock) * (pList->blockCount - low - 1));
+        pList->blockCount--;
+    }
+    else if(mergesPrevious)
+    {
+        pList->blocks[low - 1].count += count;
+    }
+    else if(mergesNext)
+    {
+        pList->blocks[low].offset = offset;
+        pList->blocks[low].count += count;
+    }
+    else
+    {
+        if(pList->blockCount == pList->blockCapacity)
+        {
+            pList->blockCapacity *= 2;
+            pList->blocks = realloc(pList->blocks, sizeof(FreeBlock) * pList->blockCapacity);
+            if(pList->blocks == NULL)
+            {
+                printf("Failed to allocate geometry pool free list!\n");
+                exit(1);
+            }
+        }
+        memmove(&pList->blocks[low + 1], &pList->blocks[low], sizeof(FreeBlock) * (pList->blockCount - low));
+        pList->blocks[low] = (FreeBlock){offset, count};
+        pList->blockCount++;
+    }
+    pList->used -= count;
+}
+
+static uint32_t largestFreeBlock(const FreeList *pList)
+{
+    uint32_t largest = 0;
+    for(uint32_t i = 0; i < pList->blockCount; i++)
+    {
+        largest = pList->blocks[i].count > largest ? pList->blocks[i].count : largest;
+    }
+    return largest;
+}
+
+void initGeometryPool(GeometryPool *pPool, uint32_t vertexCapacity, uint32_t vertexStride, uint32_t indexCapacity, uint32_t indexSize)//Only the bookkeeping, the owner creates the buffers
+{
+    memset(pPool, 0, sizeof(GeometryPool));
+    pPool->vertexStride = vertexStride;
+    pPool->indexSize = indexSize;
+    initFreeList(&pPool->vertices, vertexCapacity);
+    initFreeList(&pPool->indices, indexCapacity);
+}
+
+uint32_t geometryPoolAllocate(GeometryPool *pPool, uint32_t vertexCount, uint32_t indexCount, GeometryRange *pRange)//Returns 0 and allocates nothing when either buffer lacks a large enough block
+{
+    if(!freeListAllocate(&pPool->vertices, vertexCount, &pRange->firstVertex))
+    {
+        return 0;
+    }
+    if(!freeListAllocate(&pPool->indices, indexCount, &pRange->firstIndex))
+    {
+        freeListFree(&pPool->vertices, pRange->firstVertex, vertexCount);
+        return 0;
+    }
+    pRange->vertexCount = vertexCount;
+    pRange->indexCount = indexCount;
+    return 1;
+}
+
+void geometryPoolFree(GeometryPool *pPool, const GeometryRange *pRange)//Only once the GPU has finished drawing the range, e.g. from a deletion queue callback
+{
+    freeListFree(&pPool->vertices, pRange->firstVertex, pRange->vertexCount);
+    freeListFree(&pPool->indices, pRange->firstIndex, pRange->indexCount);
+}
+
+void printGeometryPool(const GeometryPool *pPool)
+{
+    printf("Geometry pool: %u/%u vertices (%u byte stride), %u/%u %u-bit indices, largest free blocks %u vertices and %u indices\n",
+           pPool->vertices.used, pPool->vertices.capacity, pPool->vertexStride, pPool->indices.used, pPool->indices.capacity, pPool->indexSize * 8,
+           largestFreeBlock(&pPool->vertices), largestFreeBlock(&pPool->indices));
+}
+
+void freeGeometryPool(GeometryPool *pPool)
+{
+    free(pPool->vertices.blocks);
+    free(pPool->indices.blocks);
+    pPool->vertices.blocks = NULL;
+    pPool->indices.blocks = NULL;
+}
@@ -0,0 +1,62 @@
+//
+//  geometryPool.h
+//  vkProject
+//
+//  One vertex and one index buffer shared by every mesh, sub-allocated through free-lists.
+//
+
+#ifndef geometryPool_h
+#define geometryPool_h
+
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+
+#define GEOMETRY_POOL_VERTICES (1u << 18)//Default capacities, grown to fit a larger first mesh
+#define GEOMETRY_POOL_INDICES (1u << 20)
+
+typedef struct {
+    uint32_t offset;
+    uint32_t count;
+} FreeBlock;
+
+typedef struct {
+    FreeBlock *blocks;//Sorted by offset, touching blocks are merged on free
+    uint32_t blockCount;
+    uint32_t blockCapacity;
+    uint32_t capacity;
+    uint32_t used;
+} FreeList;
+
+typedef struct {
+    uint32_t firstVertex;//Passed as vertexOffset, indices stay relative to the mesh
+    uint32_t vertexCount;
+    uint32_t firstIndex;//Added to the firstIndex of each level of detail
+    uint32_t indexCount;
+} GeometryRange;
+
+typedef struct {
+    VkBuffer vertexBuffer;
+    VkDeviceMemory vertexMemory;
+    void *vertexMapped;//Persistently mapped when the pool landed in host visible device memory, NULL when uploads are staged
+    uint32_t vertexMemoryType;
+    VkBuffer indexBuffer;
+    VkDeviceMemory indexMemory;
+    void *indexMapped;
+    uint32_t indexMemoryType;
+    uint32_t vertexStride;
+    uint32_t indexSize;//Every mesh in the pool shares one index type
+    FreeList vertices;
+    FreeList indices;
+} GeometryPool;
+
+void initGeometryPool(GeometryPool *pPool, uint32_t vertexCapacity, uint32_t vertexStride, uint32_t indexCapacity, uint32_t indexSize);
+
+uint32_t geometryPoolAllocate(GeometryPool *pPool, uint32_t vertexCount, uint32_t indexCount, GeometryRange *pRange);
+
+void geometryPoolFree(GeometryPool *pPool, const GeometryRange *pRange);
+
+void printGeometryPool(const GeometryPool *pPool);
+
+void freeGeometryPool(GeometryPool *pPool);
+
+#endif /* geometryPool_h */
@@ -0,0 +1,793 @@
+//
+//  imageLoader.c
+//  vkProject
+//
+//  PNG, uncompressed KTX2 and raw RGBA8 decoding into CPU mip chains.
+//
+
+#include "imageLoader.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define HUFFMAN_FAST_BITS 10//Codes up to this length decode with one table lookup
+#define HUFFMAN_MAX_BITS 15
+
+#define RAW_HEADER_SIZE 8//Little-endian width and height, then the RGBA8 texels
+
+static const uint8_t pngSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+static const uint8_t ktx2Identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    size_t position;
+    uint64_t bits;
+    uint32_t bitCount;
+    uint32_t overrun;//Set once a read went past the end, every later read returns zeros
+} BitReader;
+
+typedef struct {
+    uint16_t fast[1 << HUFFMAN_FAST_BITS];//symbol << 4 | length, zero for longer codes
+    uint16_t counts[HUFFMAN_MAX_BITS + 1];
+    uint16_t symbols[288];
+} Huffman;
+
+static void *allocOrExit(size_t size)
+{
+    void *pMemory = malloc(size ? size : 1);
+    if(pMemory == NULL)
+    {
+        printf("Failed to allocate image data!\n");
+        exit(1);
+    }
+    return pMemory;
+}
+
+static uint32_t readBigEndian32(const uint8_t *p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static uint32_t readLittleEndian32(const uint8_t *p)
+{
+    return (uint32_t)p[3] << 24 | (uint32_t)p[2] << 16 | (uint32_t)p[1] << 8 | p[0];
+}
+
+static uint64_t readLittleEndian64(const uint8_t *p)
+{
+    return (uint64_t)readLittleEndian32(p + 4) << 32 | readLittleEndian32(p);
+}
+
+static void refillBits(BitReader *pReader)
+{
+    while(pReader->bitCount <= 56 && pReader->position < pReader->size)
+    {
+        pReader->bits |= (uint64_t)pReader->data[pReader->position++] << pReader->bitCount;
+        pReader->bitCount += 8;
+    }
+}
+
+static uint32_t readBits(BitReader *pReader, uint32_t count)//Deflate packs fields least significant bit first
+{
+    if(count == 0)
+    {
+        return 0;
+    }
+    if(pReader->bitCount < count)
+    {
+        refillBits(pReader);
+        if(pReader->bitCount < count)
+        {
+            pReader->overrun = 1;
+            pReader->bitCount = count;
+        }
+    }
+    uint32_t value = (uint32_t)(pReader->bits & ((1ull << count) - 1));
+    pReader->bits >>= count;
+    pReader->bitCount -= count;
+    return value;
+}
+
+static uint32_t buildHuffman(Huffman *pHuffman, const uint8_t *lengths, uint32_t count)//Canonical codes from code lengths, returns 0 for an over-subscribed set
+{
+    memset(pHuffman, 0, sizeof(Huffman));
+    for(uint32_t i = 0; i < count; i++)
+    {
+        pHuffman->counts[lengths[i]]++;
+    }
+    pHuffman->counts[0] = 0;
+
+    int32_t left = 1;
+    for(uint32_t length = 1; length <= HUFFMAN_MAX_BITS; length++)
+    {
+        left = 2 * left - pHuffman->counts[length];
+        if(left < 0)
+        {
+            return 0;
+        }
+    }
+
+    uint16_t offsets[HUFFMAN_MAX_BITS + 1];
+    uint32_t nextCode[HUFFMAN_MAX_BITS + 1];
+    offsets[1] = 0;
+    nextCode[1] = 0;
+    for(uint32_t length = 1; length < HUFFMAN_MAX_BITS; length++)
+    {
+        offsets[length + 1] = offsets[length] + pHuffman->counts[length];
+        nextCode[length + 1] = (nextCode[length] + pHuffman->counts[length]) << 1;
+    }
+
+    for(uint32_t symbol = 0; symbol < count; symbol++)
+    {
+        uint32_t length = lengths[symbol];
+        if(length == 0)
+        {
+            continue;
+        }
+        pHuffman->symbols[offsets[length]++] = (uint16_t)symbol;
+
+        uint32_t code = nextCode[length]++;
+        if(length <= HUFFMAN_FAST_BITS)//Codes are sent most significant bit first, the table is indexed by the bits as they arrive
+        {
+            uint32_t reversed = 0;
+            for(uint32_t bit = 0; bit < length; bit++)
+            {
+                reversed |= ((code >> bit) & 1) << (length - 1 - bit);
+            }
+            for(uint32_t index = reversed; index < (1u << HUFFMAN_FAST_BITS); index += 1u << length)
+            {
+                pHuffman->fast[index] = (uint16_t)(symbol << 4 | length);
+            }
+        }
+    }
+    return 1;
+}
+
+static int32_t decodeSymbol(BitReader *pReader, const Huffman *pHuffman)//Returns -1 for a code that is not in the table
+{
+    if(pReader->bitCount < HUFFMAN_MAX_BITS)
+    {
+        refillBits(pReader);
+    }
+
+    uint16_t entry = pHuffman->fast[pReader->bits & ((1u << HUFFMAN_FAST_BITS) - 1)];
+    if(entry != 0)
+    {
+        uint32_t length = entry & 0xF;
+        if(length > pReader->bitCount)
+        {
+            pReader->overrun = 1;
+            return -1;
+        }
+        pReader->bits >>= length;
+        pReader->bitCount -= length;
+        return entry >> 4;
+    }
+
+    int32_t code = 0;
+    int32_t first = 0;
+    int32_t index = 0;
+    for(uint32_t length = 1; length <= HUFFMAN_MAX_BITS; length++)//Canonical decode one bit at a time for the long codes
+    {
+        code |= (int32_t)readBits(pReader, 1);
+        int32_t count = pHuffman->counts[length];
+        if(code - first < count)
+        {
+            return pHuffman->symbols[index + code - first];
+        }
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+static const uint16_t lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t distanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t distanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+static uint32_t inflateBlock(BitReader *pReader, const Huffman *pLengths, const Huffman *pDistances, uint8_t *output, size_t outputSize, size_t *pWritten)
+{
+    size_t written = *pWritten;
+    while(1)
+    {
+        int32_t symbol = decodeSymbol(pReader, pLengths);
+        if(symbol < 0 || pReader->overrun)
+        {
+            return 0;
+        }
+        if(symbol < 256)
+        {
+            if(written == outputSize)
+            {
+                return 0;
+            }
+            output[written++] = (uint8_t)symbol;
+            continue;
+        }
+        if(symbol == 256)
+        {
+            *pWritten = written;
+            return 1;
+        }
+
+        symbol -= 257;
+        if(symbol >= 29)
+        {
+            return 0;
+        }
+        uint32_t length = lengthBase[symbol] + readBits(pReader, lengthExtra[symbol]);
+
+        int32_t distanceSymbol = decodeSymbol(pReader, pDistances);
+        if(distanceSymbol < 0 || distanceSymbol >= 30)
+        {
+            return 0;
+        }
+        size_t distance = distanceBase[distanceSymbol] + readBits(pReader, distanceExtra[distanceSymbol]);
+        if(distance > written || length > outputSize - written || pReader->overrun)
+        {
+            return 0;
+        }
+
+        const uint8_t *source = output + written - distance;
+        for(uint32_t i = 0; i < length; i++)//Byte by byte, the copy may overlap its own output
+        {
+            output[written + i] = source[i];
+        }
+        written += length;
+    }
+}
+
+static uint32_t inflateZlib(const uint8_t *data, size_t size, uint8_t *output, size_t outputSize)//Returns 1 when the stream decoded to exactly outputSize bytes
+{
+    if(size < 2 || (data[0] & 0x0F) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 0x20))//Deflate, valid check bits, no preset dictionary
+    {
+        return 0;
+    }
+
+    BitReader reader = {data, size, 2, 0, 0, 0};
+    size_t written = 0;
+    Huffman *pTables = allocOrExit(sizeof(Huffman) * 3);
+    Huffman *pLengths = &pTables[0];
+    Huffman *pDistances = &pTables[1];
+    Huffman *pCodeLengths = &pTables[2];
+
+    uint32_t final = 0;
+    uint32_t valid = 1;
+    while(!final && valid)
+    {
+        final = readBits(&reader, 1);
+        uint32_t type = readBits(&reader, 2);
+
+        if(type == 0)//Stored
+        {
+            readBits(&reader, reader.bitCount & 7);
+            uint32_t length = readBits(&reader, 16);
+            uint32_t complement = readBits(&reader, 16);
+            if((length ^ 0xFFFF) != complement || length > outputSize - written || reader.overrun)
+            {
+                valid = 0;
+                break;
+            }
+            for(uint32_t i = 0; i < length; i++)
+            {
+                output[written++] = (uint8_t)readBits(&reader, 8);
+            }
+            valid = !reader.overrun;
+        }
+        else if(type == 1)//Fixed codes
+        {
+            uint8_t lengths[288 + 30];
+            memset(lengths, 8, 144);
+            memset(lengths + 144, 9, 112);
+            memset(lengths + 256, 7, 24);
+            memset(lengths + 280, 8, 8);
+            memset(lengths + 288, 5, 30);
+            buildHuffman(pLengths, lengths, 288);
+            buildHuffman(pDistances, lengths + 288, 30);
+            valid = inflateBlock(&reader, pLengths, pDistances, output, outputSize, &written);
+        }
+        else if(type == 2)//Dynamic codes
+        {
+            static const uint8_t codeLengthOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+            uint32_t lengthCount = readBits(&reader, 5) + 257;
+            uint32_t distanceCount = readBits(&reader, 5) + 1;
+            uint32_t codeLengthCount = readBits(&reader, 4) + 4;
+
+            uint8_t codeLengths[19] = {0};
+            for(uint32_t i = 0; i < codeLengthCount; i++)
+            {
+                codeLengths[codeLengthOrder[i]] = (uint8_t)readBits(&reader, 3);
+            }
+            if(lengthCount > 286 || distanceCount > 30 || !buildHuffman(pCodeLengths, codeLengths, 19))
+            {
+                valid = 0;
+                break;
+            }
+
+            uint8_t lengths[286 + 30];
+            uint32_t filled = 0;
+            while(filled < lengthCount + distanceCount && valid)
+            {
+                int32_t symbol = decodeSymbol(&reader, pCodeLengths);
+                uint32_t repeat = 0;
+                uint8_t value = 0;
+                if(symbol < 0)
+                {
+                    valid = 0;
+                }
+                else if(symbol < 16)
+                {
+                    lengths[filled++] = (uint8_t)symbol;
+                }
+                else if(symbol == 16)//Repeats the previous length
+                {
+                    valid = filled > 0;
+                    value = valid ? lengths[filled - 1] : 0;
+                    repeat = 3 + readBits(&reader, 2);
+                }
+                else if(symbol == 17)
+                {
+                    repeat = 3 + readBits(&reader, 3);
+                }
+                else
+                {
+                    repeat = 11 + readBits(&reader, 7);
+                }
+
+                if(repeat > lengthCount + distanceCount - filled)
+                {
+                    valid = 0;
+                }
+                for(uint32_t i = 0; i < repeat && valid; i++)
+                {
+                    lengths[filled++] = value;
+                }
+            }
+
+            valid = valid && !reader.overrun && lengths[256] != 0 &&
+                    buildHuffman(pLengths, lengths, lengthCount) && buildHuffman(pDistances, lengths + lengthCount, distanceCount) &&
+                    inflateBlock(&reader, pLengths, pDistances, output, outputSize, &written);
+        }
+        else
+        {
+            valid = 0;
+        }
+    }
+
+    free(pTables);
+    return valid && written == outputSize;
+}
+
+static uint8_t paethPredictor(int32_t a, int32_t b, int32_t c)
+{
+    int32_t p = a + b - c;
+    int32_t pa = abs(p - a);
+    int32_t pb = abs(p - b);
+    int32_t pc = abs(p - c);
+    if(pa <= pb && pa <= pc)
+    {
+        return (uint8_t)a;
+    }
+    return (uint8_t)(pb <= pc ? b : c);
+}
+
+static uint32_t unfilterPng(uint8_t *raw, uint32_t height, size_t rowBytes, uint32_t pixelBytes)//In place, each row keeps its filter byte in front
+{
+    const uint8_t *previous = NULL;
+    for(uint32_t y = 0; y < height; y++)
+    {
+        uint8_t *row = raw + y * (rowBytes + 1) + 1;
+        uint8_t filter = row[-1];
+        for(size_t x = 0; x < rowBytes; x++)
+        {
+            uint8_t left = x >= pixelBytes ? row[x - pixelBytes] : 0;
+            uint8_t up = previous ? previous[x] : 0;
+            uint8_t upLeft = previous && x >= pixelBytes ? previous[x - pixelBytes] : 0;
+            switch(filter)
+            {
+                case 0:
+                    break;
+                case 1:
+                    row[x] += left;
+                    break;
+                case 2:
+                    row[x] += up;
+                    break;
+                case 3:
+                    row[x] += (uint8_t)((left + up) / 2);
+                    break;
+                case 4:
+                    row[x] += paethPredictor(left, up, upLeft);
+                    break;
+                default:
+                    return 0;
+            }
+        }
+        previous = row;
+    }
+    return 1;
+}
+
+static uint32_t pngSample(const uint8_t *row, uint32_t index, uint32_t bitDepth)//Sample index within the row, at its native depth
+{
+    if(bitDepth == 16)
+    {
+        return (uint32_t)row[2 * index] << 8 | row[2 * index + 1];
+    }
+    if(bitDepth == 8)
+    {
+        return row[index];
+    }
+    uint32_t bit = index * bitDepth;
+    return (row[bit / 8] >> (8 - bitDepth - bit % 8)) & ((1u << bitDepth) - 1);
+}
+
+static uint32_t loadPng(const char *fileName, const uint8_t *data, size_t size, ImageData *pImage)
+{
+    uint32_t width = 0, height = 0, bitDepth = 0, colorType = 0;
+    uint8_t palette[256][4];
+    uint32_t paletteSize = 0;
+    uint32_t hasColorKey = 0;
+    uint32_t colorKey[3] = {0};
+    uint8_t *compressed = NULL;
+    size_t compressedSize = 0;
+
+    memset(palette, 255, sizeof(palette));
+
+    size_t position = sizeof(pngSignature);
+    while(position + 12 <= size)
+    {
+        uint32_t length = readBigEndian32(data + position);
+        const uint8_t *type = data + position + 4;
+        const uint8_t *chunk = data + position + 8;
+        if(length > size - position - 12)
+        {
+            break;
+        }
+
+        if(memcmp(type, "IHDR", 4) == 0 && length >= 13)
+        {
+            width = readBigEndian32(chunk);
+            height = readBigEndian32(chunk + 4);
+            bitDepth = chunk[8];
+            colorType = chunk[9];
+            if(chunk[12] != 0)
+            {
+                printf("Interlaced PNG is not supported: %s!\n", fileName);
+                free(compressed);
+                return 0;
+            }
+        }
+        else if(memcmp(type, "PLTE", 4) == 0)
+        {
+            paletteSize = length / 3 < 256 ? length / 3 : 256;
+            for(uint32_t i = 0; i < paletteSize; i++)
+            {
+                memcpy(palette[i], chunk + 3 * i, 3);
+            }
+        }
+        else if(memcmp(type, "tRNS", 4) == 0)
+        {
+            if(colorType == 3)
+            {
+                for(uint32_t i = 0; i < length && i < 256; i++)
+                {
+                    palette[i][3] = chunk[i];
+                }
+            }
+            else if(colorType == 0 && length >= 2)
+            {
+                hasColorKey = 1;
+                colorKey[0] = (uint32_t)chunk[0] << 8 | chunk[1];
+            }
+            else if(colorType == 2 && length >= 6)
+            {
+                hasColorKey = 1;
+                for(uint32_t c = 0; c < 3; c++)
+                {
+                    colorKey[c] = (uint32_t)chunk[2 * c] << 8 | chunk[2 * c + 1];
+                }
+            }
+        }
+        else if(memcmp(type, "IDAT", 4) == 0)//The zlib stream may be split over any number of chunks
+        {
+            compressed = realloc(compressed, compressedSize + length + 1);
+            if(compressed == NULL)
+            {
+                printf("Failed to allocate image data!\n");
+                exit(1);
+            }
+            memcpy(compressed + compressedSize, chunk, length);
+            compressedSize += length;
+        }
+        else if(memcmp(type, "IEND", 4) == 0)
+        {
+            break;
+        }
+        position += 12 + (size_t)length;
+    }
+
+    uint32_t channels = colorType == 0 ? 1 : colorType == 2 ? 3 : colorType == 3 ? 1 : colorType == 4 ? 2 : colorType == 6 ? 4 : 0;
+    uint32_t depthValid = bitDepth == 8 || bitDepth == 16 || ((colorType == 0 || colorType == 3) && (bitDepth == 1 || bitDepth == 2 || bitDepth == 4));
+    if(width == 0 || height == 0 || channels == 0 || !depthValid || compressed == NULL || (colorType == 3 && paletteSize == 0))
+    {
+        printf("Unsupported PNG: %s!\n", fileName);
+        free(compressed);
+        return 0;
+    }
+
+    size_t rowBytes = ((size_t)width * channels * bitDepth + 7) / 8;
+    uint32_t pixelBytes = channels * bitDepth / 8 ? channels * bitDepth / 8 : 1;//Filters look back one whole pixel, or one byte below 8 bits
+    size_t rawSize = (rowBytes + 1) * height;
+    uint8_t *raw = allocOrExit(rawSize);
+
+    if(!inflateZlib(compressed, compressedSize, raw, rawSize) || !unfilterPng(raw, height, rowBytes, pixelBytes))
+    {
+        printf("Corrupt PNG data: %s!\n", fileName);
+        free(compressed);
+        free(raw);
+        return 0;
+    }
+    free(compressed);
+
+    uint8_t *pixels = allocOrExit((size_t)width * height * 4);
+    uint32_t maxSample = (1u << bitDepth) - 1;
+    for(uint32_t y = 0; y < height; y++)
+    {
+        const uint8_t *row = raw + y * (rowBytes + 1) + 1;
+        uint8_t *out = pixels + (size_t)y * width * 4;
+        for(uint32_t x = 0; x < width; x++)
+        {
+            uint32_t samples[4] = {0, 0, 0, maxSample};
+            for(uint32_t c = 0; c < channels; c++)
+            {
+                samples[c] = pngSample(row, x * channels + c, bitDepth);
+            }
+
+            if(colorType == 3)
+            {
+                memcpy(out + 4 * x, palette[samples[0] < paletteSize ? samples[0] : 0], 4);
+                continue;
+            }
+
+            uint32_t red = samples[0], green = samples[0], blue = samples[0], alpha = maxSample;
+            if(colorType == 2 || colorType == 6)
+            {
+                green = samples[1];
+                blue = samples[2];
+                alpha = colorType == 6 ? samples[3] : maxSample;
+            }
+            else if(colorType == 4)
+            {
+                alpha = samples[1];
+            }
+
+            if(hasColorKey && red == colorKey[0] && (colorType == 0 || (green == colorKey[1] && blue == colorKey[2])))
+            {
+                alpha = 0;
+            }
+
+            out[4 * x + 0] = (uint8_t)(red * 255 / maxSample);
+            out[4 * x + 1] = (uint8_t)(green * 255 / maxSample);
+            out[4 * x + 2] = (uint8_t)(blue * 255 / maxSample);
+            out[4 * x + 3] = (uint8_t)(alpha * 255 / maxSample);
+        }
+    }
+    free(raw);
+
+    pImage->width = width;
+    pImage->height = height;
+    pImage->srgb = 1;//PNG without colour chunks is sRGB
+    pImage->levelCount = 1;
+    pImage->levels[0] = pixels;
+    return 1;
+}
+
+static uint32_t loadKtx2(const char *fileName, const uint8_t *data, size_t size, ImageData *pImage)//Single 2D RGBA8 images without supercompression, every stored level is kept
+{
+    if(size < 80)
+    {
+        printf("Truncated KTX2 file: %s!\n", fileName);
+        return 0;
+    }
+
+    uint32_t format = readLittleEndian32(data + 12);
+    uint32_t width = readLittleEndian32(data + 20);
+    uint32_t height = readLittleEndian32(data + 24);
+    uint32_t depth = readLittleEndian32(data + 28);
+    uint32_t layers = readLittleEndian32(data + 32);
+    uint32_t faces = readLittleEndian32(data + 36);
+    uint32_t levels = readLittleEndian32(data + 40);
+    uint32_t supercompression = readLittleEndian32(data + 44);
+    levels = levels ? levels : 1;//Zero asks the loader to generate the chain
+
+    if((format != KTX2_FORMAT_R8G8B8A8_UNORM && format != KTX2_FORMAT_R8G8B8A8_SRGB) || supercompression != 0 || depth > 1 || layers > 1 || faces != 1 ||
+       width == 0 || height == 0 || levels > imageFullLevelCount(width, height) || size < 80 + 24 * (size_t)levels)
+    {
+        printf("Unsupported KTX2 layout, only uncompressed 2D RGBA8 is read: %s!\n", fileName);
+        return 0;
+    }
+
+    pImage->width = width;
+    pImage->height = height;
+    pImage->srgb = format == KTX2_FORMAT_R8G8B8A8_SRGB;
+    pImage->levelCount = 0;
+
+    for(uint32_t level = 0; level < levels; level++)
+    {
+        const uint8_t *entry = data + 80 + 24 * level;
+        uint64_t offset = readLittleEndian64(entry);
+        uint64_t length = readLittleEndian64(entry + 8);
+        if(length != imageLevelSize(pImage, level) || offset > size || length > size - offset)
+        {
+            printf("Invalid KTX2 level %u: %s!\n", level, fileName);
+            freeImage(pImage);
+            return 0;
+        }
+        pImage->levels[level] = allocOrExit((size_t)length);
+        memcpy(pImage->levels[level], data + offset, (size_t)length);
+        pImage->levelCount++;
+    }
+    return 1;
+}
+
+static uint32_t loadRaw(const char *fileName, const uint8_t *data, size_t size, ImageData *pImage)
+{
+    uint32_t width = size >= RAW_HEADER_SIZE ? readLittleEndian32(data) : 0;
+    uint32_t height = size >= RAW_HEADER_SIZE ? readLittleEndian32(data + 4) : 0;
+    if(width == 0 || height == 0 || (size - RAW_HEADER_SIZE) / 4 / width < height)
+    {
+        printf("Invalid raw image: %s!\n", fileName);
+        return 0;
+    }
+
+    pImage->width = width;
+    pImage->height = height;
+    pImage->srgb = 1;
+    pImage->levelCount = 1;
+    pImage->levels[0] = allocOrExit((size_t)width * height * 4);
+    memcpy(pImage->levels[0], data + RAW_HEADER_SIZE, (size_t)width * height * 4);
+    return 1;
+}
+
+uint32_t loadImage(const char *fileName, ImageData *pImage)//Returns 0 after printing why when the file is not a supported image
+{
+    memset(pImage, 0, sizeof(ImageData));
+
+    char *buffer;
+    size_t size = readFile(fileName, &buffer);
+    const uint8_t *data = (const uint8_t *)buffer;
+    const char *extension = strrchr(fileName, '.');
+
+    uint32_t loaded;
+    if(size >= sizeof(pngSignature) && memcmp(data, pngSignature, sizeof(pngSignature)) == 0)
+    {
+        loaded = loadPng(fileName, data, size, pImage);
+    }
+    else if(size >= sizeof(ktx2Identifier) && memcmp(data, ktx2Identifier, sizeof(ktx2Identifier)) == 0)
+    {
+        loaded = loadKtx2(fileName, data, size, pImage);
+    }
+    else if(extension != NULL && strcmp(extension, ".raw") == 0)
+    {
+        loaded = loadRaw(fileName, data, size, pImage);
+    }
+    else
+    {
+        printf("Unknown image format: %s!\n", fileName);
+        loaded = 0;
+    }
+
+    free(buffer);
+    return loaded;
+}
+
+uint32_t imageFullLevelCount(uint32_t width, uint32_t height)
+{
+    uint32_t largest = width > height ? width : height;
+    uint32_t levels = 1;
+    while(largest > 1)
+    {
+        largest >>= 1;
+        levels++;
+    }
+    return levels;
+}
+
+uint32_t imageLevelWidth(const ImageData *pImage, uint32_t level)
+{
+    return pImage->width >> level ? pImage->width >> level : 1;
+}
+
+uint32_t imageLevelHeight(const ImageData *pImage, uint32_t level)
+{
+    return pImage->height >> level ? pImage->height >> level : 1;
+}
+
+size_t imageLevelSize(const ImageData *pImage, uint32_t level)
+{
+    return (size_t)imageLevelWidth(pImage, level) * imageLevelHeight(pImage, level) * 4;
+}
+
+static float srgbToLinear(float value)
+{
+    return value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float linearToSrgb(float value)
+{
+    return value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+}
+
+void generateImageLevels(ImageData *pImage)//2x2 box filter down to 1x1, odd edges repeat their last texel, colour is averaged in linear space
+{
+    uint32_t fullLevels = imageFullLevelCount(pImage->width, pImage->height);
+    if(pImage->levelCount >= fullLevels)
+    {
+        return;
+    }
+
+    float toLinear[256];
+    uint8_t toSrgb[4096];//Linear value quantised to 12 bits, fine enough that the round trip is exact for every 8-bit input
+    for(uint32_t i = 0; i < 256; i++)
+    {
+        toLinear[i] = pImage->srgb ? srgbToLinear(i / 255.0f) : i / 255.0f;
+    }
+    for(uint32_t i = 0; i < 4096; i++)
+    {
+        float value = pImage->srgb ? linearToSrgb(i / 4095.0f) : i / 4095.0f;
+        toSrgb[i] = (uint8_t)(value * 255.0f + 0.5f);
+    }
+
+    for(uint32_t level = pImage->levelCount; level < fullLevels; level++)
+    {
+        const uint8_t *source = pImage->levels[level - 1];
+        uint32_t sourceWidth = imageLevelWidth(pImage, level - 1);
+        uint32_t sourceHeight = imageLevelHeight(pImage, level - 1);
+        uint32_t width = imageLevelWidth(pImage, level);
+        uint32_t height = imageLevelHeight(pImage, level);
+        uint8_t *destination = allocOrExit(imageLevelSize(pImage, level));
+
+        for(uint32_t y = 0; y < height; y++)
+        {
+            uint32_t y0 = 2 * y < sourceHeight ? 2 * y : sourceHeight - 1;
+            uint32_t y1 = y0 + 1 < sourceHeight ? y0 + 1 : y0;
+            for(uint32_t x = 0; x < width; x++)
+            {
+                uint32_t x0 = 2 * x < sourceWidth ? 2 * x : sourceWidth - 1;
+                uint32_t x1 = x0 + 1 < sourceWidth ? x0 + 1 : x0;
+                const uint8_t *texels[4] = {
+                    source + 4 * ((size_t)y0 * sourceWidth + x0),
+                    source + 4 * ((size_t)y0 * sourceWidth + x1),
+                    source + 4 * ((size_t)y1 * sourceWidth + x0),
+                    source + 4 * ((size_t)y1 * sourceWidth + x1)
+                };
+                uint8_t *out = destination + 4 * ((size_t)y * width + x);
+                for(uint32_t c = 0; c < 3; c++)
+                {
+                    float sum = toLinear[texels[0][c]] + toLinear[texels[1][c]] + toLinear[texels[2][c]] + toLinear[texels[3][c]];
+                    out[c] = toSrgb[(uint32_t)(sum * 0.25f * 4095.0f + 0.5f)];
+                }
+                out[3] = (uint8_t)((texels[0][3] + texels[1][3] + texels[2][3] + texels[3][3] + 2) / 4);//Alpha is always linear
+            }
+        }
+        pImage->levels[level] = destination;
+    }
+    pImage->levelCount = fullLevels;
+}
+
+void freeImage(ImageData *pImage)
+{
+    for(uint32_t i = 0; i < MAX_IMAGE_LEVELS; i++)
+    {
+        free(pImage->levels[i]);
+        pImage->levels[i] = NULL;
+    }
+    pImage->levelCount = 0;
+}
@@ -0,0 +1,41 @@
+//
+//  imageLoader.h
+//  vkProject
+//
+//  PNG, uncompressed KTX2 and raw RGBA8 decoding into CPU mip chains.
+//
+
+#ifndef imageLoader_h
+#define imageLoader_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define MAX_IMAGE_LEVELS 16//Enough for a 32768 texel side
+
+#define KTX2_FORMAT_R8G8B8A8_UNORM 37//VkFormat values, the only KTX2 formats accepted
+#define KTX2_FORMAT_R8G8B8A8_SRGB 43
+
+typedef struct {
+    uint32_t width;
+    uint32_t height;
+    uint32_t srgb;//Colour data, averaged in linear space and sampled through an sRGB format
+    uint32_t levelCount;//Levels filled in, the full chain once generateImageLevels has run
+    uint8_t *levels[MAX_IMAGE_LEVELS];//Tightly packed RGBA8, finest first
+} ImageData;
+
+uint32_t loadImage(const char *fileName, ImageData *pImage);
+
+uint32_t imageFullLevelCount(uint32_t width, uint32_t height);
+
+uint32_t imageLevelWidth(const ImageData *pImage, uint32_t level);
+
+uint32_t imageLevelHeight(const ImageData *pImage, uint32_t level);
+
+size_t imageLevelSize(const ImageData *pImage, uint32_t level);
+
+void generateImageLevels(ImageData *pImage);
+
+void freeImage(ImageData *pImage);
+
+#endif /* imageLoader_h */
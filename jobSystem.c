@@ -0,0 +1,137 @@
+//
+//  jobSystem.c
+//  vkProject
+//
+//  Fixed pool of worker threads running parallel-for style batches.
+//
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "jobSystem.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static uint32_t runJobs(JobSystem *pJobs)//Called with the mutex held, returns with it held
+{
+    uint32_t ran = 0;
+    while(pJobs->nextJob < pJobs->jobCount)
+    {
+        uint32_t jobIndex = pJobs->nextJob++;
+        JobFunction function = pJobs->function;
+        void *pData = pJobs->pData;
+
+        pthread_mutex_unlock(&pJobs->mutex);
+        function(pData, jobIndex);
+        pthread_mutex_lock(&pJobs->mutex);
+
+        pJobs->finishedJobs++;
+        ran++;
+    }
+    return ran;
+}
+
+static void *workerMain(void *pArgument)
+{
+    JobSystem *pJobs = pArgument;
+    uint64_t seenBatch = 0;
+
+    pthread_mutex_lock(&pJobs->mutex);
+    while(1)
+    {
+        while(!pJobs->shutdown && pJobs->batch == seenBatch)
+        {
+            pthread_cond_wait(&pJobs->workAvailable, &pJobs->mutex);
+        }
+
+        if(pJobs->shutdown)
+        {
+            break;
+        }
+
+        seenBatch = pJobs->batch;
+        runJobs(pJobs);
+        if(pJobs->finishedJobs == pJobs->jobCount)
+        {
+            pthread_cond_signal(&pJobs->workDone);
+        }
+    }
+    pthread_mutex_unlock(&pJobs->mutex);
+    return NULL;
+}
+
+uint32_t jobSystemDefaultThreadCount(void)//One worker per core, leaving a core for the calling thread
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 1 ? (uint32_t)cores - 1 : 0;
+}
+
+void createJobSystem(JobSystem *pJobs, uint32_t threadCount)//Zero threads runs every batch inline on the caller
+{
+    memset(pJobs, 0, sizeof(JobSystem));
+    pJobs->threadCount = threadCount;
+    pJobs->threads = malloc(sizeof(pthread_t) * (threadCount ? threadCount : 1));
+
+    if(pJobs->threads == NULL)
+    {
+        printf("Failed to allocate job system!\n");
+        exit(1);
+    }
+
+    pthread_mutex_init(&pJobs->mutex, NULL);
+    pthread_cond_init(&pJobs->workAvailable, NULL);
+    pthread_cond_init(&pJobs->workDone, NULL);
+
+    for(uint32_t i = 0; i < threadCount; i++)
+    {
+        if(pthread_create(&pJobs->threads[i], NULL, workerMain, pJobs) != 0)
+        {
+            printf("Failed to create worker thread!\n");
+            exit(1);
+        }
+    }
+}
+
+void jobSystemRun(JobSystem *pJobs, uint32_t jobCount, JobFunction function, void *pData)//Blocks until every job of the batch has finished, batches are not reentrant
+{
+    if(jobCount == 0)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&pJobs->mutex);
+    pJobs->function = function;
+    pJobs->pData = pData;
+    pJobs->jobCount = jobCount;
+    pJobs->nextJob = 0;
+    pJobs->finishedJobs = 0;
+    pJobs->batch++;
+    pthread_cond_broadcast(&pJobs->workAvailable);
+
+    runJobs(pJobs);
+    while(pJobs->finishedJobs < pJobs->jobCount)
+    {
+        pthread_cond_wait(&pJobs->workDone, &pJobs->mutex);
+    }
+    pthread_mutex_unlock(&pJobs->mutex);
+}
+
+void destroyJobSystem(JobSystem *pJobs)
+{
+    pthread_mutex_lock(&pJobs->mutex);
+    pJobs->shutdown = 1;
+    pthread_cond_broadcast(&pJobs->workAvailable);
+    pthread_mutex_unlock(&pJobs->mutex);
+
+    for(uint32_t i = 0; i < pJobs->threadCount; i++)
+    {
+        pthread_join(pJobs->threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&pJobs->workDone);
+    pthread_cond_destroy(&pJobs->workAvailable);
+    pthread_mutex_destroy(&pJobs->mutex);
+    free(pJobs->threads);
+}
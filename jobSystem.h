@@ -0,0 +1,41 @@
+//
+//  jobSystem.h
+//  vkProject
+//
+//  Fixed pool of worker threads running parallel-for style batches.
+//
+
+#ifndef jobSystem_h
+#define jobSystem_h
+
+#include <stdint.h>
+#include <pthread.h>
+
+typedef void (*JobFunction)(void *pData, uint32_t jobIndex);
+
+typedef struct {
+    uint32_t threadCount;//Workers besides the calling thread, which also runs jobs while it waits
+    pthread_t *threads;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t workAvailable;
+    pthread_cond_t workDone;
+
+    JobFunction function;
+    void *pData;
+    uint32_t jobCount;
+    uint32_t nextJob;
+    uint32_t finishedJobs;
+    uint64_t batch;//Incremented for every batch so sleeping workers can tell a new batch from a spurious wakeup
+    uint32_t shutdown;
+} JobSystem;
+
+void createJobSystem(JobSystem *pJobs, uint32_t threadCount);
+
+uint32_t jobSystemDefaultThreadCount(void);
+
+void jobSystemRun(JobSystem *pJobs, uint32_t jobCount, JobFunction function, void *pData);
+
+void destroyJobSystem(JobSystem *pJobs);
+
+#endif /* jobSystem_h */
@@ -1,3 +1,5 @@
+#define _POSIX_C_SOURCE 200809L
+
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
@@ -5,22 +7,48 @@
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
-#include <time.h>
+#include <unistd.h>
 #include "vkMath.h"
 #include "utils.h"
+#include "profiler.h"
+#include "mesh.h"
+#include "benchmark.h"
+#include "frameSync.h"
+#include "deletionQueue.h"
+#include "deviceCapabilities.h"
+#include "memoryPolicy.h"
+#include "jobSystem.h"
+#include "renderQueue.h"
+#include "descriptorAllocator.h"
+#include "textureStreamer.h"
+#include "textureAtlas.h"
+#include "particleSystem.h"
+#include "transformStage.h"
+#include "entityStore.h"
+#include "bvh.h"
+#include "occlusionCuller.h"
+#include "resolutionScaler.h"
+#include "renderGraph.h"
+#include "meshLoader.h"
+#include "meshFile.h"
+#include "meshOptimizer.h"
+#include "meshLod.h"
+#include "vertexLayout.h"
+#include "geometryPool.h"
 
 #ifndef M_PI_2
+# define M_PI		3.14159265358979323846	/* pi */
 # define M_PI_2		1.57079632679489661923	/* pi/2 */
 # define M_PI_4		0.78539816339744830962	/* pi/4 */
 #endif
 
-#define indexC 6
-#define vertexC 4
-
 const uint32_t WIDTH = 800;
 const uint32_t HEIGHT = 600;
 
-const uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+const uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+const uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+
+#define MAX_TEXTURE_FILES 4096//As many as the bindless table holds by default
 
 const uint32_t validationLayerCount = 1;
 const char *validationLayers[] = {"VK_LAYER_KHRONOS_validation"};
@@ -40,38 +68,69 @@ const char *deviceExtensions[] = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
     const uint32_t enableCompatibilityBit = 1;
 #endif
 
-typedef struct{
-    float x;
-    float y;
-} Vector2;
+typedef struct
+{
+    const char *profileOutput;
+    BenchmarkSettings benchmark;
+    uint32_t framesInFlight;
+    uint32_t disableTimeline;
+    const char *modelFile;//.obj, .glb or a .mesh file from meshconv, the generated grid when NULL
+    uint32_t skipMeshOptimization;
+    float lodPixelError;//Largest screen-space error accepted when picking a level of detail, 0 keeps full detail
+    VertexLayout vertexLayout;//How vertices are packed in the vertex buffer, the CPU mesh always stays float
+    uint32_t depthSort;//Draw order of instances within each level of detail
+    uint32_t bindless;//Index buffers and images from push constants instead of binding descriptor sets per draw
+    const char *textureFiles[MAX_TEXTURE_FILES];//Streamed in the background or packed at startup, sampled in bindless mode
+    uint32_t textureFileCount;
+    VkDeviceSize textureBudget;
+    uint32_t texturePack;//Decode every texture at startup into atlases and arrays instead of streaming them, instances pick one each
+    uint32_t particleCount;//Capacity of the GPU particle system, 0 disables it
+    uint32_t animation;//Where instance rotations are computed, none keeps instances translation only
+    uint32_t validateTransforms;//Compare one GPU transform dispatch with the CPU path at startup
+    uint32_t culling;//How instances outside the view frustum are skipped before picking levels and sorting
+    uint32_t occlusion;//Draw in two passes, testing instances against a depth pyramid of the first on the GPU
+    float gpuBudget;//Milliseconds of GPU time per frame dynamic resolution keeps within, 0 always renders at the swap chain extent
+    float minResolutionScale;
+    float maxResolutionScale;
+    uint32_t dumpGraph;//Print the compiled frame graph every time it is built
+    float drift;//Distance entities bob along z, so the BVH is refitted and partly rebuilt every frame, 0 keeps them in place
+} Config;
+
+enum depthSort{DEPTH_SORT_FRONT_TO_BACK, DEPTH_SORT_BACK_TO_FRONT, DEPTH_SORT_NONE};
+
+#define INSTANCE_ATTRIBUTE_COUNT 6//Four rows of the model matrix, the texture rectangle and the texture slot and layer
+#define NO_INSTANCE_TEXTURE 0xFFFF
+
+typedef struct {
+    uint16_t uvRect[4];//Offset and scale within the layer as UNORM16
+    uint16_t slot;//Bindless slot of the array image, NO_INSTANCE_TEXTURE for untextured instances
+    uint16_t layer;
+} InstanceTexture;
+
+static const char *depthSortNames[] = {"front", "back", "none"};
 
-typedef struct{
-    float x;
-    float y;
-    float z;
-} Vector3;
+enum instanceAnimation{INSTANCE_ANIMATION_NONE, INSTANCE_ANIMATION_CPU, INSTANCE_ANIMATION_GPU};
 
-typedef struct{
-    Vector2 position;
-    Vector3 color;
-} Vertex;
+static const char *instanceAnimationNames[] = {"none", "cpu", "gpu"};
 
-const uint32_t vertexCount = vertexC;
+enum culling{CULLING_BVH, CULLING_FLAT, CULLING_NONE};
 
-Vertex vertices[vertexC] = {
-    {{-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}},
-    {{0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}},
-    {{0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}},
-    {{-0.5f, 0.5f}, {1.0f, 1.0f, 1.0f}}
-};
+static const char *cullingNames[] = {"bvh", "flat", "none"};
 
-const uint32_t indexCount = indexC;
+#define TRANSFORM_VALIDATION_TIME 7.25f//Several turns into every spin, so the angle wrapping is exercised
 
-const uint16_t vertexIndices[indexC] = {0, 1, 2, 2, 3, 0};
+#define DELETIONS_PER_FRAME 64
 
-uint32_t frameIndex = 0;
+typedef struct {
+    uint32_t flagBits;
+    uint32_t graphicsFamily;
+    uint32_t presentFamily;
+} QueueFamilyIndices;
 
-clock_t startTime;
+typedef struct {
+    float depth;
+    uint32_t instance;
+} InstanceOrder;
 
 typedef struct
 {
@@ -79,7 +138,10 @@ typedef struct
     VkInstance instance;
     VkDebugUtilsMessengerEXT debugMessenger;
     VkPhysicalDevice physicalDevice;
+    DeviceCapabilities capabilities;//Queried once in pickPhysicalDevice
+    QueueFamilyIndices queueFamilies;
     VkDevice device;
+    MemoryPolicy memoryPolicy;
     VkQueue graphicsQueue;
     VkQueue presentQueue;
     VkSurfaceKHR surface;
@@ -89,49 +151,110 @@ typedef struct
     VkFormat swapChainImageFormat;
     VkExtent2D swapChainExtent;
     VkImageView *swapChainImageViews;
+    VkFormat depthFormat;
+    RenderGraph frameGraph;//Rebuilt with the swap chain, owns the depth buffer and render target and orders every pass of a frame
+    uint32_t swapChainResource;//Frame graph resources
+    uint32_t colorResource;//Render target with dynamic resolution, upscaled to the swap chain image at the end of each frame, the swap chain image otherwise
+    uint32_t depthResource;//Shared by every frame in flight, the graph orders each frame's first use after the last one of the frame before
+    uint32_t imageIndex;//Swap chain image of the frame being recorded
+    VkExtent2D targetExtent;//Of the depth buffer and render target, the swap chain extent without dynamic resolution
+    VkExtent2D renderExtent;//Rendered by the frame being recorded, the top left of targetExtent
+    VkFramebuffer renderTargetFramebuffer;
+    VkFilter upscaleFilter;
+    ResolutionScaler resolution;
     VkRenderPass renderPass;
+    VkRenderPass lateRenderPass;//Loads what renderPass stored, only with occlusion culling
     VkDescriptorSetLayout descriptorSetLayout;
     VkPipelineLayout pipelineLayout;
     VkPipeline graphicsPipeline;
     VkFramebuffer *swapChainFramebuffers;
     VkCommandPool commandPool;
     VkCommandBuffer *commandBuffers;
-    VkSemaphore *imageAvailableSemaphores;
-    VkSemaphore *renderFinishedSemaphores;
-    VkFence *inFlightFences;
-    VkBuffer vertexBuffer;
-    VkDeviceMemory vertexBufferMemory;
-    VkBuffer indexBuffer;
-    VkDeviceMemory indexBufferMemory;
+    FrameSync frameSync;
+    uint32_t timelineSupported;
+    uint32_t bindlessSupported;//Requested and the device has descriptor indexing
+    DeletionQueue deletionQueue;
+    uint32_t framebufferResized;
+    GeometryPool geometryPool;//Vertices and indices of every mesh, bound once per frame
+    GeometryRange meshRange;
     VkBuffer *uniformBuffers;
     VkDeviceMemory *uniformBuffersMemory;
     void **uniformBuffersMapped;
-    VkDescriptorPool descriptorPool;
-    VkDescriptorSet *descriptorSets;
+    uint32_t uniformMemoryType;
+    DescriptorAllocator *frameDescriptors;//One per frame in flight, reset wholesale once the frame has finished on the GPU
+    BindlessTable bindless;
+    uint32_t *uniformIndices;//Bindless slot of each frame's uniform buffer
+    VkDescriptorSet *descriptorSets;//Set bound by each frame in flight, the bindless set in every slot when bindless
+    VkBuffer *instanceBuffers;
+    VkDeviceMemory *instanceBuffersMemory;
+    void **instanceBuffersMapped;
+    uint32_t instanceMemoryType;
+    EntityStore entities;//One per instance, dense index order is the order the CPU and the transform stage visit them in
+    float (*worldMatrices)[4][4];//Scratch, per dense entity, only when animating on the CPU
+    VkBuffer animationBuffer;
+    VkDeviceMemory animationBufferMemory;
+    TransformStage transformStage;
+    Bvh bvh;//Over entity bounds, for frustum culling and picking
+    float *driftOrigins;//Per dense entity, the z drifting moves it around, only when drifting
+    Frustum frustum;//Of the frame being prepared
+    uint32_t *visibleInstances;//Scratch, dense indices of the entities that passed culling
+    uint32_t visibleCount;
+    VkBuffer boundsBuffer;//Entity bounds for the occlusion culler
+    VkDeviceMemory boundsBufferMemory;
+    OcclusionCuller occlusion;
+    Mesh mesh;
+    VertexDequantization vertexDequantization;//Undoes the position quantisation of the vertex layout in the shader
+    MeshFile meshFile;//Backs mesh when a converted .mesh file was mapped
+    JobSystem jobs;
+    float meshRadius;
+    uint8_t *instanceLods;//Scratch, level picked for each instance
+    InstanceOrder *instanceOrder;//Scratch, instances sorted by view depth
+    uint32_t lodInstanceCounts[MAX_MESH_LODS];//Instances of each level written this frame, grouped in that order in the instance buffer
+    float lodDepths[MAX_MESH_LODS];//Sort depth of the first instance of each level, orders the level draws in the render queue
+    RenderQueue renderQueue;
+    TextureStreamer textureStreamer;
+    TexturePack texturePack;
+    InstanceTexture *packedTextures;//Instance attributes of each packed texture, instances cycle through them
+    uint32_t packedTextureCount;
+    ParticleSystem particles;
+    ParticleDrawConstants camera;//View and projection of the frame being recorded, for particles and occlusion culling
+    double particleTime;//Simulation time of the last particle step
+    double simulationTime;
+    uint64_t simulationFrame;
+    Config config;
+    Profiler profiler;
+    uint64_t statsUpdateTime;
+    uint32_t frameIndex;//Frame in flight being recorded
+    uint64_t startTime;
+    FILE *pSummaryFile;//The original stdout when a benchmark summary goes there, everything else printed then goes to stderr
 } Application;
 
 enum queueFamilyFlagBit{GRAPHICS_FAMILY_BIT = 1, PRESENT_FAMILY_BIT = 1<<1};
 
-typedef struct {
-    uint32_t flagBits;
-    uint32_t graphicsFamily;
-    uint32_t presentFamily;
-} QueueFamilyIndices;
-
-typedef struct {
-    VkSurfaceCapabilitiesKHR capabilities;
-    uint32_t formatCount;
-    VkSurfaceFormatKHR *formats;
-    uint32_t presentModeCount;
-    VkPresentModeKHR *presentModes;
-} SwapChainSupportDetails;
-
 typedef struct {
     float model[4][4];
     float view[4][4];
     float projection[4][4];
+    float positionScale[4];//Dequantisation of packed positions, w unused
+    float positionOffset[4];
 } UniformBufferObject;
 
+typedef struct {
+    float model[4][4];
+    InstanceTexture texture;
+} InstanceData;
+
+#define INSTANCE_SPACING 1.5f
+#define OVERDRAW_LAYER_SIDE 3//Instances per row of one layer of the overdraw scene
+#define OVERDRAW_LAYER_SPACING 0.1f//Layers are stacked along the view axis, close enough that every one covers the next
+#define DRIFT_PHASE 2.39996323f//Golden angle between the phases of neighbouring entities, so no two nearby ones move together
+#define CAMERA_FOV M_PI_2
+#define CAMERA_NEAR 0.1f
+#define DEFAULT_LOD_PIXEL_ERROR 1.0f
+#define DEFAULT_MIN_RESOLUTION_SCALE 0.5f
+#define DEFAULT_MAX_RESOLUTION_SCALE 1.0f
+#define MAX_RESOLUTION_SCALE 2.0f
+
 void initWindow(Application *pApp);
 void initVulkan(Application *pApp);
 void mainLoop(Application *pApp);
@@ -142,15 +265,14 @@ uint32_t checkValidationLayerSupport(void);
 void setupDebugMessenger(Application *pApp);
 void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT *createInfo);
 void pickPhysicalDevice(Application *pApp);
-uint32_t isDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface);
-uint32_t checkDeviceExtensionSupport(VkPhysicalDevice device);
+uint32_t isDeviceSuitable(DeviceCapabilities *pCapabilities);
+uint32_t checkDeviceExtensionSupport(DeviceCapabilities *pCapabilities);
 uint32_t isComplete(QueueFamilyIndices indices);
-QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface);
+QueueFamilyIndices findQueueFamilies(DeviceCapabilities *pCapabilities);
 void createLogicalDevice(Application *pApp);
 void createSurface(Application *pApp);
-SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface);
-VkSurfaceFormatKHR chooseSwapSurfaceFormat(VkPhysicalDevice device, VkSurfaceKHR surface);//Ugly, clean up
-VkPresentModeKHR chooseSwapPresentMode(SwapChainSupportDetails *details);
+VkSurfaceFormatKHR chooseSwapSurfaceFormat(DeviceCapabilities *pCapabilities);
+VkPresentModeKHR chooseSwapPresentMode(DeviceCapabilities *pCapabilities, uint32_t preferImmediate);
 VkExtent2D chooseSwapExtent(VkSurfaceCapabilitiesKHR *capabilities, GLFWwindow *window);
 void createSwapChain(Application *pApp);
 void createImageViews(Application *pApp);
@@ -159,6 +281,8 @@ void createDescriptorSetLayout(Application *pApp);
 void createGraphicsPipeline(Application *pApp);
 void createRenderPass(Application *pApp);
 void createFramebuffers(Application *pApp);
+VkFormat findDepthFormat(Application *pApp);
+void buildFrameGraph(Application *pApp);
 void createCommandPool(Application *pApp);
 void createCommandBuffer(Application *pApp);
 void recordCommandBuffer(VkCommandBuffer commandBuffer, Application *pApp, uint32_t imageIndex);
@@ -167,16 +291,38 @@ void drawFrame(Application *pApp);
 void createSyncObjects(Application *pApp);
 void recreateSwapChain(Application *pApp);
 void cleanupSwapChain(Application *pApp);
-VkVertexInputBindingDescription getBindingDescription(void);
-VkVertexInputAttributeDescription *getAttributeDescriptions(void);
-void copyBuffer(Application *pApp, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
-void createBuffer(Application *pApp, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer *buffer, VkDeviceMemory *bufferMemory);
-uint32_t findMemoryType(Application *pApp, uint32_t typeFilter, VkMemoryPropertyFlags properties);
-void createVertexBuffer(Application *pApp);
-void createIndexBuffer(Application *pApp);
+void retireSwapChain(Application *pApp, uint64_t value);
+void freeHostArray(VkDevice device, void *pData);
+void framebufferResizeCallback(GLFWwindow *window, int width, int height);
+void mouseButtonCallback(GLFWwindow *window, int button, int action, int mods);
+void getBindingDescriptions(const VertexLayout *pLayout, VkVertexInputBindingDescription bindingDescriptions[2]);
+void getAttributeDescriptions(const VertexLayout *pLayout, VkVertexInputAttributeDescription attributeDescriptions[VERTEX_ATTRIBUTE_COUNT + INSTANCE_ATTRIBUTE_COUNT]);
+uint64_t copyBuffer(Application *pApp, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size);
+VkCommandBuffer beginUploadCommands(Application *pApp);
+uint64_t submitUploadCommands(Application *pApp, VkCommandBuffer commandBuffer);
+void createTexturePack(Application *pApp);
+VkResult tryCreateBuffer(Application *pApp, VkDeviceSize size, VkBufferUsageFlags usage, uint32_t memoryUsage, VkBuffer *buffer, VkDeviceMemory *bufferMemory, uint32_t *pMemoryType);
+uint32_t createBuffer(Application *pApp, VkDeviceSize size, VkBufferUsageFlags usage, uint32_t memoryUsage, VkBuffer *buffer, VkDeviceMemory *bufferMemory);
+void createStaticBuffer(Application *pApp, const void *pData, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer *buffer, VkDeviceMemory *bufferMemory);
+void createPoolBuffer(Application *pApp, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer *buffer, VkDeviceMemory *bufferMemory, void **ppMapped, uint32_t *pMemoryType);
+void uploadBufferRange(Application *pApp, const void *pData, VkDeviceSize offset, VkDeviceSize size, VkBuffer buffer, VkDeviceMemory bufferMemory, void *pMapped, VkDeviceSize mappedSize, uint32_t memoryType);
+void createGeometryPool(Application *pApp);
+void uploadMesh(Application *pApp, const Mesh *pMesh, GeometryRange *pRange);
 void createUniformBuffers(Application *pApp);
-void createDescriptorPool(Application *pApp);
+void createInstanceBuffers(Application *pApp);
+void createSceneEntities(Application *pApp);
+void validateTransforms(Application *pApp);
+void moveSceneEntities(Application *pApp);
+void updateInstanceBuffer(Application *pApp, uint32_t currentFrame);
+float sceneExtent(Application *pApp);
+vector cameraEye(Application *pApp);
+vector instancePosition(Application *pApp, uint32_t instance);
+void runBenchmark(Application *pApp);
 void createDescriptorSets(Application *pApp);
+void updateFrameDescriptors(Application *pApp, uint32_t currentFrame);
+void initProfiler(Application *pApp);
+void updateStatsTitle(Application *pApp);
+void parseArguments(Config *pConfig, int argc, char **argv);
 
 void initWindow(Application *pApp)
 {
@@ -185,6 +331,56 @@ void initWindow(Application *pApp)
     glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
     pApp->window = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan", NULL, NULL);
+    glfwSetWindowUserPointer(pApp->window, pApp);
+    glfwSetFramebufferSizeCallback(pApp->window, framebufferResizeCallback);
+    glfwSetMouseButtonCallback(pApp->window, mouseButtonCallback);
+}
+
+void framebufferResizeCallback(GLFWwindow *window, int width, int height)//Only flags the resize, a burst of events during a drag turns into a single recreation on the next frame
+{
+    Application *pApp = glfwGetWindowUserPointer(window);
+    pApp->framebufferResized = 1;
+}
+
+void mouseButtonCallback(GLFWwindow *window, int button, int action, int mods)//Left click picks the nearest entity under the cursor
+{
+    Application *pApp = glfwGetWindowUserPointer(window);
+    if(button != GLFW_MOUSE_BUTTON_LEFT || action != GLFW_PRESS || pApp->bvh.entityCount == 0)
+    {
+        return;
+    }
+    
+    double x, y;
+    int width, height;
+    glfwGetCursorPos(window, &x, &y);
+    glfwGetWindowSize(window, &width, &height);
+    if(width == 0 || height == 0)
+    {
+        return;
+    }
+    
+    vector eye = cameraEye(pApp);//Same basis as cameraMatrix, the projection keeps view y pointing down the screen
+    vector up = {0.0f, 0.0f, 1.0f};
+    vector forward = normalise(v_sub((vector){0.0f, 0.0f, 0.0f}, eye));
+    vector right = normalise(crossproduct(forward, up));
+    vector down = crossproduct(forward, right);
+    float tanHalf = tanf(0.5f * CAMERA_FOV);
+    float viewX = (float)(2.0 * x / width - 1.0) * tanHalf * width / (float)height;
+    float viewY = (float)(2.0 * y / height - 1.0) * tanHalf;
+    vector direction = normalise((vector){
+        .x = forward.x + viewX * right.x + viewY * down.x,
+        .y = forward.y + viewX * right.y + viewY * down.y,
+        .z = forward.z + viewX * right.z + viewY * down.z
+    });
+    
+    float distance;
+    uint32_t dense = bvhRaycast(&pApp->bvh, pApp->entities.bounds, eye, direction, &distance);
+    if(dense == UINT32_MAX)
+    {
+        printf("Picked nothing\n");
+        return;
+    }
+    printf("Picked entity %u at distance %.2f\n", pApp->entities.entities[dense], distance);
 }
 
 void createInstance(Application *pApp)
@@ -195,7 +391,7 @@ void createInstance(Application *pApp)
         .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
         .pEngineName = "No Engine",
         .engineVersion = VK_MAKE_VERSION(1, 0, 0),
-        .apiVersion = VK_API_VERSION_1_0
+        .apiVersion = VK_API_VERSION_1_1
     };
 
     uint32_t glfwExtensionCount = 0;
@@ -406,11 +602,16 @@ void pickPhysicalDevice(Application *pApp)
 
     for(int i = 0; i < deviceCount; i++)
     {
-        if(isDeviceSuitable(devices[i], pApp->surface))
+        DeviceCapabilities capabilities;
+        queryDeviceCapabilities(&capabilities, devices[i], pApp->surface);
+        if(isDeviceSuitable(&capabilities))
         {
             pApp->physicalDevice = devices[i];
+            pApp->capabilities = capabilities;//Kept for the lifetime of the device, everything later reads from it
+            pApp->queueFamilies = findQueueFamilies(&capabilities);
             break;
         }
+        freeDeviceCapabilities(&capabilities);
     }
 
     if(pApp->physicalDevice == VK_NULL_HANDLE)
@@ -420,46 +621,24 @@ void pickPhysicalDevice(Application *pApp)
     }
 }
 
-uint32_t isDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface)
+uint32_t isDeviceSuitable(DeviceCapabilities *pCapabilities)
 {
-    VkPhysicalDeviceProperties deviceProperties;
-    VkPhysicalDeviceFeatures deviceFeatures;
-    vkGetPhysicalDeviceProperties(device, &deviceProperties);
-    vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
-
-    QueueFamilyIndices indices = findQueueFamilies(device, surface);
+    QueueFamilyIndices indices = findQueueFamilies(pCapabilities);
     
-    uint32_t extensionSupport = checkDeviceExtensionSupport(device);
-    uint32_t swapChainAdequate = 0;
-    if (extensionSupport) {
-        SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device, surface);
-        swapChainAdequate = (swapChainSupport.formatCount != 0) && (swapChainSupport.presentModeCount != 0);
-    }
+    uint32_t extensionSupport = checkDeviceExtensionSupport(pCapabilities);
+    uint32_t swapChainAdequate = (pCapabilities->formatCount != 0) && (pCapabilities->presentModeCount != 0);
     return isComplete(indices) && extensionSupport && swapChainAdequate;
 }
 
-uint32_t checkDeviceExtensionSupport(VkPhysicalDevice device) {
-    uint32_t extensionCount;
-    vkEnumerateDeviceExtensionProperties(device, NULL, &extensionCount, NULL);
-    
-    VkExtensionProperties pAvailableExtensions[extensionCount];
-    vkEnumerateDeviceExtensionProperties(device, NULL, &extensionCount, pAvailableExtensions);
-    
+uint32_t checkDeviceExtensionSupport(DeviceCapabilities *pCapabilities) {
     printf("\nRequired device extension support:\n");
     for(int i = 0; i < requiredExtensionCount; i++)
     {
-        uint32_t check = 0;
-        for(int j = 0; j < extensionCount; j++)
+        if(deviceHasExtension(pCapabilities, deviceExtensions[i]))
         {
-            if(strcmp(pAvailableExtensions[j].extensionName, deviceExtensions[i]))
-            {
-                printf("\t%s - supported\n", deviceExtensions[i]);
-                check = 1;
-                break;
-            }
+            printf("\t%s - supported\n", deviceExtensions[i]);
         }
-        
-        if(!check)
+        else
         {
             printf("\t%s - not supported\n", deviceExtensions[i]);
             return 0;
@@ -473,30 +652,22 @@ uint32_t isComplete(QueueFamilyIndices indices)
     return (indices.flagBits & GRAPHICS_FAMILY_BIT) && (indices.flagBits & PRESENT_FAMILY_BIT);
 }
 
-QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface)
+QueueFamilyIndices findQueueFamilies(DeviceCapabilities *pCapabilities)
 {
     QueueFamilyIndices indices;
     
     indices.flagBits = 0;
 
-    uint32_t queueFamilyCount = 0;
-    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, NULL);
-
-    VkQueueFamilyProperties queueFamilies[queueFamilyCount];
-    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies);
-
-    for(int i = 0; i < queueFamilyCount; i++)
+    for(int i = 0; i < pCapabilities->queueFamilyCount; i++)
     {
         
-        if((queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT))
+        if((pCapabilities->queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT))
         {
             indices.graphicsFamily = i;
             indices.flagBits |= GRAPHICS_FAMILY_BIT;
         }
 
-        VkBool32 presentSupport = VK_FALSE;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
-        if(presentSupport)
+        if(pCapabilities->presentSupport[i])
         {
             indices.presentFamily = i;
             indices.flagBits |= PRESENT_FAMILY_BIT;
@@ -513,7 +684,7 @@ QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surfa
 
 void createLogicalDevice(Application *pApp)
 {
-    QueueFamilyIndices indices = findQueueFamilies(pApp->physicalDevice, pApp->surface);
+    QueueFamilyIndices indices = pApp->queueFamilies;
     float queuePriority = 1.0f;
     uint32Tree *queueSet = allocTree();
     insert(queueSet, indices.graphicsFamily);
@@ -539,9 +710,45 @@ void createLogicalDevice(Application *pApp)
     VkPhysicalDeviceFeatures deviceFeatures = {
         0
     };
+    
+    if(pApp->config.occlusion)//The late phase draws start past the early ones in the culled instance buffer
+    {
+        if(pApp->capabilities.features.drawIndirectFirstInstance)
+        {
+            deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+        }
+        else
+        {
+            printf("Indirect draws with a first instance not supported, occlusion culling disabled\n");
+            pApp->config.occlusion = 0;
+        }
+    }
+
+    pApp->timelineSupported = !pApp->config.disableTimeline && pApp->capabilities.timelineSemaphore;
+    pApp->bindlessSupported = pApp->config.bindless && pApp->capabilities.descriptorIndexing;
+    if(pApp->config.bindless && !pApp->bindlessSupported)
+    {
+        printf("Descriptor indexing not supported, falling back to descriptor sets\n");
+    }
+    
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR,
+        .timelineSemaphore = VK_TRUE
+    };
+    
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT,
+        .pNext = pApp->timelineSupported ? &timelineFeatures : NULL,
+        .runtimeDescriptorArray = VK_TRUE,
+        .descriptorBindingPartiallyBound = VK_TRUE,
+        .descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE,
+        .descriptorBindingSampledImageUpdateAfterBind = VK_TRUE,
+        .shaderSampledImageArrayNonUniformIndexing = VK_TRUE//Texture indices vary within a draw
+    };
 
     VkDeviceCreateInfo createInfo = {
         .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+        .pNext = pApp->bindlessSupported ? (void *)&indexingFeatures : (pApp->timelineSupported ? (void *)&timelineFeatures : NULL),
         .pQueueCreateInfos = queueCreateInfos,
         .queueCreateInfoCount = queueCount,
         .pEnabledFeatures = &deviceFeatures,
@@ -557,7 +764,7 @@ void createLogicalDevice(Application *pApp)
     {
         createInfo.enabledLayerCount = 0;
     }
-    const char *requiredDeviceExtensions[requiredExtensionCount + enableCompatibilityBit];
+    const char *requiredDeviceExtensions[requiredExtensionCount + enableCompatibilityBit + 4];
     createInfo.enabledExtensionCount = requiredExtensionCount;
     for(int i = 0; i < requiredExtensionCount; i++)
     {
@@ -570,6 +777,25 @@ void createLogicalDevice(Application *pApp)
         createInfo.enabledExtensionCount++;
     }
     
+    if(pApp->timelineSupported)
+    {
+        requiredDeviceExtensions[createInfo.enabledExtensionCount] = VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME;
+        createInfo.enabledExtensionCount++;
+    }
+    
+    if(pApp->capabilities.memoryBudget)
+    {
+        requiredDeviceExtensions[createInfo.enabledExtensionCount] = VK_EXT_MEMORY_BUDGET_EXTENSION_NAME;
+        createInfo.enabledExtensionCount++;
+    }
+    
+    if(pApp->bindlessSupported)
+    {
+        requiredDeviceExtensions[createInfo.enabledExtensionCount] = VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME;
+        requiredDeviceExtensions[createInfo.enabledExtensionCount + 1] = VK_KHR_MAINTENANCE3_EXTENSION_NAME;
+        createInfo.enabledExtensionCount += 2;
+    }
+    
     createInfo.ppEnabledExtensionNames = requiredDeviceExtensions;
     
     if (vkCreateDevice(pApp->physicalDevice, &createInfo, NULL, &pApp->device) != VK_SUCCESS) {
@@ -590,36 +816,12 @@ void createSurface(Application *pApp)
     }
 }
 
-SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface) {
-    SwapChainSupportDetails details;
-    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
-
-    vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &details.formatCount, NULL);
-
-    if (details.formatCount != 0) {
-        VkSurfaceFormatKHR formats[details.formatCount];
-        details.formats = formats;
-        vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &details.formatCount, details.formats);
-    }
-    
-    vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &details.presentModeCount, NULL);
-
-    if (details.presentModeCount != 0) {
-        VkPresentModeKHR presentModes[details.presentModeCount];
-        details.presentModes = presentModes;
-        vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &details.presentModeCount, details.presentModes);
-    }
-    return details;
-}
-
-VkSurfaceFormatKHR chooseSwapSurfaceFormat(VkPhysicalDevice device, VkSurfaceKHR surface)//Selects color space, could add ranking
+VkSurfaceFormatKHR chooseSwapSurfaceFormat(DeviceCapabilities *pCapabilities)//Selects color space, could add ranking
 {
-    uint32_t formatCount = 0;
-    vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, NULL);
-    VkSurfaceFormatKHR availableFormats[formatCount];
+    uint32_t formatCount = pCapabilities->formatCount;
+    VkSurfaceFormatKHR *availableFormats = pCapabilities->formats;
     if(formatCount != 0)
     {
-        vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, availableFormats);
         for(int i = 0; i < formatCount; i++)
             {
                 VkSurfaceFormatKHR availableFormat = availableFormats[i];
@@ -637,9 +839,17 @@ VkSurfaceFormatKHR chooseSwapSurfaceFormat(VkPhysicalDevice device, VkSurfaceKHR
     }
 }
 
-VkPresentModeKHR chooseSwapPresentMode(SwapChainSupportDetails *details)//Selects how the swap chain displays images to the screen, VK_PRESENT_MODE_FIFO_KHR -> display takes images in front of queue, inserts rendered images to the back
+VkPresentModeKHR chooseSwapPresentMode(DeviceCapabilities *details, uint32_t preferImmediate)//Selects how the swap chain displays images to the screen, VK_PRESENT_MODE_FIFO_KHR -> display takes images in front of queue, inserts rendered images to the back
 {
     VkPresentModeKHR availablePresentMode;
+    if(preferImmediate)//Benchmarks should not be capped by the refresh rate
+    {
+        for (int i = 0; i < details->presentModeCount; i++) {
+            if (details->presentModes[i] == VK_PRESENT_MODE_IMMEDIATE_KHR) {
+                return VK_PRESENT_MODE_IMMEDIATE_KHR;
+            }
+        }
+    }
     for (int i = 0; i < details->presentModeCount; i++) {
         availablePresentMode = details->presentModes[i];
             if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
@@ -674,16 +884,17 @@ VkExtent2D chooseSwapExtent(VkSurfaceCapabilitiesKHR *capabilities, GLFWwindow *
 
 void createSwapChain(Application *pApp) 
 {
-    SwapChainSupportDetails swapChainSupport = querySwapChainSupport(pApp->physicalDevice, pApp->surface);
+    refreshSurfaceCapabilities(&pApp->capabilities, pApp->surface);
+    VkSurfaceCapabilitiesKHR *pSurfaceCapabilities = &pApp->capabilities.surfaceCapabilities;
 
-    VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(pApp->physicalDevice, pApp->surface);
-    VkPresentModeKHR presentMode = chooseSwapPresentMode(&swapChainSupport);
-    VkExtent2D extent = chooseSwapExtent(&swapChainSupport.capabilities, pApp->window);
+    VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(&pApp->capabilities);
+    VkPresentModeKHR presentMode = chooseSwapPresentMode(&pApp->capabilities, pApp->config.benchmark.enabled);
+    VkExtent2D extent = chooseSwapExtent(pSurfaceCapabilities, pApp->window);
     
-    uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+    uint32_t imageCount = pSurfaceCapabilities->minImageCount + 1;
     //maxImageCount = 0 -> no maximum #images
-    if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
-        imageCount = swapChainSupport.capabilities.maxImageCount;
+    if (pSurfaceCapabilities->maxImageCount > 0 && imageCount > pSurfaceCapabilities->maxImageCount) {
+        imageCount = pSurfaceCapabilities->maxImageCount;
     }
     
     VkSwapchainCreateInfoKHR createInfo = {
@@ -694,15 +905,25 @@ void createSwapChain(Application *pApp)
         .imageColorSpace = surfaceFormat.colorSpace,
         .imageExtent = extent,
         .imageArrayLayers = 1,
-        .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,//Specifies what kinds of operations the images will be used for, currently rendering directly to them
-        .preTransform = swapChainSupport.capabilities.currentTransform,//Can specify transforms to apply to images in swap chain
+        .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,//Specifies what kinds of operations the images will be used for, rendering directly to them unless upscaled
+        .preTransform = pSurfaceCapabilities->currentTransform,//Can specify transforms to apply to images in swap chain
         .compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,//Opaque -> alpha channel should not be used to blend with other windows
         .presentMode = presentMode,
         .clipped = VK_TRUE,//True -> we don't care about color of obscured pixel
-        .oldSwapchain = VK_NULL_HANDLE//If swap chain must be replaced, then reference to old one must be given here
+        .oldSwapchain = pApp->swapChain//If swap chain must be replaced, then reference to old one must be given here, VK_NULL_HANDLE on the first creation
     };
     
-    QueueFamilyIndices indices = findQueueFamilies(pApp->physicalDevice, pApp->surface);
+    if(pApp->config.gpuBudget > 0.0f)//Only written by the upscale blit
+    {
+        if(!(pSurfaceCapabilities->supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
+        {
+            printf("Swap chain images can not be blitted to, dynamic resolution is unavailable!\n");
+            exit(1);
+        }
+        createInfo.imageUsage = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    }
+    
+    QueueFamilyIndices indices = pApp->queueFamilies;
     uint32_t queueFamilyIndices[] = {indices.graphicsFamily, indices.presentFamily};
 
     if (indices.graphicsFamily != indices.presentFamily) {
@@ -732,6 +953,11 @@ void createSwapChain(Application *pApp)
 
 void createImageViews(Application *pApp)
 {
+    pApp->swapChainImageViews = NULL;
+    if(pApp->config.gpuBudget > 0.0f)//Transfer destinations only, a view of them would be invalid
+    {
+        return;
+    }
     pApp->swapChainImageViews = malloc(pApp->imageCount * sizeof(VkImageView));
     for (size_t i = 0; i < pApp->imageCount; i++)
     {
@@ -779,17 +1005,28 @@ VkShaderModule createShaderModule(Application *pApp, char *shaderFile)
     return shaderModule;
 }
 
-void createRenderPass(Application *pApp)
+void createRenderPass(Application *pApp)//The frame graph moves the attachments into these layouts and orders the passes with barriers, so no dependencies are declared
 {
     VkAttachmentDescription colorAttachment = {
-        .format = pApp->swapChainImageFormat,
+        .format = pApp->swapChainImageFormat,//Also the render target's, the upscale blit only scales
         .samples = VK_SAMPLE_COUNT_1_BIT,
         .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,//Specifies what to do with the data in the attachment before and after rendering
         .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
         .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
         .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-        .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+        .initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        .finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+    };
+    
+    VkAttachmentDescription depthAttachment = {
+        .format = pApp->depthFormat,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,//Never read after the pass, so tiled GPUs keep it on chip
+        .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+        .finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
     };
     
     VkAttachmentReference colorAttachmentRef = {
@@ -797,40 +1034,63 @@ void createRenderPass(Application *pApp)
         .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
     };
     
+    VkAttachmentReference depthAttachmentRef = {
+        .attachment = 1,
+        .layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+    };
+    
     VkSubpassDescription subpass = {
         subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
         .colorAttachmentCount = 1,
-        .pColorAttachments = &colorAttachmentRef
+        .pColorAttachments = &colorAttachmentRef,
+        .pDepthStencilAttachment = &depthAttachmentRef
     };
     
-    VkSubpassDependency dependency = {
-        .srcSubpass = VK_SUBPASS_EXTERNAL,//Specifies the indices of the dependency in the dependent subpass
-        .dstSubpass = 0,
-        .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,//Specifies the operations to wait for, and in which stage they occur
-        .srcAccessMask = 0,
-        .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,//Specifies the operations waiting for the previous operations, and in which stage they occur
-        .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
-    };
+    VkAttachmentDescription attachments[2] = {colorAttachment, depthAttachment};
     
     VkRenderPassCreateInfo renderPassInfo = {
         .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
-        .attachmentCount = 1,
-        .pAttachments = &colorAttachment,
+        .attachmentCount = 2,
+        .pAttachments = attachments,
         .subpassCount = 1,
         .pSubpasses = &subpass,
-        .dependencyCount = 1,
-        .pDependencies = &dependency
+        .dependencyCount = 0,
+        .pDependencies = NULL
     };
     
-    
+    if(pApp->config.occlusion)//The early pass keeps depth for the pyramid build and the late pass
+    {
+        attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    }
     
     if (vkCreateRenderPass(pApp->device, &renderPassInfo, NULL, &pApp->renderPass) != VK_SUCCESS) {
         printf("Failed to create render pass!");
         exit(1);
     }
+    
+    if(pApp->config.occlusion)
+    {
+        attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;//Compatible with renderPass, so the same framebuffers and pipelines work in both
+        attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+        attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        
+        if (vkCreateRenderPass(pApp->device, &renderPassInfo, NULL, &pApp->lateRenderPass) != VK_SUCCESS) {
+            printf("Failed to create late render pass!");
+            exit(1);
+        }
+    }
 }
 
 void createDescriptorSetLayout(Application *pApp) {
+    if(pApp->bindlessSupported)//The bindless table brings its own layout
+    {
+        uint32_t maxBuffers = BINDLESS_MAX_BUFFERS < pApp->capabilities.maxBindlessBuffers ? BINDLESS_MAX_BUFFERS : pApp->capabilities.maxBindlessBuffers;
+        uint32_t maxImages = BINDLESS_MAX_IMAGES < pApp->capabilities.maxBindlessImages ? BINDLESS_MAX_IMAGES : pApp->capabilities.maxBindlessImages;
+        createBindlessTable(&pApp->bindless, pApp->device, maxBuffers, maxImages);
+        pApp->descriptorSetLayout = pApp->bindless.layout;
+        return;
+    }
+    
     VkDescriptorSetLayoutBinding uboLayoutBinding = {
         .binding = 0, //Which binding is used
         .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, //Type of descriptor
@@ -850,19 +1110,38 @@ void createDescriptorSetLayout(Application *pApp) {
         printf("failed to create descriptor set layout!");
         exit(1);
     }
+    
+    pApp->frameDescriptors = malloc(sizeof(DescriptorAllocator) * pApp->config.framesInFlight);
+    for(uint32_t i = 0; i < pApp->config.framesInFlight; i++)//Pools are sized from the layout, per-frame sets are allocated from them every frame
+    {
+        createDescriptorAllocator(&pApp->frameDescriptors[i], pApp->descriptorSetLayout, &uboLayoutBinding, 1);
+    }
 }
 
 void createGraphicsPipeline(Application *pApp)
 {
-    VkShaderModule vertexModule = createShaderModule(pApp, "shaders/vert.spv");
-    VkShaderModule fragmentModule = createShaderModule(pApp, "shaders/frag.spv");
+    VkShaderModule vertexModule = createShaderModule(pApp, pApp->bindlessSupported ? "shaders/vert_bindless.spv" : "shaders/vert.spv");
+    VkShaderModule fragmentModule = createShaderModule(pApp, pApp->bindlessSupported ? "shaders/frag_bindless.spv" : "shaders/frag.spv");
+    
+    VkBool32 octahedralNormals = pApp->config.vertexLayout.formats[VERTEX_ATTRIBUTE_NORMAL] == VERTEX_FORMAT_OCTAHEDRAL16;
+    VkSpecializationMapEntry specializationEntry = {
+        .constantID = 0,//constant_id of octahedralNormals in shader.vert
+        .offset = 0,
+        .size = sizeof(VkBool32)
+    };
+    VkSpecializationInfo specializationInfo = {
+        .mapEntryCount = 1,
+        .pMapEntries = &specializationEntry,
+        .dataSize = sizeof(VkBool32),
+        .pData = &octahedralNormals
+    };
     
     VkPipelineShaderStageCreateInfo vertShaderStageInfo = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
         .stage = VK_SHADER_STAGE_VERTEX_BIT,
         .module = vertexModule,//Determines the module containing the code
         .pName = "main",//Determines which function will invoke the shader
-        .pSpecializationInfo = NULL//Optional member specifying values for shader constants
+        .pSpecializationInfo = &specializationInfo//Optional member specifying values for shader constants
     };
     
     VkPipelineShaderStageCreateInfo fragShaderStageInfo = {
@@ -887,15 +1166,17 @@ void createGraphicsPipeline(Application *pApp)
         .pDynamicStates = dynamicStates
     };
     
-    VkVertexInputBindingDescription bindingDescription = getBindingDescription();
-    VkVertexInputAttributeDescription *attributeDescriptions = getAttributeDescriptions();
+    VkVertexInputBindingDescription bindingDescriptions[2];
+    getBindingDescriptions(&pApp->config.vertexLayout, bindingDescriptions);
+    VkVertexInputAttributeDescription attributeDescriptions[VERTEX_ATTRIBUTE_COUNT + INSTANCE_ATTRIBUTE_COUNT];
+    getAttributeDescriptions(&pApp->config.vertexLayout, attributeDescriptions);
     
     //Specifies the bindings and attribute descriptions
     VkPipelineVertexInputStateCreateInfo vertexInputInfo = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-        .vertexBindingDescriptionCount = 1,
-        .pVertexBindingDescriptions = &bindingDescription, // Optional
-        .vertexAttributeDescriptionCount = 2,
+        .vertexBindingDescriptionCount = 2,
+        .pVertexBindingDescriptions = bindingDescriptions, // Optional
+        .vertexAttributeDescriptionCount = VERTEX_ATTRIBUTE_COUNT + INSTANCE_ATTRIBUTE_COUNT,
         .pVertexAttributeDescriptions = attributeDescriptions
     };
     
@@ -982,12 +1263,18 @@ void createGraphicsPipeline(Application *pApp)
         .blendConstants[3] = 0.0f // Optional
     };
     
+    VkPushConstantRange pushConstantRange = {
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+        .offset = 0,
+        .size = sizeof(BindlessPushConstants)
+    };
+    
     VkPipelineLayoutCreateInfo pipelineLayoutInfo = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
         .setLayoutCount = 1, // Optional
         .pSetLayouts = &pApp->descriptorSetLayout, // Optional
-        .pushConstantRangeCount = 0, // Optional
-        .pPushConstantRanges = NULL // Optional
+        .pushConstantRangeCount = pApp->bindlessSupported, //Bindless draws pass their table indices as push constants
+        .pPushConstantRanges = &pushConstantRange // Optional
     };
     
     if (vkCreatePipelineLayout(pApp->device, &pipelineLayoutInfo, NULL, &pApp->pipelineLayout) != VK_SUCCESS)
@@ -996,6 +1283,15 @@ void createGraphicsPipeline(Application *pApp)
         exit(1);
     }
     
+    VkPipelineDepthStencilStateCreateInfo depthStencil = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+        .depthTestEnable = VK_TRUE,
+        .depthWriteEnable = VK_TRUE,
+        .depthCompareOp = VK_COMPARE_OP_LESS,//The fragment shader writes no depth, so hidden fragments are rejected before shading
+        .depthBoundsTestEnable = VK_FALSE,
+        .stencilTestEnable = VK_FALSE
+    };
+    
     VkGraphicsPipelineCreateInfo pipelineInfo = {
         .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
         .stageCount = 2,
@@ -1005,7 +1301,7 @@ void createGraphicsPipeline(Application *pApp)
         .pViewportState = &viewportState,
         .pRasterizationState = &rasterizer,
         .pMultisampleState = &multisampling,
-        .pDepthStencilState = NULL,
+        .pDepthStencilState = &depthStencil,
         .pColorBlendState = &colorBlending,
         .pDynamicState = &dynamicState,
         .layout = pApp->pipelineLayout,
@@ -1025,15 +1321,34 @@ void createGraphicsPipeline(Application *pApp)
 
 void createFramebuffers(Application *pApp)
 {
+    pApp->swapChainFramebuffers = NULL;
+    if(pApp->config.gpuBudget > 0.0f)//Every frame renders to the render target, the swap chain images are only blitted to
+    {
+        VkImageView attachments[2] = {renderGraphImageView(&pApp->frameGraph, pApp->colorResource), renderGraphImageView(&pApp->frameGraph, pApp->depthResource)};
+        VkFramebufferCreateInfo framebufferInfo = {
+            .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+            .renderPass = pApp->renderPass,
+            .attachmentCount = 2,
+            .pAttachments = attachments,
+            .width = pApp->targetExtent.width,
+            .height = pApp->targetExtent.height,
+            .layers = 1
+        };
+        
+        if (vkCreateFramebuffer(pApp->device, &framebufferInfo, NULL, &pApp->renderTargetFramebuffer) != VK_SUCCESS) {
+                printf("Failed to create framebuffer!");
+        }
+        return;
+    }
     pApp->swapChainFramebuffers = malloc(pApp->imageCount * sizeof(VkFramebuffer));
     for(int i = 0; i < pApp->imageCount; i++)
     {
-        VkImageView attachments = pApp->swapChainImageViews[i];
+        VkImageView attachments[2] = {pApp->swapChainImageViews[i], renderGraphImageView(&pApp->frameGraph, pApp->depthResource)};
         VkFramebufferCreateInfo framebufferInfo = {
             .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
             .renderPass = pApp->renderPass,
-            .attachmentCount = 1,
-            .pAttachments = &attachments,
+            .attachmentCount = 2,
+            .pAttachments = attachments,
             .width = pApp->swapChainExtent.width,
             .height = pApp->swapChainExtent.height,
             .layers = 1
@@ -1045,9 +1360,30 @@ void createFramebuffers(Application *pApp)
     }
 }
 
+VkFormat findDepthFormat(Application *pApp)//Prefers plain 32-bit float depth, nothing here uses stencil but the fallbacks carry it
+{
+    VkFormat candidates[] = {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT};
+    VkFormatFeatureFlags features = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    if(pApp->config.occlusion)//The depth pyramid is built from it
+    {
+        features |= VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+    }
+    for(uint32_t i = 0; i < sizeof(candidates) / sizeof(candidates[0]); i++)
+    {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(pApp->physicalDevice, candidates[i], &properties);
+        if((properties.optimalTilingFeatures & features) == features)
+        {
+            return candidates[i];
+        }
+    }
+    printf("Failed to find a depth format!\n");
+    exit(1);
+}
+
 void createCommandPool(Application *pApp)
 {
-    QueueFamilyIndices queueFamilyIndices = findQueueFamilies(pApp->physicalDevice, pApp->surface);
+    QueueFamilyIndices queueFamilyIndices = pApp->queueFamilies;
     
     VkCommandPoolCreateInfo poolInfo = {
         .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
@@ -1063,13 +1399,13 @@ void createCommandPool(Application *pApp)
 
 void createCommandBuffer(Application *pApp)
 {
-    pApp->commandBuffers = malloc(sizeof(VkCommandBuffer) * MAX_FRAMES_IN_FLIGHT);
+    pApp->commandBuffers = malloc(sizeof(VkCommandBuffer) * pApp->config.framesInFlight);
     
     VkCommandBufferAllocateInfo allocInfo = {
         .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
         .commandPool = pApp->commandPool,
         .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,//Specifies if the command buffers are primary or secondary
-        .commandBufferCount = MAX_FRAMES_IN_FLIGHT
+        .commandBufferCount = pApp->config.framesInFlight
     };
     
     if(vkAllocateCommandBuffers(pApp->device, &allocInfo, pApp->commandBuffers) != VK_SUCCESS) {
@@ -1078,42 +1414,68 @@ void createCommandBuffer(Application *pApp)
     }
 }
 
-void recordCommandBuffer(VkCommandBuffer commandBuffer, Application *pApp, uint32_t imageIndex)
+static void recordStreamPass(VkCommandBuffer commandBuffer, void *pData, uint32_t argument)//Uploads and their layout changes are ordered against sampling by the streamer
 {
-    VkCommandBufferBeginInfo beginInfo = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-        .flags = 0,//Specifies how the command buffer will be used
-        .pInheritanceInfo = NULL//Specifies which state to inherit from primary calling command buffer
-    };
-    
-    if(vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
-        printf("Failed to begin recording command buffer");
-        exit(1);
+    Application *pApp = pData;
+    textureStreamerUpdate(&pApp->textureStreamer, commandBuffer, pApp->frameIndex, pApp->frameSync.submittedValue, pApp->frameSync.submittedValue + 1);
+}
+
+static void recordTransformPass(VkCommandBuffer commandBuffer, void *pData, uint32_t argument)
+{
+    Application *pApp = pData;
+    transformStageDispatch(&pApp->transformStage, commandBuffer, pApp->frameIndex, pApp->visibleCount, (float)pApp->simulationTime);
+}
+
+static void recordParticlePass(VkCommandBuffer commandBuffer, void *pData, uint32_t argument)
+{
+    Application *pApp = pData;
+    particleSystemDispatch(&pApp->particles, commandBuffer, pApp->frameIndex, (float)(pApp->simulationTime - pApp->particleTime));
+    pApp->particleTime = pApp->simulationTime;
+}
+
+static void recordOcclusionPass(VkCommandBuffer commandBuffer, void *pData, uint32_t phase)
+{
+    Application *pApp = pData;
+    if(phase == OCCLUSION_PHASE_EARLY)
+    {
+        profilerCmdTimestamp(&pApp->profiler, commandBuffer, pApp->frameIndex, 0);
+        occlusionCullerEarly(&pApp->occlusion, commandBuffer, pApp->frameIndex, pApp->visibleCount, pApp->camera.view, pApp->camera.projection);
+        return;
+    }
+    occlusionCullerLate(&pApp->occlusion, commandBuffer, pApp->frameIndex, pApp->visibleCount, pApp->camera.view, pApp->camera.projection, pApp->renderExtent);
+}
+
+static void recordScenePass(VkCommandBuffer commandBuffer, void *pData, uint32_t phase)//With occlusion culling, what was visible last frame is drawn in the early phase and its depth hides the rest from the late one
+{
+    Application *pApp = pData;
+    uint32_t phaseCount = pApp->config.occlusion ? OCCLUSION_PHASE_COUNT : 1;
+    if(!pApp->config.occlusion)
+    {
+        profilerCmdTimestamp(&pApp->profiler, commandBuffer, pApp->frameIndex, 0);
     }
     
-    VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
+    VkClearValue clearValues[2] = {
+        {.color = {{0.0f, 0.0f, 0.0f, 1.0f}}},
+        {.depthStencil = {1.0f, 0}}
+    };
     
     VkRenderPassBeginInfo renderPassInfo = {
         .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-        .renderPass = pApp->renderPass,
-        .framebuffer = pApp->swapChainFramebuffers[imageIndex],
+        .renderPass = phase == OCCLUSION_PHASE_LATE ? pApp->lateRenderPass : pApp->renderPass,//The late pass loads both attachments, the clear values go unused
+        .framebuffer = pApp->config.gpuBudget > 0.0f ? pApp->renderTargetFramebuffer : pApp->swapChainFramebuffers[pApp->imageIndex],
         .renderArea.offset = {0,0},//Specifies the size of the render area
-        .renderArea.extent = pApp->swapChainExtent,
-        .clearValueCount = 1,//Specifies the clear values for the attachment clear operation to use
-        .pClearValues = &clearColor
+        .renderArea.extent = pApp->renderExtent,//The swap chain extent, or the part of the render target this frame's scale covers
+        .clearValueCount = 2,//Specifies the clear values for the attachment clear operation to use
+        .pClearValues = clearValues
     };
     
     vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
     
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pApp->graphicsPipeline);
-    
-    
-    
     VkViewport viewport = {
         .x = 0.0f,
         .y = 0.0f,
-        .width = (float)pApp->swapChainExtent.width,
-        .height = (float)pApp->swapChainExtent.height,
+        .width = (float)pApp->renderExtent.width,
+        .height = (float)pApp->renderExtent.height,
         .minDepth = 0.0f,
         .maxDepth = 1.0f
     };
@@ -1122,96 +1484,561 @@ void recordCommandBuffer(VkCommandBuffer commandBuffer, Application *pApp, uint3
     
     VkRect2D scissor = {
         .offset = {0,0},
-        .extent = pApp->swapChainExtent
+        .extent = pApp->renderExtent
     };
     
     vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
     
-    VkBuffer vertexBuffers[] = {pApp->vertexBuffer};
-    
-    VkDeviceSize offsets[] = {0};
-        
-    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);//Parameters 2, 3 specifies the offsets and how many vertex buffers to bind. Parameters 4, 5 specifies the array of vertex buffers to write and what offset to start reading from
-        
-    vkCmdBindIndexBuffer(commandBuffer, pApp->indexBuffer, 0, VK_INDEX_TYPE_UINT16);
-    
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pApp->pipelineLayout, 0, 1, &pApp->descriptorSets[frameIndex], 0, NULL);
-    
-    vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+    vkCmdBindIndexBuffer(commandBuffer, pApp->geometryPool.indexBuffer, 0, pApp->geometryPool.indexSize == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32);//Every mesh shares the pool index buffer, bound once per pass
     
-    vkCmdEndRenderPass(commandBuffer);
+    RenderQueue *pQueue = &pApp->renderQueue;
+    renderQueueReset(pQueue);
     
-    if(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
-        printf("Failed to record command buffer!");
-        exit(1);
+    uint32_t firstInstance = 0;
+    for(uint32_t lod = 0; lod < pApp->mesh.lodCount; lod++)//One draw per level of detail, instances were grouped by level in updateInstanceBuffer
+    {
+        uint32_t instanceCount = pApp->lodInstanceCounts[lod];
+        if(instanceCount > 0)
+        {
+            DrawCommand command = {
+                .pipeline = 0,
+                .descriptorSet = 0,
+                .mesh = 0,
+                .indexCount = pApp->mesh.lods[lod].indexCount,
+                .instanceCount = instanceCount,
+                .firstIndex = pApp->meshRange.firstIndex + pApp->mesh.lods[lod].firstIndex,
+                .vertexOffset = (int32_t)pApp->meshRange.firstVertex,
+                .firstInstance = firstInstance,
+                .indirect = pApp->config.occlusion,//Same level, only the culler knows how many of its instances each phase draws
+                .indirectIndex = lod
+            };
+            renderQueuePush(pQueue, renderKey(0, command.pipeline, command.descriptorSet, command.mesh, pApp->lodDepths[lod]), &command);
+            firstInstance += instanceCount;
+        }
     }
-}
-
-void updateUniformBuffer(Application *pApp, uint32_t currentFrame)
-{
-    clock_t currentTime = clock();
-    float dTime = (float)(currentTime - startTime)/CLOCKS_PER_SEC;
-    
-    UniformBufferObject ubo;
-    
-    vector axis = {0.0f, 0.0f, 1.0f};
-
-    rotationMatrix(ubo.model, dTime * 2*M_PI, axis);
-    
-    vector new_axis = {cos(dTime), sin(dTime), 0};
     
-    float rot[4][4];
-    rotationMatrix(rot, M_PI_4, new_axis);
+    renderQueueSort(pQueue);
     
-    matmul(rot, ubo.model);
+    RenderBindings bindings = {
+        .pipelines = &pApp->graphicsPipeline,
+        .pipelineLayout = pApp->pipelineLayout,
+        .descriptorSets = &pApp->descriptorSets[pApp->frameIndex],
+        .meshVertexBuffers = &pApp->geometryPool.vertexBuffer,
+        .instanceBuffer = pApp->instanceBuffers[pApp->frameIndex]
+    };
     
-    //matcpy(rot, ubo.model);
+    if(pApp->config.occlusion)
+    {
+        bindings.instanceBuffer = pApp->occlusion.outputBuffers[pApp->frameIndex];
+        bindings.indirectBuffer = pApp->occlusion.drawBuffers[pApp->frameIndex];
+        bindings.indirectOffset = phase * sizeof(((OcclusionDraws*)0)->draws[0]);
+    }
     
-    float d = 2.0f;
+    if(pApp->bindlessSupported)//Outlives every pipeline bind, the layouts match
+    {
+        BindlessPushConstants pushConstants = {
+            .uniformIndex = pApp->uniformIndices[pApp->frameIndex],
+            .textureIndex = textureStreamerBindlessIndex(&pApp->textureStreamer, 0)//Invalid until the first texture has a level resident, the shader falls back to vertex colours
+        };
+        vkCmdPushConstants(commandBuffer, pApp->pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pushConstants), &pushConstants);
+    }
     
-    vector camera = {d, d, d};
-    vector up = {0.0f, 0.0f, 1.0f};
-    vector object = {0.0f, 0.0f, 0.0f};
+    renderQueueRecord(pQueue, commandBuffer, &bindings);
     
-    cameraMatrix(ubo.view, camera, object, up);
-
-    float r = pApp->swapChainExtent.width/((float) pApp->swapChainExtent.height);
+    if(pApp->config.particleCount > 0 && phase == phaseCount - 1)
+    {
+        particleSystemDraw(&pApp->particles, commandBuffer, &pApp->camera);
+    }
     
-    perspectiveMatrix(ubo.projection, M_PI_2, r, 0.1f, 10.0f);
+    vkCmdEndRenderPass(commandBuffer);
+}
 
-    memcpy(pApp->uniformBuffersMapped[currentFrame], &ubo, sizeof(ubo));
+static void recordUpscalePass(VkCommandBuffer commandBuffer, void *pData, uint32_t argument)//Blits the rendered part of the render target over the whole swap chain image
+{
+    Application *pApp = pData;
+    VkImageBlit region = {
+        .srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+        .srcOffsets = {{0, 0, 0}, {(int32_t)pApp->renderExtent.width, (int32_t)pApp->renderExtent.height, 1}},
+        .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+        .dstOffsets = {{0, 0, 0}, {(int32_t)pApp->swapChainExtent.width, (int32_t)pApp->swapChainExtent.height, 1}}
+    };
+    vkCmdBlitImage(commandBuffer, renderGraphImage(&pApp->frameGraph, pApp->colorResource), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                   renderGraphImage(&pApp->frameGraph, pApp->swapChainResource), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region, pApp->upscaleFilter);
 }
 
-void drawFrame(Application *pApp)
+void buildFrameGraph(Application *pApp)//Declares every pass of a frame with what it reads and writes, the graph creates the depth buffer and render target and derives the barriers between the passes
 {
-    vkWaitForFences(pApp->device, 1, &pApp->inFlightFences[frameIndex], VK_TRUE, UINT64_MAX);
+    RenderGraph *pGraph = &pApp->frameGraph;
+    uint32_t upscaled = pApp->config.gpuBudget > 0.0f;
+    uint32_t occlusion = pApp->config.occlusion;
     
-    uint32_t imageIndex;
-    VkResult result = vkAcquireNextImageKHR(pApp->device, pApp->swapChain, UINT64_MAX, pApp->imageAvailableSemaphores[frameIndex], VK_NULL_HANDLE, &imageIndex);
+    pApp->targetExtent = pApp->swapChainExtent;
+    if(upscaled)//Sized for the largest scale, so changing the scale only changes the render area
+    {
+        pApp->targetExtent = resolutionScalerMaxExtent(&pApp->resolution, pApp->swapChainExtent);
+        
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(pApp->physicalDevice, pApp->swapChainImageFormat, &properties);
+        VkFormatFeatureFlags features = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+        if((properties.optimalTilingFeatures & features) != features)
+        {
+            printf("Swap chain format can not be blitted, dynamic resolution is unavailable!\n");
+            exit(1);
+        }
+        pApp->upscaleFilter = properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+    }
     
-    if(result == VK_ERROR_OUT_OF_DATE_KHR)
+    createRenderGraph(pGraph, pApp->device, &pApp->memoryPolicy);
+    
+    pApp->swapChainResource = renderGraphImportImage(pGraph, "swap chain", VK_IMAGE_ASPECT_COLOR_BIT,
+                                                     (RenderGraphState){0, 0, VK_IMAGE_LAYOUT_UNDEFINED},//Acquired with its contents undefined, its first use waits on the acquire semaphore
+                                                     (RenderGraphState){0, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR});//Presentation is ordered by the render finished semaphore
+    
+    VkImageUsageFlags depthUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;//Cleared on load and discarded on store, so it may live in lazily allocated memory
+    uint32_t depthMemory = MEMORY_USAGE_TRANSIENT;
+    if(occlusion)//Stored between the passes and sampled by the depth pyramid build
     {
-        recreateSwapChain(pApp);
-        return;
+        depthUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        depthMemory = MEMORY_USAGE_GPU_ONLY;
     }
+    VkImageAspectFlags depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+    if(pApp->depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT || pApp->depthFormat == VK_FORMAT_D24_UNORM_S8_UINT)//Layout transitions cover every aspect of the format
+    {
+        depthAspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+    }
+    pApp->depthResource = renderGraphCreateImage(pGraph, "depth", pApp->depthFormat, pApp->targetExtent, depthUsage, depthAspect, depthMemory);
     
-    else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+    pApp->colorResource = pApp->swapChainResource;
+    if(upscaled)
     {
-        printf("Failed to acquire swap chain image!");
-        exit(1);
+        pApp->colorResource = renderGraphCreateImage(pGraph, "render target", pApp->swapChainImageFormat, pApp->targetExtent,
+                                                     VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_COLOR_BIT, MEMORY_USAGE_GPU_ONLY);
     }
-
-    updateUniformBuffer(pApp, frameIndex);
-
-    vkResetFences(pApp->device, 1, &pApp->inFlightFences[frameIndex]);
     
-    vkResetCommandBuffer(pApp->commandBuffers[frameIndex], 0);
-
-    recordCommandBuffer(pApp->commandBuffers[frameIndex], pApp, imageIndex);
+    //Each buffer stands for the current frame's copy, the frame fences keep the other frames in flight apart
+    uint32_t instances = renderGraphImportBuffer(pGraph, "instances", (RenderGraphState){0});
+    uint32_t particles = RENDER_GRAPH_NONE;
+    if(pApp->config.particleCount > 0)
+    {
+        particles = renderGraphImportBuffer(pGraph, "particles", (RenderGraphState){0});
+    }
+    uint32_t culledInstances = RENDER_GRAPH_NONE;
+    uint32_t draws = RENDER_GRAPH_NONE;
+    if(occlusion)
+    {
+        culledInstances = renderGraphImportBuffer(pGraph, "culled instances", (RenderGraphState){0});
+        draws = renderGraphImportBuffer(pGraph, "indirect draws", (RenderGraphState){VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT, 0});//The drawn counts are read back once the frame's fence has signalled
+    }
+    
+    renderGraphAddPass(pGraph, "stream textures", RENDER_GRAPH_PASS_SIDE_EFFECT, recordStreamPass, pApp, 0);
+    
+    uint32_t pass;
+    if(pApp->config.animation == INSTANCE_ANIMATION_GPU)
+    {
+        pass = renderGraphAddPass(pGraph, "animate transforms", 0, recordTransformPass, pApp, 0);
+        renderGraphUse(pGraph, pass, instances, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, 0);
+    }
+    
+    if(particles != RENDER_GRAPH_NONE)
+    {
+        pass = renderGraphAddPass(pGraph, "simulate particles", 0, recordParticlePass, pApp, 0);
+        renderGraphUse(pGraph, pass, particles, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, 0);
+    }
+    
+    uint32_t phaseCount = occlusion ? OCCLUSION_PHASE_COUNT : 1;
+    for(uint32_t phase = 0; phase < phaseCount; phase++)
+    {
+        if(occlusion)
+        {
+            pass = renderGraphAddPass(pGraph, phase == OCCLUSION_PHASE_EARLY ? "occlusion early" : "occlusion late", 0, recordOcclusionPass, pApp, phase);
+            renderGraphUse(pGraph, pass, instances, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, 0);
+            renderGraphUse(pGraph, pass, culledInstances, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, 0);
+            renderGraphUse(pGraph, pass, draws, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, 0);
+            if(phase == OCCLUSION_PHASE_LATE)//The pyramid is built from the early pass depth
+            {
+                renderGraphUse(pGraph, pass, pApp->depthResource, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+            }
+        }
+        
+        const char *name = !occlusion ? "scene" : phase == OCCLUSION_PHASE_EARLY ? "scene early" : "scene late";
+        VkAccessFlags colorLoad = phase == OCCLUSION_PHASE_LATE ? VK_ACCESS_COLOR_ATTACHMENT_READ_BIT : 0;
+        pass = renderGraphAddPass(pGraph, name, 0, recordScenePass, pApp, phase);
+        renderGraphUse(pGraph, pass, pApp->colorResource, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | colorLoad, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        renderGraphUse(pGraph, pass, pApp->depthResource, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                       VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+        renderGraphUse(pGraph, pass, occlusion ? culledInstances : instances, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, 0);
+        if(occlusion)
+        {
+            renderGraphUse(pGraph, pass, draws, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, 0);
+        }
+        if(particles != RENDER_GRAPH_NONE && phase == phaseCount - 1)
+        {
+            renderGraphUse(pGraph, pass, particles, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT, 0);
+        }
+    }
+    
+    if(upscaled)
+    {
+        pass = renderGraphAddPass(pGraph, "upscale", 0, recordUpscalePass, pApp, 0);
+        renderGraphUse(pGraph, pass, pApp->colorResource, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+        renderGraphUse(pGraph, pass, pApp->swapChainResource, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    }
+    
+    renderGraphCompile(pGraph);
+    if(pApp->config.dumpGraph)
+    {
+        renderGraphDump(pGraph, stdout);
+    }
+}
+
+void recordCommandBuffer(VkCommandBuffer commandBuffer, Application *pApp, uint32_t imageIndex)
+{
+    VkCommandBufferBeginInfo beginInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = 0,//Specifies how the command buffer will be used
+        .pInheritanceInfo = NULL//Specifies which state to inherit from primary calling command buffer
+    };
+    
+    if(vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        printf("Failed to begin recording command buffer");
+        exit(1);
+    }
+    
+    profilerCmdResetQueries(&pApp->profiler, commandBuffer, pApp->frameIndex);
+    
+    pApp->imageIndex = imageIndex;
+    renderGraphSetImage(&pApp->frameGraph, pApp->swapChainResource, pApp->swapChainImages[imageIndex]);
+    renderGraphExecute(&pApp->frameGraph, commandBuffer);//Ends with the swap chain image ready to present
+    
+    profilerCmdTimestamp(&pApp->profiler, commandBuffer, pApp->frameIndex, 1);
+    
+    if(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        printf("Failed to record command buffer!");
+        exit(1);
+    }
+}
+
+void updateUniformBuffer(Application *pApp, uint32_t currentFrame)
+{
+    float dTime = (float)pApp->simulationTime;
+    
+    UniformBufferObject ubo;
+    
+    vector axis = {0.0f, 0.0f, 1.0f};
+
+    rotationMatrix(ubo.model, dTime * 2*M_PI, axis);
+    
+    vector new_axis = {cos(dTime), sin(dTime), 0};
+    
+    float rot[4][4];
+    rotationMatrix(rot, M_PI_4, new_axis);
+    
+    matmul(rot, ubo.model);
+    
+    //matcpy(rot, ubo.model);
+    
+    float extent = sceneExtent(pApp);
+    
+    vector camera = cameraEye(pApp);
+    vector up = {0.0f, 0.0f, 1.0f};
+    vector object = {0.0f, 0.0f, 0.0f};
+    
+    cameraMatrix(ubo.view, camera, object, up);
+
+    float r = pApp->swapChainExtent.width/((float) pApp->swapChainExtent.height);
+    
+    perspectiveMatrix(ubo.projection, CAMERA_FOV, r, CAMERA_NEAR, norm(camera) + extent + 2.0f);//Far enough for the farthest instance, tight enough to keep depth precision
+    
+    for(uint32_t c = 0; c < 3; c++)
+    {
+        ubo.positionScale[c] = pApp->vertexDequantization.positionScale[c];
+        ubo.positionOffset[c] = pApp->vertexDequantization.positionOffset[c];
+    }
+    ubo.positionScale[3] = 0.0f;
+    ubo.positionOffset[3] = 0.0f;
+    
+    memcpy(pApp->camera.view, ubo.view, sizeof(ubo.view));
+    memcpy(pApp->camera.projection, ubo.projection, sizeof(ubo.projection));
+    frustumFromCamera(&pApp->frustum, ubo.view, ubo.projection);
+
+    memcpy(pApp->uniformBuffersMapped[currentFrame], &ubo, sizeof(ubo));
+    memoryPolicyFlush(&pApp->memoryPolicy, pApp->device, pApp->uniformBuffersMemory[currentFrame], pApp->uniformMemoryType, 0, VK_WHOLE_SIZE, VK_WHOLE_SIZE);
+    
+    updateInstanceBuffer(pApp, currentFrame);
+}
+
+float sceneExtent(Application *pApp)//Distance between the outermost instance centres along one side of the grid, or through the overdraw stack
+{
+    if(pApp->config.benchmark.scene == BENCHMARK_SCENE_OVERDRAW)
+    {
+        uint32_t layers = (pApp->config.benchmark.instanceCount + OVERDRAW_LAYER_SIDE * OVERDRAW_LAYER_SIDE - 1) / (OVERDRAW_LAYER_SIDE * OVERDRAW_LAYER_SIDE);
+        float depth = (layers - 1) * OVERDRAW_LAYER_SPACING;
+        float width = (OVERDRAW_LAYER_SIDE - 1) * INSTANCE_SPACING;
+        return depth > width ? depth : width;
+    }
+    uint32_t side = (uint32_t)ceil(sqrt((double)pApp->config.benchmark.instanceCount));
+    return (side - 1) * INSTANCE_SPACING;
+}
+
+vector cameraEye(Application *pApp)
+{
+    float d = 2.0f + sceneExtent(pApp);
+    vector eye = {d, d, d};
+    return eye;
+}
+
+vector instancePosition(Application *pApp, uint32_t instance)//Instances only translate the mesh
+{
+    if(pApp->config.benchmark.scene == BENCHMARK_SCENE_OVERDRAW)//Layers of a small grid facing the camera, stacked along the view axis so each covers most of the ones behind it
+    {
+        uint32_t perLayer = OVERDRAW_LAYER_SIDE * OVERDRAW_LAYER_SIDE;
+        uint32_t layers = (pApp->config.benchmark.instanceCount + perLayer - 1) / perLayer;
+        float scale = 1.0f / sqrtf(3.0f);
+        vector axis = {scale, scale, scale};//Towards the camera
+        vector right = normalise((vector){1.0f, -1.0f, 0.0f});
+        vector up = crossproduct(axis, right);
+        float column = (instance % OVERDRAW_LAYER_SIDE) - 0.5f * (OVERDRAW_LAYER_SIDE - 1);
+        float row = ((instance % perLayer) / OVERDRAW_LAYER_SIDE) - 0.5f * (OVERDRAW_LAYER_SIDE - 1);
+        float layer = (instance / perLayer) - 0.5f * (layers - 1);
+        vector position = {
+            .x = INSTANCE_SPACING * (column * right.x + row * up.x) + OVERDRAW_LAYER_SPACING * layer * axis.x,
+            .y = INSTANCE_SPACING * (column * right.y + row * up.y) + OVERDRAW_LAYER_SPACING * layer * axis.y,
+            .z = INSTANCE_SPACING * (column * right.z + row * up.z) + OVERDRAW_LAYER_SPACING * layer * axis.z
+        };
+        return position;
+    }
+    
+    uint32_t side = (uint32_t)ceil(sqrt((double)pApp->config.benchmark.instanceCount));
+    float offset = 0.5f * sceneExtent(pApp);
+    vector position = {
+        .x = (instance % side) * INSTANCE_SPACING - offset,
+        .y = (instance / side) * INSTANCE_SPACING - offset,
+        .z = 0.0f
+    };
+    return position;
+}
+
+typedef struct {
+    Application *pApp;
+    vector eye;
+    vector forward;
+    float pixelsPerUnit;
+    float time;
+    const uint32_t *visible;//Dense indices to visit, every entity when NULL
+} InstanceVisit;
+
+static void visitInstances(void *pData, uint32_t first, uint32_t last)//Level of detail and depth of a range of the visible entities, and their matrices when animating on the CPU
+{
+    InstanceVisit *pVisit = pData;
+    Application *pApp = pVisit->pApp;
+    EntityStore *pEntities = &pApp->entities;
+    
+    for(uint32_t k = first; k < last; k++)//Instances spin about their centres, so their bounding spheres hold for any rotation
+    {
+        uint32_t i = pVisit->visible ? pVisit->visible[k] : k;
+        const EntityBounds *pBounds = &pEntities->bounds[i];
+        vector centre = {pBounds->centre[0], pBounds->centre[1], pBounds->centre[2]};
+        float distance = norm(v_sub(centre, pVisit->eye)) - pBounds->radius;
+        pApp->instanceLods[i] = (uint8_t)selectMeshLod(&pApp->mesh, distance > CAMERA_NEAR ? distance : CAMERA_NEAR, pVisit->pixelsPerUnit, pApp->config.lodPixelError);
+        
+        float depth = dot(v_sub(centre, pVisit->eye), pVisit->forward);//View depth of the centre
+        pApp->instanceOrder[k].depth = pApp->config.depthSort == DEPTH_SORT_BACK_TO_FRONT ? -depth : depth;
+        pApp->instanceOrder[k].instance = i;
+        
+        if(pApp->config.animation == INSTANCE_ANIMATION_CPU)
+        {
+            animateTransform(pApp->worldMatrices[i], &pEntities->transforms[i], pVisit->time);
+        }
+    }
+}
+
+static int compareInstanceDepth(const void *a, const void *b)
+{
+    float depthA = ((const InstanceOrder *)a)->depth;
+    float depthB = ((const InstanceOrder *)b)->depth;
+    return (depthA > depthB) - (depthA < depthB);
+}
+
+static uint32_t cullInstances(Application *pApp)//Fills visibleInstances and returns how many passed, or leaves it alone and returns the entity count when not culling
+{
+    EntityStore *pEntities = &pApp->entities;
+    switch(pApp->config.culling)
+    {
+        case CULLING_BVH:
+            return bvhCullFrustum(&pApp->bvh, &pApp->frustum, pApp->visibleInstances);
+        case CULLING_FLAT:
+        {
+            uint32_t count = 0;
+            for(uint32_t i = 0; i < pEntities->count; i++)
+            {
+                if(frustumContainsSphere(&pApp->frustum, &pEntities->bounds[i]))
+                {
+                    pApp->visibleInstances[count++] = i;
+                }
+            }
+            return count;
+        }
+        default:
+            return pEntities->count;
+    }
+}
+
+void updateInstanceBuffer(Application *pApp, uint32_t currentFrame)
+{
+    EntityStore *pEntities = &pApp->entities;
+    if(pApp->config.drift > 0.0f)
+    {
+        moveSceneEntities(pApp);
+    }
+    uint32_t instanceCount = cullInstances(pApp);
+    pApp->visibleCount = instanceCount;
+    InstanceData *instances = pApp->instanceBuffersMapped[currentFrame];
+    uint32_t *sources = pApp->config.animation == INSTANCE_ANIMATION_GPU ? transformStageSources(&pApp->transformStage, currentFrame) : NULL;
+    uint32_t *candidates = pApp->config.occlusion ? occlusionCullerCandidates(&pApp->occlusion, currentFrame) : NULL;
+    InstanceOrder *order = pApp->instanceOrder;
+    
+    InstanceVisit visit = {
+        .pApp = pApp,
+        .eye = cameraEye(pApp),
+        .pixelsPerUnit = pApp->renderExtent.height / (2.0f * tanf(0.5f * CAMERA_FOV)),//Projected size of one unit at distance one in rendered pixels, the vertical field of view spans the render height
+        .time = (float)pApp->simulationTime,
+        .visible = pApp->config.culling == CULLING_NONE ? NULL : pApp->visibleInstances
+    };
+    visit.forward = normalise(v_sub((vector){0.0f, 0.0f, 0.0f}, visit.eye));
+    entityStoreForEachChunk(pEntities, instanceCount, visitInstances, &visit);
+    
+    uint8_t *lods = pApp->instanceLods;
+    memset(pApp->lodInstanceCounts, 0, sizeof(pApp->lodInstanceCounts));
+    for(uint32_t lod = 0; lod < MAX_MESH_LODS; lod++)
+    {
+        pApp->lodDepths[lod] = INFINITY;
+    }
+    for(uint32_t i = 0; i < instanceCount; i++)
+    {
+        pApp->lodInstanceCounts[lods[order[i].instance]]++;
+    }
+    
+    if(pApp->config.depthSort != DEPTH_SORT_NONE)//Nearest first lets early depth testing reject the fragments of everything drawn behind
+    {
+        qsort(order, instanceCount, sizeof(InstanceOrder), compareInstanceDepth);
+    }
+    
+    uint32_t lodStarts[MAX_MESH_LODS];
+    uint32_t start = 0;
+    for(uint32_t lod = 0; lod < MAX_MESH_LODS; lod++)
+    {
+        lodStarts[lod] = start;
+        start += pApp->lodInstanceCounts[lod];
+    }
+    
+    if(pApp->config.occlusion)//Each level draws from the same range in both phases, the culler counts the instances and places the late ones after the early ones
+    {
+        OcclusionDraws *pDraws = occlusionCullerBeginFrame(&pApp->occlusion, currentFrame);
+        for(uint32_t phase = 0; phase < OCCLUSION_PHASE_COUNT; phase++)
+        {
+            for(uint32_t lod = 0; lod < MAX_MESH_LODS; lod++)
+            {
+                uint32_t present = lod < pApp->mesh.lodCount;
+                pDraws->draws[phase][lod] = (VkDrawIndexedIndirectCommand){
+                    .indexCount = present ? pApp->mesh.lods[lod].indexCount : 0,
+                    .instanceCount = 0,
+                    .firstIndex = pApp->meshRange.firstIndex + (present ? pApp->mesh.lods[lod].firstIndex : 0),
+                    .vertexOffset = (int32_t)pApp->meshRange.firstVertex,
+                    .firstInstance = lodStarts[lod]
+                };
+            }
+        }
+    }
+    
+    for(uint32_t i = 0; i < instanceCount; i++)//Stable counting sort by level so each level draws a contiguous instance range, still in depth order
+    {
+        uint32_t instance = order[i].instance;
+        if(pApp->lodDepths[lods[instance]] == INFINITY)//After a depth sort the first instance of a level is its nearest, or its farthest when sorting back to front
+        {
+            pApp->lodDepths[lods[instance]] = order[i].depth;
+        }
+        uint32_t slot = lodStarts[lods[instance]]++;
+        if(candidates)
+        {
+            candidates[slot] = instance | (uint32_t)lods[instance] << OCCLUSION_LOD_SHIFT;
+        }
+        if(pApp->config.animation == INSTANCE_ANIMATION_GPU)//Only the order is written, the dispatch fills in the matrix and texture
+        {
+            sources[slot] = instance;
+            continue;
+        }
+        InstanceData *pInstance = &instances[slot];
+        if(pApp->config.animation == INSTANCE_ANIMATION_CPU)
+        {
+            memcpy(pInstance->model, pApp->worldMatrices[instance], sizeof(pInstance->model));
+        }
+        else
+        {
+            const float *translation = pEntities->transforms[instance].translation;
+            translationMatrix(pInstance->model, (vector){translation[0], translation[1], translation[2]});
+        }
+        pInstance->texture = pApp->packedTextures[pEntities->materials[instance]];
+    }
+    
+    if(pApp->config.animation != INSTANCE_ANIMATION_GPU)//The transform stage flushes its own sources
+    {
+        memoryPolicyFlush(&pApp->memoryPolicy, pApp->device, pApp->instanceBuffersMemory[currentFrame], pApp->instanceMemoryType, 0, VK_WHOLE_SIZE, VK_WHOLE_SIZE);
+    }
+}
+
+void drawFrame(Application *pApp)
+{
+    Profiler *pProfiler = &pApp->profiler;
+    profilerBeginFrame(pProfiler);
+    
+    profilerBeginStage(pProfiler, PROFILE_STAGE_FENCE_WAIT);
+    frameSyncWaitFrame(&pApp->frameSync, pApp->device, pApp->frameIndex);
+    profilerEndStage(pProfiler, PROFILE_STAGE_FENCE_WAIT);
+    
+    double gpuFrame = profilerCollect(pProfiler, pApp->device, pApp->frameIndex);
+    if(pApp->config.gpuBudget > 0.0f)//The slot's last frame has finished, its time decides the scale of the frames recorded from now on
+    {
+        resolutionScalerUpdate(&pApp->resolution, pApp->frameIndex, gpuFrame);
+    }
+    deletionQueueDrain(&pApp->deletionQueue, pApp->device, frameSyncCompletedValue(&pApp->frameSync, pApp->device), DELETIONS_PER_FRAME);
+    
+    uint32_t imageIndex;
+    profilerBeginStage(pProfiler, PROFILE_STAGE_ACQUIRE);
+    VkResult result = vkAcquireNextImageKHR(pApp->device, pApp->swapChain, UINT64_MAX, pApp->frameSync.imageAvailableSemaphores[pApp->frameIndex], VK_NULL_HANDLE, &imageIndex);
+    profilerEndStage(pProfiler, PROFILE_STAGE_ACQUIRE);
+    
+    if(result == VK_ERROR_OUT_OF_DATE_KHR)
+    {
+        recreateSwapChain(pApp);
+        return;
+    }
+    
+    else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+    {
+        printf("Failed to acquire swap chain image!");
+        exit(1);
+    }
+
+    pApp->renderExtent = pApp->swapChainExtent;
+    if(pApp->config.gpuBudget > 0.0f)//Only the render area changes, nothing is recreated
+    {
+        pApp->renderExtent = resolutionScalerBeginFrame(&pApp->resolution, pApp->frameIndex, pApp->swapChainExtent, pApp->targetExtent);
+    }
+    
+    profilerBeginStage(pProfiler, PROFILE_STAGE_UPDATE_UNIFORM);
+    updateUniformBuffer(pApp, pApp->frameIndex);
+    updateFrameDescriptors(pApp, pApp->frameIndex);
+    profilerEndStage(pProfiler, PROFILE_STAGE_UPDATE_UNIFORM);
+
+    profilerBeginStage(pProfiler, PROFILE_STAGE_RECORD);
+    vkResetCommandBuffer(pApp->commandBuffers[pApp->frameIndex], 0);
 
-    VkSemaphore waitSemaphores[] = {pApp->imageAvailableSemaphores[frameIndex]};
-    VkSemaphore signalSemaphores[] = {pApp->renderFinishedSemaphores[frameIndex]};
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+    recordCommandBuffer(pApp->commandBuffers[pApp->frameIndex], pApp, imageIndex);
+    profilerEndStage(pProfiler, PROFILE_STAGE_RECORD);
+
+    VkSemaphore waitSemaphores[] = {pApp->frameSync.imageAvailableSemaphores[pApp->frameIndex]};
+    VkSemaphore signalSemaphores[] = {pApp->frameSync.renderFinishedSemaphores[pApp->frameIndex]};
+    VkPipelineStageFlags waitStages[] = {renderGraphFirstStages(&pApp->frameGraph, pApp->swapChainResource)};//The graph's first barrier on the swap chain image waits on the same stages
 
     VkSubmitInfo submitInfo = {
         .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
@@ -1219,15 +2046,17 @@ void drawFrame(Application *pApp)
         .pWaitSemaphores = waitSemaphores,
         .pWaitDstStageMask = waitStages,
         .commandBufferCount = 1,
-        .pCommandBuffers = &pApp->commandBuffers[frameIndex],
+        .pCommandBuffers = &pApp->commandBuffers[pApp->frameIndex],
         .signalSemaphoreCount = 1,//Specifies which semaphores to signal, after execution
         .pSignalSemaphores = signalSemaphores
     };
 
-    if (vkQueueSubmit(pApp->graphicsQueue, 1, &submitInfo, pApp->inFlightFences[frameIndex]) != VK_SUCCESS) {
+    profilerBeginStage(pProfiler, PROFILE_STAGE_SUBMIT);
+    if (frameSyncSubmitFrame(&pApp->frameSync, pApp->device, &submitInfo, pApp->frameIndex) != VK_SUCCESS) {
         printf("Failed to submit draw command buffer!");
         exit(1);
     }
+    profilerEndStage(pProfiler, PROFILE_STAGE_SUBMIT);
     
     VkSwapchainKHR swapChains[] = {pApp->swapChain};
     
@@ -1242,11 +2071,17 @@ void drawFrame(Application *pApp)
         .pResults = NULL//Specifies an array of VK_RESULT, checking that presentation was successful for each swap chain
     };
 
+    profilerBeginStage(pProfiler, PROFILE_STAGE_PRESENT);
     result = vkQueuePresentKHR(pApp->presentQueue, &presentInfo);
-    if(result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+    profilerEndStage(pProfiler, PROFILE_STAGE_PRESENT);
+    
+    profilerEndFrame(pProfiler, pApp->frameIndex);
+    
+    pApp->frameIndex = (pApp->frameIndex + 1) % pApp->config.framesInFlight;//The frame was submitted whether or not it was presented, the next one uses the next slot
+    
+    if(result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || pApp->framebufferResized)
     {
         recreateSwapChain(pApp);
-        return;
     }
     
     else if (result != VK_SUCCESS)
@@ -1254,37 +2089,14 @@ void drawFrame(Application *pApp)
         printf("Failed to present swap chain image");
         exit(1);
     }
-
-    frameIndex = (frameIndex + 1) % MAX_FRAMES_IN_FLIGHT;
 }
 
 void createSyncObjects(Application *pApp)
 {
-    pApp->imageAvailableSemaphores = malloc(sizeof(VkSemaphore) * MAX_FRAMES_IN_FLIGHT);
-    pApp->renderFinishedSemaphores = malloc(sizeof(VkSemaphore) * MAX_FRAMES_IN_FLIGHT);
-    pApp->inFlightFences = malloc(sizeof(VkFence) * MAX_FRAMES_IN_FLIGHT);
-    
-    VkSemaphoreCreateInfo semaphoreInfo = {
-        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO
-    };
-
-    VkFenceCreateInfo fenceInfo = {
-        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-        .flags = VK_FENCE_CREATE_SIGNALED_BIT
-    };
-    
-    for(uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
-    {
-        if(vkCreateSemaphore(pApp->device, &semaphoreInfo, NULL, &pApp->imageAvailableSemaphores[i]) != VK_SUCCESS ||
-        vkCreateSemaphore(pApp->device, &semaphoreInfo, NULL, &pApp->renderFinishedSemaphores[i]) != VK_SUCCESS ||
-        vkCreateFence(pApp->device, &fenceInfo, NULL, &pApp->inFlightFences[i]) != VK_SUCCESS){
-            printf("Failed to create sync objects!");
-            exit(1);
-        }
-    }
+    createFrameSync(&pApp->frameSync, pApp->device, pApp->graphicsQueue, pApp->config.framesInFlight, pApp->timelineSupported);
 }
 
-void recreateSwapChain(Application *pApp)
+void recreateSwapChain(Application *pApp)//Frames still in flight keep rendering to the old swap chain, it is destroyed once they have completed
 {
     int width = 0, height = 0;
     glfwGetFramebufferSize(pApp->window, &width, &height);
@@ -1292,62 +2104,108 @@ void recreateSwapChain(Application *pApp)
         glfwGetFramebufferSize(pApp->window, &width, &height);
         glfwWaitEvents();
     }
-
-    vkDeviceWaitIdle(pApp->device);
     
-    cleanupSwapChain(pApp);
+    pApp->framebufferResized = 0;
     
-    createSwapChain(pApp);
+    VkSwapchainKHR oldSwapChain = pApp->swapChain;
+    
+    retireSwapChain(pApp, pApp->frameSync.submittedValue);//Nothing submitted after this point uses the old swap chain
+    
+    createSwapChain(pApp);//Passes the old swap chain, letting the presentation engine reuse its resources
     createImageViews(pApp);
+    buildFrameGraph(pApp);
     createFramebuffers(pApp);
+    if(pApp->config.occlusion)//The pyramid follows the depth buffer it is built from
+    {
+        occlusionCullerResize(&pApp->occlusion, renderGraphImageView(&pApp->frameGraph, pApp->depthResource), pApp->targetExtent.width, pApp->targetExtent.height, pApp->frameSync.submittedValue);
+    }
+    
+    deleteSwapChainLater(&pApp->deletionQueue, oldSwapChain, pApp->frameSync.submittedValue);//Queued after createSwapChain, it is still the oldSwapchain of the new one until then
 }
 
-void cleanupSwapChain(Application *pApp)
+void freeHostArray(VkDevice device, void *pData)
 {
-    for(int i = 0; i < pApp->imageCount; i++)
+    free(pData);
+}
+
+void retireSwapChain(Application *pApp, uint64_t value)//Queues the framebuffers, image views, the frame graph with its depth buffer and render target, and their arrays for destruction, the swap chain handle itself is queued by the caller
+{
+    if(pApp->config.gpuBudget > 0.0f)//The swap chain images have neither views nor framebuffers
     {
-        vkDestroyFramebuffer(pApp->device, pApp->swapChainFramebuffers[i], NULL);
+        deleteFramebufferLater(&pApp->deletionQueue, pApp->renderTargetFramebuffer, value);
     }
-    free(pApp->swapChainFramebuffers);
-    
-    for(int i = 0; i < pApp->imageCount; i++)
+    else
     {
-        vkDestroyImageView(pApp->device, pApp->swapChainImageViews[i], NULL);
+        for(int i = 0; i < pApp->imageCount; i++)
+        {
+            deleteFramebufferLater(&pApp->deletionQueue, pApp->swapChainFramebuffers[i], value);
+            deleteImageViewLater(&pApp->deletionQueue, pApp->swapChainImageViews[i], value);
+        }
     }
-    free(pApp->swapChainImageViews);
     
-    vkDestroySwapchainKHR(pApp->device, pApp->swapChain, NULL);
-    free(pApp->swapChainImages);
+    destroyRenderGraph(&pApp->frameGraph, &pApp->deletionQueue, value);//Its depth buffer and render target go through the queue
+    
+    deleteLater(&pApp->deletionQueue, freeHostArray, pApp->swapChainFramebuffers, value);
+    deleteLater(&pApp->deletionQueue, freeHostArray, pApp->swapChainImageViews, value);
+    deleteLater(&pApp->deletionQueue, freeHostArray, pApp->swapChainImages, value);
 }
 
-VkVertexInputBindingDescription getBindingDescription(void)
+void cleanupSwapChain(Application *pApp)//Only called once the device is idle
 {
-    VkVertexInputBindingDescription bindingDescription = {
+    retireSwapChain(pApp, pApp->frameSync.submittedValue);
+    deleteSwapChainLater(&pApp->deletionQueue, pApp->swapChain, pApp->frameSync.submittedValue);
+    deletionQueueFlush(&pApp->deletionQueue, pApp->device);
+}
+
+void getBindingDescriptions(const VertexLayout *pLayout, VkVertexInputBindingDescription bindingDescriptions[2])
+{
+    VkVertexInputBindingDescription vertexBinding = {
         .binding = 0,//Specifies the index in the array of bindings
-        .stride = sizeof(Vertex),//Specifies the size of the binding, giving the length between the start of the binding to the next one
+        .stride = pLayout->stride,//Specifies the size of the binding, giving the length between the start of the binding to the next one
         .inputRate = VK_VERTEX_INPUT_RATE_VERTEX//Specifies whether to move to the next data entry after each vertex or each instance
     };
     
-    return bindingDescription;
+    VkVertexInputBindingDescription instanceBinding = {
+        .binding = 1,
+        .stride = sizeof(InstanceData),
+        .inputRate = VK_VERTEX_INPUT_RATE_INSTANCE
+    };
+    
+    bindingDescriptions[0] = vertexBinding;
+    bindingDescriptions[1] = instanceBinding;
 }
 
-VkVertexInputAttributeDescription *getAttributeDescriptions(void)
+void getAttributeDescriptions(const VertexLayout *pLayout, VkVertexInputAttributeDescription attributeDescriptions[VERTEX_ATTRIBUTE_COUNT + INSTANCE_ATTRIBUTE_COUNT])
 {
-    VkVertexInputAttributeDescription *attributeDescriptions = malloc(sizeof(VkVertexInputAttributeDescription) * 2);
+    vertexLayoutAttributes(pLayout, 0, attributeDescriptions);//Per vertex attributes follow the packed layout
+    
+    for(uint32_t i = 0; i < 4; i++)//A mat4 attribute occupies four consecutive locations, one per row of the model matrix
+    {
+        attributeDescriptions[VERTEX_ATTRIBUTE_COUNT + i].binding = 1;
+        attributeDescriptions[VERTEX_ATTRIBUTE_COUNT + i].location = 4 + i;
+        attributeDescriptions[VERTEX_ATTRIBUTE_COUNT + i].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+        attributeDescriptions[VERTEX_ATTRIBUTE_COUNT + i].offset = offsetof(InstanceData, model) + i * sizeof(float[4]);
+    }
     
-    attributeDescriptions[0].binding = 0;//Specifies from which binding the data comes
-    attributeDescriptions[0].location = 0;//Specifies which 'location' the data will have in the vertex shader
-    attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;//Specifies the type of the data of the attribute, which uses the same enum as color formats
-    attributeDescriptions[0].offset = offsetof(Vertex, position);//Specifies how far from the start of the data to read from
+    VkVertexInputAttributeDescription uvRect = {
+        .location = 8,
+        .binding = 1,
+        .format = VK_FORMAT_R16G16B16A16_UNORM,
+        .offset = offsetof(InstanceData, texture.uvRect)
+    };
     
-    attributeDescriptions[1].binding = 0;
-    attributeDescriptions[1].location = 1;
-    attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attributeDescriptions[1].offset = offsetof(Vertex, color);
-    return attributeDescriptions;
+    VkVertexInputAttributeDescription textureLayer = {//Slot and layer of a texture array, so instances with different textures still share one draw
+        .location = 9,
+        .binding = 1,
+        .format = VK_FORMAT_R16G16_UINT,
+        .offset = offsetof(InstanceData, texture.slot)
+    };
+    
+    attributeDescriptions[VERTEX_ATTRIBUTE_COUNT + 4] = uvRect;
+    attributeDescriptions[VERTEX_ATTRIBUTE_COUNT + 5] = textureLayer;
 }
 
-void createBuffer(Application *pApp, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer *buffer, VkDeviceMemory *bufferMemory)
+VkResult tryCreateBuffer(Application *pApp, VkDeviceSize size, VkBufferUsageFlags usage, uint32_t memoryUsage, VkBuffer *buffer, VkDeviceMemory *bufferMemory, uint32_t *pMemoryType)//Leaves nothing behind on failure, so the caller can fall back to another usage
 {
     VkBufferCreateInfo bufferInfo = {
         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
@@ -1364,21 +2222,114 @@ void createBuffer(Application *pApp, VkDeviceSize size, VkBufferUsageFlags usage
     VkMemoryRequirements memoryReq;
     vkGetBufferMemoryRequirements(pApp->device, *buffer, &memoryReq);
     
-    VkMemoryAllocateInfo allocInfo = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .allocationSize = memoryReq.size,
-        .memoryTypeIndex = findMemoryType(pApp, memoryReq.memoryTypeBits, properties)
-    };
+    VkResult result = memoryPolicyAllocate(&pApp->memoryPolicy, pApp->device, &memoryReq, memoryUsage, bufferMemory, pMemoryType);
+    if(result != VK_SUCCESS)
+    {
+        vkDestroyBuffer(pApp->device, *buffer, NULL);
+        return result;
+    }
     
-    if(vkAllocateMemory(pApp->device, &allocInfo, NULL, bufferMemory) != VK_SUCCESS){
+    vkBindBufferMemory(pApp->device, *buffer, *bufferMemory, 0);
+    return VK_SUCCESS;
+}
+
+uint32_t createBuffer(Application *pApp, VkDeviceSize size, VkBufferUsageFlags usage, uint32_t memoryUsage, VkBuffer *buffer, VkDeviceMemory *bufferMemory)//Returns the memory type that was picked
+{
+    uint32_t memoryType;
+    if(tryCreateBuffer(pApp, size, usage, memoryUsage, buffer, bufferMemory, &memoryType) != VK_SUCCESS){
         printf("Failed to allocate buffer memory");
         exit(1);
     }
+    return memoryType;
+}
+
+void createStaticBuffer(Application *pApp, const void *pData, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer *buffer, VkDeviceMemory *bufferMemory)//Writes straight into device memory when it is mappable, otherwise goes through a staging buffer
+{
+    uint32_t memoryType;
+    void* data;
+    
+    if(tryCreateBuffer(pApp, size, usage, MEMORY_USAGE_GPU_MAPPED, buffer, bufferMemory, &memoryType) == VK_SUCCESS)
+    {
+        vkMapMemory(pApp->device, *bufferMemory, 0, size, 0, &data);
+            memcpy(data, pData, (size_t) size);
+            memoryPolicyFlush(&pApp->memoryPolicy, pApp->device, *bufferMemory, memoryType, 0, VK_WHOLE_SIZE, VK_WHOLE_SIZE);
+        vkUnmapMemory(pApp->device, *bufferMemory);
+        return;
+    }
     
-    vkBindBufferMemory(pApp->device, *buffer, *bufferMemory, 0);
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+
+    memoryType = createBuffer(pApp, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, MEMORY_USAGE_UPLOAD, &stagingBuffer, &stagingBufferMemory);
+
+    vkMapMemory(pApp->device, stagingBufferMemory, 0, size, 0, &data);
+        memcpy(data, pData, (size_t) size);
+        memoryPolicyFlush(&pApp->memoryPolicy, pApp->device, stagingBufferMemory, memoryType, 0, VK_WHOLE_SIZE, VK_WHOLE_SIZE);
+    vkUnmapMemory(pApp->device, stagingBufferMemory);
+
+    createBuffer(pApp, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, MEMORY_USAGE_GPU_ONLY, buffer, bufferMemory);
+
+    uint64_t uploadValue = copyBuffer(pApp, stagingBuffer, *buffer, 0, size);
+    
+    deleteBufferLater(&pApp->deletionQueue, stagingBuffer, uploadValue);
+    deleteMemoryLater(&pApp->deletionQueue, stagingBufferMemory, uploadValue);
+}
+
+void uploadBufferRange(Application *pApp, const void *pData, VkDeviceSize offset, VkDeviceSize size, VkBuffer buffer, VkDeviceMemory bufferMemory, void *pMapped, VkDeviceSize mappedSize, uint32_t memoryType)//Writes through the mapping when there is one, otherwise stages and copies
+{
+    if(size == 0)
+    {
+        return;
+    }
+    
+    if(pMapped != NULL)
+    {
+        memcpy((uint8_t *)pMapped + offset, pData, (size_t)size);
+        memoryPolicyFlush(&pApp->memoryPolicy, pApp->device, bufferMemory, memoryType, offset, size, mappedSize);
+        return;
+    }
+    
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    void *data;
+    
+    uint32_t stagingType = createBuffer(pApp, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, MEMORY_USAGE_UPLOAD, &stagingBuffer, &stagingBufferMemory);
+    
+    vkMapMemory(pApp->device, stagingBufferMemory, 0, size, 0, &data);
+        memcpy(data, pData, (size_t) size);
+        memoryPolicyFlush(&pApp->memoryPolicy, pApp->device, stagingBufferMemory, stagingType, 0, VK_WHOLE_SIZE, VK_WHOLE_SIZE);
+    vkUnmapMemory(pApp->device, stagingBufferMemory);
+    
+    uint64_t uploadValue = copyBuffer(pApp, stagingBuffer, buffer, offset, size);
+    
+    deleteBufferLater(&pApp->deletionQueue, stagingBuffer, uploadValue);
+    deleteMemoryLater(&pApp->deletionQueue, stagingBufferMemory, uploadValue);
 }
 
-void copyBuffer(Application *pApp, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+uint64_t copyBuffer(Application *pApp, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size)//Returns the frame value that marks the end of the copy, the command buffer is freed once it has passed
+{
+    VkCommandBuffer commandBuffer = beginUploadCommands(pApp);
+    
+    VkBufferCopy copyRegion = {
+        copyRegion.srcOffset = 0, // Optional
+        copyRegion.dstOffset = dstOffset,
+        copyRegion.size = size
+    };
+    
+    vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+    
+    VkMemoryBarrier barrier = {//Makes the copy visible to vertex input in later submissions, so nothing has to wait for it on the host
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT
+    };
+    
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+    
+    return submitUploadCommands(pApp, commandBuffer);
+}
+
+VkCommandBuffer beginUploadCommands(Application *pApp)//One time command buffer for uploads outside the frame loop
 {
     VkCommandBufferAllocateInfo allocInfo = {
         .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
@@ -1397,14 +2348,11 @@ void copyBuffer(Application *pApp, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDev
     
     vkBeginCommandBuffer(commandBuffer, &beginInfo);
     
-    VkBufferCopy copyRegion = {
-        copyRegion.srcOffset = 0, // Optional
-        copyRegion.dstOffset = 0, // Optional
-        copyRegion.size = size
-    };
-    
-    vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-    
+    return commandBuffer;
+}
+
+uint64_t submitUploadCommands(Application *pApp, VkCommandBuffer commandBuffer)//Returns the frame value that marks the end of the upload, the command buffer is freed once it has passed
+{
     vkEndCommandBuffer(commandBuffer);
     
     VkSubmitInfo submitInfo = {
@@ -1413,155 +2361,397 @@ void copyBuffer(Application *pApp, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDev
         .pCommandBuffers = &commandBuffer
     };
     
-    vkQueueSubmit(pApp->graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(pApp->graphicsQueue);
+    uint64_t uploadValue = frameSyncSubmit(&pApp->frameSync, &submitInfo);
+    
+    deleteCommandBufferLater(&pApp->deletionQueue, pApp->commandPool, commandBuffer, uploadValue);
     
-    vkFreeCommandBuffers(pApp->device, pApp->commandPool, 1, &commandBuffer);
+    return uploadValue;
 }
 
-void createVertexBuffer(Application *pApp)
+void createTexturePack(Application *pApp)//Every texture is resident before the first frame, in as few array images as the layer limit allows
 {
-    VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
+    buildTexturePack(&pApp->texturePack, pApp->config.textureFiles, pApp->config.textureFileCount, pApp->capabilities.properties.limits.maxImageArrayLayers, &pApp->jobs);
     
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
+    VkCommandBuffer commandBuffer = beginUploadCommands(pApp);
+    recordTexturePackUpload(&pApp->texturePack, pApp->device, &pApp->memoryPolicy, &pApp->deletionQueue, pApp->bindlessSupported ? &pApp->bindless : NULL, commandBuffer, pApp->frameSync.submittedValue + 1);
+    submitUploadCommands(pApp, commandBuffer);
+    printTexturePack(&pApp->texturePack);
+    
+    pApp->packedTextureCount = pApp->texturePack.regionCount > 0 ? pApp->texturePack.regionCount : 1;
+    pApp->packedTextures = malloc(sizeof(InstanceTexture) * pApp->packedTextureCount);
+    pApp->packedTextures[0] = (InstanceTexture){.slot = NO_INSTANCE_TEXTURE};
+    for(uint32_t i = 0; i < pApp->texturePack.regionCount; i++)
+    {
+        TextureRegion *pRegion = &pApp->texturePack.regions[i];
+        uint32_t slot = pApp->texturePack.arrays[pRegion->array].bindlessIndex;
+        InstanceTexture texture = {
+            .uvRect = {
+                (uint16_t)(pRegion->uvOffset[0] * 65535.0f + 0.5f),
+                (uint16_t)(pRegion->uvOffset[1] * 65535.0f + 0.5f),
+                (uint16_t)(pRegion->uvScale[0] * 65535.0f + 0.5f),
+                (uint16_t)(pRegion->uvScale[1] * 65535.0f + 0.5f)
+            },
+            .slot = slot == BINDLESS_INVALID_INDEX ? NO_INSTANCE_TEXTURE : (uint16_t)slot,//Without bindless nothing samples the arrays
+            .layer = (uint16_t)pRegion->layer
+        };
+        pApp->packedTextures[i] = texture;
+    }
+}
 
-    createBuffer(pApp, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingBuffer, &stagingBufferMemory);
+void createPoolBuffer(Application *pApp, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer *buffer, VkDeviceMemory *bufferMemory, void **ppMapped, uint32_t *pMemoryType)//Stays mapped for the lifetime of the pool when device memory is mappable
+{
+    *ppMapped = NULL;
+    if(tryCreateBuffer(pApp, size, usage, MEMORY_USAGE_GPU_MAPPED, buffer, bufferMemory, pMemoryType) == VK_SUCCESS)
+    {
+        vkMapMemory(pApp->device, *bufferMemory, 0, size, 0, ppMapped);
+        return;
+    }
+    *pMemoryType = createBuffer(pApp, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, MEMORY_USAGE_GPU_ONLY, buffer, bufferMemory);
+}
 
-    void* data;
-    vkMapMemory(pApp->device, stagingBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, vertices, (size_t) bufferSize);
-    vkUnmapMemory(pApp->device, stagingBufferMemory);
+void createGeometryPool(Application *pApp)
+{
+    uint32_t vertexCapacity = pApp->mesh.vertexCount > GEOMETRY_POOL_VERTICES ? pApp->mesh.vertexCount : GEOMETRY_POOL_VERTICES;
+    uint32_t indexCapacity = pApp->mesh.indexCount > GEOMETRY_POOL_INDICES ? pApp->mesh.indexCount : GEOMETRY_POOL_INDICES;
+    GeometryPool *pPool = &pApp->geometryPool;
+    
+    initGeometryPool(pPool, vertexCapacity, pApp->config.vertexLayout.stride, indexCapacity, pApp->mesh.indexSize);//Indices are relative to each mesh, so 16-bit holds as long as every mesh stays under 65536 vertices
+    createPoolBuffer(pApp, (VkDeviceSize)vertexCapacity * pPool->vertexStride, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &pPool->vertexBuffer, &pPool->vertexMemory, &pPool->vertexMapped, &pPool->vertexMemoryType);
+    createPoolBuffer(pApp, (VkDeviceSize)indexCapacity * pPool->indexSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &pPool->indexBuffer, &pPool->indexMemory, &pPool->indexMapped, &pPool->indexMemoryType);
+}
 
-    createBuffer(pApp, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &pApp->vertexBuffer, &pApp->vertexBufferMemory);
+void uploadMesh(Application *pApp, const Mesh *pMesh, GeometryRange *pRange)//Sub-allocates the mesh in the geometry pool and copies its packed vertices and indices there
+{
+    GeometryPool *pPool = &pApp->geometryPool;
+    const VertexLayout *pLayout = &pApp->config.vertexLayout;
+    
+    if(pMesh->indexSize > pPool->indexSize || !geometryPoolAllocate(pPool, pMesh->vertexCount, pMesh->indexCount, pRange))
+    {
+        printf("Failed to fit mesh in the geometry pool!\n");
+        exit(1);
+    }
+    
+    VkDeviceSize vertexSize = (VkDeviceSize)pLayout->stride * pMesh->vertexCount;
+    fitVertexDequantization(pLayout, pMesh->vertices, pMesh->vertexCount, &pApp->vertexDequantization);
+    if(vertexLayoutIsUnpacked(pLayout))
+    {
+        uploadBufferRange(pApp, pMesh->vertices, (VkDeviceSize)pRange->firstVertex * pPool->vertexStride, vertexSize, pPool->vertexBuffer, pPool->vertexMemory, pPool->vertexMapped, (VkDeviceSize)pPool->vertices.capacity * pPool->vertexStride, pPool->vertexMemoryType);
+    }
+    else
+    {
+        void *packedVertices = malloc(vertexSize);
+        if(packedVertices == NULL)
+        {
+            printf("Failed to allocate packed vertices!\n");
+            exit(1);
+        }
+        packVertices(pLayout, &pApp->vertexDequantization, pMesh->vertices, pMesh->vertexCount, packedVertices);
+        uploadBufferRange(pApp, packedVertices, (VkDeviceSize)pRange->firstVertex * pPool->vertexStride, vertexSize, pPool->vertexBuffer, pPool->vertexMemory, pPool->vertexMapped, (VkDeviceSize)pPool->vertices.capacity * pPool->vertexStride, pPool->vertexMemoryType);
+        free(packedVertices);
+    }
+    
+    VkDeviceSize indexSize = (VkDeviceSize)pPool->indexSize * pMesh->indexCount;
+    if(pMesh->indexSize == pPool->indexSize)
+    {
+        uploadBufferRange(pApp, pMesh->indices, (VkDeviceSize)pRange->firstIndex * pPool->indexSize, indexSize, pPool->indexBuffer, pPool->indexMemory, pPool->indexMapped, (VkDeviceSize)pPool->indices.capacity * pPool->indexSize, pPool->indexMemoryType);
+    }
+    else
+    {
+        uint32_t *widenedIndices = malloc(indexSize);//16-bit mesh in a 32-bit pool
+        if(widenedIndices == NULL)
+        {
+            printf("Failed to allocate widened indices!\n");
+            exit(1);
+        }
+        for(uint32_t i = 0; i < pMesh->indexCount; i++)
+        {
+            widenedIndices[i] = meshIndex(pMesh, i);
+        }
+        uploadBufferRange(pApp, widenedIndices, (VkDeviceSize)pRange->firstIndex * pPool->indexSize, indexSize, pPool->indexBuffer, pPool->indexMemory, pPool->indexMapped, (VkDeviceSize)pPool->indices.capacity * pPool->indexSize, pPool->indexMemoryType);
+        free(widenedIndices);
+    }
+}
 
-    copyBuffer(pApp, stagingBuffer, pApp->vertexBuffer, bufferSize);
+void createUniformBuffers(Application *pApp)
+{
+    VkDeviceSize bufferSize = sizeof(UniformBufferObject);
     
-    vkDestroyBuffer(pApp->device, stagingBuffer, NULL);
-    vkFreeMemory(pApp->device, stagingBufferMemory, NULL);
+    pApp->uniformBuffers = malloc(sizeof(VkBuffer) * pApp->config.framesInFlight);
+    pApp->uniformBuffersMemory = malloc(sizeof(VkDeviceMemory) * pApp->config.framesInFlight);
+    pApp->uniformBuffersMapped = malloc(sizeof(void*) * pApp->config.framesInFlight);
+    
+    for(size_t i = 0; i < pApp->config.framesInFlight; i++) {
+        pApp->uniformMemoryType = createBuffer(pApp, bufferSize, pApp->bindlessSupported ? VK_BUFFER_USAGE_STORAGE_BUFFER_BIT : VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, MEMORY_USAGE_DYNAMIC, &pApp->uniformBuffers[i], &pApp->uniformBuffersMemory[i]);
+        
+        vkMapMemory(pApp->device, pApp->uniformBuffersMemory[i], 0, bufferSize, 0, &pApp->uniformBuffersMapped[i]);
+    }
 }
 
-void createIndexBuffer(Application *pApp)
+void createInstanceBuffers(Application *pApp)
 {
-    VkDeviceSize bufferSize = sizeof(vertexIndices[0]) * indexCount;
+    VkDeviceSize bufferSize = sizeof(InstanceData) * pApp->config.benchmark.instanceCount;
     
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
+    pApp->instanceBuffers = malloc(sizeof(VkBuffer) * pApp->config.framesInFlight);
+    pApp->instanceBuffersMemory = malloc(sizeof(VkDeviceMemory) * pApp->config.framesInFlight);
+    pApp->instanceBuffersMapped = malloc(sizeof(void*) * pApp->config.framesInFlight);
+    pApp->instanceLods = malloc(pApp->config.benchmark.instanceCount);
+    pApp->instanceOrder = malloc(sizeof(InstanceOrder) * pApp->config.benchmark.instanceCount);
+    
+    for(size_t i = 0; i < pApp->config.framesInFlight; i++) {
+        if(pApp->config.animation == INSTANCE_ANIMATION_GPU)//Only ever written by the transform stage, copied out when validating it
+        {
+            pApp->instanceMemoryType = createBuffer(pApp, bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, MEMORY_USAGE_GPU_ONLY, &pApp->instanceBuffers[i], &pApp->instanceBuffersMemory[i]);
+            pApp->instanceBuffersMapped[i] = NULL;
+            continue;
+        }
+        
+        VkBufferUsageFlags usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+        if(pApp->config.occlusion)//Read by the occlusion culler, which writes the records actually drawn
+        {
+            usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        }
+        pApp->instanceMemoryType = createBuffer(pApp, bufferSize, usage, MEMORY_USAGE_DYNAMIC, &pApp->instanceBuffers[i], &pApp->instanceBuffersMemory[i]);
+        
+        vkMapMemory(pApp->device, pApp->instanceBuffersMemory[i], 0, bufferSize, 0, &pApp->instanceBuffersMapped[i]);
+    }
+}
 
-    createBuffer(pApp, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingBuffer, &stagingBufferMemory);
+static float instanceRandom(uint32_t *pState)//Deterministic, so CPU and GPU runs animate the same scene
+{
+    *pState = *pState * 1664525u + 1013904223u;
+    return (*pState >> 8) / 16777216.0f;
+}
 
-    void* data;
-    vkMapMemory(pApp->device, stagingBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, vertexIndices, (size_t) bufferSize);
-    vkUnmapMemory(pApp->device, stagingBufferMemory);
+typedef struct {
+    Application *pApp;
+    float time;
+} EntityDrift;
 
-    createBuffer(pApp, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &pApp->indexBuffer, &pApp->indexBufferMemory);
+static void driftEntities(void *pData, uint32_t first, uint32_t last)//Moves a range of entities and their bounds along z, each with its own phase
+{
+    EntityDrift *pDrift = pData;
+    Application *pApp = pDrift->pApp;
+    EntityStore *pEntities = &pApp->entities;
+    for(uint32_t i = first; i < last; i++)
+    {
+        float z = pApp->driftOrigins[i] + pApp->config.drift * sinf(pDrift->time + DRIFT_PHASE * i);
+        pEntities->transforms[i].translation[2] = z;
+        pEntities->bounds[i].centre[2] = z;
+    }
+}
 
-    copyBuffer(pApp, stagingBuffer, pApp->indexBuffer, bufferSize);
-    
-    vkDestroyBuffer(pApp->device, stagingBuffer, NULL);
-    vkFreeMemory(pApp->device, stagingBufferMemory, NULL);
+void moveSceneEntities(Application *pApp)//Before culling, the BVH is refitted to the new bounds and one of its subtrees rebuilt, or all of it once refits have degraded it too far
+{
+    EntityDrift drift = {pApp, (float)pApp->simulationTime};
+    entityStoreForEachChunk(&pApp->entities, pApp->entities.count, driftEntities, &drift);
+    bvhRefit(&pApp->bvh, pApp->entities.bounds);
+    bvhRebuildStep(&pApp->bvh);
 }
 
-uint32_t findMemoryType(Application *pApp, uint32_t typeFilter, VkMemoryPropertyFlags properties)
+void createSceneEntities(Application *pApp)//One entity per instance, spinning about its own axis at its own speed from a random rest orientation when animated
 {
-    VkPhysicalDeviceMemoryProperties memoryProperties;
-    vkGetPhysicalDeviceMemoryProperties(pApp->physicalDevice, &memoryProperties);
+    uint32_t instanceCount = pApp->config.benchmark.instanceCount;
+    EntityStore *pEntities = &pApp->entities;
+    createEntityStore(pEntities, instanceCount, &pApp->jobs);
+    uint32_t state = 1;
+    for(uint32_t i = 0; i < instanceCount; i++)
+    {
+        uint32_t dense = entityDenseIndex(pEntities, createEntity(pEntities));
+        InstanceAnimation *pTransform = &pEntities->transforms[dense];
+        vector position = instancePosition(pApp, i);
+        pTransform->translation[0] = position.x;
+        pTransform->translation[1] = position.y;
+        pTransform->translation[2] = position.z;
+        pTransform->scale = 1.0f;
+        pTransform->rotation[0] = 1.0f;
+        pTransform->axis[2] = 1.0f;
+        
+        if(pApp->config.animation != INSTANCE_ANIMATION_NONE)
+        {
+            vector restAxis = {instanceRandom(&state) - 0.5f, instanceRandom(&state) - 0.5f, instanceRandom(&state) + 0.01f};
+            quaternion rest = q_angle_vector(2.0f * M_PI * instanceRandom(&state), restAxis);
+            pTransform->scale = 0.8f + 0.2f * instanceRandom(&state);
+            pTransform->rotation[0] = rest.r;
+            pTransform->rotation[1] = rest.i;
+            pTransform->rotation[2] = rest.j;
+            pTransform->rotation[3] = rest.k;
+            pTransform->axis[0] = instanceRandom(&state) - 0.5f;
+            pTransform->axis[1] = instanceRandom(&state) - 0.5f;
+            pTransform->axis[2] = instanceRandom(&state) + 0.01f;//Never zero
+            pTransform->angularSpeed = 0.5f + 1.5f * instanceRandom(&state);
+        }
+        
+        pEntities->bounds[dense] = (EntityBounds){{position.x, position.y, position.z}, pApp->meshRadius * pTransform->scale};
+        pEntities->meshes[dense] = 0;
+        pEntities->materials[dense] = i % pApp->packedTextureCount;
+        memcpy(pTransform->payload, &pApp->packedTextures[pEntities->materials[dense]], sizeof(InstanceTexture));//The material as the transform stage writes it
+    }
+    
+    buildBvh(&pApp->bvh, pEntities->bounds, pEntities->count, &pApp->jobs);//Bounding spheres hold for any rotation, so spinning never needs a refit, only drifting does
+    pApp->visibleInstances = malloc(sizeof(uint32_t) * instanceCount);
+    
+    if(pApp->config.occlusion)
+    {
+        createStaticBuffer(pApp, pEntities->bounds, sizeof(EntityBounds) * pEntities->count, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, &pApp->boundsBuffer, &pApp->boundsBufferMemory);
+        createOcclusionCuller(&pApp->occlusion, pApp->device, &pApp->memoryPolicy, &pApp->deletionQueue, pApp->boundsBuffer, pApp->instanceBuffers, instanceCount, sizeof(InstanceData) / sizeof(uint32_t), pApp->config.framesInFlight);
+        occlusionCullerResize(&pApp->occlusion, renderGraphImageView(&pApp->frameGraph, pApp->depthResource), pApp->targetExtent.width, pApp->targetExtent.height, 0);
+    }
     
-    for(uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+    if(pApp->config.animation == INSTANCE_ANIMATION_CPU)
     {
-        if(typeFilter & (1 << i) && memoryProperties.memoryTypes[i].propertyFlags & properties)
+        pApp->worldMatrices = malloc(sizeof(float[4][4]) * instanceCount);
+    }
+    
+    if(pApp->config.drift > 0.0f)
+    {
+        pApp->driftOrigins = malloc(sizeof(float) * instanceCount);
+        for(uint32_t i = 0; i < pEntities->count; i++)
         {
-            return i;
+            pApp->driftOrigins[i] = pEntities->transforms[i].translation[2];
         }
     }
     
-    printf("Failed to find suitable memory type");
-    exit(1);
-}
-
-void createUniformBuffers(Application *pApp)
-{
-    VkDeviceSize bufferSize = sizeof(UniformBufferObject);
+    if(pApp->config.animation != INSTANCE_ANIMATION_GPU)
+    {
+        return;
+    }
     
-    pApp->uniformBuffers = malloc(sizeof(VkBuffer) * MAX_FRAMES_IN_FLIGHT);
-    pApp->uniformBuffersMemory = malloc(sizeof(VkDeviceMemory) * MAX_FRAMES_IN_FLIGHT);
-    pApp->uniformBuffersMapped = malloc(sizeof(void*) * MAX_FRAMES_IN_FLIGHT);
+    createStaticBuffer(pApp, pEntities->transforms, sizeof(InstanceAnimation) * pEntities->count, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, &pApp->animationBuffer, &pApp->animationBufferMemory);
+    createTransformStage(&pApp->transformStage, pApp->device, &pApp->memoryPolicy, pApp->animationBuffer, instanceCount, pApp->instanceBuffers, sizeof(InstanceData) / sizeof(uint32_t), pApp->config.framesInFlight);
     
-    for(size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        createBuffer(pApp, bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &pApp->uniformBuffers[i], &pApp->uniformBuffersMemory[i]);
-        
-        vkMapMemory(pApp->device, pApp->uniformBuffersMemory[i], 0, bufferSize, 0, &pApp->uniformBuffersMapped[i]);
+    if(pApp->config.validateTransforms)
+    {
+        validateTransforms(pApp);
     }
 }
 
-void createDescriptorPool(Application *pApp)
+void validateTransforms(Application *pApp)//Runs the transform stage once on the identity order and compares every matrix with animateTransform
 {
-    VkDescriptorPoolSize poolSize = {
-        .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-        .descriptorCount = (uint32_t)MAX_FRAMES_IN_FLIGHT,
+    uint32_t instanceCount = pApp->config.benchmark.instanceCount;
+    VkDeviceSize bufferSize = sizeof(InstanceData) * instanceCount;
+    
+    uint32_t *sources = transformStageSources(&pApp->transformStage, 0);
+    for(uint32_t i = 0; i < instanceCount; i++)
+    {
+        sources[i] = i;
+    }
+    
+    VkBuffer readbackBuffer;
+    VkDeviceMemory readbackMemory;
+    uint32_t readbackMemoryType = createBuffer(pApp, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, MEMORY_USAGE_READBACK, &readbackBuffer, &readbackMemory);
+    
+    VkCommandBuffer commandBuffer = beginUploadCommands(pApp);
+    transformStageDispatch(&pApp->transformStage, commandBuffer, 0, instanceCount, TRANSFORM_VALIDATION_TIME);
+    
+    VkMemoryBarrier computeBarrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT
     };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &computeBarrier, 0, NULL, 0, NULL);
     
-    VkDescriptorPoolCreateInfo poolInfo = {
-        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-        .poolSizeCount = 1,
-        .pPoolSizes = &poolSize,
-        
-        .maxSets = (uint32_t)MAX_FRAMES_IN_FLIGHT
+    VkBufferCopy copyRegion = {
+        .srcOffset = 0,
+        .dstOffset = 0,
+        .size = bufferSize
+    };
+    vkCmdCopyBuffer(commandBuffer, pApp->instanceBuffers[0], readbackBuffer, 1, &copyRegion);
+    
+    VkMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_HOST_READ_BIT
     };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+    
+    frameSyncWaitValue(&pApp->frameSync, pApp->device, submitUploadCommands(pApp, commandBuffer));
+    
+    InstanceData *instances;
+    vkMapMemory(pApp->device, readbackMemory, 0, bufferSize, 0, (void **)&instances);
+    memoryPolicyInvalidate(&pApp->memoryPolicy, pApp->device, readbackMemory, readbackMemoryType, 0, VK_WHOLE_SIZE, VK_WHOLE_SIZE);
+    
+    float maxError = 0.0f;
+    uint32_t mismatches = 0;
+    for(uint32_t i = 0; i < instanceCount; i++)
+    {
+        float expected[4][4];
+        animateTransform(expected, &pApp->entities.transforms[i], TRANSFORM_VALIDATION_TIME);
+        float instanceError = 0.0f;
+        for(uint32_t row = 0; row < 4; row++)
+        {
+            for(uint32_t column = 0; column < 4; column++)
+            {
+                float error = fabsf(instances[i].model[row][column] - expected[row][column]) / fmaxf(1.0f, fabsf(expected[row][column]));//Relative for the translations of far instances
+                instanceError = isnan(error) ? INFINITY : fmaxf(instanceError, error);
+            }
+        }
+        maxError = fmaxf(maxError, instanceError);
+        if(instanceError > TRANSFORM_TOLERANCE || memcmp(&instances[i].texture, &pApp->packedTextures[pApp->entities.materials[i]], sizeof(InstanceTexture)) != 0)
+        {
+            mismatches++;
+        }
+    }
     
-    if(vkCreateDescriptorPool(pApp->device, &poolInfo, NULL, &pApp->descriptorPool) != VK_SUCCESS) {
-        printf("Failed to create descriptor pool!");
+    vkUnmapMemory(pApp->device, readbackMemory);
+    vkDestroyBuffer(pApp->device, readbackBuffer, NULL);
+    vkFreeMemory(pApp->device, readbackMemory, NULL);
+    
+    printf("Transform validation: %u instances, max error %g, tolerance %g, %u mismatches\n", instanceCount, maxError, TRANSFORM_TOLERANCE, mismatches);
+    if(mismatches > 0)
+    {
+        printf("GPU transforms do not match the CPU path!\n");
         exit(1);
     }
 }
 
 void createDescriptorSets(Application *pApp)
 {
-    VkDescriptorSetLayout *layouts = malloc(sizeof(VkDescriptorSetLayout) * MAX_FRAMES_IN_FLIGHT);
-    for(uint8_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        layouts[i] = pApp->descriptorSetLayout;
+    pApp->descriptorSets = malloc(sizeof(VkDescriptorSet) * pApp->config.framesInFlight);
+    if(!pApp->bindlessSupported)//Allocated from the frame's pools in updateFrameDescriptors
+    {
+        return;
     }
     
-    VkDescriptorSetAllocateInfo allocInfo = {
-        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-        .descriptorPool = pApp->descriptorPool,
-        .descriptorSetCount = (uint32_t)(MAX_FRAMES_IN_FLIGHT),
-        .pSetLayouts = layouts
-    };
+    pApp->uniformIndices = malloc(sizeof(uint32_t) * pApp->config.framesInFlight);
+    for(uint32_t i = 0; i < pApp->config.framesInFlight; i++)
+    {
+        pApp->uniformIndices[i] = bindlessAddBuffer(&pApp->bindless, pApp->device, pApp->uniformBuffers[i], 0, sizeof(UniformBufferObject));
+        pApp->descriptorSets[i] = pApp->bindless.set;
+    }
+}
+
+void updateFrameDescriptors(Application *pApp, uint32_t currentFrame)//The frame's fence has signalled, so every set it allocated last time is free to reuse
+{
+    if(pApp->bindlessSupported)
+    {
+        return;
+    }
     
-    pApp->descriptorSets = malloc(sizeof(VkDescriptorSet) * MAX_FRAMES_IN_FLIGHT);
+    DescriptorAllocator *pAllocator = &pApp->frameDescriptors[currentFrame];
+    resetDescriptorAllocator(pAllocator, pApp->device);
+    pApp->descriptorSets[currentFrame] = descriptorAllocatorAllocate(pAllocator, pApp->device);
     
-    if(vkAllocateDescriptorSets(pApp->device, &allocInfo, pApp->descriptorSets) != VK_SUCCESS) {
-        printf("Failed to create descriptor sets!");
-        exit(1);
-    }
+    VkDescriptorBufferInfo bufferInfo = {
+        .buffer = pApp->uniformBuffers[currentFrame],
+        .offset = 0,
+        .range = sizeof(UniformBufferObject)
+    };
     
-    for(uint8_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        VkDescriptorBufferInfo bufferInfo = {
-            .buffer = pApp->uniformBuffers[i],
-            .offset = 0,
-            .range = sizeof(UniformBufferObject)
-        };
+    VkWriteDescriptorSet descriptorWrite = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = pApp->descriptorSets[currentFrame],
+        .dstBinding = 0,
+        .dstArrayElement = 0,
         
-        VkWriteDescriptorSet descriptorWrite = {
-            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            .dstSet = pApp->descriptorSets[i],
-            .dstBinding = 0,
-            .dstArrayElement = 0,
-            
-            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .descriptorCount = 1,
-            
-            .pBufferInfo = &bufferInfo,
-            .pImageInfo = NULL,
-            .pTexelBufferView = NULL
-        };
+        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+        .descriptorCount = 1,
         
-        vkUpdateDescriptorSets(pApp->device, 1, &descriptorWrite, 0, NULL);
-    }
+        .pBufferInfo = &bufferInfo,
+        .pImageInfo = NULL,
+        .pTexelBufferView = NULL
+    };
     
-    free(layouts);
+    vkUpdateDescriptorSets(pApp->device, 1, &descriptorWrite, 0, NULL);
 }
 
 void initVulkan(Application *pApp)
@@ -1576,38 +2766,228 @@ void initVulkan(Application *pApp)
     createSurface(pApp);
     pickPhysicalDevice(pApp);
     createLogicalDevice(pApp);
+    createMemoryPolicy(&pApp->memoryPolicy, pApp->physicalDevice, &pApp->capabilities.memoryProperties, pApp->capabilities.properties.limits.nonCoherentAtomSize, pApp->capabilities.memoryBudget);
+    printMemoryPolicy(&pApp->memoryPolicy);
+    if(pApp->config.gpuBudget > 0.0f)
+    {
+        createResolutionScaler(&pApp->resolution, pApp->config.minResolutionScale, pApp->config.maxResolutionScale, pApp->config.gpuBudget, pApp->config.framesInFlight);
+    }
     createSwapChain(pApp);
     createImageViews(pApp);
+    pApp->depthFormat = findDepthFormat(pApp);
     createRenderPass(pApp);
     createDescriptorSetLayout(pApp);
     createGraphicsPipeline(pApp);
+    buildFrameGraph(pApp);
     createFramebuffers(pApp);
     createCommandPool(pApp);
-    createVertexBuffer(pApp);
-    createIndexBuffer(pApp);
+    createSyncObjects(pApp);//Uploads below already complete through the frame timeline
+    createDeletionQueue(&pApp->deletionQueue, 256);
+    createJobSystem(&pApp->jobs, jobSystemDefaultThreadCount());
+    createRenderQueue(&pApp->renderQueue, &pApp->jobs);
+    createTextureStreamer(&pApp->textureStreamer, pApp->device, &pApp->memoryPolicy, &pApp->deletionQueue, pApp->bindlessSupported ? &pApp->bindless : NULL, pApp->config.framesInFlight, pApp->config.textureBudget);
+    if(pApp->config.texturePack)
+    {
+        createTexturePack(pApp);
+    }
+    else
+    {
+        for(uint32_t i = 0; i < pApp->config.textureFileCount; i++)
+        {
+            textureStreamerLoad(&pApp->textureStreamer, pApp->config.textureFiles[i]);//Decoded while the mesh below is loaded
+        }
+        pApp->packedTextures = malloc(sizeof(InstanceTexture));
+        pApp->packedTextures[0] = (InstanceTexture){.slot = NO_INSTANCE_TEXTURE};
+        pApp->packedTextureCount = 1;
+    }
+    if(pApp->config.particleCount > 0)
+    {
+        createParticleSystem(&pApp->particles, pApp->device, &pApp->memoryPolicy, pApp->renderPass, pApp->config.particleCount, pApp->config.framesInFlight);
+    }
+    if(pApp->config.modelFile != NULL && isMeshFile(pApp->config.modelFile))
+    {
+        openMeshFile(&pApp->meshFile, pApp->config.modelFile, &pApp->mesh);//Vertex and index blobs are copied from the mapping straight into staging memory
+    }
+    else if(pApp->config.modelFile != NULL)
+    {
+        loadMesh(&pApp->mesh, pApp->config.modelFile, &pApp->jobs);
+        if(!pApp->config.skipMeshOptimization)
+        {
+            optimizeMesh(&pApp->mesh);//meshconv already did this for .mesh files
+        }
+        generateMeshLods(&pApp->mesh, MAX_MESH_LODS);
+    }
+    else
+    {
+        generateGridMesh(&pApp->mesh, pApp->config.benchmark.meshComplexity);
+    }
+    pApp->meshRadius = meshBoundingRadius(&pApp->mesh);
+    createGeometryPool(pApp);
+    uploadMesh(pApp, &pApp->mesh, &pApp->meshRange);
+    printGeometryPool(&pApp->geometryPool);
     createUniformBuffers(pApp);
-    createDescriptorPool(pApp);
+    createInstanceBuffers(pApp);
+    createSceneEntities(pApp);
     createDescriptorSets(pApp);
     createCommandBuffer(pApp);
-    createSyncObjects(pApp);
+    initProfiler(pApp);
+}
+
+void initProfiler(Application *pApp)
+{
+    createProfiler(&pApp->profiler, 240, pApp->config.framesInFlight);
+    
+    DeviceCapabilities *pCapabilities = &pApp->capabilities;
+    
+    profilerInitGpu(&pApp->profiler, pApp->device, pCapabilities->properties.limits.timestampPeriod, pCapabilities->queueFamilies[pApp->queueFamilies.graphicsFamily].timestampValidBits);
+    
+    if(pApp->config.profileOutput != NULL)
+    {
+        profilerOpenExport(&pApp->profiler, pApp->config.profileOutput);
+    }
+}
+
+void updateStatsTitle(Application *pApp)//Shows the rolling frame statistics in the window title twice a second
+{
+    uint64_t now = profilerTimeNs();
+    if(now - pApp->statsUpdateTime < 500000000ull)
+    {
+        return;
+    }
+    pApp->statsUpdateTime = now;
+    
+    ProfilerStats stats;
+    profilerComputeStats(&pApp->profiler, &stats);
+    
+    char title[256];
+    snprintf(title, sizeof(title), "Vulkan - cpu %.2f ms (max %.2f) | gpu %.2f ms (max %.2f) | fence %.2f acquire %.2f record %.2f present %.2f",
+             stats.cpuFrameMean, stats.cpuFrameMax, stats.gpuFrameMean, stats.gpuFrameMax,
+             stats.cpuStageMean[PROFILE_STAGE_FENCE_WAIT], stats.cpuStageMean[PROFILE_STAGE_ACQUIRE],
+             stats.cpuStageMean[PROFILE_STAGE_RECORD], stats.cpuStageMean[PROFILE_STAGE_PRESENT]);
+    if(pApp->config.gpuBudget > 0.0f)
+    {
+        size_t length = strlen(title);
+        snprintf(title + length, sizeof(title) - length, " | scale %.2f", pApp->resolution.scale);
+    }
+    glfwSetWindowTitle(pApp->window, title);
 }
 
 void mainLoop(Application *pApp)
 {
+    if(pApp->config.benchmark.enabled)
+    {
+        runBenchmark(pApp);
+        return;
+    }
+    
     while(!glfwWindowShouldClose(pApp->window))
     {
         glfwPollEvents();
+        pApp->simulationTime = (profilerTimeNs() - pApp->startTime)/1e9;
         drawFrame(pApp);
+        updateStatsTitle(pApp);
     }
 
     vkDeviceWaitIdle(pApp->device);
 }
 
+void runBenchmark(Application *pApp)//Renders a fixed number of frames with a fixed simulated timestep, then reports the measured frames
+{
+    BenchmarkSettings *pSettings = &pApp->config.benchmark;
+    uint64_t totalFrames = (uint64_t)pSettings->warmupFrames + pSettings->measuredFrames;
+    
+    profilerKeepHistory(&pApp->profiler, (uint32_t)totalFrames);
+    
+    uint64_t warmupParticleUpdates = 0;
+    uint64_t warmupDraws = 0;
+    uint64_t warmupBinds[RENDER_BIND_COUNT] = {0};
+    uint64_t warmupSkippedBinds[RENDER_BIND_COUNT] = {0};
+    Bvh warmupBvh = pApp->bvh;//Only its counters are read
+    while(pApp->profiler.frame < totalFrames && !glfwWindowShouldClose(pApp->window))
+    {
+        glfwPollEvents();
+        if(pApp->profiler.frame == pSettings->warmupFrames)
+        {
+            warmupParticleUpdates = pApp->particles.simulated;//Read back a few frames late, which the end of the run is as well
+            warmupDraws = pApp->renderQueue.draws;//Counted while recording, so exactly at the boundary
+            memcpy(warmupBinds, pApp->renderQueue.binds, sizeof(warmupBinds));
+            memcpy(warmupSkippedBinds, pApp->renderQueue.skippedBinds, sizeof(warmupSkippedBinds));
+            warmupBvh = pApp->bvh;
+        }
+        pApp->simulationTime = pApp->profiler.frame * pSettings->timestep;//Only presented frames advance the simulation
+        drawFrame(pApp);
+    }
+    
+    vkDeviceWaitIdle(pApp->device);
+    profilerFlush(&pApp->profiler, pApp->device);
+    
+    BenchmarkSummary summary;
+    computeBenchmarkSummary(pApp->profiler.history, pApp->profiler.historyCount, pSettings->warmupFrames, &summary);
+    
+    BenchmarkScene scene = {
+        .deviceName = pApp->capabilities.properties.deviceName,
+        .vertexCount = (uint64_t)pApp->mesh.vertexCount * pSettings->instanceCount,
+        .triangleCount = (uint64_t)(pApp->mesh.lods[0].indexCount / 3) * pSettings->instanceCount,//Full detail, levels of detail are picked per frame
+        .vertexFormat = pApp->config.vertexLayout.name,
+        .vertexStride = pApp->config.vertexLayout.stride,
+        .depthSort = depthSortNames[pApp->config.depthSort],
+        .animation = instanceAnimationNames[pApp->config.animation],
+        .culling = cullingNames[pApp->config.culling],
+        .visibleInstances = pApp->visibleCount,
+        .occlusion = pApp->config.occlusion,
+        .occludedInstances = pApp->occlusion.lastOccluded,
+        .gpuBudget = pApp->config.gpuBudget,
+        .meanResolutionScale = pApp->resolution.samples ? (float)(pApp->resolution.scaleSum / pApp->resolution.samples) : 1.0f,
+        .lowestResolutionScale = pApp->config.gpuBudget > 0.0f ? pApp->resolution.lowestScale : 1.0f,
+        .draws = pApp->renderQueue.draws - warmupDraws,
+        .bindless = pApp->bindlessSupported,
+        .drift = pApp->config.drift,
+        .bvhBuilds = pApp->bvh.builds - warmupBvh.builds,
+        .bvhRefits = pApp->bvh.refits - warmupBvh.refits,
+        .bvhSubtreeRebuilds = pApp->bvh.subtreeRebuilds - warmupBvh.subtreeRebuilds,
+        .bvhCostRatio = pApp->bvh.buildCost > 0.0f ? pApp->bvh.cost / pApp->bvh.buildCost : 1.0f,
+        .particles = pApp->config.particleCount,
+        .particleUpdates = pApp->particles.simulated - warmupParticleUpdates
+    };
+    for(uint32_t i = 0; i < RENDER_BIND_COUNT; i++)
+    {
+        scene.binds[i] = pApp->renderQueue.binds[i] - warmupBinds[i];
+        scene.skippedBinds[i] = pApp->renderQueue.skippedBinds[i] - warmupSkippedBinds[i];
+    }
+    
+    FILE *pFile = pApp->pSummaryFile;
+    if(pSettings->outputFile != NULL)
+    {
+        pFile = fopen(pSettings->outputFile, "w");
+        if(pFile == NULL)
+        {
+            printf("Failed to open benchmark output: %s!\n", pSettings->outputFile);
+            exit(1);
+        }
+    }
+    
+    writeBenchmarkSummary(pFile, pSettings, &scene, &summary);
+    
+    fclose(pFile);
+    pApp->pSummaryFile = NULL;
+}
+
 void cleanup(Application *pApp)
 {
     cleanupSwapChain(pApp);
     
-    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    printTextureStreamerStats(&pApp->textureStreamer);
+    destroyTextureStreamer(&pApp->textureStreamer);
+    destroyTexturePack(&pApp->texturePack, pApp->device, pApp->bindlessSupported ? &pApp->bindless : NULL);
+    free(pApp->packedTextures);//Before the bindless table, the deletion queue has released its old slots already
+    
+    if(pApp->config.particleCount > 0)
+    {
+        printParticleSystem(&pApp->particles);
+        destroyParticleSystem(&pApp->particles);
+    }
+    
+    for (uint32_t i = 0; i < pApp->config.framesInFlight; i++) {
         vkDestroyBuffer(pApp->device, pApp->uniformBuffers[i], NULL);
         vkFreeMemory(pApp->device, pApp->uniformBuffersMemory[i], NULL);
     }
@@ -1616,35 +2996,94 @@ void cleanup(Application *pApp)
     free(pApp->uniformBuffersMemory);
     free(pApp->uniformBuffersMapped);
     
-    vkDestroyDescriptorPool(pApp->device, pApp->descriptorPool, NULL);
+    for (uint32_t i = 0; i < pApp->config.framesInFlight; i++) {
+        vkDestroyBuffer(pApp->device, pApp->instanceBuffers[i], NULL);
+        vkFreeMemory(pApp->device, pApp->instanceBuffersMemory[i], NULL);
+    }
     
-    vkDestroyDescriptorSetLayout(pApp->device, pApp->descriptorSetLayout, NULL);
+    if(pApp->config.animation == INSTANCE_ANIMATION_GPU)
+    {
+        destroyTransformStage(&pApp->transformStage);
+        vkDestroyBuffer(pApp->device, pApp->animationBuffer, NULL);
+        vkFreeMemory(pApp->device, pApp->animationBufferMemory, NULL);
+    }
+    if(pApp->config.occlusion)//After cleanupSwapChain, the deletion queue has released the old pyramids
+    {
+        printOcclusionCuller(&pApp->occlusion);
+        destroyOcclusionCuller(&pApp->occlusion);
+        vkDestroyBuffer(pApp->device, pApp->boundsBuffer, NULL);
+        vkFreeMemory(pApp->device, pApp->boundsBufferMemory, NULL);
+    }
+    if(pApp->config.gpuBudget > 0.0f)
+    {
+        printResolutionScaler(&pApp->resolution);
+        destroyResolutionScaler(&pApp->resolution);
+    }
+    printBvh(&pApp->bvh);
+    destroyBvh(&pApp->bvh);
+    free(pApp->visibleInstances);
+    destroyEntityStore(&pApp->entities);
+    free(pApp->worldMatrices);
+    free(pApp->driftOrigins);
+    
+    free(pApp->instanceBuffers);
+    free(pApp->instanceBuffersMemory);
+    free(pApp->instanceBuffersMapped);
+    free(pApp->instanceLods);
+    free(pApp->instanceOrder);
+    
+    if(pApp->bindlessSupported)
+    {
+        destroyBindlessTable(&pApp->bindless, pApp->device);//Owns descriptorSetLayout
+        free(pApp->uniformIndices);
+    }
+    else
+    {
+        for(uint32_t i = 0; i < pApp->config.framesInFlight; i++)
+        {
+            destroyDescriptorAllocator(&pApp->frameDescriptors[i], pApp->device);
+        }
+        free(pApp->frameDescriptors);
+        vkDestroyDescriptorSetLayout(pApp->device, pApp->descriptorSetLayout, NULL);
+    }
     
     free(pApp->descriptorSets);
     
-    vkDestroyBuffer(pApp->device, pApp->vertexBuffer, NULL);
-    vkFreeMemory(pApp->device, pApp->vertexBufferMemory, NULL);
+    vkDestroyBuffer(pApp->device, pApp->geometryPool.vertexBuffer, NULL);
+    vkFreeMemory(pApp->device, pApp->geometryPool.vertexMemory, NULL);
     
-    vkDestroyBuffer(pApp->device, pApp->indexBuffer, NULL);
-    vkFreeMemory(pApp->device, pApp->indexBufferMemory, NULL);
+    vkDestroyBuffer(pApp->device, pApp->geometryPool.indexBuffer, NULL);
+    vkFreeMemory(pApp->device, pApp->geometryPool.indexMemory, NULL);
+    freeGeometryPool(&pApp->geometryPool);
     
-    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        vkDestroySemaphore(pApp->device, pApp->imageAvailableSemaphores[i], NULL);
-        vkDestroySemaphore(pApp->device, pApp->renderFinishedSemaphores[i], NULL);
-        vkDestroyFence(pApp->device, pApp->inFlightFences[i], NULL);
+    if(pApp->meshFile.data != NULL)
+    {
+        closeMeshFile(&pApp->meshFile);
     }
+    else
+    {
+        freeMesh(&pApp->mesh);
+    }
+    printRenderQueueStats(&pApp->renderQueue);
+    destroyRenderQueue(&pApp->renderQueue);
+    destroyJobSystem(&pApp->jobs);
+    
+    destroyDeletionQueue(&pApp->deletionQueue, pApp->device);
     
-    free(pApp->imageAvailableSemaphores);
-    free(pApp->renderFinishedSemaphores);
-    free(pApp->inFlightFences);
+    destroyFrameSync(&pApp->frameSync, pApp->device);
+    
+    destroyProfiler(&pApp->profiler, pApp->device);
     
     vkDestroyCommandPool(pApp->device, pApp->commandPool, NULL);
     
     vkDestroyPipeline(pApp->device, pApp->graphicsPipeline, NULL);
     vkDestroyPipelineLayout(pApp->device, pApp->pipelineLayout, NULL);
     vkDestroyRenderPass(pApp->device, pApp->renderPass, NULL);
+    vkDestroyRenderPass(pApp->device, pApp->lateRenderPass, NULL);//Null without occlusion culling
     
     vkDestroyDevice(pApp->device, NULL);
+    
+    freeDeviceCapabilities(&pApp->capabilities);
 
     if (enableValidationLayers) {
         DestroyDebugUtilsMessengerEXT(pApp->instance, pApp->debugMessenger, NULL);
@@ -1667,10 +3106,252 @@ void run(Application *pApp)
     cleanup(pApp);
 }
 
-int main(void)
+void parseArguments(Config *pConfig, int argc, char **argv)
 {
-    startTime = clock();
+    defaultBenchmarkSettings(&pConfig->benchmark);
+    pConfig->framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
+    pConfig->lodPixelError = DEFAULT_LOD_PIXEL_ERROR;
+    parseVertexLayout("float", &pConfig->vertexLayout);
+    pConfig->textureBudget = DEFAULT_TEXTURE_BUDGET;
+    pConfig->minResolutionScale = DEFAULT_MIN_RESOLUTION_SCALE;
+    pConfig->maxResolutionScale = DEFAULT_MAX_RESOLUTION_SCALE;
+    
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--profile-out") == 0 && i + 1 < argc)
+        {
+            pConfig->profileOutput = argv[++i];//.json for a JSON array, anything else for CSV
+        }
+        else if(strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc)
+        {
+            pConfig->framesInFlight = (uint32_t)strtoul(argv[++i], NULL, 10);//1 for the lowest latency, 3-4 for throughput
+        }
+        else if(strcmp(argv[i], "--bindless") == 0)
+        {
+            pConfig->bindless = 1;//Needs VK_EXT_descriptor_indexing, ignored without it
+        }
+        else if(strcmp(argv[i], "--no-timeline") == 0)
+        {
+            pConfig->disableTimeline = 1;//Forces the binary semaphore and fence path
+        }
+        else if(strcmp(argv[i], "--benchmark") == 0)
+        {
+            pConfig->benchmark.enabled = 1;
+        }
+        else if(strcmp(argv[i], "--warmup-frames") == 0 && i + 1 < argc)
+        {
+            pConfig->benchmark.warmupFrames = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            pConfig->benchmark.measuredFrames = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "--timestep") == 0 && i + 1 < argc)
+        {
+            pConfig->benchmark.timestep = strtod(argv[++i], NULL);
+        }
+        else if(strcmp(argv[i], "--instances") == 0 && i + 1 < argc)
+        {
+            pConfig->benchmark.instanceCount = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "--mesh-complexity") == 0 && i + 1 < argc)
+        {
+            pConfig->benchmark.meshComplexity = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "--benchmark-out") == 0 && i + 1 < argc)
+        {
+            pConfig->benchmark.outputFile = argv[++i];
+        }
+        else if(strcmp(argv[i], "--model") == 0 && i + 1 < argc)
+        {
+            pConfig->modelFile = argv[++i];//Replaces the grid, --mesh-complexity is ignored
+        }
+        else if(strcmp(argv[i], "--lod-error") == 0 && i + 1 < argc)
+        {
+            pConfig->lodPixelError = strtof(argv[++i], NULL);//In pixels, 0 always draws full detail
+        }
+        else if(strcmp(argv[i], "--vertex-format") == 0 && i + 1 < argc)
+        {
+            if(!parseVertexLayout(argv[++i], &pConfig->vertexLayout))
+            {
+                printf("Unknown vertex format: %s!\n", argv[i]);
+                exit(1);
+            }
+        }
+        else if(strcmp(argv[i], "--scene") == 0 && i + 1 < argc)
+        {
+            const char *scene = argv[++i];
+            if(strcmp(scene, "grid") == 0)
+            {
+                pConfig->benchmark.scene = BENCHMARK_SCENE_GRID;
+            }
+            else if(strcmp(scene, "overdraw") == 0)
+            {
+                pConfig->benchmark.scene = BENCHMARK_SCENE_OVERDRAW;//Instances stacked along the view axis
+            }
+            else
+            {
+                printf("Unknown scene: %s!\n", scene);
+                exit(1);
+            }
+        }
+        else if(strcmp(argv[i], "--depth-sort") == 0 && i + 1 < argc)
+        {
+            const char *sort = argv[++i];
+            uint32_t found = 0;
+            for(uint32_t s = 0; s < sizeof(depthSortNames) / sizeof(depthSortNames[0]); s++)
+            {
+                if(strcmp(sort, depthSortNames[s]) == 0)
+                {
+                    pConfig->depthSort = s;//back and none are baselines for measuring what early depth rejection saves
+                    found = 1;
+                }
+            }
+            if(!found)
+            {
+                printf("Unknown depth sort: %s!\n", sort);
+                exit(1);
+            }
+        }
+        else if(strcmp(argv[i], "--animate") == 0 && i + 1 < argc)
+        {
+            const char *animation = argv[++i];
+            uint32_t found = 0;
+            for(uint32_t a = 0; a < sizeof(instanceAnimationNames) / sizeof(instanceAnimationNames[0]); a++)
+            {
+                if(strcmp(animation, instanceAnimationNames[a]) == 0)
+                {
+                    pConfig->animation = a;//cpu and gpu animate the same scene, compare them to see what the dispatch saves
+                    found = 1;
+                }
+            }
+            if(!found)
+            {
+                printf("Unknown animation: %s!\n", animation);
+                exit(1);
+            }
+        }
+        else if(strcmp(argv[i], "--culling") == 0 && i + 1 < argc)
+        {
+            const char *culling = argv[++i];
+            uint32_t found = 0;
+            for(uint32_t c = 0; c < sizeof(cullingNames) / sizeof(cullingNames[0]); c++)
+            {
+                if(strcmp(culling, cullingNames[c]) == 0)
+                {
+                    pConfig->culling = c;//flat tests every bounding sphere, none draws everything, both are baselines for the hierarchy
+                    found = 1;
+                }
+            }
+            if(!found)
+            {
+                printf("Unknown culling: %s!\n", culling);
+                exit(1);
+            }
+        }
+        else if(strcmp(argv[i], "--occlusion") == 0)
+        {
+            pConfig->occlusion = 1;//Pays off when most instances hide behind others, see the overdraw scene
+        }
+        else if(strcmp(argv[i], "--dynamic-resolution") == 0 && i + 1 < argc)
+        {
+            pConfig->gpuBudget = strtof(argv[++i], NULL);//Milliseconds, 16.6 for 60 Hz leaves no time to spare
+        }
+        else if(strcmp(argv[i], "--min-resolution") == 0 && i + 1 < argc)
+        {
+            pConfig->minResolutionScale = strtof(argv[++i], NULL);
+        }
+        else if(strcmp(argv[i], "--max-resolution") == 0 && i + 1 < argc)
+        {
+            pConfig->maxResolutionScale = strtof(argv[++i], NULL);//Above 1 supersamples when there is time to spare
+        }
+        else if(strcmp(argv[i], "--dump-graph") == 0)
+        {
+            pConfig->dumpGraph = 1;//Passes, barriers and transient memory of the frame, printed whenever the swap chain is created
+        }
+        else if(strcmp(argv[i], "--drift") == 0 && i + 1 < argc)
+        {
+            pConfig->drift = strtof(argv[++i], NULL);//Exercises refitting and incremental rebuilds of the BVH, watch its stats and the culling stage time
+        }
+        else if(strcmp(argv[i], "--validate-transforms") == 0)
+        {
+            pConfig->validateTransforms = 1;
+        }
+        else if(strcmp(argv[i], "--texture") == 0 && i + 1 < argc)
+        {
+            if(pConfig->textureFileCount == MAX_TEXTURE_FILES)
+            {
+                printf("At most %u textures can be given!\n", MAX_TEXTURE_FILES);
+                exit(1);
+            }
+            pConfig->textureFiles[pConfig->textureFileCount++] = argv[++i];//.png, .ktx2 or .raw, may be repeated
+        }
+        else if(strcmp(argv[i], "--texture-pack") == 0)
+        {
+            pConfig->texturePack = 1;//Batches differently textured instances, at the cost of loading everything up front
+        }
+        else if(strcmp(argv[i], "--texture-budget") == 0 && i + 1 < argc)
+        {
+            pConfig->textureBudget = (VkDeviceSize)strtoul(argv[++i], NULL, 10) << 20;//In MiB, finer levels stop streaming once it is reached
+        }
+        else if(strcmp(argv[i], "--particles") == 0 && i + 1 < argc)
+        {
+            pConfig->particleCount = (uint32_t)strtoul(argv[++i], NULL, 10);//Emitted, simulated and drawn without the CPU touching a particle
+        }
+        else if(strcmp(argv[i], "--no-mesh-optimize") == 0)
+        {
+            pConfig->skipMeshOptimization = 1;//Keeps the file's triangle and vertex order
+        }
+        else
+        {
+            printf("Unknown argument: %s\n", argv[i]);
+            printf("Usage: VulkanProject [--profile-out <file.csv|file.json>] [--frames-in-flight 1-%u] [--no-timeline] [--bindless]\n"
+                   "                     [--benchmark] [--warmup-frames N] [--frames N] [--timestep seconds]\n"
+                   "                     [--instances N] [--mesh-complexity subdivisions] [--benchmark-out file.json]\n"
+                   "                     [--model file.obj|file.glb|file.mesh] [--no-mesh-optimize] [--lod-error pixels]\n"
+                   "                     [--vertex-format float|compact|position=float|half|snorm16|unorm16,normal=float|oct16,uv=float|half,color=float|unorm8]\n"
+                   "                     [--scene grid|overdraw] [--depth-sort front|back|none]\n"
+                   "                     [--texture file.png|file.ktx2|file.raw]... [--texture-budget MiB] [--texture-pack]\n"
+                   "                     [--particles N] [--animate none|cpu|gpu] [--validate-transforms] [--culling bvh|flat|none] [--occlusion]\n"
+                   "                     [--dynamic-resolution gpu-ms] [--min-resolution scale] [--max-resolution scale] [--dump-graph]\n"
+                   "                     [--drift distance]\n", MAX_FRAMES_IN_FLIGHT);
+            exit(1);
+        }
+    }
+    
+    if(pConfig->framesInFlight < 1 || pConfig->framesInFlight > MAX_FRAMES_IN_FLIGHT)
+    {
+        printf("Frames in flight must be between 1 and %u!\n", MAX_FRAMES_IN_FLIGHT);
+        exit(1);
+    }
+    
+    if(pConfig->validateTransforms && pConfig->animation != INSTANCE_ANIMATION_GPU)
+    {
+        printf("--validate-transforms needs --animate gpu!\n");
+        exit(1);
+    }
+    
+    if(pConfig->drift > 0.0f && (pConfig->animation == INSTANCE_ANIMATION_GPU || pConfig->occlusion))
+    {
+        printf("--drift needs --animate none or cpu and no --occlusion, the GPU reads positions and bounds uploaded once!\n");
+        exit(1);
+    }
+    
+    if(pConfig->gpuBudget < 0.0f || pConfig->minResolutionScale <= 0.0f || pConfig->minResolutionScale > pConfig->maxResolutionScale || pConfig->maxResolutionScale > MAX_RESOLUTION_SCALE)
+    {
+        printf("Resolution scales must satisfy 0 < min <= max <= %.1f and the GPU budget can not be negative!\n", MAX_RESOLUTION_SCALE);
+        exit(1);
+    }
+    
+    if(pConfig->benchmark.instanceCount == 0)
+    {
+        printf("At least one instance is required!\n");
+        exit(1);
+    }
+}
 
+int main(int argc, char **argv)
+{
     if(enableCompatibilityBit)
     {
         printf("Compatibility bit enabled\n");
@@ -1680,6 +3361,18 @@ int main(void)
         printf("Compatibility bit NOT enabled\n");
     }
     Application app = {0};
+    app.startTime = profilerTimeNs();
+    parseArguments(&app.config, argc, argv);
+    
+    if(app.config.benchmark.enabled && app.config.benchmark.outputFile == NULL)//Keeps stdout for the summary alone so it can be piped into a JSON parser, what was printed so far is still buffered and follows the rest to stderr
+    {
+        app.pSummaryFile = fdopen(dup(STDOUT_FILENO), "w");
+        if(app.pSummaryFile == NULL || dup2(STDERR_FILENO, STDOUT_FILENO) < 0)
+        {
+            printf("Failed to redirect output to stderr!\n");
+            exit(1);
+        }
+    }
 
     run(&app);
 
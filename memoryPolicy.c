@@ -0,0 +1,275 @@
+//
+//  memoryPolicy.c
+//  vkProject
+//
+//  Ranks memory types by intended usage and heap budget.
+//
+
+#include "memoryPolicy.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LEGACY_BAR_SIZE (256ull * 1024 * 1024)
+#define SMALL_DYNAMIC_ALLOCATION (256ull * 1024)//Small enough to live in a legacy BAR window without crowding it
+
+static const char *memoryUsageNames[] = {"gpu_only", "gpu_mapped", "upload", "readback", "dynamic", "transient"};
+
+void createMemoryPolicy(MemoryPolicy *pPolicy, VkPhysicalDevice physicalDevice, const VkPhysicalDeviceMemoryProperties *pMemoryProperties, VkDeviceSize nonCoherentAtomSize, uint32_t budgetEnabled)
+{
+    memset(pPolicy, 0, sizeof(MemoryPolicy));
+    pPolicy->physicalDevice = physicalDevice;
+    pPolicy->memoryProperties = *pMemoryProperties;
+    pPolicy->nonCoherentAtomSize = nonCoherentAtomSize ? nonCoherentAtomSize : 1;
+    pPolicy->budgetEnabled = budgetEnabled;
+
+    uint32_t deviceLocalTypes = 0;
+    uint32_t mappableDeviceLocalTypes = 0;
+    for(uint32_t i = 0; i < pMemoryProperties->memoryTypeCount; i++)
+    {
+        VkMemoryType type = pMemoryProperties->memoryTypes[i];
+        if(!(type.propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+        {
+            continue;
+        }
+
+        deviceLocalTypes++;
+        if(type.propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+        {
+            mappableDeviceLocalTypes++;
+            if(pMemoryProperties->memoryHeaps[type.heapIndex].size > LEGACY_BAR_SIZE)
+            {
+                pPolicy->resizableBar = 1;
+            }
+        }
+    }
+    pPolicy->unifiedMemory = deviceLocalTypes > 0 && deviceLocalTypes == mappableDeviceLocalTypes;
+
+    memoryPolicyUpdateBudget(pPolicy);
+}
+
+void memoryPolicyUpdateBudget(MemoryPolicy *pPolicy)
+{
+    if(pPolicy->budgetEnabled)
+    {
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT
+        };
+
+        VkPhysicalDeviceMemoryProperties2 memoryProperties = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2,
+            .pNext = &budgetProperties
+        };
+
+        vkGetPhysicalDeviceMemoryProperties2(pPolicy->physicalDevice, &memoryProperties);
+        memcpy(pPolicy->heapBudget, budgetProperties.heapBudget, sizeof(pPolicy->heapBudget));
+        memcpy(pPolicy->heapUsage, budgetProperties.heapUsage, sizeof(pPolicy->heapUsage));
+        return;
+    }
+
+    for(uint32_t i = 0; i < pPolicy->memoryProperties.memoryHeapCount; i++)//Without the extension usage is unknown, a single allocation may take up to three quarters of a heap and running out is caught by vkAllocateMemory
+    {
+        pPolicy->heapBudget[i] = pPolicy->memoryProperties.memoryHeaps[i].size / 4 * 3;
+        pPolicy->heapUsage[i] = 0;
+    }
+}
+
+static int32_t scoreType(MemoryPolicy *pPolicy, VkMemoryPropertyFlags flags, uint32_t usage, VkDeviceSize size)//Negative when the type can not serve the usage at all
+{
+    if((flags & VK_MEMORY_PROPERTY_PROTECTED_BIT) || ((flags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) && usage != MEMORY_USAGE_TRANSIENT))
+    {
+        return -1;
+    }
+
+    uint32_t deviceLocal = (flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0;
+    uint32_t hostVisible = (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+    uint32_t hostCoherent = (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+    uint32_t hostCached = (flags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT) != 0;
+    uint32_t lazilyAllocated = (flags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) != 0;
+
+    switch(usage)
+    {
+        case MEMORY_USAGE_GPU_ONLY://Keeps mappable device memory free for data that needs it
+            return 1 + 8 * deviceLocal - 2 * hostVisible;
+        case MEMORY_USAGE_GPU_MAPPED:
+            if(!deviceLocal || !hostVisible || !(pPolicy->resizableBar || pPolicy->unifiedMemory))
+            {
+                return -1;
+            }
+            return 1 + 2 * hostCoherent - hostCached;
+        case MEMORY_USAGE_UPLOAD://Write-combined system memory, the copy reads it once
+            if(!hostVisible)
+            {
+                return -1;
+            }
+            return 1 + 4 * hostCoherent - 2 * deviceLocal - hostCached;
+        case MEMORY_USAGE_READBACK://CPU reads from uncached memory are very slow, coherency is handled with invalidates
+            if(!hostVisible)
+            {
+                return -1;
+            }
+            return 1 + 4 * hostCached + hostCoherent;
+        case MEMORY_USAGE_DYNAMIC:
+        {
+            if(!hostVisible)
+            {
+                return -1;
+            }
+            uint32_t preferDeviceLocal = pPolicy->resizableBar || pPolicy->unifiedMemory || size <= SMALL_DYNAMIC_ALLOCATION;
+            return 1 + 4 * (deviceLocal && preferDeviceLocal) - 4 * (deviceLocal && !preferDeviceLocal) + 2 * hostCoherent - hostCached;
+        }
+        case MEMORY_USAGE_TRANSIENT:
+            if(!deviceLocal)
+            {
+                return -1;
+            }
+            return 1 + 8 * lazilyAllocated - 2 * hostVisible;
+    }
+    return -1;
+}
+
+uint32_t memoryPolicyRankTypes(MemoryPolicy *pPolicy, uint32_t typeFilter, uint32_t usage, VkDeviceSize size, uint32_t rankedTypes[VK_MAX_MEMORY_TYPES])//Fills rankedTypes best first, returns how many types qualify
+{
+    int32_t scores[VK_MAX_MEMORY_TYPES];
+    uint32_t count = 0;
+
+    for(uint32_t i = 0; i < pPolicy->memoryProperties.memoryTypeCount; i++)
+    {
+        if(!(typeFilter & (1u << i)))
+        {
+            continue;
+        }
+
+        int32_t score = scoreType(pPolicy, pPolicy->memoryProperties.memoryTypes[i].propertyFlags, usage, size);
+        if(score < 0)
+        {
+            continue;
+        }
+
+        uint32_t j = count++;//Insertion sort, equal scores keep the driver's order which is already sorted by preference
+        while(j > 0 && scores[j - 1] < score)
+        {
+            scores[j] = scores[j - 1];
+            rankedTypes[j] = rankedTypes[j - 1];
+            j--;
+        }
+        scores[j] = score;
+        rankedTypes[j] = i;
+    }
+    return count;
+}
+
+static uint32_t fitsBudget(MemoryPolicy *pPolicy, uint32_t memoryTypeIndex, VkDeviceSize size)
+{
+    uint32_t heapIndex = pPolicy->memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+    return pPolicy->heapUsage[heapIndex] + size <= pPolicy->heapBudget[heapIndex];
+}
+
+VkResult memoryPolicyAllocate(MemoryPolicy *pPolicy, VkDevice device, const VkMemoryRequirements *pRequirements, uint32_t usage, VkDeviceMemory *pMemory, uint32_t *pMemoryTypeIndex)
+{
+    uint32_t rankedTypes[VK_MAX_MEMORY_TYPES];
+    uint32_t count = memoryPolicyRankTypes(pPolicy, pRequirements->memoryTypeBits, usage, pRequirements->size, rankedTypes);
+    if(count == 0)
+    {
+        return VK_ERROR_FEATURE_NOT_PRESENT;
+    }
+
+    memoryPolicyUpdateBudget(pPolicy);
+
+    for(uint32_t pass = 0; pass < 2; pass++)//Types within budget first, then anything the driver will still give us
+    {
+        for(uint32_t i = 0; i < count; i++)
+        {
+            uint32_t typeIndex = rankedTypes[i];
+            if(pass == 0 && !fitsBudget(pPolicy, typeIndex, pRequirements->size))
+            {
+                continue;
+            }
+
+            VkMemoryAllocateInfo allocInfo = {
+                .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+                .allocationSize = pRequirements->size,
+                .memoryTypeIndex = typeIndex
+            };
+
+            VkResult result = vkAllocateMemory(device, &allocInfo, NULL, pMemory);
+            if(result == VK_SUCCESS)
+            {
+                *pMemoryTypeIndex = typeIndex;
+                return VK_SUCCESS;
+            }
+
+            if(result != VK_ERROR_OUT_OF_DEVICE_MEMORY && result != VK_ERROR_OUT_OF_HOST_MEMORY)
+            {
+                return result;
+            }
+        }
+    }
+    return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+}
+
+VkMemoryPropertyFlags memoryPolicyTypeFlags(MemoryPolicy *pPolicy, uint32_t memoryTypeIndex)
+{
+    return pPolicy->memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+}
+
+static VkMappedMemoryRange alignedRange(MemoryPolicy *pPolicy, VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize size, VkDeviceSize mappedSize)//Non-coherent ranges have to be multiples of nonCoherentAtomSize within the mapping, or run to its end with VK_WHOLE_SIZE
+{
+    VkDeviceSize atom = pPolicy->nonCoherentAtomSize;
+    VkDeviceSize start = offset / atom * atom;
+
+    VkMappedMemoryRange range = {
+        .sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+        .memory = memory,
+        .offset = start,
+        .size = VK_WHOLE_SIZE
+    };
+    if(size != VK_WHOLE_SIZE)
+    {
+        VkDeviceSize end = (offset + size + atom - 1) / atom * atom;
+        if(end <= mappedSize)//Rounding up past the mapping, which need not be a multiple of the atom size, is invalid
+        {
+            range.size = end - start;
+        }
+    }
+    return range;
+}
+
+void memoryPolicyFlush(MemoryPolicy *pPolicy, VkDevice device, VkDeviceMemory memory, uint32_t memoryTypeIndex, VkDeviceSize offset, VkDeviceSize size, VkDeviceSize mappedSize)//Makes CPU writes visible to the GPU, nothing to do for coherent memory. mappedSize is only read for ranges short of VK_WHOLE_SIZE
+{
+    if(memoryPolicyTypeFlags(pPolicy, memoryTypeIndex) & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+    {
+        return;
+    }
+
+    VkMappedMemoryRange range = alignedRange(pPolicy, memory, offset, size, mappedSize);
+    vkFlushMappedMemoryRanges(device, 1, &range);
+}
+
+void memoryPolicyInvalidate(MemoryPolicy *pPolicy, VkDevice device, VkDeviceMemory memory, uint32_t memoryTypeIndex, VkDeviceSize offset, VkDeviceSize size, VkDeviceSize mappedSize)//Makes GPU writes visible to the CPU, call after the GPU work is known to be complete
+{
+    if(memoryPolicyTypeFlags(pPolicy, memoryTypeIndex) & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+    {
+        return;
+    }
+
+    VkMappedMemoryRange range = alignedRange(pPolicy, memory, offset, size, mappedSize);
+    vkInvalidateMappedMemoryRanges(device, 1, &range);
+}
+
+void printMemoryPolicy(MemoryPolicy *pPolicy)
+{
+    printf("\nMemory policy: %s%s%s\n", pPolicy->resizableBar ? "resizable BAR " : "", pPolicy->unifiedMemory ? "unified memory " : "", pPolicy->budgetEnabled ? "with budget" : "estimated budget");
+    for(uint32_t usage = MEMORY_USAGE_GPU_ONLY; usage <= MEMORY_USAGE_TRANSIENT; usage++)
+    {
+        uint32_t rankedTypes[VK_MAX_MEMORY_TYPES];
+        uint32_t count = memoryPolicyRankTypes(pPolicy, ~0u, usage, 0, rankedTypes);
+        printf("\t%s:", memoryUsageNames[usage]);
+        for(uint32_t i = 0; i < count; i++)
+        {
+            printf(" %u(0x%x)", rankedTypes[i], memoryPolicyTypeFlags(pPolicy, rankedTypes[i]));
+        }
+        printf("\n");
+    }
+}
@@ -0,0 +1,52 @@
+//
+//  memoryPolicy.h
+//  vkProject
+//
+//  Ranks memory types by intended usage and heap budget.
+//
+
+#ifndef memoryPolicy_h
+#define memoryPolicy_h
+
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+
+enum memoryUsage {
+    MEMORY_USAGE_GPU_ONLY,//Written once through a transfer, only read by the GPU
+    MEMORY_USAGE_GPU_MAPPED,//Device local and written directly by the CPU, only offered with resizable BAR or unified memory
+    MEMORY_USAGE_UPLOAD,//Staging, written once by the CPU and copied by the GPU
+    MEMORY_USAGE_READBACK,//Written by the GPU, read by the CPU
+    MEMORY_USAGE_DYNAMIC,//Rewritten by the CPU every frame and read by the GPU
+    MEMORY_USAGE_TRANSIENT//Attachments that never leave the render pass, lazily allocated where the device offers it so tiled GPUs need no backing memory
+};
+
+typedef struct {
+    VkPhysicalDevice physicalDevice;
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    VkDeviceSize nonCoherentAtomSize;
+
+    uint32_t budgetEnabled;//VK_EXT_memory_budget, otherwise a fixed fraction of each heap is assumed available
+    VkDeviceSize heapBudget[VK_MAX_MEMORY_HEAPS];
+    VkDeviceSize heapUsage[VK_MAX_MEMORY_HEAPS];
+
+    uint32_t resizableBar;//A device local, host visible heap larger than the legacy 256 MiB window
+    uint32_t unifiedMemory;//Every device local type is host visible, as on integrated GPUs
+} MemoryPolicy;
+
+void createMemoryPolicy(MemoryPolicy *pPolicy, VkPhysicalDevice physicalDevice, const VkPhysicalDeviceMemoryProperties *pMemoryProperties, VkDeviceSize nonCoherentAtomSize, uint32_t budgetEnabled);
+
+void memoryPolicyUpdateBudget(MemoryPolicy *pPolicy);
+
+uint32_t memoryPolicyRankTypes(MemoryPolicy *pPolicy, uint32_t typeFilter, uint32_t usage, VkDeviceSize size, uint32_t rankedTypes[VK_MAX_MEMORY_TYPES]);
+
+VkResult memoryPolicyAllocate(MemoryPolicy *pPolicy, VkDevice device, const VkMemoryRequirements *pRequirements, uint32_t usage, VkDeviceMemory *pMemory, uint32_t *pMemoryTypeIndex);
+
+VkMemoryPropertyFlags memoryPolicyTypeFlags(MemoryPolicy *pPolicy, uint32_t memoryTypeIndex);
+
+void memoryPolicyFlush(MemoryPolicy *pPolicy, VkDevice device, VkDeviceMemory memory, uint32_t memoryTypeIndex, VkDeviceSize offset, VkDeviceSize size, VkDeviceSize mappedSize);
+
+void memoryPolicyInvalidate(MemoryPolicy *pPolicy, VkDevice device, VkDeviceMemory memory, uint32_t memoryTypeIndex, VkDeviceSize offset, VkDeviceSize size, VkDeviceSize mappedSize);
+
+void printMemoryPolicy(MemoryPolicy *pPolicy);
+
+#endif /* memoryPolicy_h */
@@ -0,0 +1,170 @@
+//
+//  mesh.c
+//  vkProject
+//
+//  Vertex types and CPU-side mesh data.
+//
+
+#include "mesh.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+static Vector3 bilinear(Vector3 c00, Vector3 c10, Vector3 c11, Vector3 c01, float u, float v)
+{
+    Vector3 result = {
+        .x = (1-u)*(1-v)*c00.x + u*(1-v)*c10.x + u*v*c11.x + (1-u)*v*c01.x,
+        .y = (1-u)*(1-v)*c00.y + u*(1-v)*c10.y + u*v*c11.y + (1-u)*v*c01.y,
+        .z = (1-u)*(1-v)*c00.z + u*(1-v)*c10.z + u*v*c11.z + (1-u)*v*c01.z
+    };
+    return result;
+}
+
+void generateGridMesh(Mesh *pMesh, uint32_t subdivisions)//Unit quad split into subdivisions^2 cells, one subdivision gives the original four vertex quad
+{
+    if(subdivisions == 0 || subdivisions > MAX_GRID_SUBDIVISIONS)
+    {
+        printf("Grid subdivisions must be between 1 and %d!\n", MAX_GRID_SUBDIVISIONS);
+        exit(1);
+    }
+
+    uint32_t side = subdivisions + 1;
+    pMesh->vertexCount = side * side;
+    pMesh->vertices = malloc(sizeof(Vertex) * pMesh->vertexCount);
+    uint32_t indexCount = 6 * subdivisions * subdivisions;
+    uint32_t *indices = malloc(sizeof(uint32_t) * indexCount);
+
+    if(pMesh->vertices == NULL || indices == NULL)
+    {
+        printf("Failed to allocate mesh!\n");
+        exit(1);
+    }
+
+    Vector3 red = {1.0f, 0.0f, 0.0f};
+    Vector3 green = {0.0f, 1.0f, 0.0f};
+    Vector3 blue = {0.0f, 0.0f, 1.0f};
+    Vector3 white = {1.0f, 1.0f, 1.0f};
+
+    for(uint32_t j = 0; j < side; j++)
+    {
+        for(uint32_t i = 0; i < side; i++)
+        {
+            float u = (float)i / subdivisions;
+            float v = (float)j / subdivisions;
+            Vertex *pVertex = &pMesh->vertices[j * side + i];
+            pVertex->position.x = u - 0.5f;
+            pVertex->position.y = v - 0.5f;
+            pVertex->position.z = 0.0f;
+            pVertex->normal.x = 0.0f;
+            pVertex->normal.y = 0.0f;
+            pVertex->normal.z = 1.0f;
+            pVertex->uv.x = u;
+            pVertex->uv.y = v;
+            pVertex->color = bilinear(red, green, blue, white, u, v);
+        }
+    }
+
+    uint32_t index = 0;
+    for(uint32_t j = 0; j < subdivisions; j++)
+    {
+        for(uint32_t i = 0; i < subdivisions; i++)
+        {
+            uint32_t v00 = j * side + i;
+            uint32_t v10 = v00 + 1;
+            uint32_t v01 = v00 + side;
+            uint32_t v11 = v01 + 1;
+
+            indices[index++] = v00;
+            indices[index++] = v10;
+            indices[index++] = v11;
+            indices[index++] = v11;
+            indices[index++] = v01;
+            indices[index++] = v00;
+        }
+    }
+
+    meshSetIndices(pMesh, indices, indexCount);
+    free(indices);
+}
+
+void meshSetIndices(Mesh *pMesh, const uint32_t *indices, uint32_t indexCount)//Picks 16-bit indices whenever every vertex is addressable with them, halving index bandwidth. Needs vertexCount set first, leaves a single level of detail
+{
+    pMesh->indexSize = pMesh->vertexCount <= UINT16_MAX ? sizeof(uint16_t) : sizeof(uint32_t);//0xFFFF stays free for primitive restart
+    pMesh->indexCount = indexCount;
+    pMesh->lodCount = 1;
+    pMesh->lods[0].firstIndex = 0;
+    pMesh->lods[0].indexCount = indexCount;
+    pMesh->lods[0].error = 0.0f;
+    pMesh->indices = malloc((size_t)pMesh->indexSize * (indexCount ? indexCount : 1));
+
+    if(pMesh->indices == NULL)
+    {
+        printf("Failed to allocate mesh indices!\n");
+        exit(1);
+    }
+
+    if(pMesh->indexSize == sizeof(uint32_t))
+    {
+        memcpy(pMesh->indices, indices, sizeof(uint32_t) * indexCount);
+        return;
+    }
+
+    uint16_t *indices16 = pMesh->indices;
+    for(uint32_t i = 0; i < indexCount; i++)
+    {
+        indices16[i] = (uint16_t)indices[i];
+    }
+}
+
+uint32_t meshIndex(const Mesh *pMesh, uint32_t i)
+{
+    if(pMesh->indexSize == sizeof(uint16_t))
+    {
+        return ((const uint16_t *)pMesh->indices)[i];
+    }
+    return ((const uint32_t *)pMesh->indices)[i];
+}
+
+void normalizeMesh(Mesh *pMesh)//Centres the mesh and scales its longest side to one, the size of the grid the camera is set up for
+{
+    if(pMesh->vertexCount == 0)
+    {
+        return;
+    }
+
+    Vector3 lower = pMesh->vertices[0].position;
+    Vector3 upper = lower;
+    for(uint32_t i = 1; i < pMesh->vertexCount; i++)
+    {
+        Vector3 p = pMesh->vertices[i].position;
+        lower.x = fminf(lower.x, p.x); upper.x = fmaxf(upper.x, p.x);
+        lower.y = fminf(lower.y, p.y); upper.y = fmaxf(upper.y, p.y);
+        lower.z = fminf(lower.z, p.z); upper.z = fmaxf(upper.z, p.z);
+    }
+
+    float size = fmaxf(upper.x - lower.x, fmaxf(upper.y - lower.y, upper.z - lower.z));
+    float scale = size > 0.0f ? 1.0f / size : 1.0f;
+    Vector3 centre = {0.5f * (lower.x + upper.x), 0.5f * (lower.y + upper.y), 0.5f * (lower.z + upper.z)};
+
+    for(uint32_t i = 0; i < pMesh->vertexCount; i++)
+    {
+        Vector3 *p = &pMesh->vertices[i].position;
+        p->x = (p->x - centre.x) * scale;
+        p->y = (p->y - centre.y) * scale;
+        p->z = (p->z - centre.z) * scale;
+    }
+}
+
+void freeMesh(Mesh *pMesh)
+{
+    free(pMesh->vertices);
+    free(pMesh->indices);
+    pMesh->vertices = NULL;
+    pMesh->indices = NULL;
+    pMesh->vertexCount = 0;
+    pMesh->indexCount = 0;
+    pMesh->indexSize = 0;
+    pMesh->lodCount = 0;
+}
@@ -0,0 +1,61 @@
+//
+//  mesh.h
+//  vkProject
+//
+//  Vertex types and CPU-side mesh data.
+//
+
+#ifndef mesh_h
+#define mesh_h
+
+#include <stdint.h>
+
+typedef struct{
+    float x;
+    float y;
+} Vector2;
+
+typedef struct{
+    float x;
+    float y;
+    float z;
+} Vector3;
+
+typedef struct{
+    Vector3 position;
+    Vector3 normal;
+    Vector2 uv;
+    Vector3 color;
+} Vertex;
+
+#define MAX_MESH_LODS 8
+
+typedef struct{
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error;//Largest distance from the full detail surface, in mesh units
+} MeshLod;
+
+typedef struct{
+    Vertex *vertices;
+    uint32_t vertexCount;
+    void *indices;//uint16_t when indexSize is 2, uint32_t when it is 4
+    uint32_t indexSize;
+    uint32_t indexCount;//Every level of detail, back to back
+    MeshLod lods[MAX_MESH_LODS];//Finest first, all index the same vertices
+    uint32_t lodCount;
+} Mesh;
+
+#define MAX_GRID_SUBDIVISIONS 1023
+
+void generateGridMesh(Mesh *pMesh, uint32_t subdivisions);
+
+void meshSetIndices(Mesh *pMesh, const uint32_t *indices, uint32_t indexCount);
+
+uint32_t meshIndex(const Mesh *pMesh, uint32_t i);
+
+void normalizeMesh(Mesh *pMesh);
+
+void freeMesh(Mesh *pMesh);
+
+#endif /* mesh_h */
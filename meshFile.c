@@ -0,0 +1,258 @@
+//
+//  meshFile.c
+//  vkProject
+//
+//  Versioned binary mesh container, memory mapped for upload without parsing.
+//
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "meshFile.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const MeshFileAttribute vertexLayout[] = {//Matches Vertex, files with another layout need converting again
+    {MESH_SEMANTIC_POSITION, MESH_FORMAT_FLOAT3, offsetof(Vertex, position), 0},
+    {MESH_SEMANTIC_NORMAL, MESH_FORMAT_FLOAT3, offsetof(Vertex, normal), 0},
+    {MESH_SEMANTIC_UV, MESH_FORMAT_FLOAT2, offsetof(Vertex, uv), 0},
+    {MESH_SEMANTIC_COLOR, MESH_FORMAT_FLOAT3, offsetof(Vertex, color), 0}
+};
+
+#define VERTEX_ATTRIBUTE_COUNT (sizeof(vertexLayout) / sizeof(vertexLayout[0]))
+
+static uint64_t alignOffset(uint64_t offset)
+{
+    return (offset + MESH_FILE_ALIGNMENT - 1) / MESH_FILE_ALIGNMENT * MESH_FILE_ALIGNMENT;
+}
+
+uint32_t isMeshFile(const char *fileName)//Sniffs the magic rather than trusting the extension
+{
+    FILE *pFile = fopen(fileName, "rb");
+    if(pFile == NULL)
+    {
+        return 0;
+    }
+
+    uint32_t magic = 0;
+    size_t read = fread(&magic, sizeof(magic), 1, pFile);
+    fclose(pFile);
+    return read == 1 && magic == MESH_FILE_MAGIC;
+}
+
+static uint32_t rangeInFile(const MeshFile *pFile, uint64_t offset, uint64_t size)
+{
+    return offset <= pFile->size && size <= pFile->size - offset;
+}
+
+void openMeshFile(MeshFile *pFile, const char *fileName, Mesh *pMesh)//pMesh points into the mapping and must not be passed to freeMesh
+{
+    memset(pFile, 0, sizeof(MeshFile));
+
+    int fd = open(fileName, O_RDONLY);
+    struct stat fileStat;
+    if(fd < 0 || fstat(fd, &fileStat) != 0)
+    {
+        printf("Failed to open file: %s!\n", fileName);
+        exit(1);
+    }
+
+    pFile->size = (size_t)fileStat.st_size;
+    if(pFile->size < sizeof(MeshFileHeader))
+    {
+        printf("Not a mesh file: %s!\n", fileName);
+        exit(1);
+    }
+
+    pFile->data = mmap(NULL, pFile->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);//Private pages are shared with the page cache until written, so in place edits never reach the file
+    close(fd);
+    if(pFile->data == MAP_FAILED)
+    {
+        printf("Failed to map file: %s!\n", fileName);
+        exit(1);
+    }
+    posix_madvise(pFile->data, pFile->size, POSIX_MADV_SEQUENTIAL);//The upload touches every page once in order
+    posix_madvise(pFile->data, pFile->size, POSIX_MADV_WILLNEED);//Starts read-ahead for the whole file right away
+
+    const MeshFileHeader *pHeader = pFile->data;
+    pFile->pHeader = pHeader;
+    if(pHeader->magic != MESH_FILE_MAGIC)
+    {
+        printf("Not a mesh file, or written on a big endian host: %s!\n", fileName);
+        exit(1);
+    }
+
+    if(pHeader->version != MESH_FILE_VERSION || pHeader->headerSize < sizeof(MeshFileHeader))
+    {
+        printf("Unsupported mesh file version %u in %s, convert it again!\n", pHeader->version, fileName);
+        exit(1);
+    }
+
+    if(pHeader->indexSize != 2 && pHeader->indexSize != 4)//Checked before it divides anything
+    {
+        printf("Truncated or corrupt mesh file: %s!\n", fileName);
+        exit(1);
+    }
+
+    uint64_t vertexBytes = (uint64_t)pHeader->vertexStride * pHeader->vertexCount;
+    uint64_t indexBytes = (uint64_t)pHeader->indexSize * pHeader->indexCount;
+    if(pHeader->fileSize != pFile->size
+       || !rangeInFile(pFile, pHeader->attributeOffset, sizeof(MeshFileAttribute) * (uint64_t)pHeader->attributeCount)
+       || !rangeInFile(pFile, pHeader->submeshOffset, sizeof(MeshFileSubmesh) * (uint64_t)pHeader->submeshCount)
+       || !rangeInFile(pFile, pHeader->lodOffset, sizeof(MeshFileLod) * (uint64_t)pHeader->lodCount)
+       || pHeader->lodCount == 0 || pHeader->lodCount > MAX_MESH_LODS || pHeader->lodOffset % sizeof(uint32_t) != 0
+       || !rangeInFile(pFile, pHeader->vertexOffset, vertexBytes)
+       || !rangeInFile(pFile, pHeader->indexOffset, indexBytes)
+       || pHeader->attributeOffset % sizeof(uint32_t) != 0 || pHeader->submeshOffset % sizeof(uint32_t) != 0
+       || pHeader->vertexOffset % sizeof(float) != 0 || pHeader->indexOffset % pHeader->indexSize != 0)
+    {
+        printf("Truncated or corrupt mesh file: %s!\n", fileName);
+        exit(1);
+    }
+
+    pFile->attributes = (const MeshFileAttribute *)((const uint8_t *)pFile->data + pHeader->attributeOffset);
+    pFile->submeshes = (const MeshFileSubmesh *)((const uint8_t *)pFile->data + pHeader->submeshOffset);
+    pFile->lods = (const MeshFileLod *)((const uint8_t *)pFile->data + pHeader->lodOffset);
+
+    uint32_t layoutMatches = pHeader->vertexStride == sizeof(Vertex) && pHeader->attributeCount == VERTEX_ATTRIBUTE_COUNT;
+    for(uint32_t i = 0; layoutMatches && i < VERTEX_ATTRIBUTE_COUNT; i++)
+    {
+        layoutMatches = pFile->attributes[i].semantic == vertexLayout[i].semantic && pFile->attributes[i].format == vertexLayout[i].format && pFile->attributes[i].offset == vertexLayout[i].offset;
+    }
+
+    if(!layoutMatches)
+    {
+        printf("Mesh file vertex layout does not match this build, convert it again: %s!\n", fileName);
+        exit(1);
+    }
+
+    const uint8_t *indices = (const uint8_t *)pFile->data + pHeader->indexOffset;
+    for(uint32_t i = 0; i < pHeader->indexCount; i++)//An index past the vertices would read outside the vertex buffer on the GPU
+    {
+        uint32_t index = pHeader->indexSize == 2 ? ((const uint16_t *)indices)[i] : ((const uint32_t *)indices)[i];
+        if(index >= pHeader->vertexCount)
+        {
+            printf("Mesh file index %u out of range in %s!\n", index, fileName);
+            exit(1);
+        }
+    }
+
+    pMesh->vertices = (Vertex *)((uint8_t *)pFile->data + pHeader->vertexOffset);
+    pMesh->vertexCount = pHeader->vertexCount;
+    pMesh->indices = (uint8_t *)pFile->data + pHeader->indexOffset;
+    pMesh->indexSize = pHeader->indexSize;
+    pMesh->indexCount = pHeader->indexCount;
+    pMesh->lodCount = pHeader->lodCount;
+
+    for(uint32_t i = 0; i < pHeader->lodCount; i++)
+    {
+        const MeshFileLod *pLod = &pFile->lods[i];
+        if(pLod->firstIndex > pHeader->indexCount || pLod->indexCount > pHeader->indexCount - pLod->firstIndex)
+        {
+            printf("Truncated or corrupt mesh file: %s!\n", fileName);
+            exit(1);
+        }
+        pMesh->lods[i].firstIndex = pLod->firstIndex;
+        pMesh->lods[i].indexCount = pLod->indexCount;
+        pMesh->lods[i].error = pLod->error;
+    }
+
+    printf("Mapped %s: %u vertices, %u triangles, %u-bit indices\n", fileName, pMesh->vertexCount, pMesh->indexCount / 3, pMesh->indexSize * 8);
+}
+
+void closeMeshFile(MeshFile *pFile)
+{
+    if(pFile->data != NULL)
+    {
+        munmap(pFile->data, pFile->size);
+    }
+    memset(pFile, 0, sizeof(MeshFile));
+}
+
+static void writeAt(FILE *pFile, uint64_t offset, const void *pData, size_t size, const char *fileName)//Pads with zeros up to offset first
+{
+    static const uint8_t zeros[64] = {0};
+    uint64_t position = (uint64_t)ftell(pFile);
+    while(position < offset)
+    {
+        size_t padding = offset - position < sizeof(zeros) ? (size_t)(offset - position) : sizeof(zeros);
+        fwrite(zeros, 1, padding, pFile);
+        position += padding;
+    }
+
+    if(size != 0 && fwrite(pData, 1, size, pFile) != size)
+    {
+        printf("Failed to write file: %s!\n", fileName);
+        exit(1);
+    }
+}
+
+void writeMeshFile(const Mesh *pMesh, const char *fileName)
+{
+    MeshFileSubmesh submesh = {
+        .firstIndex = 0,
+        .indexCount = pMesh->lods[0].indexCount,
+        .firstVertex = 0,
+        .vertexCount = pMesh->vertexCount
+    };
+
+    for(uint32_t i = 0; i < pMesh->vertexCount; i++)
+    {
+        const float position[3] = {pMesh->vertices[i].position.x, pMesh->vertices[i].position.y, pMesh->vertices[i].position.z};
+        for(uint32_t k = 0; k < 3; k++)
+        {
+            submesh.boundsMin[k] = i == 0 || position[k] < submesh.boundsMin[k] ? position[k] : submesh.boundsMin[k];
+            submesh.boundsMax[k] = i == 0 || position[k] > submesh.boundsMax[k] ? position[k] : submesh.boundsMax[k];
+        }
+    }
+
+    MeshFileHeader header = {
+        .magic = MESH_FILE_MAGIC,
+        .version = MESH_FILE_VERSION,
+        .headerSize = sizeof(MeshFileHeader),
+        .attributeCount = VERTEX_ATTRIBUTE_COUNT,
+        .vertexStride = sizeof(Vertex),
+        .vertexCount = pMesh->vertexCount,
+        .indexSize = pMesh->indexSize,
+        .indexCount = pMesh->indexCount,
+        .submeshCount = 1,
+        .lodCount = pMesh->lodCount
+    };
+    header.attributeOffset = sizeof(MeshFileHeader);
+    header.submeshOffset = header.attributeOffset + sizeof(vertexLayout);
+    header.lodOffset = header.submeshOffset + sizeof(MeshFileSubmesh) * header.submeshCount;
+    header.vertexOffset = alignOffset(header.lodOffset + sizeof(MeshFileLod) * header.lodCount);
+    header.indexOffset = alignOffset(header.vertexOffset + (uint64_t)sizeof(Vertex) * pMesh->vertexCount);
+    header.fileSize = header.indexOffset + (uint64_t)pMesh->indexSize * pMesh->indexCount;
+    memcpy(header.boundsMin, submesh.boundsMin, sizeof(header.boundsMin));
+    memcpy(header.boundsMax, submesh.boundsMax, sizeof(header.boundsMax));
+
+    FILE *pFile = fopen(fileName, "wb");
+    if(pFile == NULL)
+    {
+        printf("Failed to open file: %s!\n", fileName);
+        exit(1);
+    }
+
+    writeAt(pFile, 0, &header, sizeof(header), fileName);
+    writeAt(pFile, header.attributeOffset, vertexLayout, sizeof(vertexLayout), fileName);
+    writeAt(pFile, header.submeshOffset, &submesh, sizeof(submesh), fileName);
+    for(uint32_t i = 0; i < pMesh->lodCount; i++)
+    {
+        MeshFileLod lod = {pMesh->lods[i].firstIndex, pMesh->lods[i].indexCount, pMesh->lods[i].error, 0};
+        writeAt(pFile, header.lodOffset + sizeof(MeshFileLod) * i, &lod, sizeof(lod), fileName);
+    }
+    writeAt(pFile, header.vertexOffset, pMesh->vertices, sizeof(Vertex) * (size_t)pMesh->vertexCount, fileName);
+    writeAt(pFile, header.indexOffset, pMesh->indices, (size_t)pMesh->indexSize * pMesh->indexCount, fileName);
+
+    if(fclose(pFile) != 0)
+    {
+        printf("Failed to write file: %s!\n", fileName);
+        exit(1);
+    }
+}
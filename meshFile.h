@@ -0,0 +1,84 @@
+//
+//  meshFile.h
+//  vkProject
+//
+//  Versioned binary mesh container, memory mapped for upload without parsing.
+//
+
+#ifndef meshFile_h
+#define meshFile_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include "mesh.h"
+
+#define MESH_FILE_MAGIC 0x4853454Du//"MESH" read as a little endian word
+#define MESH_FILE_VERSION 2//2 added the level of detail table
+#define MESH_FILE_ALIGNMENT 4096//Blobs start on page boundaries so they can be mapped or read with O_DIRECT
+
+enum meshFileSemantic{MESH_SEMANTIC_POSITION, MESH_SEMANTIC_NORMAL, MESH_SEMANTIC_UV, MESH_SEMANTIC_COLOR};
+
+enum meshFileFormat{MESH_FORMAT_FLOAT2, MESH_FORMAT_FLOAT3};
+
+typedef struct {//Every field little endian, offsets from the start of the file
+    uint32_t magic;
+    uint32_t version;
+    uint32_t headerSize;//Readers skip anything past the fields they know
+    uint32_t attributeCount;
+    uint32_t vertexStride;
+    uint32_t vertexCount;
+    uint32_t indexSize;//2 or 4 bytes
+    uint32_t indexCount;
+    uint32_t submeshCount;
+    uint32_t lodCount;
+    uint64_t attributeOffset;
+    uint64_t submeshOffset;
+    uint64_t lodOffset;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint64_t fileSize;
+    float boundsMin[3];
+    float boundsMax[3];
+} MeshFileHeader;
+
+typedef struct {
+    uint32_t semantic;
+    uint32_t format;
+    uint32_t offset;//Within a vertex
+    uint32_t reserved;
+} MeshFileAttribute;
+
+typedef struct {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    uint32_t firstVertex;
+    uint32_t vertexCount;
+    float boundsMin[3];
+    float boundsMax[3];
+} MeshFileSubmesh;
+
+typedef struct {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error;
+    uint32_t reserved;
+} MeshFileLod;
+
+typedef struct {
+    void *data;//Read only mapping of the whole file
+    size_t size;
+    const MeshFileHeader *pHeader;
+    const MeshFileAttribute *attributes;
+    const MeshFileSubmesh *submeshes;
+    const MeshFileLod *lods;
+} MeshFile;
+
+uint32_t isMeshFile(const char *fileName);
+
+void openMeshFile(MeshFile *pFile, const char *fileName, Mesh *pMesh);
+
+void closeMeshFile(MeshFile *pFile);
+
+void writeMeshFile(const Mesh *pMesh, const char *fileName);
+
+#endif /* meshFile_h */
@@ -0,0 +1,1361 @@
+//
+//  meshLoader.c
+//  vkProject
+//
+//  Wavefront OBJ and binary glTF 2.0 loading into deduplicated meshes.
+//
+
+#include "meshLoader.h"
+#include "utils.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NO_INDEX UINT32_MAX
+#define OBJ_CHUNK_SIZE (4u * 1024 * 1024)//Large enough to amortise a job, small enough to spread a big file over every worker
+#define VERTEX_BATCH 65536
+#define MAX_JSON_DEPTH 64
+
+#define GLB_MAGIC 0x46546C67//"glTF"
+#define GLB_CHUNK_JSON 0x4E4F534A
+#define GLB_CHUNK_BIN 0x004E4942
+
+enum vertexFlagBit{MISSING_NORMAL_BIT = 1, MISSING_COLOR_BIT = 1<<1};
+
+static void *allocOrExit(size_t size)
+{
+    void *pMemory = malloc(size ? size : 1);
+    if(pMemory == NULL)
+    {
+        printf("Failed to allocate mesh data!\n");
+        exit(1);
+    }
+    return pMemory;
+}
+
+static uint32_t batchCount(uint32_t count)
+{
+    return (count + VERTEX_BATCH - 1) / VERTEX_BATCH;
+}
+
+//Open addressing hash set over fixed size keys, each key gets the index it was first inserted at
+
+typedef struct {
+    size_t keySize;//Multiple of four bytes
+    uint8_t *keys;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t *slots;//Index into keys, NO_INDEX for an empty slot
+    uint32_t slotMask;
+} Deduplicator;
+
+static uint64_t hashKey(const uint8_t *key, size_t keySize)
+{
+    uint64_t hash = 0x9E3779B97F4A7C15ull;
+    for(size_t i = 0; i < keySize; i += sizeof(uint32_t))
+    {
+        uint32_t word;
+        memcpy(&word, key + i, sizeof(uint32_t));
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 32;
+    }
+    return hash;
+}
+
+static void createDeduplicator(Deduplicator *pDedup, size_t keySize, uint32_t expectedCount)
+{
+    uint32_t slotCount = 16;
+    while(slotCount < expectedCount && slotCount < (1u << 31))
+    {
+        slotCount <<= 1;
+    }
+
+    pDedup->keySize = keySize;
+    pDedup->count = 0;
+    pDedup->capacity = expectedCount ? expectedCount : 16;
+    pDedup->keys = allocOrExit(keySize * pDedup->capacity);
+    pDedup->slots = allocOrExit(sizeof(uint32_t) * slotCount);
+    pDedup->slotMask = slotCount - 1;
+    memset(pDedup->slots, 0xFF, sizeof(uint32_t) * slotCount);
+}
+
+static void growSlots(Deduplicator *pDedup)
+{
+    uint32_t slotCount = (pDedup->slotMask + 1) * 2;
+    free(pDedup->slots);
+    pDedup->slots = allocOrExit(sizeof(uint32_t) * slotCount);
+    pDedup->slotMask = slotCount - 1;
+    memset(pDedup->slots, 0xFF, sizeof(uint32_t) * slotCount);
+
+    for(uint32_t i = 0; i < pDedup->count; i++)
+    {
+        uint32_t slot = hashKey(pDedup->keys + (size_t)i * pDedup->keySize, pDedup->keySize) & pDedup->slotMask;
+        while(pDedup->slots[slot] != NO_INDEX)
+        {
+            slot = (slot + 1) & pDedup->slotMask;
+        }
+        pDedup->slots[slot] = i;
+    }
+}
+
+static uint32_t deduplicate(Deduplicator *pDedup, const void *pKey)
+{
+    if((uint64_t)(pDedup->count + 1) * 2 > (uint64_t)pDedup->slotMask + 1)//Kept at most half full so probe runs stay short
+    {
+        growSlots(pDedup);
+    }
+
+    uint32_t slot = hashKey(pKey, pDedup->keySize) & pDedup->slotMask;
+    while(pDedup->slots[slot] != NO_INDEX)
+    {
+        uint32_t index = pDedup->slots[slot];
+        if(memcmp(pDedup->keys + (size_t)index * pDedup->keySize, pKey, pDedup->keySize) == 0)
+        {
+            return index;
+        }
+        slot = (slot + 1) & pDedup->slotMask;
+    }
+
+    if(pDedup->count == pDedup->capacity)
+    {
+        pDedup->capacity *= 2;
+        pDedup->keys = realloc(pDedup->keys, pDedup->keySize * pDedup->capacity);
+        if(pDedup->keys == NULL)
+        {
+            printf("Failed to allocate mesh data!\n");
+            exit(1);
+        }
+    }
+
+    memcpy(pDedup->keys + (size_t)pDedup->count * pDedup->keySize, pKey, pDedup->keySize);
+    pDedup->slots[slot] = pDedup->count;
+    return pDedup->count++;
+}
+
+static void freeDeduplicator(Deduplicator *pDedup)
+{
+    free(pDedup->keys);
+    free(pDedup->slots);
+}
+
+static void finishVertices(Vertex *vertices, uint32_t vertexCount, const uint32_t *indices, uint32_t indexCount, const uint8_t *flags)//Smooth normals for vertices the file gave none, then colours from the normals so unlit meshes stay readable
+{
+    uint32_t missingNormals = 0;
+    for(uint32_t i = 0; i < vertexCount; i++)
+    {
+        missingNormals |= flags[i] & MISSING_NORMAL_BIT;
+    }
+
+    if(missingNormals)
+    {
+        for(uint32_t i = 0; i + 2 < indexCount; i += 3)//Area weighted, the cross product length is twice the triangle area
+        {
+            Vector3 a = vertices[indices[i]].position;
+            Vector3 b = vertices[indices[i + 1]].position;
+            Vector3 c = vertices[indices[i + 2]].position;
+            Vector3 e1 = {b.x - a.x, b.y - a.y, b.z - a.z};
+            Vector3 e2 = {c.x - a.x, c.y - a.y, c.z - a.z};
+            Vector3 n = {e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x};
+
+            for(uint32_t k = 0; k < 3; k++)
+            {
+                Vertex *pVertex = &vertices[indices[i + k]];
+                if(flags[indices[i + k]] & MISSING_NORMAL_BIT)
+                {
+                    pVertex->normal.x += n.x;
+                    pVertex->normal.y += n.y;
+                    pVertex->normal.z += n.z;
+                }
+            }
+        }
+    }
+
+    for(uint32_t i = 0; i < vertexCount; i++)
+    {
+        Vertex *pVertex = &vertices[i];
+        if(flags[i] & MISSING_NORMAL_BIT)
+        {
+            Vector3 n = pVertex->normal;
+            float length = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+            float scale = length > 0.0f ? 1.0f / length : 0.0f;
+            pVertex->normal.x = n.x * scale;
+            pVertex->normal.y = n.y * scale;
+            pVertex->normal.z = length > 0.0f ? n.z * scale : 1.0f;
+        }
+
+        if(flags[i] & MISSING_COLOR_BIT)
+        {
+            pVertex->color.x = 0.5f + 0.5f * pVertex->normal.x;
+            pVertex->color.y = 0.5f + 0.5f * pVertex->normal.y;
+            pVertex->color.z = 0.5f + 0.5f * pVertex->normal.z;
+        }
+    }
+}
+
+//Wavefront OBJ, parsed in newline aligned chunks. A counting pass sizes every chunk so the parsing pass can write straight into shared arrays
+
+typedef struct {
+    uint32_t position;
+    uint32_t uv;//NO_INDEX when the face corner has none
+    uint32_t normal;
+} ObjCorner;
+
+typedef struct {
+    const char *begin;
+    const char *end;
+    uint32_t positionCount;
+    uint32_t uvCount;
+    uint32_t normalCount;
+    uint32_t cornerCount;//Three per triangle after fan triangulation
+    uint32_t positionBase;//Where the chunk writes in the shared arrays, also how many elements precede it for relative indices
+    uint32_t uvBase;
+    uint32_t normalBase;
+    uint32_t cornerBase;
+    uint32_t invalid;
+} ObjChunk;
+
+typedef struct {
+    ObjChunk *chunks;
+    float *positions;
+    float *colors;//Negative red when the vertex had no colour
+    float *uvs;
+    float *normals;
+    ObjCorner *corners;
+    uint32_t positionCount;
+    uint32_t uvCount;
+    uint32_t normalCount;
+    Vertex *vertices;
+    uint8_t *flags;
+    const ObjCorner *uniqueCorners;
+    uint32_t vertexCount;
+} ObjParse;
+
+enum objLineType{OBJ_LINE_OTHER, OBJ_LINE_POSITION, OBJ_LINE_UV, OBJ_LINE_NORMAL, OBJ_LINE_FACE};
+
+static uint32_t isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static const char *skipBlanks(const char *p, const char *end)
+{
+    while(p < end && isBlank(*p))
+    {
+        p++;
+    }
+    return p;
+}
+
+static const char *lineEnd(const char *p, const char *end)
+{
+    const char *newline = memchr(p, '\n', end - p);
+    return newline ? newline : end;
+}
+
+static uint32_t classifyLine(const char **pp, const char *end)//Advances past the keyword
+{
+    const char *p = skipBlanks(*pp, end);
+    uint32_t type = OBJ_LINE_OTHER;
+    if(end - p >= 2 && p[0] == 'v' && isBlank(p[1]))
+    {
+        type = OBJ_LINE_POSITION;
+        p += 1;
+    }
+    else if(end - p >= 3 && p[0] == 'v' && p[1] == 't' && isBlank(p[2]))
+    {
+        type = OBJ_LINE_UV;
+        p += 2;
+    }
+    else if(end - p >= 3 && p[0] == 'v' && p[1] == 'n' && isBlank(p[2]))
+    {
+        type = OBJ_LINE_NORMAL;
+        p += 2;
+    }
+    else if(end - p >= 2 && p[0] == 'f' && isBlank(p[1]))
+    {
+        type = OBJ_LINE_FACE;
+        p += 1;
+    }
+    *pp = p;
+    return type;
+}
+
+static const char *parseFloat(const char *p, const char *end, float *pValue)//Returns p unchanged when there is no number, much faster than strtof and needs no terminator
+{
+    static const double powersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+    const char *start = skipBlanks(p, end);
+    const char *q = start;
+
+    double sign = 1.0;
+    if(q < end && (*q == '-' || *q == '+'))
+    {
+        sign = *q == '-' ? -1.0 : 1.0;
+        q++;
+    }
+
+    uint64_t mantissa = 0;
+    int32_t exponent = 0;
+    uint32_t digits = 0;
+    for(; q < end && isdigit((unsigned char)*q); q++, digits++)
+    {
+        if(mantissa < 100000000000000000ull)
+        {
+            mantissa = mantissa * 10 + (*q - '0');
+        }
+        else
+        {
+            exponent++;
+        }
+    }
+
+    if(q < end && *q == '.')
+    {
+        for(q++; q < end && isdigit((unsigned char)*q); q++, digits++)
+        {
+            if(mantissa < 100000000000000000ull)
+            {
+                mantissa = mantissa * 10 + (*q - '0');
+                exponent--;
+            }
+        }
+    }
+
+    if(digits == 0)
+    {
+        return p;
+    }
+
+    if(q < end && (*q == 'e' || *q == 'E'))
+    {
+        const char *e = q + 1;
+        int32_t exponentSign = 1;
+        if(e < end && (*e == '-' || *e == '+'))
+        {
+            exponentSign = *e == '-' ? -1 : 1;
+            e++;
+        }
+
+        int32_t value = 0;
+        const char *digitsStart = e;
+        for(; e < end && isdigit((unsigned char)*e); e++)
+        {
+            value = value < 10000 ? value * 10 + (*e - '0') : value;
+        }
+
+        if(e != digitsStart)
+        {
+            exponent += exponentSign * value;
+            q = e;
+        }
+    }
+
+    double result = (double)mantissa;
+    if(exponent >= 0)
+    {
+        result *= exponent <= 18 ? powersOfTen[exponent] : pow(10.0, exponent);
+    }
+    else
+    {
+        result /= -exponent <= 18 ? powersOfTen[-exponent] : pow(10.0, -exponent);
+    }
+
+    *pValue = (float)(sign * result);
+    return q;
+}
+
+static const char *parseInt(const char *p, const char *end, int64_t *pValue)//Returns p unchanged when there is no number
+{
+    const char *q = p;
+    int64_t sign = 1;
+    if(q < end && (*q == '-' || *q == '+'))
+    {
+        sign = *q == '-' ? -1 : 1;
+        q++;
+    }
+
+    const char *digitsStart = q;
+    int64_t value = 0;
+    for(; q < end && isdigit((unsigned char)*q); q++)
+    {
+        value = value < (INT64_MAX / 10 - 10) ? value * 10 + (*q - '0') : value;
+    }
+
+    if(q == digitsStart)
+    {
+        return p;
+    }
+
+    *pValue = sign * value;
+    return q;
+}
+
+static uint32_t resolveIndex(int64_t index, uint32_t seen, uint32_t *pInvalid)//OBJ indices are one based, negative ones count back from the latest element
+{
+    if(index > 0 && index <= UINT32_MAX - 1)
+    {
+        return (uint32_t)(index - 1);//Indices past the end are caught once every element is known
+    }
+
+    if(index < 0 && -index <= (int64_t)seen)
+    {
+        return (uint32_t)(seen + index);
+    }
+
+    *pInvalid = 1;
+    return 0;
+}
+
+static void countObjChunk(void *pData, uint32_t jobIndex)
+{
+    ObjChunk *pChunk = &((ObjParse *)pData)->chunks[jobIndex];
+    const char *p = pChunk->begin;
+
+    while(p < pChunk->end)
+    {
+        const char *end = lineEnd(p, pChunk->end);
+        switch(classifyLine(&p, end))
+        {
+            case OBJ_LINE_POSITION:
+                pChunk->positionCount++;
+                break;
+            case OBJ_LINE_UV:
+                pChunk->uvCount++;
+                break;
+            case OBJ_LINE_NORMAL:
+                pChunk->normalCount++;
+                break;
+            case OBJ_LINE_FACE:
+            {
+                uint32_t tokens = 0;
+                for(p = skipBlanks(p, end); p < end; p = skipBlanks(p, end), tokens++)
+                {
+                    while(p < end && !isBlank(*p))
+                    {
+                        p++;
+                    }
+                }
+
+                if(tokens >= 3)
+                {
+                    pChunk->cornerCount += 3 * (tokens - 2);
+                }
+                break;
+            }
+        }
+        p = end + 1;
+    }
+}
+
+static void parseObjChunk(void *pData, uint32_t jobIndex)
+{
+    ObjParse *pParse = pData;
+    ObjChunk *pChunk = &pParse->chunks[jobIndex];
+    uint32_t positionIndex = pChunk->positionBase;
+    uint32_t uvIndex = pChunk->uvBase;
+    uint32_t normalIndex = pChunk->normalBase;
+    ObjCorner *pCorner = pParse->corners + pChunk->cornerBase;
+    const char *p = pChunk->begin;
+
+    while(p < pChunk->end)
+    {
+        const char *end = lineEnd(p, pChunk->end);
+        switch(classifyLine(&p, end))
+        {
+            case OBJ_LINE_POSITION:
+            {
+                float *position = &pParse->positions[3 * (size_t)positionIndex];
+                float *color = &pParse->colors[3 * (size_t)positionIndex];
+                position[0] = position[1] = position[2] = 0.0f;
+                color[0] = color[1] = color[2] = 1.0f;
+                for(uint32_t i = 0; i < 3; i++)
+                {
+                    p = parseFloat(p, end, &position[i]);
+                }
+
+                const char *colorStart = p;
+                for(uint32_t i = 0; i < 3; i++)//Optional vertex colour extension, x y z r g b
+                {
+                    const char *next = parseFloat(p, end, &color[i]);
+                    if(next == p)
+                    {
+                        break;
+                    }
+                    p = next;
+                }
+
+                if(p == colorStart)
+                {
+                    color[0] = -1.0f;
+                }
+                positionIndex++;
+                break;
+            }
+            case OBJ_LINE_UV:
+            {
+                float *uv = &pParse->uvs[2 * (size_t)uvIndex];
+                uv[0] = uv[1] = 0.0f;
+                p = parseFloat(p, end, &uv[0]);
+                p = parseFloat(p, end, &uv[1]);
+                uv[1] = 1.0f - uv[1];//OBJ puts the texture origin at the bottom left, Vulkan at the top left
+                uvIndex++;
+                break;
+            }
+            case OBJ_LINE_NORMAL:
+            {
+                float *normal = &pParse->normals[3 * (size_t)normalIndex];
+                normal[0] = normal[1] = normal[2] = 0.0f;
+                for(uint32_t i = 0; i < 3; i++)
+                {
+                    p = parseFloat(p, end, &normal[i]);
+                }
+                normalIndex++;
+                break;
+            }
+            case OBJ_LINE_FACE:
+            {
+                ObjCorner first = {0}, previous = {0};
+                uint32_t tokens = 0;
+                for(p = skipBlanks(p, end); p < end; p = skipBlanks(p, end), tokens++)//Every blank separated token is a corner, matching the counting pass
+                {
+                    const char *tokenEnd = p;
+                    while(tokenEnd < end && !isBlank(*tokenEnd))
+                    {
+                        tokenEnd++;
+                    }
+
+                    ObjCorner corner = {0, NO_INDEX, NO_INDEX};
+                    int64_t index = 0;
+                    const char *q = parseInt(p, tokenEnd, &index);
+                    corner.position = resolveIndex(index, positionIndex, &pChunk->invalid);
+                    if(q < tokenEnd && *q == '/')
+                    {
+                        q++;
+                        if(q < tokenEnd && *q != '/')
+                        {
+                            index = 0;
+                            q = parseInt(q, tokenEnd, &index);
+                            corner.uv = resolveIndex(index, uvIndex, &pChunk->invalid);
+                        }
+
+                        if(q < tokenEnd && *q == '/')
+                        {
+                            index = 0;
+                            q = parseInt(q + 1, tokenEnd, &index);
+                            corner.normal = resolveIndex(index, normalIndex, &pChunk->invalid);
+                        }
+                    }
+                    p = tokenEnd;
+
+                    if(tokens == 0)
+                    {
+                        first = corner;
+                    }
+                    else if(tokens >= 2)
+                    {
+                        *pCorner++ = first;
+                        *pCorner++ = previous;
+                        *pCorner++ = corner;
+                    }
+                    previous = corner;
+                }
+                break;
+            }
+        }
+        p = end + 1;
+    }
+}
+
+static void buildObjVertices(void *pData, uint32_t jobIndex)
+{
+    ObjParse *pParse = pData;
+    uint32_t begin = jobIndex * VERTEX_BATCH;
+    uint32_t end = begin + VERTEX_BATCH < pParse->vertexCount ? begin + VERTEX_BATCH : pParse->vertexCount;
+
+    for(uint32_t i = begin; i < end; i++)
+    {
+        ObjCorner corner = pParse->uniqueCorners[i];
+        Vertex *pVertex = &pParse->vertices[i];
+        const float *position = &pParse->positions[3 * (size_t)corner.position];
+        const float *color = &pParse->colors[3 * (size_t)corner.position];
+        uint8_t flags = 0;
+
+        pVertex->position = (Vector3){position[0], position[1], position[2]};
+
+        if(corner.uv != NO_INDEX)
+        {
+            const float *uv = &pParse->uvs[2 * (size_t)corner.uv];
+            pVertex->uv = (Vector2){uv[0], uv[1]};
+        }
+        else
+        {
+            pVertex->uv = (Vector2){0.0f, 0.0f};
+        }
+
+        if(corner.normal != NO_INDEX)
+        {
+            const float *normal = &pParse->normals[3 * (size_t)corner.normal];
+            pVertex->normal = (Vector3){normal[0], normal[1], normal[2]};
+        }
+        else
+        {
+            pVertex->normal = (Vector3){0.0f, 0.0f, 0.0f};
+            flags |= MISSING_NORMAL_BIT;
+        }
+
+        if(color[0] >= 0.0f)
+        {
+            pVertex->color = (Vector3){color[0], color[1], color[2]};
+        }
+        else
+        {
+            flags |= MISSING_COLOR_BIT;
+        }
+        pParse->flags[i] = flags;
+    }
+}
+
+void loadObj(Mesh *pMesh, const char *fileName, JobSystem *pJobs)
+{
+    char *buffer;
+    size_t size = readFile(fileName, &buffer);
+    const char *bufferEnd = buffer + size;
+
+    ObjParse parse = {0};
+    uint32_t chunkCount = (uint32_t)(size / OBJ_CHUNK_SIZE) + 1;
+    parse.chunks = allocOrExit(sizeof(ObjChunk) * chunkCount);
+    memset(parse.chunks, 0, sizeof(ObjChunk) * chunkCount);
+
+    const char *begin = buffer;
+    for(uint32_t i = 0; i < chunkCount; i++)//Chunk ends are moved forward to the next line break so no line is split
+    {
+        const char *end = bufferEnd;
+        if(i + 1 < chunkCount)
+        {
+            const char *split = buffer + (size_t)(i + 1) * OBJ_CHUNK_SIZE;
+            end = split < begin ? begin : split;
+            end = end < bufferEnd ? lineEnd(end, bufferEnd) : bufferEnd;
+            end = end < bufferEnd ? end + 1 : bufferEnd;
+        }
+        parse.chunks[i].begin = begin;
+        parse.chunks[i].end = end;
+        begin = end;
+    }
+
+    jobSystemRun(pJobs, chunkCount, countObjChunk, &parse);
+
+    uint64_t positionCount = 0, uvCount = 0, normalCount = 0, cornerCount = 0;
+    for(uint32_t i = 0; i < chunkCount; i++)
+    {
+        ObjChunk *pChunk = &parse.chunks[i];
+        pChunk->positionBase = (uint32_t)positionCount;
+        pChunk->uvBase = (uint32_t)uvCount;
+        pChunk->normalBase = (uint32_t)normalCount;
+        pChunk->cornerBase = (uint32_t)cornerCount;
+        positionCount += pChunk->positionCount;
+        uvCount += pChunk->uvCount;
+        normalCount += pChunk->normalCount;
+        cornerCount += pChunk->cornerCount;
+    }
+
+    if(cornerCount >= UINT32_MAX || positionCount >= UINT32_MAX)
+    {
+        printf("Mesh is too large: %s!\n", fileName);
+        exit(1);
+    }
+
+    parse.positionCount = (uint32_t)positionCount;
+    parse.uvCount = (uint32_t)uvCount;
+    parse.normalCount = (uint32_t)normalCount;
+    parse.positions = allocOrExit(sizeof(float) * 3 * positionCount);
+    parse.colors = allocOrExit(sizeof(float) * 3 * positionCount);
+    parse.uvs = allocOrExit(sizeof(float) * 2 * uvCount);
+    parse.normals = allocOrExit(sizeof(float) * 3 * normalCount);
+    parse.corners = allocOrExit(sizeof(ObjCorner) * cornerCount);
+
+    jobSystemRun(pJobs, chunkCount, parseObjChunk, &parse);
+    free(buffer);
+
+    Deduplicator dedup;
+    createDeduplicator(&dedup, sizeof(ObjCorner), parse.positionCount);
+    uint32_t *indices = allocOrExit(sizeof(uint32_t) * cornerCount);
+
+    for(uint32_t i = 0; i < chunkCount; i++)
+    {
+        if(parse.chunks[i].invalid)
+        {
+            printf("Invalid face index in %s!\n", fileName);
+            exit(1);
+        }
+    }
+
+    for(uint32_t i = 0; i < cornerCount; i++)
+    {
+        ObjCorner corner = parse.corners[i];
+        if(corner.position >= parse.positionCount || (corner.uv != NO_INDEX && corner.uv >= parse.uvCount) || (corner.normal != NO_INDEX && corner.normal >= parse.normalCount))
+        {
+            printf("Invalid face index in %s!\n", fileName);
+            exit(1);
+        }
+        indices[i] = deduplicate(&dedup, &corner);
+    }
+    free(parse.corners);
+
+    parse.vertexCount = dedup.count;
+    parse.uniqueCorners = (const ObjCorner *)dedup.keys;
+    parse.vertices = allocOrExit(sizeof(Vertex) * parse.vertexCount);
+    parse.flags = allocOrExit(parse.vertexCount);
+    jobSystemRun(pJobs, batchCount(parse.vertexCount), buildObjVertices, &parse);
+    finishVertices(parse.vertices, parse.vertexCount, indices, (uint32_t)cornerCount, parse.flags);
+
+    pMesh->vertices = parse.vertices;
+    pMesh->vertexCount = parse.vertexCount;
+    meshSetIndices(pMesh, indices, (uint32_t)cornerCount);
+
+    free(indices);
+    free(parse.flags);
+    freeDeduplicator(&dedup);
+    free(parse.positions);
+    free(parse.colors);
+    free(parse.uvs);
+    free(parse.normals);
+    free(parse.chunks);
+}
+
+//Binary glTF 2.0. The JSON chunk is tokenised into a flat preorder array, each token knows where its subtree ends so siblings can be skipped
+
+enum jsonType{JSON_OBJECT, JSON_ARRAY, JSON_STRING, JSON_PRIMITIVE};
+
+typedef struct {
+    uint32_t type;
+    uint32_t start;//Strings exclude the quotes
+    uint32_t end;
+    uint32_t size;//Members of an object or elements of an array
+    uint32_t next;//Token after this subtree
+} JsonToken;
+
+typedef struct {
+    const char *json;
+    uint32_t length;
+    uint32_t position;
+    JsonToken *tokens;
+    uint32_t count;
+    uint32_t capacity;
+} JsonParser;
+
+static void skipJsonSpace(JsonParser *pParser)
+{
+    while(pParser->position < pParser->length && isspace((unsigned char)pParser->json[pParser->position]))
+    {
+        pParser->position++;
+    }
+}
+
+static uint32_t pushJsonToken(JsonParser *pParser, uint32_t type, uint32_t start)
+{
+    if(pParser->count == pParser->capacity)
+    {
+        pParser->capacity = pParser->capacity ? pParser->capacity * 2 : 256;
+        pParser->tokens = realloc(pParser->tokens, sizeof(JsonToken) * pParser->capacity);
+        if(pParser->tokens == NULL)
+        {
+            printf("Failed to allocate mesh data!\n");
+            exit(1);
+        }
+    }
+
+    JsonToken token = {type, start, start, 0, 0};
+    pParser->tokens[pParser->count] = token;
+    return pParser->count++;
+}
+
+static int32_t parseJsonValue(JsonParser *pParser, uint32_t depth)//Returns the token index, or -1 on malformed input
+{
+    skipJsonSpace(pParser);
+    if(pParser->position >= pParser->length || depth > MAX_JSON_DEPTH)
+    {
+        return -1;
+    }
+
+    char c = pParser->json[pParser->position];
+    uint32_t index;
+
+    if(c == '{' || c == '[')
+    {
+        char close = c == '{' ? '}' : ']';
+        index = pushJsonToken(pParser, c == '{' ? JSON_OBJECT : JSON_ARRAY, pParser->position);
+        pParser->position++;
+
+        skipJsonSpace(pParser);
+        if(pParser->position < pParser->length && pParser->json[pParser->position] == close)
+        {
+            pParser->position++;
+        }
+        else
+        {
+            while(1)
+            {
+                if(c == '{')
+                {
+                    skipJsonSpace(pParser);
+                    if(pParser->position >= pParser->length || pParser->json[pParser->position] != '"' || parseJsonValue(pParser, depth + 1) < 0)
+                    {
+                        return -1;
+                    }
+
+                    skipJsonSpace(pParser);
+                    if(pParser->position >= pParser->length || pParser->json[pParser->position] != ':')
+                    {
+                        return -1;
+                    }
+                    pParser->position++;
+                }
+
+                if(parseJsonValue(pParser, depth + 1) < 0)
+                {
+                    return -1;
+                }
+                pParser->tokens[index].size++;
+
+                skipJsonSpace(pParser);
+                if(pParser->position >= pParser->length)
+                {
+                    return -1;
+                }
+
+                char separator = pParser->json[pParser->position++];
+                if(separator == close)
+                {
+                    break;
+                }
+                if(separator != ',')
+                {
+                    return -1;
+                }
+            }
+        }
+    }
+    else if(c == '"')
+    {
+        index = pushJsonToken(pParser, JSON_STRING, pParser->position + 1);
+        pParser->position++;
+        while(pParser->position < pParser->length && pParser->json[pParser->position] != '"')
+        {
+            pParser->position += pParser->json[pParser->position] == '\\' ? 2 : 1;
+        }
+
+        if(pParser->position >= pParser->length)
+        {
+            return -1;
+        }
+        pParser->tokens[index].end = pParser->position++;
+        pParser->tokens[index].next = pParser->count;
+        return index;
+    }
+    else
+    {
+        index = pushJsonToken(pParser, JSON_PRIMITIVE, pParser->position);
+        while(pParser->position < pParser->length && !isspace((unsigned char)pParser->json[pParser->position]) && strchr(",]}", pParser->json[pParser->position]) == NULL)
+        {
+            pParser->position++;
+        }
+    }
+
+    pParser->tokens[index].end = pParser->position;
+    pParser->tokens[index].next = pParser->count;
+    return index;
+}
+
+typedef struct {
+    const char *fileName;
+    char *json;//Null terminated copy of the JSON chunk
+    JsonToken *tokens;
+    const uint8_t *bin;
+    uint64_t binLength;
+    int32_t accessors;
+    int32_t bufferViews;
+} Glb;
+
+typedef struct {
+    const uint8_t *data;
+    uint32_t count;
+    uint32_t stride;
+    uint32_t componentType;
+    uint32_t components;
+    uint32_t normalized;
+} GlbAccessor;
+
+static int32_t jsonGet(const Glb *pGlb, int32_t object, const char *key)//Value of a member, -1 when missing
+{
+    if(object < 0 || pGlb->tokens[object].type != JSON_OBJECT)
+    {
+        return -1;
+    }
+
+    size_t keyLength = strlen(key);
+    uint32_t child = object + 1;
+    for(uint32_t i = 0; i < pGlb->tokens[object].size; i++)
+    {
+        const JsonToken *pKey = &pGlb->tokens[child];
+        if(pKey->end - pKey->start == keyLength && strncmp(pGlb->json + pKey->start, key, keyLength) == 0)
+        {
+            return child + 1;
+        }
+        child = pGlb->tokens[child + 1].next;
+    }
+    return -1;
+}
+
+static int32_t jsonAt(const Glb *pGlb, int32_t array, uint32_t n)//Element of an array, -1 when out of range
+{
+    if(array < 0 || pGlb->tokens[array].type != JSON_ARRAY || n >= pGlb->tokens[array].size)
+    {
+        return -1;
+    }
+
+    uint32_t child = array + 1;
+    for(uint32_t i = 0; i < n; i++)
+    {
+        child = pGlb->tokens[child].next;
+    }
+    return child;
+}
+
+static double jsonNumber(const Glb *pGlb, int32_t token, double fallback)
+{
+    if(token < 0 || pGlb->tokens[token].type != JSON_PRIMITIVE)
+    {
+        return fallback;
+    }
+    return strtod(pGlb->json + pGlb->tokens[token].start, NULL);//The copy is terminated, strtod stops at the delimiter
+}
+
+static uint32_t jsonEquals(const Glb *pGlb, int32_t token, const char *value)
+{
+    if(token < 0)
+    {
+        return 0;
+    }
+
+    size_t length = strlen(value);
+    const JsonToken *pToken = &pGlb->tokens[token];
+    return pToken->end - pToken->start == length && strncmp(pGlb->json + pToken->start, value, length) == 0;
+}
+
+static uint32_t componentSize(uint32_t componentType)
+{
+    switch(componentType)
+    {
+        case 5120://BYTE
+        case 5121://UNSIGNED_BYTE
+            return 1;
+        case 5122://SHORT
+        case 5123://UNSIGNED_SHORT
+            return 2;
+        case 5125://UNSIGNED_INT
+        case 5126://FLOAT
+            return 4;
+    }
+    return 0;
+}
+
+static void glbAccessor(const Glb *pGlb, double accessorIndex, GlbAccessor *pAccessor)
+{
+    int32_t accessor = accessorIndex >= 0.0 ? jsonAt(pGlb, pGlb->accessors, (uint32_t)accessorIndex) : -1;
+    if(accessor < 0)
+    {
+        printf("Invalid accessor in %s!\n", pGlb->fileName);
+        exit(1);
+    }
+
+    if(jsonGet(pGlb, accessor, "sparse") >= 0 || jsonGet(pGlb, accessor, "bufferView") < 0)
+    {
+        printf("Sparse and zero filled accessors are not supported: %s!\n", pGlb->fileName);
+        exit(1);
+    }
+
+    int32_t type = jsonGet(pGlb, accessor, "type");
+    pAccessor->components = jsonEquals(pGlb, type, "SCALAR") ? 1 : jsonEquals(pGlb, type, "VEC2") ? 2 : jsonEquals(pGlb, type, "VEC3") ? 3 : jsonEquals(pGlb, type, "VEC4") ? 4 : 0;
+    pAccessor->componentType = (uint32_t)jsonNumber(pGlb, jsonGet(pGlb, accessor, "componentType"), 0);
+    pAccessor->count = (uint32_t)jsonNumber(pGlb, jsonGet(pGlb, accessor, "count"), 0);
+    pAccessor->normalized = jsonEquals(pGlb, jsonGet(pGlb, accessor, "normalized"), "true");
+
+    int32_t view = jsonAt(pGlb, pGlb->bufferViews, (uint32_t)jsonNumber(pGlb, jsonGet(pGlb, accessor, "bufferView"), -1));
+    if(view < 0 || jsonNumber(pGlb, jsonGet(pGlb, view, "buffer"), 0) != 0 || pGlb->bin == NULL)
+    {
+        printf("Only the embedded GLB buffer is supported: %s!\n", pGlb->fileName);
+        exit(1);
+    }
+
+    uint64_t elementSize = (uint64_t)componentSize(pAccessor->componentType) * pAccessor->components;
+    uint64_t viewOffset = (uint64_t)jsonNumber(pGlb, jsonGet(pGlb, view, "byteOffset"), 0);
+    uint64_t viewLength = (uint64_t)jsonNumber(pGlb, jsonGet(pGlb, view, "byteLength"), 0);
+    uint64_t offset = (uint64_t)jsonNumber(pGlb, jsonGet(pGlb, accessor, "byteOffset"), 0);
+    uint64_t stride = (uint64_t)jsonNumber(pGlb, jsonGet(pGlb, view, "byteStride"), 0);
+    stride = stride ? stride : elementSize;
+
+    uint64_t required = pAccessor->count ? offset + (pAccessor->count - 1) * stride + elementSize : 0;
+    if(elementSize == 0 || required > viewLength || viewOffset + viewLength > pGlb->binLength)
+    {
+        printf("Accessor out of bounds in %s!\n", pGlb->fileName);
+        exit(1);
+    }
+
+    pAccessor->data = pGlb->bin + viewOffset + offset;
+    pAccessor->stride = (uint32_t)stride;
+}
+
+static float readComponent(const GlbAccessor *pAccessor, uint32_t element, uint32_t component)//glTF data is little endian, as is every platform we build for
+{
+    const uint8_t *p = pAccessor->data + (size_t)element * pAccessor->stride + component * componentSize(pAccessor->componentType);
+    switch(pAccessor->componentType)
+    {
+        case 5120:
+            return pAccessor->normalized ? fmaxf(*(const int8_t *)p / 127.0f, -1.0f) : *(const int8_t *)p;
+        case 5121:
+            return pAccessor->normalized ? *p / 255.0f : *p;
+        case 5122:
+        {
+            int16_t value;
+            memcpy(&value, p, sizeof(value));
+            return pAccessor->normalized ? fmaxf(value / 32767.0f, -1.0f) : value;
+        }
+        case 5123:
+        {
+            uint16_t value;
+            memcpy(&value, p, sizeof(value));
+            return pAccessor->normalized ? value / 65535.0f : value;
+        }
+        case 5125:
+        {
+            uint32_t value;
+            memcpy(&value, p, sizeof(value));
+            return (float)value;
+        }
+        case 5126:
+        {
+            float value;
+            memcpy(&value, p, sizeof(value));
+            return value;
+        }
+    }
+    return 0.0f;
+}
+
+static uint32_t readIndex(const GlbAccessor *pAccessor, uint32_t element)
+{
+    const uint8_t *p = pAccessor->data + (size_t)element * pAccessor->stride;
+    switch(pAccessor->componentType)
+    {
+        case 5121:
+            return *p;
+        case 5123:
+        {
+            uint16_t value;
+            memcpy(&value, p, sizeof(value));
+            return value;
+        }
+        case 5125:
+        {
+            uint32_t value;
+            memcpy(&value, p, sizeof(value));
+            return value;
+        }
+    }
+    return NO_INDEX;
+}
+
+typedef struct {
+    GlbAccessor position;
+    GlbAccessor normal;
+    GlbAccessor uv;
+    GlbAccessor color;
+    uint32_t hasNormal;
+    uint32_t hasUv;
+    uint32_t hasColor;
+    Vertex *vertices;
+    uint8_t *flags;
+} GlbPrimitive;
+
+static void decodeGlbVertices(void *pData, uint32_t jobIndex)
+{
+    GlbPrimitive *pPrimitive = pData;
+    uint32_t begin = jobIndex * VERTEX_BATCH;
+    uint32_t end = begin + VERTEX_BATCH < pPrimitive->position.count ? begin + VERTEX_BATCH : pPrimitive->position.count;
+
+    for(uint32_t i = begin; i < end; i++)
+    {
+        Vertex *pVertex = &pPrimitive->vertices[i];
+        uint8_t flags = 0;
+        memset(pVertex, 0, sizeof(Vertex));//Deduplication compares whole vertices
+
+        pVertex->position = (Vector3){readComponent(&pPrimitive->position, i, 0), readComponent(&pPrimitive->position, i, 1), readComponent(&pPrimitive->position, i, 2)};
+
+        if(pPrimitive->hasNormal)
+        {
+            pVertex->normal = (Vector3){readComponent(&pPrimitive->normal, i, 0), readComponent(&pPrimitive->normal, i, 1), readComponent(&pPrimitive->normal, i, 2)};
+        }
+        else
+        {
+            flags |= MISSING_NORMAL_BIT;
+        }
+
+        if(pPrimitive->hasUv)
+        {
+            pVertex->uv = (Vector2){readComponent(&pPrimitive->uv, i, 0), readComponent(&pPrimitive->uv, i, 1)};
+        }
+
+        if(pPrimitive->hasColor)
+        {
+            pVertex->color = (Vector3){readComponent(&pPrimitive->color, i, 0), readComponent(&pPrimitive->color, i, 1), readComponent(&pPrimitive->color, i, 2)};
+        }
+        else
+        {
+            flags |= MISSING_COLOR_BIT;
+        }
+        pPrimitive->flags[i] = flags;
+    }
+}
+
+static uint32_t readGlbPrimitive(const Glb *pGlb, int32_t primitive, GlbPrimitive *pPrimitive, GlbAccessor *pIndices, uint32_t *pHasIndices)//Returns zero for primitives that are not triangle lists
+{
+    if(jsonNumber(pGlb, jsonGet(pGlb, primitive, "mode"), 4) != 4)
+    {
+        return 0;
+    }
+
+    int32_t attributes = jsonGet(pGlb, primitive, "attributes");
+    int32_t position = jsonGet(pGlb, attributes, "POSITION");
+    int32_t normal = jsonGet(pGlb, attributes, "NORMAL");
+    int32_t uv = jsonGet(pGlb, attributes, "TEXCOORD_0");
+    int32_t color = jsonGet(pGlb, attributes, "COLOR_0");
+    int32_t indices = jsonGet(pGlb, primitive, "indices");
+    if(position < 0)
+    {
+        return 0;
+    }
+
+    memset(pPrimitive, 0, sizeof(GlbPrimitive));
+    glbAccessor(pGlb, jsonNumber(pGlb, position, -1), &pPrimitive->position);
+    if(normal >= 0)
+    {
+        glbAccessor(pGlb, jsonNumber(pGlb, normal, -1), &pPrimitive->normal);
+        pPrimitive->hasNormal = pPrimitive->normal.count == pPrimitive->position.count;
+    }
+    if(uv >= 0)
+    {
+        glbAccessor(pGlb, jsonNumber(pGlb, uv, -1), &pPrimitive->uv);
+        pPrimitive->hasUv = pPrimitive->uv.count == pPrimitive->position.count;
+    }
+    if(color >= 0)
+    {
+        glbAccessor(pGlb, jsonNumber(pGlb, color, -1), &pPrimitive->color);
+        pPrimitive->hasColor = pPrimitive->color.count == pPrimitive->position.count && pPrimitive->color.components >= 3;
+    }
+
+    *pHasIndices = indices >= 0;
+    if(*pHasIndices)
+    {
+        glbAccessor(pGlb, jsonNumber(pGlb, indices, -1), pIndices);
+    }
+    return 1;
+}
+
+static uint32_t read32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+void loadGlb(Mesh *pMesh, const char *fileName, JobSystem *pJobs)//Every triangle primitive of every mesh is merged in its local space, node transforms are not applied
+{
+    char *buffer;
+    size_t size = readFile(fileName, &buffer);
+    const uint8_t *data = (const uint8_t *)buffer;
+
+    if(size < 20 || read32(data) != GLB_MAGIC || read32(data + 4) != 2 || read32(data + 8) > size || read32(data + 16) != GLB_CHUNK_JSON)
+    {
+        printf("Not a glTF 2.0 binary: %s!\n", fileName);
+        exit(1);
+    }
+
+    uint64_t length = read32(data + 8);
+    uint64_t jsonLength = read32(data + 12);
+    if(20 + jsonLength > length)
+    {
+        printf("Not a glTF 2.0 binary: %s!\n", fileName);
+        exit(1);
+    }
+
+    Glb glb = {.fileName = fileName};
+    uint64_t binChunk = 20 + ((jsonLength + 3) & ~3ull);
+    if(binChunk + 8 <= length && read32(data + binChunk + 4) == GLB_CHUNK_BIN && binChunk + 8 + read32(data + binChunk) <= length)
+    {
+        glb.bin = data + binChunk + 8;
+        glb.binLength = read32(data + binChunk);
+    }
+
+    glb.json = allocOrExit(jsonLength + 1);
+    memcpy(glb.json, data + 20, jsonLength);
+    glb.json[jsonLength] = '\0';
+
+    JsonParser parser = {.json = glb.json, .length = (uint32_t)jsonLength};
+    int32_t root = parseJsonValue(&parser, 0);
+    glb.tokens = parser.tokens;
+    if(root < 0 || glb.tokens[root].type != JSON_OBJECT)
+    {
+        printf("Malformed glTF JSON in %s!\n", fileName);
+        exit(1);
+    }
+    glb.accessors = jsonGet(&glb, root, "accessors");
+    glb.bufferViews = jsonGet(&glb, root, "bufferViews");
+    int32_t meshes = jsonGet(&glb, root, "meshes");
+
+    uint64_t vertexCount = 0, indexCount = 0;
+    for(uint32_t pass = 0; pass < 2; pass++)//Sizes everything first, then decodes into the final arrays
+    {
+        Vertex *vertices = NULL;
+        uint8_t *flags = NULL;
+        uint32_t *indices = NULL;
+        if(pass == 1)
+        {
+            if(vertexCount >= UINT32_MAX || indexCount >= UINT32_MAX)
+            {
+                printf("Mesh is too large: %s!\n", fileName);
+                exit(1);
+            }
+            vertices = allocOrExit(sizeof(Vertex) * vertexCount);
+            flags = allocOrExit(vertexCount);
+            indices = allocOrExit(sizeof(uint32_t) * indexCount);
+        }
+
+        uint32_t baseVertex = 0, baseIndex = 0;
+        uint32_t meshCount = meshes >= 0 ? glb.tokens[meshes].size : 0;
+        for(uint32_t m = 0; m < meshCount; m++)
+        {
+            int32_t primitives = jsonGet(&glb, jsonAt(&glb, meshes, m), "primitives");
+            uint32_t primitiveCount = primitives >= 0 ? glb.tokens[primitives].size : 0;
+            for(uint32_t p = 0; p < primitiveCount; p++)
+            {
+                GlbPrimitive primitive;
+                GlbAccessor indexAccessor;
+                uint32_t hasIndices;
+                if(!readGlbPrimitive(&glb, jsonAt(&glb, primitives, p), &primitive, &indexAccessor, &hasIndices))
+                {
+                    continue;
+                }
+
+                uint32_t primitiveVertices = primitive.position.count;
+                uint32_t primitiveIndices = (hasIndices ? indexAccessor.count : primitiveVertices) / 3 * 3;
+                if(pass == 0)
+                {
+                    vertexCount += primitiveVertices;
+                    indexCount += primitiveIndices;
+                    continue;
+                }
+
+                primitive.vertices = vertices + baseVertex;
+                primitive.flags = flags + baseVertex;
+                jobSystemRun(pJobs, batchCount(primitiveVertices), decodeGlbVertices, &primitive);
+
+                for(uint32_t i = 0; i < primitiveIndices; i++)
+                {
+                    uint32_t index = hasIndices ? readIndex(&indexAccessor, i) : i;
+                    if(index >= primitiveVertices)
+                    {
+                        printf("Invalid index in %s!\n", fileName);
+                        exit(1);
+                    }
+                    indices[baseIndex + i] = baseVertex + index;
+                }
+
+                baseVertex += primitiveVertices;
+                baseIndex += primitiveIndices;
+            }
+        }
+
+        if(pass == 1)
+        {
+            finishVertices(vertices, (uint32_t)vertexCount, indices, (uint32_t)indexCount, flags);
+
+            Deduplicator dedup;//Exporters often split vertices per face, merging bit identical ones restores sharing
+            createDeduplicator(&dedup, sizeof(Vertex), (uint32_t)vertexCount);
+            uint32_t *remap = allocOrExit(sizeof(uint32_t) * vertexCount);
+            for(uint32_t i = 0; i < vertexCount; i++)
+            {
+                remap[i] = deduplicate(&dedup, &vertices[i]);
+            }
+            for(uint32_t i = 0; i < indexCount; i++)
+            {
+                indices[i] = remap[indices[i]];
+            }
+
+            pMesh->vertexCount = dedup.count;
+            pMesh->vertices = realloc(dedup.keys, sizeof(Vertex) * (dedup.count ? dedup.count : 1));//The key array already is the compacted vertex array
+            dedup.keys = NULL;
+            meshSetIndices(pMesh, indices, (uint32_t)indexCount);
+
+            free(remap);
+            freeDeduplicator(&dedup);
+            free(vertices);
+            free(flags);
+            free(indices);
+        }
+    }
+
+    if(pMesh->vertexCount == 0)
+    {
+        printf("No triangle meshes in %s!\n", fileName);
+        exit(1);
+    }
+
+    free(parser.tokens);
+    free(glb.json);
+    free(buffer);
+}
+
+static uint32_t hasExtension(const char *fileName, const char *extension)//Case insensitive
+{
+    size_t nameLength = strlen(fileName);
+    size_t extensionLength = strlen(extension);
+    if(nameLength < extensionLength)
+    {
+        return 0;
+    }
+
+    for(size_t i = 0; i < extensionLength; i++)
+    {
+        if(tolower((unsigned char)fileName[nameLength - extensionLength + i]) != extension[i])
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void loadMesh(Mesh *pMesh, const char *fileName, JobSystem *pJobs)
+{
+    if(hasExtension(fileName, ".obj"))
+    {
+        loadObj(pMesh, fileName, pJobs);
+    }
+    else if(hasExtension(fileName, ".glb"))
+    {
+        loadGlb(pMesh, fileName, pJobs);
+    }
+    else
+    {
+        printf("Unsupported mesh format, expected .obj or .glb: %s!\n", fileName);
+        exit(1);
+    }
+
+    if(pMesh->vertices == NULL)
+    {
+        printf("Failed to allocate mesh data!\n");
+        exit(1);
+    }
+
+    normalizeMesh(pMesh);
+    printf("Loaded %s: %u vertices, %u triangles, %u-bit indices\n", fileName, pMesh->vertexCount, pMesh->indexCount / 3, pMesh->indexSize * 8);
+}
@@ -0,0 +1,20 @@
+//
+//  meshLoader.h
+//  vkProject
+//
+//  Wavefront OBJ and binary glTF 2.0 loading into deduplicated meshes.
+//
+
+#ifndef meshLoader_h
+#define meshLoader_h
+
+#include "mesh.h"
+#include "jobSystem.h"
+
+void loadMesh(Mesh *pMesh, const char *fileName, JobSystem *pJobs);
+
+void loadObj(Mesh *pMesh, const char *fileName, JobSystem *pJobs);
+
+void loadGlb(Mesh *pMesh, const char *fileName, JobSystem *pJobs);
+
+#endif /* meshLoader_h */
@@ -0,0 +1,561 @@
+//
+//  meshLod.c
+//  vkProject
+//
+//  Quadric error simplification into a level of detail chain, and picking a level from screen-space error.
+//
+
+#include "meshLod.h"
+#include "meshOptimizer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void *allocOrExit(size_t size)
+{
+    void *pMemory = malloc(size ? size : 1);
+    if(pMemory == NULL)
+    {
+        printf("Failed to allocate mesh LOD data!\n");
+        exit(1);
+    }
+    return pMemory;
+}
+
+//Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics", 1997. Collapses are restricted to existing vertices so every level indexes the original vertex buffer
+
+typedef struct {
+    double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;//Symmetric 4x4 plane quadric, sum of squared distances to the planes
+    double weight;//Total area, dividing by it turns the error into a mean squared distance
+} Quadric;
+
+static void addPlaneQuadric(Quadric *pQuadric, double a, double b, double c, double d, double weight)
+{
+    pQuadric->a2 += weight * a * a;
+    pQuadric->ab += weight * a * b;
+    pQuadric->ac += weight * a * c;
+    pQuadric->ad += weight * a * d;
+    pQuadric->b2 += weight * b * b;
+    pQuadric->bc += weight * b * c;
+    pQuadric->bd += weight * b * d;
+    pQuadric->c2 += weight * c * c;
+    pQuadric->cd += weight * c * d;
+    pQuadric->d2 += weight * d * d;
+    pQuadric->weight += weight;
+}
+
+static void addQuadric(Quadric *pQuadric, const Quadric *pOther)
+{
+    double *sum = &pQuadric->a2;
+    const double *other = &pOther->a2;
+    for(uint32_t i = 0; i < 11; i++)
+    {
+        sum[i] += other[i];
+    }
+}
+
+static double quadricError(const Quadric *pQ, const Quadric *pR, Vector3 p)//Mean squared distance from p to the planes of both quadrics
+{
+    double x = p.x, y = p.y, z = p.z;
+    double a2 = pQ->a2 + pR->a2, ab = pQ->ab + pR->ab, ac = pQ->ac + pR->ac, ad = pQ->ad + pR->ad;
+    double b2 = pQ->b2 + pR->b2, bc = pQ->bc + pR->bc, bd = pQ->bd + pR->bd;
+    double c2 = pQ->c2 + pR->c2, cd = pQ->cd + pR->cd, d2 = pQ->d2 + pR->d2;
+    double error = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x + b2 * y * y + 2 * bc * y * z + 2 * bd * y + c2 * z * z + 2 * cd * z + d2;
+    double weight = pQ->weight + pR->weight;
+    return error > 0.0 && weight > 0.0 ? error / weight : 0.0;
+}
+
+static Vector3 triangleNormal(Vector3 a, Vector3 b, Vector3 c)//Length is twice the area
+{
+    Vector3 e1 = {b.x - a.x, b.y - a.y, b.z - a.z};
+    Vector3 e2 = {c.x - a.x, c.y - a.y, c.z - a.z};
+    Vector3 n = {e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x};
+    return n;
+}
+
+typedef struct {
+    float x, y, z;
+    uint32_t index;
+} WeldKey;
+
+static int compareWeldKeys(const void *pA, const void *pB)
+{
+    const WeldKey *a = pA;
+    const WeldKey *b = pB;
+    if(a->x != b->x) return a->x < b->x ? -1 : 1;
+    if(a->y != b->y) return a->y < b->y ? -1 : 1;
+    if(a->z != b->z) return a->z < b->z ? -1 : 1;
+    return a->index < b->index ? -1 : a->index > b->index;
+}
+
+static void weldPositions(const Mesh *pMesh, uint32_t *weld)//Vertices split at normal or uv seams share one representative, simplification sees one surface while the levels keep indexing the split vertices
+{
+    WeldKey *keys = allocOrExit(sizeof(WeldKey) * pMesh->vertexCount);
+    for(uint32_t i = 0; i < pMesh->vertexCount; i++)
+    {
+        WeldKey key = {pMesh->vertices[i].position.x, pMesh->vertices[i].position.y, pMesh->vertices[i].position.z, i};
+        keys[i] = key;
+    }
+    qsort(keys, pMesh->vertexCount, sizeof(WeldKey), compareWeldKeys);
+
+    for(uint32_t i = 0; i < pMesh->vertexCount; i++)
+    {
+        uint32_t same = i > 0 && keys[i].x == keys[i - 1].x && keys[i].y == keys[i - 1].y && keys[i].z == keys[i - 1].z;
+        weld[keys[i].index] = same ? weld[keys[i - 1].index] : keys[i].index;
+    }
+    free(keys);
+}
+
+static uint32_t sameAttributes(const Vertex *pA, const Vertex *pB)
+{
+    return pA->normal.x == pB->normal.x && pA->normal.y == pB->normal.y && pA->normal.z == pB->normal.z && pA->uv.x == pB->uv.x && pA->uv.y == pB->uv.y &&
+           pA->color.x == pB->color.x && pA->color.y == pB->color.y && pA->color.z == pB->color.z;
+}
+
+static void lockSeams(const Mesh *pMesh, const uint32_t *weld, uint8_t *locked)//Split vertices never move, a corner collapsing onto one would have to pick a side of the seam it does not lie on
+{
+    for(uint32_t i = 0; i < pMesh->vertexCount; i++)
+    {
+        if(!sameAttributes(&pMesh->vertices[i], &pMesh->vertices[weld[i]]))
+        {
+            locked[weld[i]] = 1;
+        }
+    }
+}
+
+static int compareEdges(const void *pA, const void *pB)
+{
+    uint64_t a = *(const uint64_t *)pA;
+    uint64_t b = *(const uint64_t *)pB;
+    return a < b ? -1 : a > b;
+}
+
+static void lockBorders(const uint32_t *indices, uint32_t indexCount, uint8_t *locked)//Vertices on open or non-manifold edges never move, which keeps silhouettes and cracks between parts closed
+{
+    uint64_t *edges = allocOrExit(sizeof(uint64_t) * indexCount);
+    for(uint32_t i = 0; i < indexCount; i++)
+    {
+        uint32_t a = indices[i];
+        uint32_t b = indices[i % 3 == 2 ? i - 2 : i + 1];
+        edges[i] = a < b ? (uint64_t)a << 32 | b : (uint64_t)b << 32 | a;
+    }
+    qsort(edges, indexCount, sizeof(uint64_t), compareEdges);
+
+    for(uint32_t i = 0; i < indexCount;)
+    {
+        uint32_t run = 1;
+        while(i + run < indexCount && edges[i + run] == edges[i])
+        {
+            run++;
+        }
+
+        if(run != 2)
+        {
+            locked[edges[i] >> 32] = 1;
+            locked[edges[i] & 0xFFFFFFFFu] = 1;
+        }
+        i += run;
+    }
+    free(edges);
+}
+
+typedef struct {
+    double cost;
+    uint32_t from;
+    uint32_t to;
+} Collapse;
+
+static int compareCollapses(const void *pA, const void *pB)
+{
+    const Collapse *a = pA;
+    const Collapse *b = pB;
+    if(a->cost != b->cost)
+    {
+        return a->cost < b->cost ? -1 : 1;
+    }
+    return a->from < b->from ? -1 : a->from > b->from;
+}
+
+typedef struct {
+    const Vertex *vertices;
+    uint32_t vertexCount;
+    Quadric *quadrics;
+    uint8_t *locked;
+    uint8_t *touched;
+    uint32_t *remap;
+    uint32_t *target;//Original vertex the corners of a collapsed vertex take, on the side of any seam through to that they lie on
+    uint32_t *marks;//Per vertex stamp for the link test
+    uint32_t mark;
+    uint32_t *offsets;
+    uint32_t *adjacency;
+    Collapse *collapses;
+    double maxError;//Largest collapse cost accepted so far, a mean squared distance
+} Simplifier;
+
+static uint32_t flipsTriangles(const Simplifier *pSimplifier, const uint32_t *indices, uint32_t from, uint32_t to)//Any triangle around from turning by more than about 75 degrees when from moves onto to
+{
+    Vector3 target = pSimplifier->vertices[to].position;
+    for(uint32_t k = pSimplifier->offsets[from]; k < pSimplifier->offsets[from + 1]; k++)
+    {
+        const uint32_t *triangle = &indices[3 * pSimplifier->adjacency[k]];
+        if(triangle[0] == to || triangle[1] == to || triangle[2] == to)
+        {
+            continue;//Becomes degenerate and is removed
+        }
+
+        Vector3 corners[3], moved[3];
+        Vector3 shading = {0.0f, 0.0f, 0.0f};//Vertex normals of the original surface, which passes never change
+        for(uint32_t c = 0; c < 3; c++)
+        {
+            corners[c] = pSimplifier->vertices[triangle[c]].position;
+            moved[c] = triangle[c] == from ? target : corners[c];
+            Vector3 normal = pSimplifier->vertices[triangle[c] == from ? to : triangle[c]].normal;
+            shading.x += normal.x;
+            shading.y += normal.y;
+            shading.z += normal.z;
+        }
+
+        Vector3 before = triangleNormal(corners[0], corners[1], corners[2]);
+        Vector3 after = triangleNormal(moved[0], moved[1], moved[2]);
+        float dot = before.x * after.x + before.y * after.y + before.z * after.z;
+        float lengths = sqrtf(before.x * before.x + before.y * before.y + before.z * before.z) * sqrtf(after.x * after.x + after.y * after.y + after.z * after.z);
+        if(dot < 0.25f * lengths)//A tighter bound than turning over
+        {
+            return 1;
+        }
+        if(after.x * shading.x + after.y * shading.y + after.z * shading.z < 0.0f)//Small turns could still add up to a fold over several passes
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static uint32_t pinchesSurface(Simplifier *pSimplifier, const uint32_t *indices, uint32_t from, uint32_t to)//Link condition, more than the two vertices opposite the edge neighbouring both ends would fold two sheets onto each other
+{
+    uint32_t fromMark = ++pSimplifier->mark;
+    for(uint32_t k = pSimplifier->offsets[from]; k < pSimplifier->offsets[from + 1]; k++)
+    {
+        const uint32_t *triangle = &indices[3 * pSimplifier->adjacency[k]];
+        for(uint32_t c = 0; c < 3; c++)
+        {
+            pSimplifier->marks[triangle[c]] = fromMark;
+        }
+    }
+
+    uint32_t sharedMark = ++pSimplifier->mark;
+    uint32_t shared = 0;
+    for(uint32_t k = pSimplifier->offsets[to]; k < pSimplifier->offsets[to + 1]; k++)
+    {
+        const uint32_t *triangle = &indices[3 * pSimplifier->adjacency[k]];
+        for(uint32_t c = 0; c < 3; c++)
+        {
+            uint32_t v = triangle[c];
+            if(v != from && v != to && pSimplifier->marks[v] == fromMark)
+            {
+                pSimplifier->marks[v] = sharedMark;
+                shared++;
+            }
+        }
+    }
+    return shared > 2;
+}
+
+static uint32_t simplifyPass(Simplifier *pSimplifier, uint32_t *indices, uint32_t *corners, uint32_t indexCount, uint32_t targetIndexCount)//One round of independent edge collapses on welded indices, corners follows with the original vertices. Returns the new index count
+{
+    uint32_t vertexCount = pSimplifier->vertexCount;
+    uint32_t triangleCount = indexCount / 3;
+
+    memset(pSimplifier->offsets, 0, sizeof(uint32_t) * (vertexCount + 1));
+    for(uint32_t i = 0; i < indexCount; i++)
+    {
+        pSimplifier->offsets[indices[i] + 1]++;
+    }
+    for(uint32_t v = 0; v < vertexCount; v++)
+    {
+        pSimplifier->offsets[v + 1] += pSimplifier->offsets[v];
+    }
+    memcpy(pSimplifier->remap, pSimplifier->offsets, sizeof(uint32_t) * vertexCount);//Borrowed as the fill cursor, reset below
+    for(uint32_t i = 0; i < indexCount; i++)
+    {
+        pSimplifier->adjacency[pSimplifier->remap[indices[i]]++] = i / 3;
+    }
+
+    uint32_t collapseCount = 0;
+    for(uint32_t i = 0; i < indexCount; i++)
+    {
+        uint32_t a = indices[i];
+        uint32_t b = indices[i % 3 == 2 ? i - 2 : i + 1];
+        if(a >= b || (pSimplifier->locked[a] && pSimplifier->locked[b]))
+        {
+            continue;//Interior edges show up once in each direction, only one is needed
+        }
+
+        Quadric *pA = &pSimplifier->quadrics[a];
+        Quadric *pB = &pSimplifier->quadrics[b];
+        double costAB = pSimplifier->locked[a] ? INFINITY : quadricError(pA, pB, pSimplifier->vertices[b].position);
+        double costBA = pSimplifier->locked[b] ? INFINITY : quadricError(pA, pB, pSimplifier->vertices[a].position);
+
+        Collapse collapse = {costAB, a, b};
+        if(costBA < costAB)
+        {
+            collapse.cost = costBA;
+            collapse.from = b;
+            collapse.to = a;
+        }
+        pSimplifier->collapses[collapseCount++] = collapse;
+    }
+    qsort(pSimplifier->collapses, collapseCount, sizeof(Collapse), compareCollapses);
+
+    for(uint32_t v = 0; v < vertexCount; v++)
+    {
+        pSimplifier->remap[v] = v;
+    }
+    memset(pSimplifier->touched, 0, vertexCount);
+
+    uint32_t removable = (indexCount - targetIndexCount) / 3;
+    uint32_t removed = 0;
+    uint32_t applied = 0;
+    for(uint32_t i = 0; i < collapseCount && removed < removable; i++)
+    {
+        Collapse collapse = pSimplifier->collapses[i];
+        if(pSimplifier->touched[collapse.from] || pSimplifier->touched[collapse.to] || pinchesSurface(pSimplifier, indices, collapse.from, collapse.to) ||
+           flipsTriangles(pSimplifier, indices, collapse.from, collapse.to))
+        {
+            continue;
+        }
+
+        for(uint32_t k = pSimplifier->offsets[collapse.from]; k < pSimplifier->offsets[collapse.from + 1]; k++)//Freezes the whole neighbourhood, the flip test assumed it stays put
+        {
+            const uint32_t *triangle = &indices[3 * pSimplifier->adjacency[k]];
+            pSimplifier->touched[triangle[0]] = 1;
+            pSimplifier->touched[triangle[1]] = 1;
+            pSimplifier->touched[triangle[2]] = 1;
+            for(uint32_t c = 0; c < 3; c++)
+            {
+                if(triangle[c] == collapse.to)//from is never on a seam, so every triangle on the edge has the same original vertex at to
+                {
+                    pSimplifier->target[collapse.from] = corners[3 * pSimplifier->adjacency[k] + c];
+                    removed++;
+                }
+            }
+        }
+
+        pSimplifier->remap[collapse.from] = collapse.to;
+        addQuadric(&pSimplifier->quadrics[collapse.to], &pSimplifier->quadrics[collapse.from]);
+        pSimplifier->maxError = fmax(pSimplifier->maxError, collapse.cost);
+        applied++;
+    }
+
+    if(applied == 0)
+    {
+        return indexCount;
+    }
+
+    uint32_t writeIndex = 0;
+    for(uint32_t t = 0; t < triangleCount; t++)
+    {
+        uint32_t a = pSimplifier->remap[indices[3 * t]];
+        uint32_t b = pSimplifier->remap[indices[3 * t + 1]];
+        uint32_t c = pSimplifier->remap[indices[3 * t + 2]];
+        if(a != b && b != c && c != a)
+        {
+            for(uint32_t k = 0; k < 3; k++)
+            {
+                uint32_t welded = indices[3 * t + k];
+                corners[writeIndex + k] = welded == pSimplifier->remap[welded] ? corners[3 * t + k] : pSimplifier->target[welded];
+            }
+            indices[writeIndex++] = a;
+            indices[writeIndex++] = b;
+            indices[writeIndex++] = c;
+        }
+    }
+    return writeIndex;
+}
+
+void generateMeshLods(Mesh *pMesh, uint32_t maxLods)//Appends coarser index ranges to a heap owned mesh, each with about LOD_REDUCTION of the triangles of the one before
+{
+    uint32_t vertexCount = pMesh->vertexCount;
+    uint32_t indexCount = pMesh->lods[0].indexCount / 3 * 3;
+    maxLods = maxLods < MAX_MESH_LODS ? maxLods : MAX_MESH_LODS;
+    if(indexCount / 3 < 2 * MIN_LOD_TRIANGLES || maxLods < 2)
+    {
+        return;
+    }
+
+    uint32_t *weld = allocOrExit(sizeof(uint32_t) * vertexCount);
+    weldPositions(pMesh, weld);
+
+    uint32_t *levels[MAX_MESH_LODS];
+    uint32_t levelCounts[MAX_MESH_LODS];
+    levels[0] = allocOrExit(sizeof(uint32_t) * indexCount);
+    levelCounts[0] = indexCount;
+    for(uint32_t i = 0; i < indexCount; i++)
+    {
+        levels[0][i] = meshIndex(pMesh, pMesh->lods[0].firstIndex + i);
+    }
+
+    Simplifier simplifier = {
+        .vertices = pMesh->vertices,
+        .vertexCount = vertexCount,
+        .quadrics = calloc(vertexCount, sizeof(Quadric)),
+        .locked = calloc(vertexCount, 1),
+        .touched = allocOrExit(vertexCount),
+        .remap = allocOrExit(sizeof(uint32_t) * vertexCount),
+        .target = allocOrExit(sizeof(uint32_t) * vertexCount),
+        .marks = calloc(vertexCount, sizeof(uint32_t)),
+        .offsets = allocOrExit(sizeof(uint32_t) * (vertexCount + 1)),
+        .adjacency = allocOrExit(sizeof(uint32_t) * indexCount),
+        .collapses = allocOrExit(sizeof(Collapse) * indexCount)
+    };
+    if(simplifier.quadrics == NULL || simplifier.locked == NULL || simplifier.marks == NULL)
+    {
+        printf("Failed to allocate mesh LOD data!\n");
+        exit(1);
+    }
+
+    uint32_t *current = allocOrExit(sizeof(uint32_t) * indexCount);//Welded, for the quadrics, adjacency and locking
+    uint32_t *corners = allocOrExit(sizeof(uint32_t) * indexCount);//The original vertex of every corner of current, what the levels store
+    for(uint32_t i = 0; i < indexCount; i++)
+    {
+        current[i] = weld[levels[0][i]];
+        corners[i] = levels[0][i];
+    }
+
+    for(uint32_t t = 0; t < indexCount / 3; t++)//Area weighted plane of every triangle, on its corners
+    {
+        Vector3 a = pMesh->vertices[current[3 * t]].position;
+        Vector3 n = triangleNormal(a, pMesh->vertices[current[3 * t + 1]].position, pMesh->vertices[current[3 * t + 2]].position);
+        double length = sqrt((double)n.x * n.x + (double)n.y * n.y + (double)n.z * n.z);
+        if(length <= 0.0)
+        {
+            continue;
+        }
+
+        double nx = n.x / length, ny = n.y / length, nz = n.z / length;
+        double d = -(nx * a.x + ny * a.y + nz * a.z);
+        for(uint32_t c = 0; c < 3; c++)
+        {
+            addPlaneQuadric(&simplifier.quadrics[current[3 * t + c]], nx, ny, nz, d, 0.5 * length);
+        }
+    }
+    lockBorders(current, indexCount, simplifier.locked);
+    lockSeams(pMesh, weld, simplifier.locked);
+
+    uint32_t lodCount = 1;
+    uint32_t currentCount = indexCount;
+    uint32_t *clusterStarts = allocOrExit(sizeof(uint32_t) * (indexCount / 3));
+    float errors[MAX_MESH_LODS] = {0.0f};
+
+    while(lodCount < maxLods)
+    {
+        uint32_t target = (uint32_t)(levelCounts[lodCount - 1] / 3 * LOD_REDUCTION) * 3;
+        if(target / 3 < MIN_LOD_TRIANGLES)
+        {
+            break;
+        }
+
+        while(currentCount > target)
+        {
+            uint32_t count = simplifyPass(&simplifier, current, corners, currentCount, target);
+            if(count == currentCount)
+            {
+                break;
+            }
+            currentCount = count;
+        }
+
+        if(currentCount > levelCounts[lodCount - 1] * 0.9f)//Stalled on locked borders or flips, further levels would barely differ
+        {
+            break;
+        }
+
+        float error = (float)sqrt(simplifier.maxError);
+        if(lodCount > 1 && error > LOD_MAX_ERROR_GROWTH * errors[lodCount - 1])//Stops the chain rather than storing a broken level
+        {
+            break;
+        }
+
+        levels[lodCount] = allocOrExit(sizeof(uint32_t) * currentCount);
+        memcpy(levels[lodCount], corners, sizeof(uint32_t) * currentCount);
+        levelCounts[lodCount] = currentCount;
+        errors[lodCount] = error;
+        optimizeVertexCache(levels[lodCount], currentCount, vertexCount, VERTEX_CACHE_SIZE, clusterStarts);
+        lodCount++;
+    }
+
+    uint32_t totalCount = 0;
+    for(uint32_t l = 0; l < lodCount; l++)
+    {
+        totalCount += levelCounts[l];
+    }
+
+    uint32_t *indices = allocOrExit(sizeof(uint32_t) * totalCount);
+    MeshLod lods[MAX_MESH_LODS];
+    uint32_t offset = 0;
+    for(uint32_t l = 0; l < lodCount; l++)
+    {
+        memcpy(&indices[offset], levels[l], sizeof(uint32_t) * levelCounts[l]);
+        lods[l].firstIndex = offset;
+        lods[l].indexCount = levelCounts[l];
+        lods[l].error = errors[l];
+        offset += levelCounts[l];
+        free(levels[l]);
+    }
+
+    free(pMesh->indices);
+    meshSetIndices(pMesh, indices, totalCount);
+    memcpy(pMesh->lods, lods, sizeof(MeshLod) * lodCount);
+    pMesh->lodCount = lodCount;
+
+    printf("Mesh LODs:");
+    for(uint32_t l = 0; l < lodCount; l++)
+    {
+        printf(" %u (%.4f)", lods[l].indexCount / 3, lods[l].error);
+    }
+    printf(" triangles\n");
+
+    free(indices);
+    free(clusterStarts);
+    free(current);
+    free(corners);
+    free(weld);
+    free(simplifier.quadrics);
+    free(simplifier.locked);
+    free(simplifier.touched);
+    free(simplifier.remap);
+    free(simplifier.target);
+    free(simplifier.marks);
+    free(simplifier.offsets);
+    free(simplifier.adjacency);
+    free(simplifier.collapses);
+}
+
+float meshBoundingRadius(const Mesh *pMesh)//Around the origin, where normalizeMesh centres everything
+{
+    float radiusSquared = 0.0f;
+    for(uint32_t i = 0; i < pMesh->vertexCount; i++)
+    {
+        Vector3 p = pMesh->vertices[i].position;
+        radiusSquared = fmaxf(radiusSquared, p.x * p.x + p.y * p.y + p.z * p.z);
+    }
+    return sqrtf(radiusSquared);
+}
+
+uint32_t selectMeshLod(const Mesh *pMesh, float distance, float pixelsPerUnit, float maxPixelError)//Coarsest level whose error projects to at most maxPixelError. pixelsPerUnit is the projected size of one unit at distance one
+{
+    if(maxPixelError <= 0.0f)
+    {
+        return 0;
+    }
+
+    float scale = pixelsPerUnit / fmaxf(distance, 1e-4f);
+    uint32_t lod = 0;
+    while(lod + 1 < pMesh->lodCount && pMesh->lods[lod + 1].error * scale <= maxPixelError)
+    {
+        lod++;
+    }
+    return lod;
+}
@@ -0,0 +1,24 @@
+//
+//  meshLod.h
+//  vkProject
+//
+//  Quadric error simplification into a level of detail chain, and picking a level from screen-space error.
+//
+
+#ifndef meshLod_h
+#define meshLod_h
+
+#include <stdint.h>
+#include "mesh.h"
+
+#define LOD_REDUCTION 0.5f//Triangle ratio between neighbouring levels
+#define MIN_LOD_TRIANGLES 32
+#define LOD_MAX_ERROR_GROWTH 4.0f//Between neighbouring levels, halving the triangles of a smooth surface about doubles the error, a larger jump means the collapses left cut through the shape
+
+void generateMeshLods(Mesh *pMesh, uint32_t maxLods);
+
+float meshBoundingRadius(const Mesh *pMesh);
+
+uint32_t selectMeshLod(const Mesh *pMesh, float distance, float pixelsPerUnit, float maxPixelError);
+
+#endif /* meshLod_h */
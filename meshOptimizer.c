@@ -0,0 +1,437 @@
+//
+//  meshOptimizer.c
+//  vkProject
+//
+//  Index and vertex reordering for post-transform cache, overdraw and fetch locality.
+//
+
+#include "meshOptimizer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void *allocOrExit(size_t size)
+{
+    void *pMemory = malloc(size ? size : 1);
+    if(pMemory == NULL)
+    {
+        printf("Failed to allocate mesh optimizer data!\n");
+        exit(1);
+    }
+    return pMemory;
+}
+
+void analyzeVertexCache(const uint32_t *indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize, VertexCacheStats *pStats)//Simulates a FIFO cache, a vertex hits while fewer than cacheSize misses happened since it was loaded
+{
+    uint32_t *loadedAt = allocOrExit(sizeof(uint32_t) * vertexCount);
+    uint8_t *referenced = calloc(vertexCount ? vertexCount : 1, 1);
+    if(referenced == NULL)
+    {
+        printf("Failed to allocate mesh optimizer data!\n");
+        exit(1);
+    }
+
+    uint32_t misses = 0;
+    uint32_t uniqueVertices = 0;
+    for(uint32_t i = 0; i < indexCount; i++)
+    {
+        uint32_t v = indices[i];
+        if(!referenced[v] || misses - loadedAt[v] >= cacheSize)
+        {
+            uniqueVertices += !referenced[v];
+            referenced[v] = 1;
+            loadedAt[v] = misses++;
+        }
+    }
+
+    pStats->acmr = indexCount >= 3 ? (float)misses / (indexCount / 3) : 0.0f;
+    pStats->atvr = uniqueVertices ? (float)misses / uniqueVertices : 0.0f;
+
+    free(loadedAt);
+    free(referenced);
+}
+
+//Tipsify, Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007. Fans around one vertex at a time and picks the next fanning vertex among the ones still in cache
+
+typedef struct {
+    uint32_t *offsets;//Triangles of vertex v are triangles[offsets[v]] up to offsets[v + 1]
+    uint32_t *triangles;
+    uint32_t *liveCount;//Triangles of each vertex not emitted yet
+} Adjacency;
+
+static void buildAdjacency(Adjacency *pAdjacency, const uint32_t *indices, uint32_t indexCount, uint32_t vertexCount)
+{
+    pAdjacency->offsets = calloc(vertexCount + 1, sizeof(uint32_t));
+    pAdjacency->liveCount = calloc(vertexCount ? vertexCount : 1, sizeof(uint32_t));
+    pAdjacency->triangles = allocOrExit(sizeof(uint32_t) * indexCount);
+    if(pAdjacency->offsets == NULL || pAdjacency->liveCount == NULL)
+    {
+        printf("Failed to allocate mesh optimizer data!\n");
+        exit(1);
+    }
+
+    for(uint32_t i = 0; i < indexCount; i++)
+    {
+        pAdjacency->liveCount[indices[i]]++;
+    }
+
+    uint32_t offset = 0;
+    for(uint32_t v = 0; v < vertexCount; v++)
+    {
+        pAdjacency->offsets[v] = offset;
+        offset += pAdjacency->liveCount[v];
+    }
+    pAdjacency->offsets[vertexCount] = offset;
+
+    uint32_t *cursor = allocOrExit(sizeof(uint32_t) * (vertexCount ? vertexCount : 1));
+    memcpy(cursor, pAdjacency->offsets, sizeof(uint32_t) * vertexCount);
+    for(uint32_t i = 0; i < indexCount; i++)
+    {
+        pAdjacency->triangles[cursor[indices[i]]++] = i / 3;
+    }
+    free(cursor);
+}
+
+static void freeAdjacency(Adjacency *pAdjacency)
+{
+    free(pAdjacency->offsets);
+    free(pAdjacency->triangles);
+    free(pAdjacency->liveCount);
+}
+
+uint32_t optimizeVertexCache(uint32_t *indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize, uint32_t *clusterStarts)//Reorders triangles in place. clusterStarts gets the first triangle of every run between cache flushes, room for indexCount / 3 entries, returns the run count
+{
+    uint32_t triangleCount = indexCount / 3;
+    if(triangleCount == 0)
+    {
+        return 0;
+    }
+
+    Adjacency adjacency;
+    buildAdjacency(&adjacency, indices, triangleCount * 3, vertexCount);
+
+    uint32_t *output = allocOrExit(sizeof(uint32_t) * triangleCount * 3);
+    uint32_t *cacheTime = calloc(vertexCount, sizeof(uint32_t));
+    uint8_t *emitted = calloc(triangleCount, 1);
+    uint32_t *deadEnd = allocOrExit(sizeof(uint32_t) * triangleCount * 3);
+    uint32_t *candidates = allocOrExit(sizeof(uint32_t) * triangleCount * 3);
+    if(cacheTime == NULL || emitted == NULL)
+    {
+        printf("Failed to allocate mesh optimizer data!\n");
+        exit(1);
+    }
+
+    uint32_t time = cacheSize + 1;
+    uint32_t deadEndCount = 0;
+    uint32_t outputCount = 0;
+    uint32_t clusterCount = 0;
+    uint32_t cursor = 0;//Next vertex in input order to restart from once the dead end stack runs dry
+    int64_t fanning = 0;
+    uint32_t newCluster = 1;
+
+    while(fanning >= 0)
+    {
+        uint32_t candidateCount = 0;
+        uint32_t f = (uint32_t)fanning;
+
+        if(newCluster && adjacency.liveCount[f] > 0)
+        {
+            clusterStarts[clusterCount++] = outputCount / 3;
+            newCluster = 0;
+        }
+
+        for(uint32_t k = adjacency.offsets[f]; k < adjacency.offsets[f + 1]; k++)
+        {
+            uint32_t t = adjacency.triangles[k];
+            if(emitted[t])
+            {
+                continue;
+            }
+
+            for(uint32_t c = 0; c < 3; c++)
+            {
+                uint32_t v = indices[3 * t + c];
+                output[outputCount++] = v;
+                deadEnd[deadEndCount++] = v;
+                candidates[candidateCount++] = v;
+                adjacency.liveCount[v]--;
+                if(time - cacheTime[v] > cacheSize)
+                {
+                    cacheTime[v] = time++;
+                }
+            }
+            emitted[t] = 1;
+        }
+
+        int64_t best = -1;
+        int64_t bestPriority = -1;
+        for(uint32_t k = 0; k < candidateCount; k++)//Prefers the oldest vertex that will still be in cache after fanning around it
+        {
+            uint32_t v = candidates[k];
+            if(adjacency.liveCount[v] == 0)
+            {
+                continue;
+            }
+
+            int64_t priority = 0;
+            if(time - cacheTime[v] + 2 * adjacency.liveCount[v] <= cacheSize)
+            {
+                priority = time - cacheTime[v];
+            }
+
+            if(priority > bestPriority)
+            {
+                bestPriority = priority;
+                best = v;
+            }
+        }
+
+        if(best < 0)//Dead end, the cache is effectively flushed so a new cluster starts
+        {
+            newCluster = 1;
+            while(deadEndCount > 0 && best < 0)
+            {
+                uint32_t v = deadEnd[--deadEndCount];
+                if(adjacency.liveCount[v] > 0)
+                {
+                    best = v;
+                }
+            }
+
+            while(best < 0 && cursor < vertexCount)
+            {
+                if(adjacency.liveCount[cursor] > 0)
+                {
+                    best = cursor;
+                }
+                cursor++;
+            }
+        }
+        fanning = best;
+    }
+
+    memcpy(indices, output, sizeof(uint32_t) * triangleCount * 3);
+
+    free(output);
+    free(cacheTime);
+    free(emitted);
+    free(deadEnd);
+    free(candidates);
+    freeAdjacency(&adjacency);
+    return clusterCount;
+}
+
+#define OVERDRAW_THRESHOLD 1.05f//Largest ACMR increase accepted for finer overdraw sorting, the lambda of the paper
+
+typedef struct {
+    uint32_t firstTriangle;
+    uint32_t triangleCount;
+    float sortKey;
+} Cluster;
+
+static int compareClusters(const void *pA, const void *pB)//Descending key, ties keep the cache order
+{
+    const Cluster *a = pA;
+    const Cluster *b = pB;
+    if(a->sortKey != b->sortKey)
+    {
+        return a->sortKey < b->sortKey ? 1 : -1;
+    }
+    return a->firstTriangle < b->firstTriangle ? -1 : a->firstTriangle > b->firstTriangle;
+}
+
+static uint32_t cacheMisses(const uint32_t *indices, uint32_t *loadedAt, uint32_t *pMisses, uint32_t epoch, uint32_t cacheSize)//One triangle through the FIFO simulation, vertices loaded before epoch count as evicted
+{
+    uint32_t misses = 0;
+    for(uint32_t c = 0; c < 3; c++)
+    {
+        uint32_t v = indices[c];
+        if(loadedAt[v] == UINT32_MAX || loadedAt[v] < epoch || *pMisses - loadedAt[v] >= cacheSize)
+        {
+            loadedAt[v] = (*pMisses)++;
+            misses++;
+        }
+    }
+    return misses;
+}
+
+static uint32_t splitClusters(const uint32_t *indices, uint32_t triangleCount, uint32_t vertexCount, uint32_t cacheSize, const uint32_t *clusterStarts, uint32_t clusterCount, Cluster *clusters)//Cuts the cache runs wherever the part so far is within OVERDRAW_THRESHOLD of the run's own ACMR, so more, smaller clusters can be sorted
+{
+    uint32_t *loadedAt = allocOrExit(sizeof(uint32_t) * (vertexCount ? vertexCount : 1));
+    memset(loadedAt, 0xFF, sizeof(uint32_t) * vertexCount);
+    uint32_t misses = 0;
+    uint32_t count = 0;
+
+    for(uint32_t c = 0; c < clusterCount; c++)
+    {
+        uint32_t begin = clusterStarts[c];
+        uint32_t end = c + 1 < clusterCount ? clusterStarts[c + 1] : triangleCount;
+
+        uint32_t epoch = misses;
+        uint32_t runMisses = 0;
+        for(uint32_t t = begin; t < end; t++)
+        {
+            runMisses += cacheMisses(&indices[3 * t], loadedAt, &misses, epoch, cacheSize);
+        }
+        float runAcmr = (float)runMisses / (end - begin);
+
+        uint32_t first = begin;
+        uint32_t partMisses = 0;
+        epoch = misses;//Each part starts cold since sorting can put anything in front of it
+        for(uint32_t t = begin; t < end; t++)
+        {
+            partMisses += cacheMisses(&indices[3 * t], loadedAt, &misses, epoch, cacheSize);
+            if(t + 1 == end || (float)partMisses / (t + 1 - first) <= OVERDRAW_THRESHOLD * runAcmr)
+            {
+                clusters[count].firstTriangle = first;
+                clusters[count].triangleCount = t + 1 - first;
+                count++;
+                first = t + 1;
+                partMisses = 0;
+                epoch = misses;
+            }
+        }
+    }
+
+    free(loadedAt);
+    return count;
+}
+
+void optimizeOverdraw(uint32_t *indices, uint32_t indexCount, const Vertex *vertices, uint32_t vertexCount, uint32_t cacheSize, const uint32_t *clusterStarts, uint32_t clusterCount)//Draws outward facing clusters first, they are the most likely to occlude the rest of the mesh from any direction
+{
+    uint32_t triangleCount = indexCount / 3;
+    if(clusterCount == 0)
+    {
+        return;
+    }
+
+    Cluster *clusters = allocOrExit(sizeof(Cluster) * triangleCount);
+    clusterCount = splitClusters(indices, triangleCount, vertexCount, cacheSize, clusterStarts, clusterCount, clusters);
+
+    float meshCentroid[3] = {0.0f, 0.0f, 0.0f};
+    float meshArea = 0.0f;
+    float (*centroids)[3] = allocOrExit(sizeof(float[3]) * clusterCount);
+    float (*normals)[3] = allocOrExit(sizeof(float[3]) * clusterCount);
+
+    for(uint32_t c = 0; c < clusterCount; c++)
+    {
+        float area = 0.0f;
+        memset(centroids[c], 0, sizeof(float[3]));
+        memset(normals[c], 0, sizeof(float[3]));
+        for(uint32_t t = clusters[c].firstTriangle; t < clusters[c].firstTriangle + clusters[c].triangleCount; t++)
+        {
+            Vector3 a = vertices[indices[3 * t]].position;
+            Vector3 b = vertices[indices[3 * t + 1]].position;
+            Vector3 p = vertices[indices[3 * t + 2]].position;
+            float e1[3] = {b.x - a.x, b.y - a.y, b.z - a.z};
+            float e2[3] = {p.x - a.x, p.y - a.y, p.z - a.z};
+            float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+            float triangleArea = 0.5f * sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            float centre[3] = {(a.x + b.x + p.x) / 3.0f, (a.y + b.y + p.y) / 3.0f, (a.z + b.z + p.z) / 3.0f};
+
+            for(uint32_t k = 0; k < 3; k++)
+            {
+                centroids[c][k] += centre[k] * triangleArea;
+                normals[c][k] += n[k];//Unnormalised cross products are already area weighted
+            }
+            area += triangleArea;
+        }
+
+        for(uint32_t k = 0; k < 3; k++)
+        {
+            meshCentroid[k] += centroids[c][k];
+            centroids[c][k] = area > 0.0f ? centroids[c][k] / area : 0.0f;
+        }
+        meshArea += area;
+    }
+
+    for(uint32_t k = 0; k < 3; k++)
+    {
+        meshCentroid[k] = meshArea > 0.0f ? meshCentroid[k] / meshArea : 0.0f;
+    }
+
+    for(uint32_t c = 0; c < clusterCount; c++)
+    {
+        float length = sqrtf(normals[c][0] * normals[c][0] + normals[c][1] * normals[c][1] + normals[c][2] * normals[c][2]);
+        float key = 0.0f;
+        for(uint32_t k = 0; length > 0.0f && k < 3; k++)
+        {
+            key += (centroids[c][k] - meshCentroid[k]) * normals[c][k] / length;
+        }
+        clusters[c].sortKey = key;
+    }
+
+    qsort(clusters, clusterCount, sizeof(Cluster), compareClusters);
+
+    uint32_t *output = allocOrExit(sizeof(uint32_t) * triangleCount * 3);
+    uint32_t outputCount = 0;
+    for(uint32_t c = 0; c < clusterCount; c++)
+    {
+        memcpy(&output[outputCount], &indices[3 * clusters[c].firstTriangle], sizeof(uint32_t) * 3 * clusters[c].triangleCount);
+        outputCount += 3 * clusters[c].triangleCount;
+    }
+    memcpy(indices, output, sizeof(uint32_t) * outputCount);
+
+    free(output);
+    free(clusters);
+    free(centroids);
+    free(normals);
+}
+
+uint32_t optimizeVertexFetch(Vertex *vertices, uint32_t vertexCount, uint32_t *indices, uint32_t indexCount)//Orders vertices by first use so fetches walk the buffer forwards, drops unreferenced ones and returns the new count
+{
+    uint32_t *remap = allocOrExit(sizeof(uint32_t) * (vertexCount ? vertexCount : 1));
+    memset(remap, 0xFF, sizeof(uint32_t) * vertexCount);
+    Vertex *reordered = allocOrExit(sizeof(Vertex) * (vertexCount ? vertexCount : 1));
+
+    uint32_t nextVertex = 0;
+    for(uint32_t i = 0; i < indexCount; i++)
+    {
+        uint32_t v = indices[i];
+        if(remap[v] == UINT32_MAX)
+        {
+            remap[v] = nextVertex;
+            reordered[nextVertex++] = vertices[v];
+        }
+        indices[i] = remap[v];
+    }
+
+    memcpy(vertices, reordered, sizeof(Vertex) * nextVertex);
+    free(reordered);
+    free(remap);
+    return nextVertex;
+}
+
+void optimizeMesh(Mesh *pMesh)//Works on heap owned meshes, the index width is picked again for the new vertex count
+{
+    uint32_t indexCount = pMesh->indexCount / 3 * 3;
+    if(indexCount == 0)
+    {
+        return;
+    }
+
+    uint32_t *indices = allocOrExit(sizeof(uint32_t) * indexCount);
+    for(uint32_t i = 0; i < indexCount; i++)
+    {
+        indices[i] = meshIndex(pMesh, i);
+    }
+
+    VertexCacheStats before, after;
+    analyzeVertexCache(indices, indexCount, pMesh->vertexCount, VERTEX_CACHE_SIZE, &before);
+
+    uint32_t *clusterStarts = allocOrExit(sizeof(uint32_t) * (indexCount / 3));
+    uint32_t clusterCount = optimizeVertexCache(indices, indexCount, pMesh->vertexCount, VERTEX_CACHE_SIZE, clusterStarts);
+    optimizeOverdraw(indices, indexCount, pMesh->vertices, pMesh->vertexCount, VERTEX_CACHE_SIZE, clusterStarts, clusterCount);
+    pMesh->vertexCount = optimizeVertexFetch(pMesh->vertices, pMesh->vertexCount, indices, indexCount);
+
+    analyzeVertexCache(indices, indexCount, pMesh->vertexCount, VERTEX_CACHE_SIZE, &after);
+    printf("Mesh optimisation (%u entry FIFO): ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", VERTEX_CACHE_SIZE, before.acmr, after.acmr, before.atvr, after.atvr);
+
+    free(pMesh->indices);
+    meshSetIndices(pMesh, indices, indexCount);
+
+    free(indices);
+    free(clusterStarts);
+}
@@ -0,0 +1,31 @@
+//
+//  meshOptimizer.h
+//  vkProject
+//
+//  Index and vertex reordering for post-transform cache, overdraw and fetch locality.
+//
+
+#ifndef meshOptimizer_h
+#define meshOptimizer_h
+
+#include <stdint.h>
+#include "mesh.h"
+
+#define VERTEX_CACHE_SIZE 16//Conservative FIFO size, smaller than what current GPUs effectively have so the order holds up everywhere
+
+typedef struct {
+    float acmr;//Vertices transformed per triangle, 0.5 is the ideal for a large regular mesh and 3 the worst case
+    float atvr;//Vertices transformed per referenced vertex, 1 is ideal
+} VertexCacheStats;
+
+void analyzeVertexCache(const uint32_t *indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize, VertexCacheStats *pStats);
+
+uint32_t optimizeVertexCache(uint32_t *indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize, uint32_t *clusterStarts);
+
+void optimizeOverdraw(uint32_t *indices, uint32_t indexCount, const Vertex *vertices, uint32_t vertexCount, uint32_t cacheSize, const uint32_t *clusterStarts, uint32_t clusterCount);
+
+uint32_t optimizeVertexFetch(Vertex *vertices, uint32_t vertexCount, uint32_t *indices, uint32_t indexCount);
+
+void optimizeMesh(Mesh *pMesh);
+
+#endif /* meshOptimizer_h */
@@ -0,0 +1,38 @@
+//
+//  meshconv.c
+//  vkProject
+//
+//  Converts OBJ and GLB models into optimised, memory mappable mesh files.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "mesh.h"
+#include "meshLoader.h"
+#include "meshFile.h"
+#include "meshOptimizer.h"
+#include "meshLod.h"
+#include "jobSystem.h"
+
+int main(int argc, char **argv)
+{
+    if(argc != 3)
+    {
+        printf("Usage: meshconv <input.obj|input.glb> <output.mesh>\n");
+        return 1;
+    }
+
+    JobSystem jobs;
+    createJobSystem(&jobs, jobSystemDefaultThreadCount());
+
+    Mesh mesh = {0};
+    loadMesh(&mesh, argv[1], &jobs);
+    optimizeMesh(&mesh);
+    generateMeshLods(&mesh, MAX_MESH_LODS);
+    writeMeshFile(&mesh, argv[2]);
+    printf("Wrote %s\n", argv[2]);
+
+    freeMesh(&mesh);
+    destroyJobSystem(&jobs);
+    return 0;
+}
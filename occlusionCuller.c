@@ -0,0 +1,665 @@
+//
+//  occlusionCuller.c
+//  vkProject
+//
+//  Two-phase occlusion culling against a hierarchical depth pyramid, drawn through indirect draws the compute passes fill in.
+//
+
+#include "occlusionCuller.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "utils.h"
+
+static void *allocOrExit(size_t size)
+{
+    void *pMemory = malloc(size ? size : 1);
+    if(pMemory == NULL)
+    {
+        printf("Failed to allocate occlusion culler!\n");
+        exit(1);
+    }
+    return pMemory;
+}
+
+static VkShaderModule loadShader(VkDevice device, const char *fileName)
+{
+    char *binary;
+    size_t codeSize = readFile(fileName, &binary);
+
+    VkShaderModuleCreateInfo createInfo = {
+        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        .codeSize = codeSize,
+        .pCode = (uint32_t *)binary
+    };
+
+    VkShaderModule shaderModule;
+    if(vkCreateShaderModule(device, &createInfo, NULL, &shaderModule) != VK_SUCCESS)
+    {
+        printf("Failed to create occlusion shader module!\n");
+        exit(1);
+    }
+    free(binary);
+    return shaderModule;
+}
+
+static void createCullerBuffer(OcclusionCuller *pCuller, VkDeviceSize size, VkBufferUsageFlags usage, uint32_t memoryUsage, VkBuffer *pBuffer, VkDeviceMemory *pMemory, uint32_t *pMemoryType)
+{
+    VkBufferCreateInfo bufferInfo = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = size,
+        .usage = usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE
+    };
+
+    if(vkCreateBuffer(pCuller->device, &bufferInfo, NULL, pBuffer) != VK_SUCCESS)
+    {
+        printf("Failed to create occlusion buffer!\n");
+        exit(1);
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(pCuller->device, *pBuffer, &requirements);
+    if(memoryPolicyAllocate(pCuller->pMemoryPolicy, pCuller->device, &requirements, memoryUsage, pMemory, pMemoryType) != VK_SUCCESS)
+    {
+        printf("Failed to allocate occlusion memory!\n");
+        exit(1);
+    }
+    vkBindBufferMemory(pCuller->device, *pBuffer, *pMemory, 0);
+}
+
+static VkDescriptorSetLayout createSetLayout(VkDevice device, const VkDescriptorType *types, uint32_t count)
+{
+    VkDescriptorSetLayoutBinding bindings[8];
+    for(uint32_t i = 0; i < count; i++)
+    {
+        bindings[i] = (VkDescriptorSetLayoutBinding){
+            .binding = i,
+            .descriptorType = types[i],
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT
+        };
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = count,
+        .pBindings = bindings
+    };
+
+    VkDescriptorSetLayout layout;
+    if(vkCreateDescriptorSetLayout(device, &layoutInfo, NULL, &layout) != VK_SUCCESS)
+    {
+        printf("Failed to create occlusion descriptor set layout!\n");
+        exit(1);
+    }
+    return layout;
+}
+
+static void createDescriptors(OcclusionCuller *pCuller, VkBuffer boundsBuffer, const VkBuffer *inputBuffers)
+{
+    VkDescriptorType cullTypes[6] = {
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+    };
+    VkDescriptorType testTypes[1] = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER};
+    VkDescriptorType reduceTypes[3] = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE};
+    pCuller->cullSetLayout = createSetLayout(pCuller->device, cullTypes, 6);
+    pCuller->testSetLayout = createSetLayout(pCuller->device, testTypes, 1);
+    pCuller->reduceSetLayout = createSetLayout(pCuller->device, reduceTypes, 3);
+
+    VkDescriptorPoolSize poolSize = {
+        .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .descriptorCount = 6 * pCuller->frameCount
+    };
+
+    VkDescriptorPoolCreateInfo poolInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .maxSets = pCuller->frameCount,
+        .poolSizeCount = 1,
+        .pPoolSizes = &poolSize
+    };
+
+    if(vkCreateDescriptorPool(pCuller->device, &poolInfo, NULL, &pCuller->descriptorPool) != VK_SUCCESS)
+    {
+        printf("Failed to create occlusion descriptor pool!\n");
+        exit(1);
+    }
+
+    VkDescriptorSetLayout layouts[pCuller->frameCount];
+    for(uint32_t i = 0; i < pCuller->frameCount; i++)
+    {
+        layouts[i] = pCuller->cullSetLayout;
+    }
+    VkDescriptorSetAllocateInfo allocInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = pCuller->descriptorPool,
+        .descriptorSetCount = pCuller->frameCount,
+        .pSetLayouts = layouts
+    };
+
+    pCuller->cullSets = allocOrExit(sizeof(VkDescriptorSet) * pCuller->frameCount);
+    if(vkAllocateDescriptorSets(pCuller->device, &allocInfo, pCuller->cullSets) != VK_SUCCESS)
+    {
+        printf("Failed to allocate occlusion descriptor sets!\n");
+        exit(1);
+    }
+
+    for(uint32_t frame = 0; frame < pCuller->frameCount; frame++)
+    {
+        VkDescriptorBufferInfo bufferInfos[6] = {
+            {boundsBuffer, 0, VK_WHOLE_SIZE},
+            {pCuller->visibilityBuffer, 0, VK_WHOLE_SIZE},
+            {pCuller->candidateBuffers[frame], 0, VK_WHOLE_SIZE},
+            {inputBuffers[frame], 0, VK_WHOLE_SIZE},
+            {pCuller->outputBuffers[frame], 0, VK_WHOLE_SIZE},
+            {pCuller->drawBuffers[frame], 0, VK_WHOLE_SIZE}
+        };
+        VkWriteDescriptorSet writes[6];
+        for(uint32_t i = 0; i < 6; i++)
+        {
+            writes[i] = (VkWriteDescriptorSet){
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = pCuller->cullSets[frame],
+                .dstBinding = i,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pBufferInfo = &bufferInfos[i]
+            };
+        }
+        vkUpdateDescriptorSets(pCuller->device, 6, writes, 0, NULL);
+    }
+}
+
+static void createPipelines(OcclusionCuller *pCuller)
+{
+    VkPushConstantRange cullConstants = {
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .offset = 0,
+        .size = sizeof(OcclusionConstants)
+    };
+
+    VkDescriptorSetLayout cullLayouts[2] = {pCuller->cullSetLayout, pCuller->testSetLayout};
+    VkPipelineLayoutCreateInfo cullLayoutInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 2,
+        .pSetLayouts = cullLayouts,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &cullConstants
+    };
+
+    if(vkCreatePipelineLayout(pCuller->device, &cullLayoutInfo, NULL, &pCuller->cullLayout) != VK_SUCCESS)
+    {
+        printf("Failed to create occlusion pipeline layout!\n");
+        exit(1);
+    }
+
+    VkPushConstantRange reduceConstants = {
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .offset = 0,
+        .size = sizeof(HiZConstants)
+    };
+
+    VkPipelineLayoutCreateInfo reduceLayoutInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &pCuller->reduceSetLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &reduceConstants
+    };
+
+    if(vkCreatePipelineLayout(pCuller->device, &reduceLayoutInfo, NULL, &pCuller->reduceLayout) != VK_SUCCESS)
+    {
+        printf("Failed to create depth pyramid pipeline layout!\n");
+        exit(1);
+    }
+
+    VkShaderModule cullModule = loadShader(pCuller->device, "shaders/comp_occlusion.spv");
+    uint32_t phases[OCCLUSION_PHASE_COUNT] = {OCCLUSION_PHASE_EARLY, OCCLUSION_PHASE_LATE};
+    VkSpecializationMapEntry specializationEntry = {
+        .constantID = 0,//constant_id of phase in occlusion.comp
+        .offset = 0,
+        .size = sizeof(uint32_t)
+    };
+    VkSpecializationInfo specializationInfos[OCCLUSION_PHASE_COUNT];
+    VkComputePipelineCreateInfo pipelineInfos[OCCLUSION_PHASE_COUNT];
+    for(uint32_t i = 0; i < OCCLUSION_PHASE_COUNT; i++)
+    {
+        specializationInfos[i] = (VkSpecializationInfo){
+            .mapEntryCount = 1,
+            .pMapEntries = &specializationEntry,
+            .dataSize = sizeof(uint32_t),
+            .pData = &phases[i]
+        };
+        pipelineInfos[i] = (VkComputePipelineCreateInfo){
+            .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+            .stage = {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+                .module = cullModule,
+                .pName = "main",
+                .pSpecializationInfo = &specializationInfos[i]
+            },
+            .layout = pCuller->cullLayout,
+            .basePipelineIndex = -1
+        };
+    }
+
+    if(vkCreateComputePipelines(pCuller->device, VK_NULL_HANDLE, OCCLUSION_PHASE_COUNT, pipelineInfos, NULL, pCuller->cullPipelines) != VK_SUCCESS)
+    {
+        printf("Failed to create occlusion pipelines!\n");
+        exit(1);
+    }
+    vkDestroyShaderModule(pCuller->device, cullModule, NULL);
+
+    VkShaderModule reduceModule = loadShader(pCuller->device, "shaders/comp_hiz.spv");
+    VkComputePipelineCreateInfo reduceInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = reduceModule,
+            .pName = "main"
+        },
+        .layout = pCuller->reduceLayout,
+        .basePipelineIndex = -1
+    };
+
+    if(vkCreateComputePipelines(pCuller->device, VK_NULL_HANDLE, 1, &reduceInfo, NULL, &pCuller->reducePipeline) != VK_SUCCESS)
+    {
+        printf("Failed to create depth pyramid pipeline!\n");
+        exit(1);
+    }
+    vkDestroyShaderModule(pCuller->device, reduceModule, NULL);
+}
+
+void createOcclusionCuller(OcclusionCuller *pCuller, VkDevice device, MemoryPolicy *pMemoryPolicy, DeletionQueue *pDeletionQueue, VkBuffer boundsBuffer, const VkBuffer *inputBuffers, uint32_t instanceCount, uint32_t stride, uint32_t frameCount)//boundsBuffer holds an EntityBounds per dense entity, inputBuffers the frustum culled instance records of each frame
+{
+    memset(pCuller, 0, sizeof(OcclusionCuller));
+    pCuller->device = device;
+    pCuller->pMemoryPolicy = pMemoryPolicy;
+    pCuller->pDeletionQueue = pDeletionQueue;
+    pCuller->instanceCount = instanceCount;
+    pCuller->stride = stride;
+    pCuller->frameCount = frameCount;
+
+    uint32_t memoryType;
+    createCullerBuffer(pCuller, sizeof(uint32_t) * (VkDeviceSize)instanceCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, MEMORY_USAGE_GPU_ONLY, &pCuller->visibilityBuffer, &pCuller->visibilityMemory, &memoryType);
+
+    pCuller->candidateBuffers = allocOrExit(sizeof(VkBuffer) * frameCount);
+    pCuller->candidateMemory = allocOrExit(sizeof(VkDeviceMemory) * frameCount);
+    pCuller->candidateMapped = allocOrExit(sizeof(uint32_t *) * frameCount);
+    pCuller->drawBuffers = allocOrExit(sizeof(VkBuffer) * frameCount);
+    pCuller->drawMemory = allocOrExit(sizeof(VkDeviceMemory) * frameCount);
+    pCuller->drawMapped = allocOrExit(sizeof(OcclusionDraws *) * frameCount);
+    pCuller->pendingCandidates = allocOrExit(sizeof(uint32_t) * frameCount);
+    pCuller->outputBuffers = allocOrExit(sizeof(VkBuffer) * frameCount);
+    pCuller->outputMemory = allocOrExit(sizeof(VkDeviceMemory) * frameCount);
+    for(uint32_t i = 0; i < frameCount; i++)
+    {
+        createCullerBuffer(pCuller, sizeof(uint32_t) * (VkDeviceSize)instanceCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, MEMORY_USAGE_DYNAMIC, &pCuller->candidateBuffers[i], &pCuller->candidateMemory[i], &pCuller->dynamicMemoryType);
+        vkMapMemory(device, pCuller->candidateMemory[i], 0, VK_WHOLE_SIZE, 0, (void **)&pCuller->candidateMapped[i]);
+        createCullerBuffer(pCuller, sizeof(OcclusionDraws), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, MEMORY_USAGE_DYNAMIC, &pCuller->drawBuffers[i], &pCuller->drawMemory[i], &pCuller->dynamicMemoryType);
+        vkMapMemory(device, pCuller->drawMemory[i], 0, VK_WHOLE_SIZE, 0, (void **)&pCuller->drawMapped[i]);
+        pCuller->pendingCandidates[i] = UINT32_MAX;
+        createCullerBuffer(pCuller, sizeof(uint32_t) * stride * (VkDeviceSize)instanceCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, MEMORY_USAGE_GPU_ONLY, &pCuller->outputBuffers[i], &pCuller->outputMemory[i], &memoryType);
+    }
+
+    VkSamplerCreateInfo samplerInfo = {//Only read with texelFetch, which ignores filtering
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = VK_FILTER_NEAREST,
+        .minFilter = VK_FILTER_NEAREST,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .anisotropyEnable = VK_FALSE,
+        .maxAnisotropy = 1.0f,
+        .minLod = 0.0f,
+        .maxLod = 1000.0f
+    };
+
+    if(vkCreateSampler(device, &samplerInfo, NULL, &pCuller->sampler) != VK_SUCCESS)
+    {
+        printf("Failed to create depth pyramid sampler!\n");
+        exit(1);
+    }
+
+    createDescriptors(pCuller, boundsBuffer, inputBuffers);
+    createPipelines(pCuller);
+}
+
+static void destroyPyramid(VkDevice device, void *pData)
+{
+    HiZPyramid *pPyramid = pData;
+    vkDestroyDescriptorPool(device, pPyramid->descriptorPool, NULL);
+    for(uint32_t level = 0; level < pPyramid->levelCount; level++)
+    {
+        vkDestroyImageView(device, pPyramid->levelViews[level], NULL);
+    }
+    vkDestroyImageView(device, pPyramid->view, NULL);
+    vkDestroyImage(device, pPyramid->image, NULL);
+    vkFreeMemory(device, pPyramid->memory, NULL);
+    free(pPyramid);
+}
+
+static uint32_t previousPowerOfTwo(uint32_t value)
+{
+    uint32_t result = 1;
+    while(result <= value / 2)
+    {
+        result *= 2;
+    }
+    return result;
+}
+
+static VkImageView createPyramidView(VkDevice device, VkImage image, uint32_t baseLevel, uint32_t levelCount)
+{
+    VkImageViewCreateInfo viewInfo = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = VK_FORMAT_R32_SFLOAT,
+        .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, baseLevel, levelCount, 0, 1}
+    };
+
+    VkImageView view;
+    if(vkCreateImageView(device, &viewInfo, NULL, &view) != VK_SUCCESS)
+    {
+        printf("Failed to create depth pyramid view!\n");
+        exit(1);
+    }
+    return view;
+}
+
+static HiZPyramid *createPyramid(OcclusionCuller *pCuller, VkImageView depthView, uint32_t width, uint32_t height)//Each texel holds the farthest depth under it, so anything behind it is hidden
+{
+    VkDevice device = pCuller->device;
+    HiZPyramid *pPyramid = allocOrExit(sizeof(HiZPyramid));
+    memset(pPyramid, 0, sizeof(HiZPyramid));
+    pPyramid->width = previousPowerOfTwo(width);//Every level then halves exactly, level 0 texels cover at most 3x3 depth texels
+    pPyramid->height = previousPowerOfTwo(height);
+    uint32_t largest = pPyramid->width > pPyramid->height ? pPyramid->width : pPyramid->height;
+    while(pPyramid->levelCount < HIZ_MAX_LEVELS && (1u << pPyramid->levelCount) <= largest)
+    {
+        pPyramid->levelCount++;
+    }
+
+    VkImageCreateInfo imageInfo = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = VK_FORMAT_R32_SFLOAT,
+        .extent = {pPyramid->width, pPyramid->height, 1},
+        .mipLevels = pPyramid->levelCount,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+    };
+
+    if(vkCreateImage(device, &imageInfo, NULL, &pPyramid->image) != VK_SUCCESS)
+    {
+        printf("Failed to create depth pyramid!\n");
+        exit(1);
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(device, pPyramid->image, &requirements);
+    uint32_t memoryType;
+    if(memoryPolicyAllocate(pCuller->pMemoryPolicy, device, &requirements, MEMORY_USAGE_GPU_ONLY, &pPyramid->memory, &memoryType) != VK_SUCCESS)
+    {
+        printf("Failed to allocate depth pyramid memory!\n");
+        exit(1);
+    }
+    vkBindImageMemory(device, pPyramid->image, pPyramid->memory, 0);
+
+    pPyramid->view = createPyramidView(device, pPyramid->image, 0, pPyramid->levelCount);
+    for(uint32_t level = 0; level < pPyramid->levelCount; level++)
+    {
+        pPyramid->levelViews[level] = createPyramidView(device, pPyramid->image, level, 1);
+    }
+
+    VkDescriptorPoolSize poolSizes[2] = {
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, pPyramid->levelCount + 1},
+        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2 * pPyramid->levelCount}
+    };
+
+    VkDescriptorPoolCreateInfo poolInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .maxSets = pPyramid->levelCount + 1,
+        .poolSizeCount = 2,
+        .pPoolSizes = poolSizes
+    };
+
+    if(vkCreateDescriptorPool(device, &poolInfo, NULL, &pPyramid->descriptorPool) != VK_SUCCESS)
+    {
+        printf("Failed to create depth pyramid descriptor pool!\n");
+        exit(1);
+    }
+
+    VkDescriptorSetLayout layouts[HIZ_MAX_LEVELS];
+    for(uint32_t level = 0; level < pPyramid->levelCount; level++)
+    {
+        layouts[level] = pCuller->reduceSetLayout;
+    }
+    VkDescriptorSetAllocateInfo allocInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = pPyramid->descriptorPool,
+        .descriptorSetCount = pPyramid->levelCount,
+        .pSetLayouts = layouts
+    };
+    VkDescriptorSetAllocateInfo testAllocInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = pPyramid->descriptorPool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &pCuller->testSetLayout
+    };
+
+    if(vkAllocateDescriptorSets(device, &allocInfo, pPyramid->reduceSets) != VK_SUCCESS || vkAllocateDescriptorSets(device, &testAllocInfo, &pPyramid->testSet) != VK_SUCCESS)
+    {
+        printf("Failed to allocate depth pyramid descriptor sets!\n");
+        exit(1);
+    }
+
+    VkDescriptorImageInfo depthInfo = {pCuller->sampler, depthView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+    for(uint32_t level = 0; level < pPyramid->levelCount; level++)
+    {
+        VkDescriptorImageInfo sourceInfo = {VK_NULL_HANDLE, pPyramid->levelViews[level ? level - 1 : 0], VK_IMAGE_LAYOUT_GENERAL};//Level 0 never reads it, but the binding must be valid
+        VkDescriptorImageInfo destinationInfo = {VK_NULL_HANDLE, pPyramid->levelViews[level], VK_IMAGE_LAYOUT_GENERAL};
+        VkWriteDescriptorSet writes[3] = {
+            {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = pPyramid->reduceSets[level], .dstBinding = 0, .descriptorCount = 1, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .pImageInfo = &depthInfo},
+            {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = pPyramid->reduceSets[level], .dstBinding = 1, .descriptorCount = 1, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .pImageInfo = &sourceInfo},
+            {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = pPyramid->reduceSets[level], .dstBinding = 2, .descriptorCount = 1, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .pImageInfo = &destinationInfo}
+        };
+        vkUpdateDescriptorSets(device, 3, writes, 0, NULL);
+    }
+
+    VkDescriptorImageInfo pyramidInfo = {pCuller->sampler, pPyramid->view, VK_IMAGE_LAYOUT_GENERAL};
+    VkWriteDescriptorSet testWrite = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = pPyramid->testSet,
+        .dstBinding = 0,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .pImageInfo = &pyramidInfo
+    };
+    vkUpdateDescriptorSets(device, 1, &testWrite, 0, NULL);
+
+    return pPyramid;
+}
+
+void occlusionCullerResize(OcclusionCuller *pCuller, VkImageView depthView, uint32_t width, uint32_t height, uint64_t retireValue)//After the depth buffer is created or recreated, frames up to retireValue keep the old pyramid
+{
+    if(pCuller->pPyramid != NULL)
+    {
+        deleteLater(pCuller->pDeletionQueue, destroyPyramid, pCuller->pPyramid, retireValue);
+    }
+    pCuller->pPyramid = createPyramid(pCuller, depthView, width, height);
+}
+
+uint32_t *occlusionCullerCandidates(OcclusionCuller *pCuller, uint32_t frameSlot)//Written by the CPU, input record i belongs to dense entity candidates[i] & mask and is drawn at level candidates[i] >> OCCLUSION_LOD_SHIFT
+{
+    return pCuller->candidateMapped[frameSlot];
+}
+
+OcclusionDraws *occlusionCullerBeginFrame(OcclusionCuller *pCuller, uint32_t frameSlot)//Once the slot's fence has signalled, collects what its last frame drew and hands its draws to the CPU to fill in
+{
+    OcclusionDraws *pDraws = pCuller->drawMapped[frameSlot];
+    uint32_t candidates = pCuller->pendingCandidates[frameSlot];
+    if(candidates != UINT32_MAX)
+    {
+        memoryPolicyInvalidate(pCuller->pMemoryPolicy, pCuller->device, pCuller->drawMemory[frameSlot], pCuller->dynamicMemoryType, 0, VK_WHOLE_SIZE, VK_WHOLE_SIZE);
+        uint32_t drawn[OCCLUSION_PHASE_COUNT] = {0, 0};
+        for(uint32_t phase = 0; phase < OCCLUSION_PHASE_COUNT; phase++)
+        {
+            for(uint32_t lod = 0; lod < MAX_MESH_LODS; lod++)
+            {
+                drawn[phase] += pDraws->draws[phase][lod].instanceCount;
+            }
+        }
+        pCuller->candidates += candidates;
+        pCuller->earlyInstances += drawn[OCCLUSION_PHASE_EARLY];
+        pCuller->lateInstances += drawn[OCCLUSION_PHASE_LATE];
+        pCuller->lastOccluded = candidates - drawn[OCCLUSION_PHASE_EARLY] - drawn[OCCLUSION_PHASE_LATE];
+        pCuller->pendingCandidates[frameSlot] = UINT32_MAX;
+    }
+    return pDraws;
+}
+
+static void computeBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+    VkMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = srcAccess,
+        .dstAccessMask = dstAccess
+    };
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 1, &barrier, 0, NULL, 0, NULL);
+}
+
+static void pyramidBarrier(VkCommandBuffer commandBuffer, HiZPyramid *pPyramid, VkImageLayout oldLayout, VkAccessFlags dstAccess)//Every level, after the compute reads of the previous frame
+{
+    VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = 0,
+        .dstAccessMask = dstAccess,
+        .oldLayout = oldLayout,
+        .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = pPyramid->image,
+        .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, pPyramid->levelCount, 0, 1}
+    };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+}
+
+static void dispatchPhase(OcclusionCuller *pCuller, VkCommandBuffer commandBuffer, uint32_t frameSlot, uint32_t phase, uint32_t candidateCount, float view[4][4], float projection[4][4])
+{
+    OcclusionConstants constants = {
+        .projection = {projection[0][0], projection[1][1], projection[2][2], projection[2][3]},
+        .near = -projection[2][3] / projection[2][2],//perspectiveMatrix maps view depth z to A + B / z, B / A is minus the near plane
+        .candidateCount = candidateCount,
+        .stride = pCuller->stride
+    };
+    memcpy(constants.view, view, sizeof(constants.view));
+
+    VkDescriptorSet sets[2] = {pCuller->cullSets[frameSlot], pCuller->pPyramid->testSet};
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pCuller->cullPipelines[phase]);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pCuller->cullLayout, 0, 2, sets, 0, NULL);
+    vkCmdPushConstants(commandBuffer, pCuller->cullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    vkCmdDispatch(commandBuffer, (candidateCount + OCCLUSION_WORKGROUP_SIZE - 1) / OCCLUSION_WORKGROUP_SIZE, 1, 1);
+}
+
+void occlusionCullerEarly(OcclusionCuller *pCuller, VkCommandBuffer commandBuffer, uint32_t frameSlot, uint32_t candidateCount, float view[4][4], float projection[4][4])//Outside the render pass, before the early pass. Draws the candidates that were visible last frame, the draws wait on the compute writes to the output and draw buffers themselves
+{
+    memoryPolicyFlush(pCuller->pMemoryPolicy, pCuller->device, pCuller->candidateMemory[frameSlot], pCuller->dynamicMemoryType, 0, VK_WHOLE_SIZE, VK_WHOLE_SIZE);
+    memoryPolicyFlush(pCuller->pMemoryPolicy, pCuller->device, pCuller->drawMemory[frameSlot], pCuller->dynamicMemoryType, 0, VK_WHOLE_SIZE, VK_WHOLE_SIZE);
+
+    if(!pCuller->initialised)//Nothing was visible before the first frame, so it draws everything in the late phase
+    {
+        vkCmdFillBuffer(commandBuffer, pCuller->visibilityBuffer, 0, VK_WHOLE_SIZE, 0);
+        computeBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+        pCuller->initialised = 1;
+    }
+    if(!pCuller->pPyramid->initialised)//Bound but not read by the early phase, it still has to be in the layout its descriptor names
+    {
+        pyramidBarrier(commandBuffer, pCuller->pPyramid, VK_IMAGE_LAYOUT_UNDEFINED, VK_ACCESS_SHADER_READ_BIT);
+        pCuller->pPyramid->initialised = 1;
+    }
+
+    //The previous frame's late phase wrote the visibility read here
+    computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    dispatchPhase(pCuller, commandBuffer, frameSlot, OCCLUSION_PHASE_EARLY, candidateCount, view, projection);
+
+    pCuller->pendingCandidates[frameSlot] = candidateCount;
+}
+
+void occlusionCullerLate(OcclusionCuller *pCuller, VkCommandBuffer commandBuffer, uint32_t frameSlot, uint32_t candidateCount, float view[4][4], float projection[4][4], VkExtent2D depthExtent)//Between the passes, once the early pass depth writes are visible to compute in a read only layout. Builds the pyramid from its depth, tests every candidate and draws the ones that just became visible
+{
+    HiZPyramid *pPyramid = pCuller->pPyramid;
+    pyramidBarrier(commandBuffer, pPyramid, VK_IMAGE_LAYOUT_UNDEFINED, VK_ACCESS_SHADER_WRITE_BIT);//Last frame's pyramid is not needed
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pCuller->reducePipeline);
+    for(uint32_t level = 0; level < pPyramid->levelCount; level++)
+    {
+        uint32_t width = pPyramid->width >> level ? pPyramid->width >> level : 1;
+        uint32_t height = pPyramid->height >> level ? pPyramid->height >> level : 1;
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pCuller->reduceLayout, 0, 1, &pPyramid->reduceSets[level], 0, NULL);
+        HiZConstants constants = {level, depthExtent.width, depthExtent.height};
+        vkCmdPushConstants(commandBuffer, pCuller->reduceLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+        vkCmdDispatch(commandBuffer, (width + HIZ_WORKGROUP_SIZE - 1) / HIZ_WORKGROUP_SIZE, (height + HIZ_WORKGROUP_SIZE - 1) / HIZ_WORKGROUP_SIZE, 1);
+        computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    }
+
+    dispatchPhase(pCuller, commandBuffer, frameSlot, OCCLUSION_PHASE_LATE, candidateCount, view, projection);
+}
+
+void printOcclusionCuller(OcclusionCuller *pCuller)
+{
+    printf("Occlusion culling: %llu candidates, %llu drawn early, %llu drawn late, %llu occluded, %u occluded in the last frame read back\n",
+           (unsigned long long)pCuller->candidates, (unsigned long long)pCuller->earlyInstances, (unsigned long long)pCuller->lateInstances,
+           (unsigned long long)(pCuller->candidates - pCuller->earlyInstances - pCuller->lateInstances), pCuller->lastOccluded);
+}
+
+void destroyOcclusionCuller(OcclusionCuller *pCuller)//Only once the device is idle and the deletion queue has been flushed
+{
+    VkDevice device = pCuller->device;
+    destroyPyramid(device, pCuller->pPyramid);
+    vkDestroySampler(device, pCuller->sampler, NULL);
+    vkDestroyPipeline(device, pCuller->reducePipeline, NULL);
+    vkDestroyPipelineLayout(device, pCuller->reduceLayout, NULL);
+    for(uint32_t i = 0; i < OCCLUSION_PHASE_COUNT; i++)
+    {
+        vkDestroyPipeline(device, pCuller->cullPipelines[i], NULL);
+    }
+    vkDestroyPipelineLayout(device, pCuller->cullLayout, NULL);
+    vkDestroyDescriptorPool(device, pCuller->descriptorPool, NULL);
+    vkDestroyDescriptorSetLayout(device, pCuller->cullSetLayout, NULL);
+    vkDestroyDescriptorSetLayout(device, pCuller->testSetLayout, NULL);
+    vkDestroyDescriptorSetLayout(device, pCuller->reduceSetLayout, NULL);
+    free(pCuller->cullSets);
+
+    for(uint32_t i = 0; i < pCuller->frameCount; i++)
+    {
+        vkDestroyBuffer(device, pCuller->candidateBuffers[i], NULL);
+        vkFreeMemory(device, pCuller->candidateMemory[i], NULL);
+        vkDestroyBuffer(device, pCuller->drawBuffers[i], NULL);
+        vkFreeMemory(device, pCuller->drawMemory[i], NULL);
+        vkDestroyBuffer(device, pCuller->outputBuffers[i], NULL);
+        vkFreeMemory(device, pCuller->outputMemory[i], NULL);
+    }
+    free(pCuller->candidateBuffers);
+    free(pCuller->candidateMemory);
+    free(pCuller->candidateMapped);
+    free(pCuller->drawBuffers);
+    free(pCuller->drawMemory);
+    free(pCuller->drawMapped);
+    free(pCuller->pendingCandidates);
+    free(pCuller->outputBuffers);
+    free(pCuller->outputMemory);
+
+    vkDestroyBuffer(device, pCuller->visibilityBuffer, NULL);
+    vkFreeMemory(device, pCuller->visibilityMemory, NULL);
+}
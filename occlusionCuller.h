@@ -0,0 +1,113 @@
+//
+//  occlusionCuller.h
+//  vkProject
+//
+//  Two-phase occlusion culling against a hierarchical depth pyramid, drawn through indirect draws the compute passes fill in.
+//
+
+#ifndef occlusionCuller_h
+#define occlusionCuller_h
+
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "memoryPolicy.h"
+#include "deletionQueue.h"
+#include "mesh.h"
+
+#define OCCLUSION_WORKGROUP_SIZE 64//local_size_x of shaders/occlusion.comp
+#define HIZ_WORKGROUP_SIZE 8//local_size_x and local_size_y of shaders/hiz.comp
+#define HIZ_MAX_LEVELS 16//Enough for a pyramid 32768 texels wide
+#define OCCLUSION_LOD_SHIFT 24//Candidates hold the level of detail above the dense entity index, ENTITY_INDEX_BITS keeps indices below it
+
+enum occlusionPhase{OCCLUSION_PHASE_EARLY, OCCLUSION_PHASE_LATE, OCCLUSION_PHASE_COUNT};
+
+typedef struct {
+    VkDrawIndexedIndirectCommand draws[OCCLUSION_PHASE_COUNT][MAX_MESH_LODS];//Per level of detail, the CPU fills in everything but the instance counts, late draws start after the early ones
+} OcclusionDraws;
+
+typedef struct {
+    float view[4][4];
+    float projection[4];//x and y scale, then depth = z + w / view depth
+    float near;
+    uint32_t candidateCount;
+    uint32_t stride;//Words per instance record
+} OcclusionConstants;
+
+typedef struct {
+    uint32_t level;//Written by the dispatch
+    uint32_t depthWidth;//Part of the depth buffer rendered this frame, level 0 covers only that
+    uint32_t depthHeight;
+} HiZConstants;
+
+typedef struct {
+    VkImage image;
+    VkDeviceMemory memory;
+    VkImageView view;//Every level, sampled by the occlusion test
+    VkImageView levelViews[HIZ_MAX_LEVELS];//Written by the reduction
+    uint32_t width;//Level 0, the depth buffer rounded down to powers of two
+    uint32_t height;
+    uint32_t levelCount;
+    VkDescriptorPool descriptorPool;
+    VkDescriptorSet reduceSets[HIZ_MAX_LEVELS];//Level 0 reads the depth buffer, every other level the one before it
+    VkDescriptorSet testSet;
+    uint32_t initialised;//Still in the undefined layout before its first frame
+} HiZPyramid;
+
+typedef struct {
+    VkDevice device;
+    MemoryPolicy *pMemoryPolicy;
+    DeletionQueue *pDeletionQueue;
+    uint32_t instanceCount;
+    uint32_t stride;
+    uint32_t frameCount;
+    uint32_t initialised;
+
+    VkBuffer visibilityBuffer;//Per dense entity, whether it passed the test the last time it was a candidate
+    VkDeviceMemory visibilityMemory;
+    VkBuffer *candidateBuffers;//Per frame in flight, the entity and level of each input instance record
+    VkDeviceMemory *candidateMemory;
+    uint32_t **candidateMapped;
+    VkBuffer *drawBuffers;//Per frame in flight, OcclusionDraws
+    VkDeviceMemory *drawMemory;
+    OcclusionDraws **drawMapped;
+    uint32_t dynamicMemoryType;
+    uint32_t *pendingCandidates;//Per frame in flight, candidates of the frame whose counts have not been read yet, UINT32_MAX for none
+    VkBuffer *outputBuffers;//Per frame in flight, the instance records of both phases, bound as the instance buffer
+    VkDeviceMemory *outputMemory;
+
+    VkSampler sampler;
+    HiZPyramid *pPyramid;//Replaced on resize, the old one goes through the deletion queue
+
+    VkDescriptorSetLayout cullSetLayout;
+    VkDescriptorSetLayout testSetLayout;
+    VkDescriptorSetLayout reduceSetLayout;
+    VkDescriptorPool descriptorPool;
+    VkDescriptorSet *cullSets;//Per frame in flight, bindings are the bounds, visibility, candidates, input, output and draws
+    VkPipelineLayout cullLayout;
+    VkPipeline cullPipelines[OCCLUSION_PHASE_COUNT];//One source, the phase is a specialisation constant
+    VkPipelineLayout reduceLayout;
+    VkPipeline reducePipeline;
+
+    uint64_t candidates;//Totals over the frames read back
+    uint64_t earlyInstances;
+    uint64_t lateInstances;
+    uint32_t lastOccluded;
+} OcclusionCuller;
+
+void createOcclusionCuller(OcclusionCuller *pCuller, VkDevice device, MemoryPolicy *pMemoryPolicy, DeletionQueue *pDeletionQueue, VkBuffer boundsBuffer, const VkBuffer *inputBuffers, uint32_t instanceCount, uint32_t stride, uint32_t frameCount);
+
+void occlusionCullerResize(OcclusionCuller *pCuller, VkImageView depthView, uint32_t width, uint32_t height, uint64_t retireValue);
+
+uint32_t *occlusionCullerCandidates(OcclusionCuller *pCuller, uint32_t frameSlot);
+
+OcclusionDraws *occlusionCullerBeginFrame(OcclusionCuller *pCuller, uint32_t frameSlot);
+
+void occlusionCullerEarly(OcclusionCuller *pCuller, VkCommandBuffer commandBuffer, uint32_t frameSlot, uint32_t candidateCount, float view[4][4], float projection[4][4]);
+
+void occlusionCullerLate(OcclusionCuller *pCuller, VkCommandBuffer commandBuffer, uint32_t frameSlot, uint32_t candidateCount, float view[4][4], float projection[4][4], VkExtent2D depthExtent);
+
+void printOcclusionCuller(OcclusionCuller *pCuller);
+
+void destroyOcclusionCuller(OcclusionCuller *pCuller);
+
+#endif /* occlusionCuller_h */
@@ -0,0 +1,496 @@
+//
+//  particleSystem.c
+//  vkProject
+//
+//  GPU particles emitted, simulated and compacted by compute shaders and drawn with an indirect draw.
+//
+
+#include "particleSystem.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "utils.h"
+
+static void *allocOrExit(size_t size)
+{
+    void *pMemory = malloc(size ? size : 1);
+    if(pMemory == NULL)
+    {
+        printf("Failed to allocate particle system!\n");
+        exit(1);
+    }
+    return pMemory;
+}
+
+static VkShaderModule loadShader(VkDevice device, const char *fileName)
+{
+    char *binary;
+    size_t codeSize = readFile(fileName, &binary);
+
+    VkShaderModuleCreateInfo createInfo = {
+        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        .codeSize = codeSize,
+        .pCode = (uint32_t *)binary
+    };
+
+    VkShaderModule shaderModule;
+    if(vkCreateShaderModule(device, &createInfo, NULL, &shaderModule) != VK_SUCCESS)
+    {
+        printf("Failed to create particle shader module!\n");
+        exit(1);
+    }
+    free(binary);
+    return shaderModule;
+}
+
+static void createParticleBuffer(ParticleSystem *pParticles, VkDeviceSize size, VkBufferUsageFlags usage, uint32_t memoryUsage, VkBuffer *pBuffer, VkDeviceMemory *pMemory, uint32_t *pMemoryType)
+{
+    VkBufferCreateInfo bufferInfo = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = size,
+        .usage = usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE
+    };
+
+    if(vkCreateBuffer(pParticles->device, &bufferInfo, NULL, pBuffer) != VK_SUCCESS)
+    {
+        printf("Failed to create particle buffer!\n");
+        exit(1);
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(pParticles->device, *pBuffer, &requirements);
+    if(memoryPolicyAllocate(pParticles->pMemoryPolicy, pParticles->device, &requirements, memoryUsage, pMemory, pMemoryType) != VK_SUCCESS)
+    {
+        printf("Failed to allocate particle memory!\n");
+        exit(1);
+    }
+    vkBindBufferMemory(pParticles->device, *pBuffer, *pMemory, 0);
+}
+
+static void createDescriptors(ParticleSystem *pParticles)
+{
+    VkDescriptorSetLayoutBinding bindings[3];
+    for(uint32_t i = 0; i < 3; i++)
+    {
+        bindings[i] = (VkDescriptorSetLayoutBinding){
+            .binding = i,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT
+        };
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = 3,
+        .pBindings = bindings
+    };
+
+    if(vkCreateDescriptorSetLayout(pParticles->device, &layoutInfo, NULL, &pParticles->setLayout) != VK_SUCCESS)
+    {
+        printf("Failed to create particle descriptor set layout!\n");
+        exit(1);
+    }
+
+    VkDescriptorPoolSize poolSize = {
+        .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .descriptorCount = 6
+    };
+
+    VkDescriptorPoolCreateInfo poolInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .maxSets = 2,
+        .poolSizeCount = 1,
+        .pPoolSizes = &poolSize
+    };
+
+    if(vkCreateDescriptorPool(pParticles->device, &poolInfo, NULL, &pParticles->descriptorPool) != VK_SUCCESS)
+    {
+        printf("Failed to create particle descriptor pool!\n");
+        exit(1);
+    }
+
+    VkDescriptorSetLayout layouts[2] = {pParticles->setLayout, pParticles->setLayout};
+    VkDescriptorSetAllocateInfo allocInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = pParticles->descriptorPool,
+        .descriptorSetCount = 2,
+        .pSetLayouts = layouts
+    };
+
+    if(vkAllocateDescriptorSets(pParticles->device, &allocInfo, pParticles->sets) != VK_SUCCESS)
+    {
+        printf("Failed to allocate particle descriptor sets!\n");
+        exit(1);
+    }
+
+    for(uint32_t parity = 0; parity < 2; parity++)
+    {
+        VkDescriptorBufferInfo bufferInfos[3] = {
+            {pParticles->particleBuffers[parity], 0, VK_WHOLE_SIZE},
+            {pParticles->particleBuffers[parity ^ 1], 0, VK_WHOLE_SIZE},
+            {pParticles->counterBuffer, 0, VK_WHOLE_SIZE}
+        };
+        VkWriteDescriptorSet writes[3];
+        for(uint32_t i = 0; i < 3; i++)
+        {
+            writes[i] = (VkWriteDescriptorSet){
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = pParticles->sets[parity],
+                .dstBinding = i,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pBufferInfo = &bufferInfos[i]
+            };
+        }
+        vkUpdateDescriptorSets(pParticles->device, 3, writes, 0, NULL);
+    }
+}
+
+static void createComputePipelines(ParticleSystem *pParticles)
+{
+    VkPushConstantRange pushConstantRange = {
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .offset = 0,
+        .size = sizeof(ParticleComputeConstants)
+    };
+
+    VkPipelineLayoutCreateInfo layoutInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &pParticles->setLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstantRange
+    };
+
+    if(vkCreatePipelineLayout(pParticles->device, &layoutInfo, NULL, &pParticles->computeLayout) != VK_SUCCESS)
+    {
+        printf("Failed to create particle compute pipeline layout!\n");
+        exit(1);
+    }
+
+    VkShaderModule computeModule = loadShader(pParticles->device, "shaders/comp_particle.spv");
+    uint32_t passes[PARTICLE_PASS_COUNT] = {PARTICLE_PASS_SIMULATE, PARTICLE_PASS_EMIT, PARTICLE_PASS_FINALIZE};
+    VkSpecializationMapEntry specializationEntry = {
+        .constantID = 0,//constant_id of particlePass in particle.comp
+        .offset = 0,
+        .size = sizeof(uint32_t)
+    };
+    VkSpecializationInfo specializationInfos[PARTICLE_PASS_COUNT];
+    VkComputePipelineCreateInfo pipelineInfos[PARTICLE_PASS_COUNT];
+    for(uint32_t i = 0; i < PARTICLE_PASS_COUNT; i++)//One source, the pass is a specialisation constant so each pipeline only keeps its own branch
+    {
+        specializationInfos[i] = (VkSpecializationInfo){
+            .mapEntryCount = 1,
+            .pMapEntries = &specializationEntry,
+            .dataSize = sizeof(uint32_t),
+            .pData = &passes[i]
+        };
+        pipelineInfos[i] = (VkComputePipelineCreateInfo){
+            .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+            .stage = {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+                .module = computeModule,
+                .pName = "main",
+                .pSpecializationInfo = &specializationInfos[i]
+            },
+            .layout = pParticles->computeLayout,
+            .basePipelineIndex = -1
+        };
+    }
+
+    if(vkCreateComputePipelines(pParticles->device, VK_NULL_HANDLE, PARTICLE_PASS_COUNT, pipelineInfos, NULL, pParticles->computePipelines) != VK_SUCCESS)
+    {
+        printf("Failed to create particle compute pipelines!\n");
+        exit(1);
+    }
+    vkDestroyShaderModule(pParticles->device, computeModule, NULL);
+}
+
+static void createDrawPipeline(ParticleSystem *pParticles, VkRenderPass renderPass)//Camera facing quads expanded from the particle buffer, no vertex input
+{
+    VkShaderModule vertexModule = loadShader(pParticles->device, "shaders/vert_particle.spv");
+    VkShaderModule fragmentModule = loadShader(pParticles->device, "shaders/frag_particle.spv");
+
+    VkPipelineShaderStageCreateInfo shaderStages[2] = {
+        {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_VERTEX_BIT,
+            .module = vertexModule,
+            .pName = "main"
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .module = fragmentModule,
+            .pName = "main"
+        }
+    };
+
+    VkDynamicState dynamicStates[2] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .dynamicStateCount = 2,
+        .pDynamicStates = dynamicStates
+    };
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO
+    };
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST
+    };
+
+    VkPipelineViewportStateCreateInfo viewportState = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .viewportCount = 1,
+        .scissorCount = 1
+    };
+
+    VkPipelineRasterizationStateCreateInfo rasterizer = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .polygonMode = VK_POLYGON_MODE_FILL,
+        .lineWidth = 1.0f,
+        .cullMode = VK_CULL_MODE_NONE,
+        .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE
+    };
+
+    VkPipelineMultisampleStateCreateInfo multisampling = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+        .minSampleShading = 1.0f
+    };
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment = {
+        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+        .blendEnable = VK_FALSE
+    };
+
+    VkPipelineColorBlendStateCreateInfo colorBlending = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .attachmentCount = 1,
+        .pAttachments = &colorBlendAttachment
+    };
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+        .depthTestEnable = VK_TRUE,
+        .depthWriteEnable = VK_TRUE,//Opaque discs, no sorting needed
+        .depthCompareOp = VK_COMPARE_OP_LESS
+    };
+
+    VkPushConstantRange pushConstantRange = {
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+        .offset = 0,
+        .size = sizeof(ParticleDrawConstants)//Exactly the guaranteed minimum of 128 bytes
+    };
+
+    VkPipelineLayoutCreateInfo layoutInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &pParticles->setLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstantRange
+    };
+
+    if(vkCreatePipelineLayout(pParticles->device, &layoutInfo, NULL, &pParticles->drawLayout) != VK_SUCCESS)
+    {
+        printf("Failed to create particle pipeline layout!\n");
+        exit(1);
+    }
+
+    VkGraphicsPipelineCreateInfo pipelineInfo = {
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .stageCount = 2,
+        .pStages = shaderStages,
+        .pVertexInputState = &vertexInputInfo,
+        .pInputAssemblyState = &inputAssembly,
+        .pViewportState = &viewportState,
+        .pRasterizationState = &rasterizer,
+        .pMultisampleState = &multisampling,
+        .pDepthStencilState = &depthStencil,
+        .pColorBlendState = &colorBlending,
+        .pDynamicState = &dynamicState,
+        .layout = pParticles->drawLayout,
+        .renderPass = renderPass,
+        .subpass = 0,
+        .basePipelineIndex = -1
+    };
+
+    if(vkCreateGraphicsPipelines(pParticles->device, VK_NULL_HANDLE, 1, &pipelineInfo, NULL, &pParticles->drawPipeline) != VK_SUCCESS)
+    {
+        printf("Failed to create particle pipeline!\n");
+        exit(1);
+    }
+
+    vkDestroyShaderModule(pParticles->device, vertexModule, NULL);
+    vkDestroyShaderModule(pParticles->device, fragmentModule, NULL);
+}
+
+void createParticleSystem(ParticleSystem *pParticles, VkDevice device, MemoryPolicy *pMemoryPolicy, VkRenderPass renderPass, uint32_t maxParticles, uint32_t frameCount)
+{
+    memset(pParticles, 0, sizeof(ParticleSystem));
+    pParticles->device = device;
+    pParticles->pMemoryPolicy = pMemoryPolicy;
+    pParticles->maxParticles = maxParticles;
+    pParticles->emitRate = maxParticles / PARTICLE_LIFETIME;//Emitted particles live between half and all of the lifetime, so the pool settles below its capacity
+    pParticles->frameCount = frameCount;
+
+    uint32_t memoryType;
+    for(uint32_t i = 0; i < 2; i++)
+    {
+        createParticleBuffer(pParticles, sizeof(Particle) * (VkDeviceSize)maxParticles, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, MEMORY_USAGE_GPU_ONLY, &pParticles->particleBuffers[i], &pParticles->particleMemory[i], &memoryType);
+    }
+    createParticleBuffer(pParticles, sizeof(ParticleCounters), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                         MEMORY_USAGE_GPU_ONLY, &pParticles->counterBuffer, &pParticles->counterMemory, &memoryType);
+
+    pParticles->readbackBuffers = allocOrExit(sizeof(VkBuffer) * frameCount);
+    pParticles->readbackMemory = allocOrExit(sizeof(VkDeviceMemory) * frameCount);
+    pParticles->readbackMapped = allocOrExit(sizeof(void *) * frameCount);
+    pParticles->readbackPending = allocOrExit(sizeof(uint32_t) * frameCount);
+    memset(pParticles->readbackPending, 0, sizeof(uint32_t) * frameCount);
+    for(uint32_t i = 0; i < frameCount; i++)
+    {
+        createParticleBuffer(pParticles, sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_DST_BIT, MEMORY_USAGE_READBACK, &pParticles->readbackBuffers[i], &pParticles->readbackMemory[i], &pParticles->readbackMemoryType);
+        vkMapMemory(device, pParticles->readbackMemory[i], 0, VK_WHOLE_SIZE, 0, &pParticles->readbackMapped[i]);
+    }
+
+    createDescriptors(pParticles);
+    createComputePipelines(pParticles);
+    createDrawPipeline(pParticles, renderPass);
+}
+
+static void computeBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+    VkMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = srcAccess,
+        .dstAccessMask = dstAccess
+    };
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 1, &barrier, 0, NULL, 0, NULL);
+}
+
+void particleSystemDispatch(ParticleSystem *pParticles, VkCommandBuffer commandBuffer, uint32_t frameSlot, float deltaTime)//Outside the render pass, once the frame slot's fence has signalled. The CPU only picks the emission count
+{
+    if(pParticles->readbackPending[frameSlot])
+    {
+        memoryPolicyInvalidate(pParticles->pMemoryPolicy, pParticles->device, pParticles->readbackMemory[frameSlot], pParticles->readbackMemoryType, 0, VK_WHOLE_SIZE, VK_WHOLE_SIZE);
+        pParticles->lastAlive = *(uint32_t *)pParticles->readbackMapped[frameSlot];
+        pParticles->simulated += pParticles->lastAlive;
+    }
+
+    if(!pParticles->initialised)
+    {
+        ParticleCounters counters = {
+            .alive = {0, 0},
+            .simulate = {0, 1, 1},
+            .draw = {6, 0, 0, 0}
+        };
+        vkCmdUpdateBuffer(commandBuffer, pParticles->counterBuffer, 0, sizeof(counters), &counters);
+        computeBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                       VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+        pParticles->initialised = 1;
+    }
+
+    //Last frame's draw read the buffer this frame writes, and its finalize wrote the counters read here
+    computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                   VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    float step = deltaTime < 0.0f ? 0.0f : (deltaTime > PARTICLE_MAX_STEP ? PARTICLE_MAX_STEP : deltaTime);
+    pParticles->emitRemainder += pParticles->emitRate * step;
+    uint32_t emitCount = pParticles->emitRemainder < pParticles->maxParticles ? (uint32_t)pParticles->emitRemainder : pParticles->maxParticles;
+    pParticles->emitRemainder -= emitCount;
+
+    ParticleComputeConstants constants = {
+        .deltaTime = step,
+        .lifetime = PARTICLE_LIFETIME,
+        .emitCount = emitCount,
+        .maxParticles = pParticles->maxParticles,
+        .seed = pParticles->frame,
+        .parity = pParticles->parity
+    };
+
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pParticles->computeLayout, 0, 1, &pParticles->sets[pParticles->parity], 0, NULL);
+    vkCmdPushConstants(commandBuffer, pParticles->computeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pParticles->computePipelines[PARTICLE_PASS_SIMULATE]);
+    vkCmdDispatchIndirect(commandBuffer, pParticles->counterBuffer, offsetof(ParticleCounters, simulate));//Sized by last frame's finalize, never read back
+
+    if(emitCount > 0)//Appends after the survivors through the same counter
+    {
+        computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pParticles->computePipelines[PARTICLE_PASS_EMIT]);
+        vkCmdDispatch(commandBuffer, (emitCount + PARTICLE_WORKGROUP_SIZE - 1) / PARTICLE_WORKGROUP_SIZE, 1, 1);
+    }
+
+    computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pParticles->computePipelines[PARTICLE_PASS_FINALIZE]);
+    vkCmdDispatch(commandBuffer, 1, 1, 1);
+
+    computeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);//The draw waits on the compute writes itself
+
+    VkBufferCopy copyRegion = {
+        .srcOffset = offsetof(ParticleCounters, draw.instanceCount),
+        .dstOffset = 0,
+        .size = sizeof(uint32_t)
+    };
+    vkCmdCopyBuffer(commandBuffer, pParticles->counterBuffer, pParticles->readbackBuffers[frameSlot], 1, &copyRegion);
+    computeBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+    pParticles->readbackPending[frameSlot] = 1;
+
+    pParticles->emitted += emitCount;
+    pParticles->parity ^= 1;
+    pParticles->frame++;
+}
+
+void particleSystemDraw(ParticleSystem *pParticles, VkCommandBuffer commandBuffer, const ParticleDrawConstants *pCamera)//Inside the render pass, after particleSystemDispatch and a barrier from its compute writes to the indirect and vertex shader reads
+{
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pParticles->drawPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pParticles->drawLayout, 0, 1, &pParticles->sets[pParticles->parity ^ 1], 0, NULL);//Set of the dispatch, its destination holds this frame's particles
+    vkCmdPushConstants(commandBuffer, pParticles->drawLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ParticleDrawConstants), pCamera);
+    vkCmdDrawIndirect(commandBuffer, pParticles->counterBuffer, offsetof(ParticleCounters, draw), 1, sizeof(VkDrawIndirectCommand));
+}
+
+void printParticleSystem(ParticleSystem *pParticles)
+{
+    printf("Particles: %u capacity, %u live at the last read back, %llu emitted, %llu particle updates\n",
+           pParticles->maxParticles, pParticles->lastAlive, (unsigned long long)pParticles->emitted, (unsigned long long)pParticles->simulated);
+}
+
+void destroyParticleSystem(ParticleSystem *pParticles)//Only once the device is idle
+{
+    VkDevice device = pParticles->device;
+    vkDestroyPipeline(device, pParticles->drawPipeline, NULL);
+    vkDestroyPipelineLayout(device, pParticles->drawLayout, NULL);
+    for(uint32_t i = 0; i < PARTICLE_PASS_COUNT; i++)
+    {
+        vkDestroyPipeline(device, pParticles->computePipelines[i], NULL);
+    }
+    vkDestroyPipelineLayout(device, pParticles->computeLayout, NULL);
+    vkDestroyDescriptorPool(device, pParticles->descriptorPool, NULL);
+    vkDestroyDescriptorSetLayout(device, pParticles->setLayout, NULL);
+
+    for(uint32_t i = 0; i < pParticles->frameCount; i++)
+    {
+        vkDestroyBuffer(device, pParticles->readbackBuffers[i], NULL);
+        vkFreeMemory(device, pParticles->readbackMemory[i], NULL);
+    }
+    free(pParticles->readbackBuffers);
+    free(pParticles->readbackMemory);
+    free(pParticles->readbackMapped);
+    free(pParticles->readbackPending);
+
+    vkDestroyBuffer(device, pParticles->counterBuffer, NULL);
+    vkFreeMemory(device, pParticles->counterMemory, NULL);
+    for(uint32_t i = 0; i < 2; i++)
+    {
+        vkDestroyBuffer(device, pParticles->particleBuffers[i], NULL);
+        vkFreeMemory(device, pParticles->particleMemory[i], NULL);
+    }
+}
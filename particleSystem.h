@@ -0,0 +1,92 @@
+//
+//  particleSystem.h
+//  vkProject
+//
+//  GPU particles emitted, simulated and compacted by compute shaders and drawn with an indirect draw.
+//
+
+#ifndef particleSystem_h
+#define particleSystem_h
+
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "memoryPolicy.h"
+
+#define PARTICLE_WORKGROUP_SIZE 256//local_size_x of shaders/particle.comp
+#define PARTICLE_LIFETIME 4.0f//Seconds, the emission rate keeps the pool full at this age
+#define PARTICLE_MAX_STEP 0.1f//Longest simulated step, hitches do not fling particles through the floor
+
+enum particlePass{PARTICLE_PASS_SIMULATE, PARTICLE_PASS_EMIT, PARTICLE_PASS_FINALIZE, PARTICLE_PASS_COUNT};
+
+typedef struct {
+    float position[4];//w is the remaining life in seconds
+    float velocity[4];//w is the full life, for fading
+} Particle;
+
+typedef struct {
+    uint32_t alive[2];//Particles in each buffer, the source count is cleared by finalize once it becomes the next destination
+    VkDispatchIndirectCommand simulate;//Covers the live particles of the next frame's source
+    uint32_t padding[3];
+    VkDrawIndirectCommand draw;//One quad per live particle
+} ParticleCounters;
+
+typedef struct {
+    float deltaTime;
+    float lifetime;
+    uint32_t emitCount;
+    uint32_t maxParticles;
+    uint32_t seed;
+    uint32_t parity;//Buffer holding last frame's particles
+} ParticleComputeConstants;
+
+typedef struct {
+    float view[4][4];
+    float projection[4][4];
+} ParticleDrawConstants;
+
+typedef struct {
+    VkDevice device;
+    MemoryPolicy *pMemoryPolicy;
+    uint32_t maxParticles;
+    double emitRate;//Particles per second
+    double emitRemainder;
+    uint32_t parity;
+    uint32_t frame;
+    uint32_t initialised;
+
+    VkBuffer particleBuffers[2];//Ping-ponged, survivors of one are compacted into the other every frame
+    VkDeviceMemory particleMemory[2];
+    VkBuffer counterBuffer;
+    VkDeviceMemory counterMemory;
+
+    uint32_t frameCount;
+    VkBuffer *readbackBuffers;//Live count of each frame in flight, read once its fence has signalled, for statistics only
+    VkDeviceMemory *readbackMemory;
+    void **readbackMapped;
+    uint32_t *readbackPending;
+    uint32_t readbackMemoryType;
+
+    VkDescriptorSetLayout setLayout;
+    VkDescriptorPool descriptorPool;
+    VkDescriptorSet sets[2];//One per parity, binding 0 is the source and 1 the destination
+    VkPipelineLayout computeLayout;
+    VkPipeline computePipelines[PARTICLE_PASS_COUNT];
+    VkPipelineLayout drawLayout;
+    VkPipeline drawPipeline;
+
+    uint64_t emitted;
+    uint64_t simulated;//Sum of the live counts read back so far
+    uint32_t lastAlive;
+} ParticleSystem;
+
+void createParticleSystem(ParticleSystem *pParticles, VkDevice device, MemoryPolicy *pMemoryPolicy, VkRenderPass renderPass, uint32_t maxParticles, uint32_t frameCount);
+
+void particleSystemDispatch(ParticleSystem *pParticles, VkCommandBuffer commandBuffer, uint32_t frameSlot, float deltaTime);
+
+void particleSystemDraw(ParticleSystem *pParticles, VkCommandBuffer commandBuffer, const ParticleDrawConstants *pCamera);
+
+void printParticleSystem(ParticleSystem *pParticles);
+
+void destroyParticleSystem(ParticleSystem *pParticles);
+
+#endif /* particleSystem_h */
@@ -0,0 +1,316 @@
+//
+//  profiler.c
+//  vkProject
+//
+//  Per-stage CPU timers and GPU timestamp queries for each frame.
+//
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "profiler.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+const char *profilerStageNames[PROFILE_STAGE_COUNT] = {
+    "fence_wait", "acquire", "update_uniform", "record", "submit", "present"
+};
+
+uint64_t profilerTimeNs(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);//Wall clock time that is not affected by system time changes, unlike clock() which measures CPU time
+    return (uint64_t)time.tv_sec * 1000000000ull + (uint64_t)time.tv_nsec;
+}
+
+static double nsToMs(uint64_t ns)
+{
+    return (double)ns / 1000000.0;
+}
+
+void createProfiler(Profiler *pProfiler, uint32_t windowSize, uint32_t slotCount)
+{
+    memset(pProfiler, 0, sizeof(Profiler));
+
+    pProfiler->windowSize = windowSize;
+    pProfiler->window = calloc(windowSize, sizeof(FrameTimings));
+    pProfiler->slotCount = slotCount;
+    pProfiler->pending = calloc(slotCount, sizeof(FrameTimings));
+    pProfiler->pendingValid = calloc(slotCount, sizeof(uint32_t));
+
+    if(pProfiler->window == NULL || pProfiler->pending == NULL || pProfiler->pendingValid == NULL)
+    {
+        printf("Failed to allocate profiler!\n");
+        exit(1);
+    }
+}
+
+void profilerInitGpu(Profiler *pProfiler, VkDevice device, float timestampPeriod, uint32_t timestampValidBits)
+{
+    if(timestampValidBits == 0)
+    {
+        printf("Timestamp queries not supported on the graphics queue, GPU timings disabled\n");
+        return;
+    }
+
+    VkQueryPoolCreateInfo queryPoolInfo = {
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount = 2 * pProfiler->slotCount//A begin and end timestamp per frame in flight
+    };
+
+    if(vkCreateQueryPool(device, &queryPoolInfo, NULL, &pProfiler->queryPool) != VK_SUCCESS)
+    {
+        printf("Failed to create timestamp query pool!\n");
+        exit(1);
+    }
+
+    pProfiler->gpuEnabled = 1;
+    pProfiler->timestampPeriod = timestampPeriod;
+    pProfiler->timestampMask = timestampValidBits >= 64 ? ~0ull : (1ull << timestampValidBits) - 1;
+}
+
+void profilerOpenExport(Profiler *pProfiler, const char *fileName)
+{
+    const char *extension = strrchr(fileName, '.');
+    if(extension != NULL && strcmp(extension, ".json") == 0)
+    {
+        pProfiler->exportFormat = PROFILE_EXPORT_JSON;
+    }
+    else
+    {
+        pProfiler->exportFormat = PROFILE_EXPORT_CSV;
+    }
+
+    pProfiler->exportFile = fopen(fileName, "w");
+    if(pProfiler->exportFile == NULL)
+    {
+        printf("Failed to open profile output: %s!\n", fileName);
+        exit(1);
+    }
+
+    if(pProfiler->exportFormat == PROFILE_EXPORT_CSV)
+    {
+        fprintf(pProfiler->exportFile, "frame");
+        for(int i = 0; i < PROFILE_STAGE_COUNT; i++)
+        {
+            fprintf(pProfiler->exportFile, ",%s_ms", profilerStageNames[i]);
+        }
+        fprintf(pProfiler->exportFile, ",cpu_frame_ms,gpu_frame_ms\n");
+    }
+    else
+    {
+        fprintf(pProfiler->exportFile, "[\n");
+    }
+}
+
+void profilerKeepHistory(Profiler *pProfiler, uint32_t capacity)
+{
+    pProfiler->history = malloc(sizeof(FrameTimings) * capacity);
+    if(pProfiler->history == NULL)
+    {
+        printf("Failed to allocate profiler history!\n");
+        exit(1);
+    }
+    pProfiler->historyCapacity = capacity;
+    pProfiler->historyCount = 0;
+}
+
+static void exportFrame(Profiler *pProfiler, FrameTimings *pTimings)
+{
+    FILE *pFile = pProfiler->exportFile;
+
+    if(pProfiler->exportFormat == PROFILE_EXPORT_CSV)
+    {
+        fprintf(pFile, "%llu", (unsigned long long)pTimings->frame);
+        for(int i = 0; i < PROFILE_STAGE_COUNT; i++)
+        {
+            fprintf(pFile, ",%.4f", pTimings->cpuStage[i]);
+        }
+        fprintf(pFile, ",%.4f,%.4f\n", pTimings->cpuFrame, pTimings->gpuFrame);
+    }
+    else
+    {
+        fprintf(pFile, "%s  {\"frame\": %llu", pProfiler->exportedCount ? ",\n" : "", (unsigned long long)pTimings->frame);
+        for(int i = 0; i < PROFILE_STAGE_COUNT; i++)
+        {
+            fprintf(pFile, ", \"%s_ms\": %.4f", profilerStageNames[i], pTimings->cpuStage[i]);
+        }
+        fprintf(pFile, ", \"cpu_frame_ms\": %.4f, \"gpu_frame_ms\": %.4f}", pTimings->cpuFrame, pTimings->gpuFrame);
+    }
+
+    pProfiler->exportedCount++;
+}
+
+static void finishFrame(Profiler *pProfiler, FrameTimings *pTimings)
+{
+    pProfiler->window[pProfiler->windowHead] = *pTimings;
+    pProfiler->windowHead = (pProfiler->windowHead + 1) % pProfiler->windowSize;
+    if(pProfiler->windowCount < pProfiler->windowSize)
+    {
+        pProfiler->windowCount++;
+    }
+
+    if(pProfiler->historyCount < pProfiler->historyCapacity)
+    {
+        pProfiler->history[pProfiler->historyCount++] = *pTimings;
+    }
+
+    if(pProfiler->exportFile != NULL)
+    {
+        exportFrame(pProfiler, pTimings);
+    }
+}
+
+void profilerBeginFrame(Profiler *pProfiler)
+{
+    memset(&pProfiler->current, 0, sizeof(FrameTimings));
+    pProfiler->current.gpuFrame = -1.0;
+    pProfiler->frameStart = profilerTimeNs();
+}
+
+void profilerBeginStage(Profiler *pProfiler, uint32_t stage)
+{
+    pProfiler->stageStart[stage] = profilerTimeNs();
+}
+
+void profilerEndStage(Profiler *pProfiler, uint32_t stage)
+{
+    pProfiler->current.cpuStage[stage] += nsToMs(profilerTimeNs() - pProfiler->stageStart[stage]);
+}
+
+void profilerEndFrame(Profiler *pProfiler, uint32_t slot)
+{
+    pProfiler->current.frame = pProfiler->frame++;
+    pProfiler->current.cpuFrame = nsToMs(profilerTimeNs() - pProfiler->frameStart);
+
+    if(pProfiler->gpuEnabled)
+    {
+        pProfiler->pending[slot] = pProfiler->current;//GPU time is filled in once the slot comes around again
+        pProfiler->pendingValid[slot] = 1;
+    }
+    else
+    {
+        finishFrame(pProfiler, &pProfiler->current);
+    }
+}
+
+void profilerCmdResetQueries(Profiler *pProfiler, VkCommandBuffer commandBuffer, uint32_t slot)
+{
+    if(pProfiler->gpuEnabled)
+    {
+        vkCmdResetQueryPool(commandBuffer, pProfiler->queryPool, 2 * slot, 2);//Must be recorded outside of a render pass
+    }
+}
+
+void profilerCmdTimestamp(Profiler *pProfiler, VkCommandBuffer commandBuffer, uint32_t slot, uint32_t end)
+{
+    if(pProfiler->gpuEnabled)
+    {
+        VkPipelineStageFlagBits stage = end ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        vkCmdWriteTimestamp(commandBuffer, stage, pProfiler->queryPool, 2 * slot + (end ? 1 : 0));
+    }
+}
+
+double profilerCollect(Profiler *pProfiler, VkDevice device, uint32_t slot)//Returns the GPU time of the frame it finished, negative if none
+{
+    if(!pProfiler->gpuEnabled || !pProfiler->pendingValid[slot])
+    {
+        return -1.0;
+    }
+
+    //Called once the frame's fence has been waited on, so the results are normally ready. No WAIT_BIT, a missing result is reported instead of stalling
+    uint64_t results[4];
+    VkResult result = vkGetQueryPoolResults(device, pProfiler->queryPool, 2 * slot, 2, sizeof(results), results, 2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+    FrameTimings *pTimings = &pProfiler->pending[slot];
+    if(result == VK_SUCCESS && results[1] && results[3])
+    {
+        uint64_t ticks = (results[2] - results[0]) & pProfiler->timestampMask;
+        pTimings->gpuFrame = (double)ticks * pProfiler->timestampPeriod / 1000000.0;
+    }
+
+    finishFrame(pProfiler, pTimings);
+    pProfiler->pendingValid[slot] = 0;
+    return pTimings->gpuFrame;
+}
+
+void profilerFlush(Profiler *pProfiler, VkDevice device)//Only valid once the device is idle, finishes every frame still in flight
+{
+    for(uint32_t i = 0; i < pProfiler->slotCount; i++)
+    {
+        profilerCollect(pProfiler, device, i);
+    }
+}
+
+void profilerComputeStats(Profiler *pProfiler, ProfilerStats *pStats)
+{
+    memset(pStats, 0, sizeof(ProfilerStats));
+    pStats->sampleCount = pProfiler->windowCount;
+
+    uint32_t gpuCount = 0;
+    for(uint32_t i = 0; i < pProfiler->windowCount; i++)
+    {
+        FrameTimings *pTimings = &pProfiler->window[i];
+        for(int j = 0; j < PROFILE_STAGE_COUNT; j++)
+        {
+            pStats->cpuStageMean[j] += pTimings->cpuStage[j];
+            if(pTimings->cpuStage[j] > pStats->cpuStageMax[j])
+            {
+                pStats->cpuStageMax[j] = pTimings->cpuStage[j];
+            }
+        }
+
+        pStats->cpuFrameMean += pTimings->cpuFrame;
+        if(pTimings->cpuFrame > pStats->cpuFrameMax)
+        {
+            pStats->cpuFrameMax = pTimings->cpuFrame;
+        }
+
+        if(pTimings->gpuFrame >= 0.0)
+        {
+            gpuCount++;
+            pStats->gpuFrameMean += pTimings->gpuFrame;
+            if(pTimings->gpuFrame > pStats->gpuFrameMax)
+            {
+                pStats->gpuFrameMax = pTimings->gpuFrame;
+            }
+        }
+    }
+
+    if(pStats->sampleCount)
+    {
+        for(int j = 0; j < PROFILE_STAGE_COUNT; j++)
+        {
+            pStats->cpuStageMean[j] /= pStats->sampleCount;
+        }
+        pStats->cpuFrameMean /= pStats->sampleCount;
+    }
+
+    pStats->gpuFrameMean = gpuCount ? pStats->gpuFrameMean / gpuCount : -1.0;
+}
+
+void destroyProfiler(Profiler *pProfiler, VkDevice device)
+{
+    profilerFlush(pProfiler, device);
+
+    if(pProfiler->gpuEnabled)
+    {
+        vkDestroyQueryPool(device, pProfiler->queryPool, NULL);
+    }
+
+    if(pProfiler->exportFile != NULL)
+    {
+        if(pProfiler->exportFormat == PROFILE_EXPORT_JSON)
+        {
+            fprintf(pProfiler->exportFile, "\n]\n");
+        }
+        fclose(pProfiler->exportFile);
+    }
+
+    free(pProfiler->window);
+    free(pProfiler->pending);
+    free(pProfiler->pendingValid);
+    free(pProfiler->history);
+}
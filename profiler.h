@@ -0,0 +1,105 @@
+//
+//  profiler.h
+//  vkProject
+//
+//  Per-stage CPU timers and GPU timestamp queries for each frame.
+//
+
+#ifndef profiler_h
+#define profiler_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vulkan/vulkan.h>
+
+enum profilerStage {
+    PROFILE_STAGE_FENCE_WAIT,
+    PROFILE_STAGE_ACQUIRE,
+    PROFILE_STAGE_UPDATE_UNIFORM,
+    PROFILE_STAGE_RECORD,
+    PROFILE_STAGE_SUBMIT,
+    PROFILE_STAGE_PRESENT,
+    PROFILE_STAGE_COUNT
+};
+
+enum profilerExportFormat {PROFILE_EXPORT_NONE, PROFILE_EXPORT_CSV, PROFILE_EXPORT_JSON};
+
+typedef struct {
+    uint64_t frame;
+    double cpuStage[PROFILE_STAGE_COUNT];//Milliseconds spent in each stage
+    double cpuFrame;//Milliseconds from the start of the frame to the end of present
+    double gpuFrame;//Milliseconds between the timestamps around the render pass, negative if unavailable
+} FrameTimings;
+
+typedef struct {
+    uint32_t sampleCount;
+    double cpuStageMean[PROFILE_STAGE_COUNT];
+    double cpuStageMax[PROFILE_STAGE_COUNT];
+    double cpuFrameMean;
+    double cpuFrameMax;
+    double gpuFrameMean;
+    double gpuFrameMax;
+} ProfilerStats;
+
+typedef struct {
+    FrameTimings *window;//Rolling window of finished frames
+    uint32_t windowSize;
+    uint32_t windowCount;
+    uint32_t windowHead;
+
+    uint64_t frame;
+    FrameTimings current;
+    uint64_t frameStart;
+    uint64_t stageStart[PROFILE_STAGE_COUNT];
+
+    uint32_t slotCount;//One pending frame per frame in flight, finished once its timestamps are read back
+    FrameTimings *pending;
+    uint32_t *pendingValid;
+
+    VkQueryPool queryPool;
+    uint32_t gpuEnabled;
+    double timestampPeriod;
+    uint64_t timestampMask;
+
+    FILE *exportFile;
+    uint32_t exportFormat;
+    uint64_t exportedCount;
+
+    FrameTimings *history;//Every finished frame, only kept when requested
+    uint32_t historyCapacity;
+    uint32_t historyCount;
+} Profiler;
+
+extern const char *profilerStageNames[PROFILE_STAGE_COUNT];
+
+uint64_t profilerTimeNs(void);
+
+void createProfiler(Profiler *pProfiler, uint32_t windowSize, uint32_t slotCount);
+
+void profilerInitGpu(Profiler *pProfiler, VkDevice device, float timestampPeriod, uint32_t timestampValidBits);
+
+void profilerOpenExport(Profiler *pProfiler, const char *fileName);
+
+void profilerKeepHistory(Profiler *pProfiler, uint32_t capacity);
+
+void profilerBeginFrame(Profiler *pProfiler);
+
+void profilerBeginStage(Profiler *pProfiler, uint32_t stage);
+
+void profilerEndStage(Profiler *pProfiler, uint32_t stage);
+
+void profilerEndFrame(Profiler *pProfiler, uint32_t slot);
+
+void profilerCmdResetQueries(Profiler *pProfiler, VkCommandBuffer commandBuffer, uint32_t slot);
+
+void profilerCmdTimestamp(Profiler *pProfiler, VkCommandBuffer commandBuffer, uint32_t slot, uint32_t end);
+
+double profilerCollect(Profiler *pProfiler, VkDevice device, uint32_t slot);
+
+void profilerFlush(Profiler *pProfiler, VkDevice device);
+
+void profilerComputeStats(Profiler *pProfiler, ProfilerStats *pStats);
+
+void destroyProfiler(Profiler *pProfiler, VkDevice device);
+
+#endif /* profiler_h */
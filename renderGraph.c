@@ -0,0 +1,790 @@
+//
+//  renderGraph.c
+//  vkProject
+//
+//  Frame passes declared with the resources they read and write. Compiling culls passes nothing depends on, derives the pipeline barriers and layout transitions between the rest and aliases transient resources into shared memory.
+//
+
+#include "renderGraph.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    VkPipelineStageFlags writeStages;//Of the last write or layout transition
+    VkAccessFlags writeAccess;
+    VkPipelineStageFlags readStages;//Reads since then, a later write waits on them
+    VkPipelineStageFlags visibleStages;//Stages and access the last write has been made visible to
+    VkAccessFlags visibleAccess;
+    VkImageLayout layout;
+} ResourceTracking;
+
+typedef struct {
+    uint32_t flag;
+    const char *name;
+} FlagName;
+
+static const FlagName stageNames[] = {
+    {VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, "top"},
+    {VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, "draw_indirect"},
+    {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, "vertex_input"},
+    {VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, "vertex_shader"},
+    {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, "fragment_shader"},
+    {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT, "early_fragment_tests"},
+    {VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, "late_fragment_tests"},
+    {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, "color_attachment_output"},
+    {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, "compute"},
+    {VK_PIPELINE_STAGE_TRANSFER_BIT, "transfer"},
+    {VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, "bottom"},
+    {VK_PIPELINE_STAGE_HOST_BIT, "host"},
+    {VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, "all_graphics"},
+    {VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, "all_commands"}
+};
+
+static const FlagName accessNames[] = {
+    {VK_ACCESS_INDIRECT_COMMAND_READ_BIT, "indirect_read"},
+    {VK_ACCESS_INDEX_READ_BIT, "index_read"},
+    {VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, "vertex_attribute_read"},
+    {VK_ACCESS_UNIFORM_READ_BIT, "uniform_read"},
+    {VK_ACCESS_SHADER_READ_BIT, "shader_read"},
+    {VK_ACCESS_SHADER_WRITE_BIT, "shader_write"},
+    {VK_ACCESS_COLOR_ATTACHMENT_READ_BIT, "color_read"},
+    {VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, "color_write"},
+    {VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, "depth_read"},
+    {VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, "depth_write"},
+    {VK_ACCESS_TRANSFER_READ_BIT, "transfer_read"},
+    {VK_ACCESS_TRANSFER_WRITE_BIT, "transfer_write"},
+    {VK_ACCESS_HOST_READ_BIT, "host_read"},
+    {VK_ACCESS_HOST_WRITE_BIT, "host_write"},
+    {VK_ACCESS_MEMORY_READ_BIT, "memory_read"},
+    {VK_ACCESS_MEMORY_WRITE_BIT, "memory_write"}
+};
+
+static void *allocOrExit(size_t size)
+{
+    void *pMemory = malloc(size ? size : 1);
+    if(pMemory == NULL)
+    {
+        printf("Failed to allocate render graph!\n");
+        exit(1);
+    }
+    return pMemory;
+}
+
+static void *growOrExit(void *pArray, uint32_t *pCapacity, uint32_t count, size_t elementSize)//Room for one more element
+{
+    if(count < *pCapacity)
+    {
+        return pArray;
+    }
+    uint32_t capacity = *pCapacity ? 2 * *pCapacity : 8;
+    void *pGrown = realloc(pArray, capacity * elementSize);
+    if(pGrown == NULL)
+    {
+        printf("Failed to allocate render graph!\n");
+        exit(1);
+    }
+    *pCapacity = capacity;
+    return pGrown;
+}
+
+void createRenderGraph(RenderGraph *pGraph, VkDevice device, MemoryPolicy *pMemoryPolicy)
+{
+    memset(pGraph, 0, sizeof(RenderGraph));
+    pGraph->device = device;
+    pGraph->pMemoryPolicy = pMemoryPolicy;
+}
+
+static uint32_t addResource(RenderGraph *pGraph, const char *name, uint32_t type, uint32_t transient)
+{
+    pGraph->resources = growOrExit(pGraph->resources, &pGraph->resourceCapacity, pGraph->resourceCount, sizeof(RenderGraphResource));
+    RenderGraphResource *pResource = &pGraph->resources[pGraph->resourceCount];
+    memset(pResource, 0, sizeof(RenderGraphResource));
+    pResource->name = name;
+    pResource->type = type;
+    pResource->transient = transient;
+    pResource->allocation = RENDER_GRAPH_NONE;
+    pResource->firstPass = RENDER_GRAPH_NONE;
+    pResource->lastPass = RENDER_GRAPH_NONE;
+    pResource->predecessor = RENDER_GRAPH_NONE;
+    return pGraph->resourceCount++;
+}
+
+uint32_t renderGraphImportImage(RenderGraph *pGraph, const char *name, VkImageAspectFlags aspect, RenderGraphState initial, RenderGraphState final)//Owned elsewhere, set with renderGraphSetImage before each execute
+{
+    uint32_t resource = addResource(pGraph, name, RENDER_GRAPH_IMAGE, 0);
+    pGraph->resources[resource].aspect = aspect;
+    pGraph->resources[resource].initial = initial;
+    pGraph->resources[resource].final = final;
+    return resource;
+}
+
+uint32_t renderGraphImportBuffer(RenderGraph *pGraph, const char *name, RenderGraphState final)//Owned elsewhere, possibly a different buffer every frame, hazards with earlier frames stay with the owner
+{
+    uint32_t resource = addResource(pGraph, name, RENDER_GRAPH_BUFFER, 0);
+    pGraph->resources[resource].final = final;
+    return resource;
+}
+
+uint32_t renderGraphCreateImage(RenderGraph *pGraph, const char *name, VkFormat format, VkExtent2D extent, VkImageUsageFlags usage, VkImageAspectFlags aspect, uint32_t memoryUsage)//Created by renderGraphCompile
+{
+    uint32_t resource = addResource(pGraph, name, RENDER_GRAPH_IMAGE, 1);
+    RenderGraphResource *pResource = &pGraph->resources[resource];
+    pResource->aspect = aspect;
+    pResource->memoryUsage = memoryUsage;
+    pResource->imageInfo = (VkImageCreateInfo){
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = format,
+        .extent = {extent.width, extent.height, 1},
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+    };
+    return resource;
+}
+
+uint32_t renderGraphCreateBuffer(RenderGraph *pGraph, const char *name, VkDeviceSize size, VkBufferUsageFlags usage, uint32_t memoryUsage)//Created by renderGraphCompile
+{
+    uint32_t resource = addResource(pGraph, name, RENDER_GRAPH_BUFFER, 1);
+    RenderGraphResource *pResource = &pGraph->resources[resource];
+    pResource->memoryUsage = memoryUsage;
+    pResource->bufferInfo = (VkBufferCreateInfo){
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = size,
+        .usage = usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE
+    };
+    return resource;
+}
+
+uint32_t renderGraphAddPass(RenderGraph *pGraph, const char *name, uint32_t flags, RenderGraphRecord record, void *pData, uint32_t argument)//Passes run in the order they are added
+{
+    pGraph->passes = growOrExit(pGraph->passes, &pGraph->passCapacity, pGraph->passCount, sizeof(RenderGraphPass));
+    RenderGraphPass *pPass = &pGraph->passes[pGraph->passCount];
+    memset(pPass, 0, sizeof(RenderGraphPass));
+    pPass->name = name;
+    pPass->flags = flags;
+    pPass->record = record;
+    pPass->pData = pData;
+    pPass->argument = argument;
+    return pGraph->passCount++;
+}
+
+void renderGraphUse(RenderGraph *pGraph, uint32_t pass, uint32_t resource, VkPipelineStageFlags stages, VkAccessFlags access, VkImageLayout layout)//Any write bit in access makes it a write, images are in layout for the whole pass
+{
+    RenderGraphPass *pPass = &pGraph->passes[pass];
+    if(pPass->accessCount == RENDER_GRAPH_MAX_ACCESSES)
+    {
+        printf("Render graph pass %s uses too many resources!\n", pPass->name);
+        exit(1);
+    }
+    pPass->accesses[pPass->accessCount++] = (RenderGraphAccess){resource, stages, access, layout};
+}
+
+static void cullPasses(RenderGraph *pGraph)//Walks back from passes with side effects and writes to imported resources, which outlive the frame
+{
+    uint32_t *needed = allocOrExit(sizeof(uint32_t) * pGraph->resourceCount);//Transients read by a live pass later on
+    memset(needed, 0, sizeof(uint32_t) * pGraph->resourceCount);
+    for(uint32_t i = pGraph->passCount; i-- > 0;)
+    {
+        RenderGraphPass *pPass = &pGraph->passes[i];
+        uint32_t live = pPass->flags & RENDER_GRAPH_PASS_SIDE_EFFECT;
+        for(uint32_t j = 0; j < pPass->accessCount; j++)
+        {
+            const RenderGraphAccess *pAccess = &pPass->accesses[j];
+            if((pAccess->access & RENDER_GRAPH_WRITE_ACCESS) && (!pGraph->resources[pAccess->resource].transient || needed[pAccess->resource]))
+            {
+                live = 1;
+            }
+        }
+        pPass->culled = !live;
+        if(!live)
+        {
+            continue;
+        }
+        for(uint32_t j = 0; j < pPass->accessCount; j++)
+        {
+            if(pPass->accesses[j].access & ~RENDER_GRAPH_WRITE_ACCESS)
+            {
+                needed[pPass->accesses[j].resource] = 1;
+            }
+        }
+    }
+    free(needed);
+
+    pGraph->schedule = allocOrExit(sizeof(uint32_t) * pGraph->passCount);
+    pGraph->scheduleCount = 0;
+    for(uint32_t i = 0; i < pGraph->passCount; i++)
+    {
+        if(!pGraph->passes[i].culled)
+        {
+            pGraph->schedule[pGraph->scheduleCount++] = i;
+        }
+    }
+}
+
+static void findLifetimes(RenderGraph *pGraph)
+{
+    for(uint32_t i = 0; i < pGraph->scheduleCount; i++)
+    {
+        const RenderGraphPass *pPass = &pGraph->passes[pGraph->schedule[i]];
+        for(uint32_t j = 0; j < pPass->accessCount; j++)
+        {
+            RenderGraphResource *pResource = &pGraph->resources[pPass->accesses[j].resource];
+            if(pResource->firstPass == RENDER_GRAPH_NONE)
+            {
+                pResource->firstPass = i;
+                pResource->firstStages = 0;
+            }
+            if(pResource->firstPass == i)
+            {
+                pResource->firstStages |= pPass->accesses[j].stages;
+            }
+            pResource->lastPass = i;
+        }
+    }
+}
+
+static uint32_t lifetimesOverlap(const RenderGraphResource *pA, const RenderGraphResource *pB)
+{
+    if(pA->firstPass == RENDER_GRAPH_NONE || pB->firstPass == RENDER_GRAPH_NONE)
+    {
+        return 0;
+    }
+    return pA->firstPass <= pB->lastPass && pB->firstPass <= pA->lastPass;
+}
+
+static uint32_t fitsAllocation(const RenderGraph *pGraph, uint32_t allocation, uint32_t resource)//Images and buffers never share, so buffer image granularity can be ignored
+{
+    const RenderGraphAllocation *pAllocation = &pGraph->allocations[allocation];
+    const RenderGraphResource *pResource = &pGraph->resources[resource];
+    if(pAllocation->type != pResource->type || pAllocation->memoryUsage != pResource->memoryUsage || !(pAllocation->requirements.memoryTypeBits & pResource->requirements.memoryTypeBits))
+    {
+        return 0;
+    }
+    for(uint32_t i = 0; i < pGraph->resourceCount; i++)
+    {
+        if(pGraph->resources[i].allocation == allocation && lifetimesOverlap(&pGraph->resources[i], pResource))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void aliasTransients(RenderGraph *pGraph)//Largest first, each into the first allocation whose resources are all dead by then
+{
+    uint32_t *order = allocOrExit(sizeof(uint32_t) * pGraph->resourceCount);
+    uint32_t transientCount = 0;
+    for(uint32_t i = 0; i < pGraph->resourceCount; i++)
+    {
+        if(!pGraph->resources[i].transient || pGraph->resources[i].firstPass == RENDER_GRAPH_NONE)
+        {
+            continue;
+        }
+        uint32_t j = transientCount++;
+        for(; j > 0 && pGraph->resources[order[j - 1]].requirements.size < pGraph->resources[i].requirements.size; j--)
+        {
+            order[j] = order[j - 1];
+        }
+        order[j] = i;
+    }
+
+    pGraph->allocations = allocOrExit(sizeof(RenderGraphAllocation) * transientCount);
+    pGraph->allocationCount = 0;
+    for(uint32_t i = 0; i < transientCount; i++)
+    {
+        RenderGraphResource *pResource = &pGraph->resources[order[i]];
+        uint32_t allocation = 0;
+        while(allocation < pGraph->allocationCount && !fitsAllocation(pGraph, allocation, order[i]))
+        {
+            allocation++;
+        }
+        RenderGraphAllocation *pAllocation = &pGraph->allocations[allocation];
+        if(allocation == pGraph->allocationCount)
+        {
+            pGraph->allocationCount++;
+            memset(pAllocation, 0, sizeof(RenderGraphAllocation));
+            pAllocation->type = pResource->type;
+            pAllocation->memoryUsage = pResource->memoryUsage;
+            pAllocation->requirements = pResource->requirements;
+        }
+        else
+        {
+            if(pResource->requirements.size > pAllocation->requirements.size)
+            {
+                pAllocation->requirements.size = pResource->requirements.size;
+            }
+            if(pResource->requirements.alignment > pAllocation->requirements.alignment)
+            {
+                pAllocation->requirements.alignment = pResource->requirements.alignment;
+            }
+            pAllocation->requirements.memoryTypeBits &= pResource->requirements.memoryTypeBits;
+        }
+        pResource->allocation = allocation;
+        pGraph->unaliasedBytes += pResource->requirements.size;
+    }
+    free(order);
+
+    for(uint32_t i = 0; i < pGraph->resourceCount; i++)//The schedule repeats every frame, so the first use in an allocation follows the last one of the frame before
+    {
+        RenderGraphResource *pResource = &pGraph->resources[i];
+        if(!pResource->transient || pResource->firstPass == RENDER_GRAPH_NONE)
+        {
+            continue;
+        }
+        uint32_t before = RENDER_GRAPH_NONE;
+        uint32_t last = RENDER_GRAPH_NONE;
+        for(uint32_t j = 0; j < pGraph->resourceCount; j++)
+        {
+            const RenderGraphResource *pOther = &pGraph->resources[j];
+            if(pOther->allocation != pResource->allocation || pOther->firstPass == RENDER_GRAPH_NONE)
+            {
+                continue;
+            }
+            if(pOther->lastPass < pResource->firstPass && (before == RENDER_GRAPH_NONE || pOther->lastPass > pGraph->resources[before].lastPass))
+            {
+                before = j;
+            }
+            if(last == RENDER_GRAPH_NONE || pOther->lastPass > pGraph->resources[last].lastPass)
+            {
+                last = j;
+            }
+        }
+        pResource->predecessor = before != RENDER_GRAPH_NONE ? before : last;
+    }
+}
+
+static void createTransients(RenderGraph *pGraph)//Only those some scheduled pass uses, the rest were left to culled passes
+{
+    for(uint32_t i = 0; i < pGraph->resourceCount; i++)
+    {
+        RenderGraphResource *pResource = &pGraph->resources[i];
+        if(!pResource->transient || pResource->firstPass == RENDER_GRAPH_NONE)
+        {
+            continue;
+        }
+        if(pResource->type == RENDER_GRAPH_IMAGE)
+        {
+            if(vkCreateImage(pGraph->device, &pResource->imageInfo, NULL, &pResource->image) != VK_SUCCESS)
+            {
+                printf("Failed to create render graph image %s!\n", pResource->name);
+                exit(1);
+            }
+            vkGetImageMemoryRequirements(pGraph->device, pResource->image, &pResource->requirements);
+        }
+        else
+        {
+            if(vkCreateBuffer(pGraph->device, &pResource->bufferInfo, NULL, &pResource->buffer) != VK_SUCCESS)
+            {
+                printf("Failed to create render graph buffer %s!\n", pResource->name);
+                exit(1);
+            }
+            vkGetBufferMemoryRequirements(pGraph->device, pResource->buffer, &pResource->requirements);
+        }
+    }
+
+    aliasTransients(pGraph);
+
+    for(uint32_t i = 0; i < pGraph->allocationCount; i++)
+    {
+        RenderGraphAllocation *pAllocation = &pGraph->allocations[i];
+        uint32_t memoryType;
+        if(memoryPolicyAllocate(pGraph->pMemoryPolicy, pGraph->device, &pAllocation->requirements, pAllocation->memoryUsage, &pAllocation->memory, &memoryType) != VK_SUCCESS)
+        {
+            printf("Failed to allocate render graph memory!\n");
+            exit(1);
+        }
+        pGraph->transientBytes += pAllocation->requirements.size;
+    }
+
+    for(uint32_t i = 0; i < pGraph->resourceCount; i++)//Every resource sits at the start of its allocation
+    {
+        RenderGraphResource *pResource = &pGraph->resources[i];
+        if(pResource->allocation == RENDER_GRAPH_NONE)
+        {
+            continue;
+        }
+        VkDeviceMemory memory = pGraph->allocations[pResource->allocation].memory;
+        if(pResource->type == RENDER_GRAPH_BUFFER)
+        {
+            vkBindBufferMemory(pGraph->device, pResource->buffer, memory, 0);
+            continue;
+        }
+        vkBindImageMemory(pGraph->device, pResource->image, memory, 0);
+
+        VkImageAspectFlags viewAspect = pResource->aspect;
+        if((pResource->imageInfo.usage & VK_IMAGE_USAGE_SAMPLED_BIT) && (viewAspect & VK_IMAGE_ASPECT_DEPTH_BIT))//A sampled view selects one aspect of a depth/stencil format
+        {
+            viewAspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+        }
+        VkImageViewCreateInfo viewInfo = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .image = pResource->image,
+            .viewType = VK_IMAGE_VIEW_TYPE_2D,
+            .format = pResource->imageInfo.format,
+            .subresourceRange = {viewAspect, 0, 1, 0, 1}
+        };
+        if(vkCreateImageView(pGraph->device, &viewInfo, NULL, &pResource->view) != VK_SUCCESS)
+        {
+            printf("Failed to create render graph image view %s!\n", pResource->name);
+            exit(1);
+        }
+    }
+}
+
+static void startTracking(const RenderGraph *pGraph, uint32_t resource, ResourceTracking *pTracking)//State at the start of a frame
+{
+    const RenderGraphResource *pResource = &pGraph->resources[resource];
+    memset(pTracking, 0, sizeof(ResourceTracking));
+    if(!pResource->transient)
+    {
+        if(pResource->initial.access & RENDER_GRAPH_WRITE_ACCESS)
+        {
+            pTracking->writeStages = pResource->initial.stages;
+            pTracking->writeAccess = pResource->initial.access & RENDER_GRAPH_WRITE_ACCESS;
+        }
+        else
+        {
+            pTracking->readStages = pResource->initial.stages;
+        }
+        pTracking->layout = pResource->initial.layout;
+        return;
+    }
+    pTracking->layout = VK_IMAGE_LAYOUT_UNDEFINED;//Contents are discarded, only the previous user of the memory has to be waited on
+    if(pResource->predecessor != RENDER_GRAPH_NONE)
+    {
+        pTracking->writeStages = pGraph->resources[pResource->predecessor].endState.stages;
+        pTracking->writeAccess = pGraph->resources[pResource->predecessor].endState.access;
+    }
+}
+
+static void applyAccess(RenderGraph *pGraph, RenderGraphBarrier *pBarrier, ResourceTracking *pTracking, uint32_t resource, VkPipelineStageFlags stages, VkAccessFlags access, VkImageLayout layout)
+{
+    const RenderGraphResource *pResource = &pGraph->resources[resource];
+    if(pResource->type == RENDER_GRAPH_IMAGE && layout != pTracking->layout)//A transition writes the image, so it waits on every earlier access
+    {
+        VkPipelineStageFlags srcStages = pTracking->writeStages | pTracking->readStages;
+        pGraph->transitions = growOrExit(pGraph->transitions, &pGraph->transitionCapacity, pGraph->transitionCount, sizeof(RenderGraphTransition));
+        pGraph->transitions[pGraph->transitionCount++] = (RenderGraphTransition){resource, pTracking->layout, layout, pTracking->writeAccess, access};
+        pBarrier->transitionCount++;
+        pBarrier->srcStages |= srcStages ? srcStages : stages;//Nothing earlier in the frame, waiting on its own stages chains it to the semaphore the submission waits on there
+        pBarrier->dstStages |= stages;
+        *pTracking = (ResourceTracking){stages, access & RENDER_GRAPH_WRITE_ACCESS, 0, stages, access, layout};
+        return;
+    }
+
+    if(access & RENDER_GRAPH_WRITE_ACCESS)
+    {
+        VkPipelineStageFlags srcStages = pTracking->writeStages | pTracking->readStages;
+        if(srcStages)//Write after read only needs the execution dependency
+        {
+            pBarrier->srcStages |= srcStages;
+            pBarrier->dstStages |= stages;
+            if(pTracking->writeAccess)
+            {
+                pBarrier->srcAccess |= pTracking->writeAccess;
+                pBarrier->dstAccess |= access;
+            }
+        }
+        *pTracking = (ResourceTracking){stages, access & RENDER_GRAPH_WRITE_ACCESS, 0, stages, access, pTracking->layout};
+        return;
+    }
+
+    if(pTracking->writeStages && ((stages & ~pTracking->visibleStages) || (access & ~pTracking->visibleAccess)))//Reads the last write made visible already need nothing
+    {
+        pBarrier->srcStages |= pTracking->writeStages;
+        pBarrier->dstStages |= stages;
+        if(pTracking->writeAccess)
+        {
+            pBarrier->srcAccess |= pTracking->writeAccess;
+            pBarrier->dstAccess |= access;
+        }
+        pTracking->visibleStages |= stages;
+        pTracking->visibleAccess |= access;
+    }
+    pTracking->readStages |= stages;
+}
+
+static void buildBarriers(RenderGraph *pGraph)//Replays one frame of accesses, then records where each resource was left
+{
+    ResourceTracking *tracking = allocOrExit(sizeof(ResourceTracking) * pGraph->resourceCount);
+    for(uint32_t i = 0; i < pGraph->resourceCount; i++)
+    {
+        startTracking(pGraph, i, &tracking[i]);
+    }
+
+    pGraph->transitionCount = 0;
+    for(uint32_t i = 0; i <= pGraph->scheduleCount; i++)
+    {
+        RenderGraphBarrier *pBarrier = &pGraph->barriers[i];
+        memset(pBarrier, 0, sizeof(RenderGraphBarrier));
+        pBarrier->firstTransition = pGraph->transitionCount;
+        if(i < pGraph->scheduleCount)
+        {
+            const RenderGraphPass *pPass = &pGraph->passes[pGraph->schedule[i]];
+            for(uint32_t j = 0; j < pPass->accessCount; j++)
+            {
+                const RenderGraphAccess *pAccess = &pPass->accesses[j];
+                applyAccess(pGraph, pBarrier, &tracking[pAccess->resource], pAccess->resource, pAccess->stages, pAccess->access, pAccess->layout);
+            }
+            continue;
+        }
+        for(uint32_t j = 0; j < pGraph->resourceCount; j++)//Imported resources are handed back in their final state
+        {
+            const RenderGraphResource *pResource = &pGraph->resources[j];
+            uint32_t relayout = pResource->type == RENDER_GRAPH_IMAGE && pResource->final.layout != VK_IMAGE_LAYOUT_UNDEFINED;
+            if(pResource->transient || (!pResource->final.stages && !relayout))
+            {
+                continue;
+            }
+            VkPipelineStageFlags stages = pResource->final.stages ? pResource->final.stages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+            applyAccess(pGraph, pBarrier, &tracking[j], j, stages, pResource->final.access, relayout ? pResource->final.layout : tracking[j].layout);
+        }
+    }
+
+    for(uint32_t i = 0; i < pGraph->resourceCount; i++)
+    {
+        pGraph->resources[i].endState = (RenderGraphState){tracking[i].writeStages | tracking[i].readStages, tracking[i].writeAccess, tracking[i].layout};
+    }
+    free(tracking);
+}
+
+void renderGraphCompile(RenderGraph *pGraph)//Once every pass and resource has been declared, creates the transient resources
+{
+    cullPasses(pGraph);
+    findLifetimes(pGraph);
+
+    pGraph->barriers = allocOrExit(sizeof(RenderGraphBarrier) * (pGraph->scheduleCount + 1));
+    buildBarriers(pGraph);//End states do not depend on the start of a transient, its first use is always a write or a transition
+    createTransients(pGraph);
+    buildBarriers(pGraph);//Again, now that transients wait on whatever used their memory last
+
+    uint32_t largest = 1;
+    for(uint32_t i = 0; i <= pGraph->scheduleCount; i++)
+    {
+        if(pGraph->barriers[i].transitionCount > largest)
+        {
+            largest = pGraph->barriers[i].transitionCount;
+        }
+    }
+    pGraph->imageBarriers = allocOrExit(sizeof(VkImageMemoryBarrier) * largest);
+}
+
+void renderGraphSetImage(RenderGraph *pGraph, uint32_t resource, VkImage image)
+{
+    pGraph->resources[resource].image = image;
+}
+
+VkImage renderGraphImage(const RenderGraph *pGraph, uint32_t resource)
+{
+    return pGraph->resources[resource].image;
+}
+
+VkImageView renderGraphImageView(const RenderGraph *pGraph, uint32_t resource)//Transient images only, null when only culled passes use them
+{
+    return pGraph->resources[resource].view;
+}
+
+VkBuffer renderGraphBuffer(const RenderGraph *pGraph, uint32_t resource)//Transient buffers only
+{
+    return pGraph->resources[resource].buffer;
+}
+
+VkPipelineStageFlags renderGraphFirstStages(const RenderGraph *pGraph, uint32_t resource)//Where a semaphore guarding the resource has to be waited on
+{
+    return pGraph->resources[resource].firstStages;
+}
+
+static void recordBarrier(RenderGraph *pGraph, VkCommandBuffer commandBuffer, const RenderGraphBarrier *pBarrier)
+{
+    if(!pBarrier->srcStages)
+    {
+        return;
+    }
+    for(uint32_t i = 0; i < pBarrier->transitionCount; i++)
+    {
+        const RenderGraphTransition *pTransition = &pGraph->transitions[pBarrier->firstTransition + i];
+        const RenderGraphResource *pResource = &pGraph->resources[pTransition->resource];
+        pGraph->imageBarriers[i] = (VkImageMemoryBarrier){
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask = pTransition->srcAccess,
+            .dstAccessMask = pTransition->dstAccess,
+            .oldLayout = pTransition->oldLayout,
+            .newLayout = pTransition->newLayout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = pResource->image,
+            .subresourceRange = {pResource->aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS}
+        };
+    }
+    VkMemoryBarrier memoryBarrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = pBarrier->srcAccess,
+        .dstAccessMask = pBarrier->dstAccess
+    };
+    vkCmdPipelineBarrier(commandBuffer, pBarrier->srcStages, pBarrier->dstStages, 0, pBarrier->srcAccess ? 1 : 0, &memoryBarrier, 0, NULL, pBarrier->transitionCount, pGraph->imageBarriers);
+}
+
+void renderGraphExecute(RenderGraph *pGraph, VkCommandBuffer commandBuffer)//Outside any render pass, passes begin and end their own
+{
+    for(uint32_t i = 0; i < pGraph->scheduleCount; i++)
+    {
+        const RenderGraphPass *pPass = &pGraph->passes[pGraph->schedule[i]];
+        recordBarrier(pGraph, commandBuffer, &pGraph->barriers[i]);
+        pPass->record(commandBuffer, pPass->pData, pPass->argument);
+    }
+    recordBarrier(pGraph, commandBuffer, &pGraph->barriers[pGraph->scheduleCount]);
+}
+
+static void dumpFlags(FILE *pFile, uint32_t flags, const FlagName *names, uint32_t nameCount)
+{
+    if(!flags)
+    {
+        fprintf(pFile, "none");
+        return;
+    }
+    const char *separator = "";
+    for(uint32_t i = 0; i < nameCount; i++)
+    {
+        if(flags & names[i].flag)
+        {
+            fprintf(pFile, "%s%s", separator, names[i].name);
+            separator = "|";
+            flags &= ~names[i].flag;
+        }
+    }
+    if(flags)
+    {
+        fprintf(pFile, "%s0x%x", separator, flags);
+    }
+}
+
+static const char *layoutName(VkImageLayout layout)
+{
+    switch(layout)
+    {
+        case VK_IMAGE_LAYOUT_UNDEFINED: return "undefined";
+        case VK_IMAGE_LAYOUT_GENERAL: return "general";
+        case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL: return "color_attachment";
+        case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL: return "depth_stencil_attachment";
+        case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL: return "depth_stencil_read_only";
+        case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL: return "shader_read_only";
+        case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL: return "transfer_src";
+        case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL: return "transfer_dst";
+        case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR: return "present_src";
+        default: return "other";
+    }
+}
+
+static void dumpBarrier(const RenderGraph *pGraph, FILE *pFile, const RenderGraphBarrier *pBarrier)
+{
+    if(!pBarrier->srcStages)
+    {
+        return;
+    }
+    fprintf(pFile, "      barrier ");
+    dumpFlags(pFile, pBarrier->srcStages, stageNames, sizeof(stageNames) / sizeof(stageNames[0]));
+    fprintf(pFile, " -> ");
+    dumpFlags(pFile, pBarrier->dstStages, stageNames, sizeof(stageNames) / sizeof(stageNames[0]));
+    if(pBarrier->srcAccess)
+    {
+        fprintf(pFile, ", memory ");
+        dumpFlags(pFile, pBarrier->srcAccess, accessNames, sizeof(accessNames) / sizeof(accessNames[0]));
+        fprintf(pFile, " -> ");
+        dumpFlags(pFile, pBarrier->dstAccess, accessNames, sizeof(accessNames) / sizeof(accessNames[0]));
+    }
+    fprintf(pFile, "\n");
+    for(uint32_t i = 0; i < pBarrier->transitionCount; i++)
+    {
+        const RenderGraphTransition *pTransition = &pGraph->transitions[pBarrier->firstTransition + i];
+        fprintf(pFile, "        %s: %s -> %s\n", pGraph->resources[pTransition->resource].name, layoutName(pTransition->oldLayout), layoutName(pTransition->newLayout));
+    }
+}
+
+void renderGraphDump(const RenderGraph *pGraph, FILE *pFile)//The compiled schedule, every barrier and where each transient lives
+{
+    uint32_t barrierCount = 0;
+    for(uint32_t i = 0; i <= pGraph->scheduleCount; i++)
+    {
+        barrierCount += pGraph->barriers[i].srcStages ? 1 : 0;
+    }
+    fprintf(pFile, "Render graph: %u passes, %u culled, %u barriers, %u layout transitions\n",
+            pGraph->passCount, pGraph->passCount - pGraph->scheduleCount, barrierCount, pGraph->transitionCount);
+    fprintf(pFile, "  Transient memory: %u allocations, %.2f MiB, %.2f MiB without aliasing\n",
+            pGraph->allocationCount, pGraph->transientBytes / (1024.0 * 1024.0), pGraph->unaliasedBytes / (1024.0 * 1024.0));
+    for(uint32_t i = 0; i < pGraph->allocationCount; i++)
+    {
+        fprintf(pFile, "    allocation %u, %.2f MiB:", i, pGraph->allocations[i].requirements.size / (1024.0 * 1024.0));
+        for(uint32_t j = 0; j < pGraph->resourceCount; j++)
+        {
+            const RenderGraphResource *pResource = &pGraph->resources[j];
+            if(!pResource->transient || pResource->allocation != i)
+            {
+                continue;
+            }
+            fprintf(pFile, " %s (passes %u-%u)", pResource->name, pResource->firstPass, pResource->lastPass);
+        }
+        fprintf(pFile, "\n");
+    }
+
+    uint32_t scheduled = 0;
+    for(uint32_t i = 0; i < pGraph->passCount; i++)
+    {
+        const RenderGraphPass *pPass = &pGraph->passes[i];
+        if(pPass->culled)
+        {
+            fprintf(pFile, "  culled %s\n", pPass->name);
+            continue;
+        }
+        dumpBarrier(pGraph, pFile, &pGraph->barriers[scheduled]);
+        fprintf(pFile, "  %u %s:", scheduled, pPass->name);
+        for(uint32_t j = 0; j < pPass->accessCount; j++)
+        {
+            const RenderGraphAccess *pAccess = &pPass->accesses[j];
+            fprintf(pFile, " %s %s", pAccess->access & RENDER_GRAPH_WRITE_ACCESS ? "writes" : "reads", pGraph->resources[pAccess->resource].name);
+        }
+        fprintf(pFile, "%s\n", pPass->flags & RENDER_GRAPH_PASS_SIDE_EFFECT ? " (side effects)" : "");
+        scheduled++;
+    }
+    dumpBarrier(pGraph, pFile, &pGraph->barriers[pGraph->scheduleCount]);
+}
+
+void destroyRenderGraph(RenderGraph *pGraph, DeletionQueue *pDeletionQueue, uint64_t retireValue)//Transients go through the deletion queue, frames still in flight may use them
+{
+    for(uint32_t i = 0; i < pGraph->resourceCount; i++)
+    {
+        RenderGraphResource *pResource = &pGraph->resources[i];
+        if(pResource->allocation == RENDER_GRAPH_NONE)
+        {
+            continue;
+        }
+        if(pResource->type == RENDER_GRAPH_IMAGE)
+        {
+            deleteImageViewLater(pDeletionQueue, pResource->view, retireValue);
+            deleteImageLater(pDeletionQueue, pResource->image, retireValue);
+        }
+        else
+        {
+            deleteBufferLater(pDeletionQueue, pResource->buffer, retireValue);
+        }
+    }
+    for(uint32_t i = 0; i < pGraph->allocationCount; i++)
+    {
+        deleteMemoryLater(pDeletionQueue, pGraph->allocations[i].memory, retireValue);
+    }
+
+    free(pGraph->resources);
+    free(pGraph->passes);
+    free(pGraph->schedule);
+    free(pGraph->barriers);
+    free(pGraph->transitions);
+    free(pGraph->imageBarriers);
+    free(pGraph->allocations);
+    memset(pGraph, 0, sizeof(RenderGraph));
+}
@@ -0,0 +1,157 @@
+//
+//  renderGraph.h
+//  vkProject
+//
+//  Frame passes declared with the resources they read and write. Compiling culls passes nothing depends on, derives the pipeline barriers and layout transitions between the rest and aliases transient resources into shared memory.
+//
+
+#ifndef renderGraph_h
+#define renderGraph_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vulkan/vulkan.h>
+#include "memoryPolicy.h"
+#include "deletionQueue.h"
+
+#define RENDER_GRAPH_MAX_ACCESSES 8//Per pass
+#define RENDER_GRAPH_NONE UINT32_MAX
+
+#define RENDER_GRAPH_WRITE_ACCESS (VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT)
+
+enum renderGraphResourceType{RENDER_GRAPH_IMAGE, RENDER_GRAPH_BUFFER};
+
+enum renderGraphPassFlagBits{RENDER_GRAPH_PASS_SIDE_EFFECT = 1};//Never culled, for passes whose results the graph does not see
+
+typedef void (*RenderGraphRecord)(VkCommandBuffer commandBuffer, void *pData, uint32_t argument);
+
+typedef struct {
+    VkPipelineStageFlags stages;//0 at the start of a frame for a resource first touched after a semaphore wait, its first barrier then waits on the stages it transitions for
+    VkAccessFlags access;
+    VkImageLayout layout;//Images only
+} RenderGraphState;
+
+typedef struct {
+    const char *name;
+    uint32_t type;
+    uint32_t transient;//Created, owned and aliased by the graph, its contents do not survive from one frame to the next
+    RenderGraphState initial;//Imported resources only, what the frame starts from
+    RenderGraphState final;//Imported resources only, left in this state after the last pass, no stages for none
+
+    VkImageAspectFlags aspect;//Every aspect of the format, barriers cover them all
+    VkImage image;//Imported images are set every frame
+    VkImageView view;
+    VkBuffer buffer;//Transient buffers only, imported buffers are tracked by name and synchronised with global memory barriers
+    VkImageCreateInfo imageInfo;
+    VkBufferCreateInfo bufferInfo;
+    uint32_t memoryUsage;
+    VkMemoryRequirements requirements;
+
+    uint32_t allocation;//Transient memory shared with every resource whose lifetime does not overlap
+    uint32_t firstPass;//Position in the schedule, RENDER_GRAPH_NONE when unused
+    uint32_t lastPass;
+    uint32_t predecessor;//Transient whose last use of the same memory comes before this one's first, possibly in the previous frame
+    VkPipelineStageFlags firstStages;//Of the first access in the schedule, the semaphore wait stage for imported images
+    RenderGraphState endState;//Stages and writes not yet waited on after the last pass
+} RenderGraphResource;
+
+typedef struct {
+    uint32_t resource;
+    VkPipelineStageFlags stages;
+    VkAccessFlags access;
+    VkImageLayout layout;//Images only
+} RenderGraphAccess;
+
+typedef struct {
+    const char *name;
+    uint32_t flags;
+    RenderGraphRecord record;
+    void *pData;
+    uint32_t argument;
+    RenderGraphAccess accesses[RENDER_GRAPH_MAX_ACCESSES];
+    uint32_t accessCount;
+    uint32_t culled;
+} RenderGraphPass;
+
+typedef struct {
+    uint32_t resource;
+    VkImageLayout oldLayout;
+    VkImageLayout newLayout;
+    VkAccessFlags srcAccess;
+    VkAccessFlags dstAccess;
+} RenderGraphTransition;
+
+typedef struct {
+    VkPipelineStageFlags srcStages;//Nothing to record when 0
+    VkPipelineStageFlags dstStages;
+    VkAccessFlags srcAccess;//Global memory barrier, covers buffers and images that keep their layout
+    VkAccessFlags dstAccess;
+    uint32_t firstTransition;
+    uint32_t transitionCount;
+} RenderGraphBarrier;
+
+typedef struct {
+    VkDeviceMemory memory;
+    VkMemoryRequirements requirements;//Largest size and alignment of the resources placed in it, the memory types they all accept
+    uint32_t type;
+    uint32_t memoryUsage;
+} RenderGraphAllocation;
+
+typedef struct {
+    VkDevice device;
+    MemoryPolicy *pMemoryPolicy;
+
+    RenderGraphResource *resources;
+    uint32_t resourceCount;
+    uint32_t resourceCapacity;
+    RenderGraphPass *passes;
+    uint32_t passCount;
+    uint32_t passCapacity;
+
+    uint32_t *schedule;//Passes left after culling, in the order they were added
+    uint32_t scheduleCount;
+    RenderGraphBarrier *barriers;//Before each scheduled pass, then one leaving imported resources in their final state
+    RenderGraphTransition *transitions;
+    uint32_t transitionCount;
+    uint32_t transitionCapacity;
+    VkImageMemoryBarrier *imageBarriers;//Scratch for recording, as many as the largest barrier needs
+
+    RenderGraphAllocation *allocations;
+    uint32_t allocationCount;
+    VkDeviceSize transientBytes;//Allocated for transient resources
+    VkDeviceSize unaliasedBytes;//What they would take without aliasing
+} RenderGraph;
+
+void createRenderGraph(RenderGraph *pGraph, VkDevice device, MemoryPolicy *pMemoryPolicy);
+
+uint32_t renderGraphImportImage(RenderGraph *pGraph, const char *name, VkImageAspectFlags aspect, RenderGraphState initial, RenderGraphState final);
+
+uint32_t renderGraphImportBuffer(RenderGraph *pGraph, const char *name, RenderGraphState final);
+
+uint32_t renderGraphCreateImage(RenderGraph *pGraph, const char *name, VkFormat format, VkExtent2D extent, VkImageUsageFlags usage, VkImageAspectFlags aspect, uint32_t memoryUsage);
+
+uint32_t renderGraphCreateBuffer(RenderGraph *pGraph, const char *name, VkDeviceSize size, VkBufferUsageFlags usage, uint32_t memoryUsage);
+
+uint32_t renderGraphAddPass(RenderGraph *pGraph, const char *name, uint32_t flags, RenderGraphRecord record, void *pData, uint32_t argument);
+
+void renderGraphUse(RenderGraph *pGraph, uint32_t pass, uint32_t resource, VkPipelineStageFlags stages, VkAccessFlags access, VkImageLayout layout);
+
+void renderGraphCompile(RenderGraph *pGraph);
+
+void renderGraphSetImage(RenderGraph *pGraph, uint32_t resource, VkImage image);
+
+VkImage renderGraphImage(const RenderGraph *pGraph, uint32_t resource);
+
+VkImageView renderGraphImageView(const RenderGraph *pGraph, uint32_t resource);
+
+VkBuffer renderGraphBuffer(const RenderGraph *pGraph, uint32_t resource);
+
+VkPipelineStageFlags renderGraphFirstStages(const RenderGraph *pGraph, uint32_t resource);
+
+void renderGraphExecute(RenderGraph *pGraph, VkCommandBuffer commandBuffer);
+
+void renderGraphDump(const RenderGraph *pGraph, FILE *pFile);
+
+void destroyRenderGraph(RenderGraph *pGraph, DeletionQueue *pDeletionQueue, uint64_t retireValue);
+
+#endif /* renderGraph_h */
@@ -0,0 +1,269 @@
+//
+//  renderQueue.c
+//  vkProject
+//
+//  Per-frame draw list ordered by 64-bit state keys, recorded with redundant binds skipped.
+//
+
+#include "renderQueue.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    RenderQueue *pQueue;
+    const RenderItem *source;
+    RenderItem *destination;
+    uint32_t shift;
+} RadixPass;
+
+static const char *renderBindNames[RENDER_BIND_COUNT] = {"pipeline", "descriptor set", "vertex buffer"};
+
+void createRenderQueue(RenderQueue *pQueue, JobSystem *pJobs)
+{
+    memset(pQueue, 0, sizeof(RenderQueue));
+    pQueue->pJobs = pJobs;
+}
+
+static uint32_t depthBits(float depth)//Flips the float bits so that unsigned order matches float order, negative depths included
+{
+    uint32_t bits;
+    memcpy(&bits, &depth, sizeof(bits));
+    bits ^= (bits & 0x80000000u) ? 0xFFFFFFFFu : 0x80000000u;
+    return bits >> (32 - RENDER_KEY_DEPTH_BITS);
+}
+
+uint64_t renderKey(uint32_t pass, uint32_t pipeline, uint32_t descriptorSet, uint32_t mesh, float depth)//The most expensive state sits in the most significant bits so it changes least often across the sorted list
+{
+    if(pass >> RENDER_KEY_PASS_BITS || pipeline >> RENDER_KEY_PIPELINE_BITS || descriptorSet >> RENDER_KEY_DESCRIPTOR_SET_BITS || mesh >> RENDER_KEY_MESH_BITS)
+    {
+        printf("Render key field out of range!\n");
+        exit(1);
+    }
+
+    uint64_t key = pass;
+    key = (key << RENDER_KEY_PIPELINE_BITS) | pipeline;
+    key = (key << RENDER_KEY_DESCRIPTOR_SET_BITS) | descriptorSet;
+    key = (key << RENDER_KEY_MESH_BITS) | mesh;
+    key = (key << RENDER_KEY_DEPTH_BITS) | depthBits(depth);
+    return key;
+}
+
+void renderQueueReset(RenderQueue *pQueue)
+{
+    pQueue->count = 0;
+    pQueue->keyAnd = UINT64_MAX;
+    pQueue->keyOr = 0;
+}
+
+void renderQueuePush(RenderQueue *pQueue, uint64_t key, const DrawCommand *pCommand)
+{
+    if(pQueue->count == pQueue->capacity)
+    {
+        pQueue->capacity = pQueue->capacity ? 2 * pQueue->capacity : 64;
+        pQueue->commands = realloc(pQueue->commands, sizeof(DrawCommand) * pQueue->capacity);
+        pQueue->items = realloc(pQueue->items, sizeof(RenderItem) * pQueue->capacity);
+        pQueue->scratch = realloc(pQueue->scratch, sizeof(RenderItem) * pQueue->capacity);
+        if(pQueue->commands == NULL || pQueue->items == NULL || pQueue->scratch == NULL)
+        {
+            printf("Failed to allocate render queue!\n");
+            exit(1);
+        }
+    }
+
+    pQueue->commands[pQueue->count] = *pCommand;
+    pQueue->items[pQueue->count] = (RenderItem){key, pQueue->count, 0};
+    pQueue->keyAnd &= key;
+    pQueue->keyOr |= key;
+    pQueue->count++;
+}
+
+static void radixPassSerial(const RenderItem *source, RenderItem *destination, uint32_t count, uint32_t shift)
+{
+    uint32_t offsets[256] = {0};
+    for(uint32_t i = 0; i < count; i++)
+    {
+        offsets[(source[i].key >> shift) & 0xFF]++;
+    }
+
+    uint32_t start = 0;
+    for(uint32_t digit = 0; digit < 256; digit++)
+    {
+        uint32_t digitCount = offsets[digit];
+        offsets[digit] = start;
+        start += digitCount;
+    }
+
+    for(uint32_t i = 0; i < count; i++)
+    {
+        destination[offsets[(source[i].key >> shift) & 0xFF]++] = source[i];
+    }
+}
+
+static void histogramJob(void *pData, uint32_t chunk)
+{
+    RadixPass *pPass = pData;
+    uint32_t *histogram = pPass->pQueue->chunkHistograms[chunk];
+    uint32_t first = chunk * RENDER_QUEUE_CHUNK;
+    uint32_t last = first + RENDER_QUEUE_CHUNK < pPass->pQueue->count ? first + RENDER_QUEUE_CHUNK : pPass->pQueue->count;
+
+    memset(histogram, 0, sizeof(uint32_t) * 256);
+    for(uint32_t i = first; i < last; i++)
+    {
+        histogram[(pPass->source[i].key >> pPass->shift) & 0xFF]++;
+    }
+}
+
+static void scatterJob(void *pData, uint32_t chunk)//Each chunk owns a disjoint run of every bucket, so the pass stays stable
+{
+    RadixPass *pPass = pData;
+    uint32_t *offsets = pPass->pQueue->chunkHistograms[chunk];
+    uint32_t first = chunk * RENDER_QUEUE_CHUNK;
+    uint32_t last = first + RENDER_QUEUE_CHUNK < pPass->pQueue->count ? first + RENDER_QUEUE_CHUNK : pPass->pQueue->count;
+
+    for(uint32_t i = first; i < last; i++)
+    {
+        pPass->destination[offsets[(pPass->source[i].key >> pPass->shift) & 0xFF]++] = pPass->source[i];
+    }
+}
+
+static void radixPassParallel(RenderQueue *pQueue, const RenderItem *source, RenderItem *destination, uint32_t shift)
+{
+    uint32_t chunkCount = (pQueue->count + RENDER_QUEUE_CHUNK - 1) / RENDER_QUEUE_CHUNK;
+    RadixPass pass = {pQueue, source, destination, shift};
+
+    jobSystemRun(pQueue->pJobs, chunkCount, histogramJob, &pass);
+
+    uint32_t start = 0;
+    for(uint32_t digit = 0; digit < 256; digit++)//Digit major, chunk minor, so earlier chunks land first within a bucket
+    {
+        for(uint32_t chunk = 0; chunk < chunkCount; chunk++)
+        {
+            uint32_t chunkDigitCount = pQueue->chunkHistograms[chunk][digit];
+            pQueue->chunkHistograms[chunk][digit] = start;
+            start += chunkDigitCount;
+        }
+    }
+
+    jobSystemRun(pQueue->pJobs, chunkCount, scatterJob, &pass);
+}
+
+void renderQueueSort(RenderQueue *pQueue)//Least significant digit radix sort, stable, so equal keys keep their push order
+{
+    uint32_t parallel = pQueue->pJobs != NULL && pQueue->pJobs->threadCount > 0 && pQueue->count >= RENDER_QUEUE_PARALLEL_THRESHOLD;
+    if(parallel)
+    {
+        uint32_t chunkCount = (pQueue->count + RENDER_QUEUE_CHUNK - 1) / RENDER_QUEUE_CHUNK;
+        if(chunkCount > pQueue->chunkCapacity)
+        {
+            pQueue->chunkCapacity = chunkCount;
+            pQueue->chunkHistograms = realloc(pQueue->chunkHistograms, sizeof(uint32_t[256]) * chunkCount);
+            if(pQueue->chunkHistograms == NULL)
+            {
+                printf("Failed to allocate render queue histograms!\n");
+                exit(1);
+            }
+        }
+    }
+
+    uint64_t varyingBits = pQueue->keyAnd ^ pQueue->keyOr;
+    for(uint32_t shift = 0; shift < 64; shift += 8)
+    {
+        if(((varyingBits >> shift) & 0xFF) == 0)//Every key has the same digit, the pass would not move anything
+        {
+            continue;
+        }
+
+        if(parallel)
+        {
+            radixPassParallel(pQueue, pQueue->items, pQueue->scratch, shift);
+        }
+        else
+        {
+            radixPassSerial(pQueue->items, pQueue->scratch, pQueue->count, shift);
+        }
+
+        RenderItem *sorted = pQueue->scratch;
+        pQueue->scratch = pQueue->items;
+        pQueue->items = sorted;
+    }
+}
+
+void renderQueueRecord(RenderQueue *pQueue, VkCommandBuffer commandBuffer, const RenderBindings *pBindings)//Binds only when the resolved handle differs from the one already bound
+{
+    VkPipeline boundPipeline = VK_NULL_HANDLE;
+    VkDescriptorSet boundDescriptorSet = VK_NULL_HANDLE;
+    VkBuffer boundVertexBuffer = VK_NULL_HANDLE;
+
+    for(uint32_t i = 0; i < pQueue->count; i++)
+    {
+        const DrawCommand *pCommand = &pQueue->commands[pQueue->items[i].command];
+
+        VkPipeline pipeline = pBindings->pipelines[pCommand->pipeline];
+        if(pipeline != boundPipeline)
+        {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            boundPipeline = pipeline;
+            pQueue->binds[RENDER_BIND_PIPELINE]++;
+        }
+        else
+        {
+            pQueue->skippedBinds[RENDER_BIND_PIPELINE]++;
+        }
+
+        VkDescriptorSet descriptorSet = pBindings->descriptorSets[pCommand->descriptorSet];
+        if(descriptorSet != boundDescriptorSet)//Every pipeline shares the layout, so sets stay bound across pipeline changes
+        {
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pBindings->pipelineLayout, 0, 1, &descriptorSet, 0, NULL);
+            boundDescriptorSet = descriptorSet;
+            pQueue->binds[RENDER_BIND_DESCRIPTOR_SET]++;
+        }
+        else
+        {
+            pQueue->skippedBinds[RENDER_BIND_DESCRIPTOR_SET]++;
+        }
+
+        VkBuffer vertexBuffer = pBindings->meshVertexBuffers[pCommand->mesh];
+        if(vertexBuffer != boundVertexBuffer)
+        {
+            VkBuffer vertexBuffers[] = {vertexBuffer, pBindings->instanceBuffer};
+            VkDeviceSize offsets[] = {0, 0};
+            vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+            boundVertexBuffer = vertexBuffer;
+            pQueue->binds[RENDER_BIND_VERTEX_BUFFERS]++;
+        }
+        else
+        {
+            pQueue->skippedBinds[RENDER_BIND_VERTEX_BUFFERS]++;
+        }
+
+        if(pCommand->indirect)
+        {
+            vkCmdDrawIndexedIndirect(commandBuffer, pBindings->indirectBuffer, pBindings->indirectOffset + sizeof(VkDrawIndexedIndirectCommand) * (VkDeviceSize)pCommand->indirectIndex, 1, sizeof(VkDrawIndexedIndirectCommand));
+        }
+        else
+        {
+            vkCmdDrawIndexed(commandBuffer, pCommand->indexCount, pCommand->instanceCount, pCommand->firstIndex, pCommand->vertexOffset, pCommand->firstInstance);
+        }
+    }
+    pQueue->draws += pQueue->count;
+}
+
+void printRenderQueueStats(const RenderQueue *pQueue)
+{
+    printf("Render queue: %llu draws\n", (unsigned long long)pQueue->draws);
+    for(uint32_t bind = 0; bind < RENDER_BIND_COUNT; bind++)
+    {
+        printf("\t%s binds: %llu issued, %llu redundant skipped\n", renderBindNames[bind], (unsigned long long)pQueue->binds[bind], (unsigned long long)pQueue->skippedBinds[bind]);
+    }
+}
+
+void destroyRenderQueue(RenderQueue *pQueue)
+{
+    free(pQueue->commands);
+    free(pQueue->items);
+    free(pQueue->scratch);
+    free(pQueue->chunkHistograms);
+    memset(pQueue, 0, sizeof(RenderQueue));
+}
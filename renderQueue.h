@@ -0,0 +1,89 @@
+//
+//  renderQueue.h
+//  vkProject
+//
+//  Per-frame draw list ordered by 64-bit state keys, recorded with redundant binds skipped.
+//
+
+#ifndef renderQueue_h
+#define renderQueue_h
+
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "jobSystem.h"
+
+#define RENDER_KEY_PASS_BITS 4//Most significant, passes never interleave
+#define RENDER_KEY_PIPELINE_BITS 12
+#define RENDER_KEY_DESCRIPTOR_SET_BITS 12
+#define RENDER_KEY_MESH_BITS 12
+#define RENDER_KEY_DEPTH_BITS 24//Least significant, orders draws that share all state
+
+#define RENDER_QUEUE_PARALLEL_THRESHOLD 16384//Below this the sort runs on the calling thread
+#define RENDER_QUEUE_CHUNK 4096//Draws per job of the parallel sort
+
+enum renderBind{RENDER_BIND_PIPELINE, RENDER_BIND_DESCRIPTOR_SET, RENDER_BIND_VERTEX_BUFFERS, RENDER_BIND_COUNT};
+
+typedef struct {
+    uint32_t pipeline;//Indices into the RenderBindings tables
+    uint32_t descriptorSet;
+    uint32_t mesh;
+    uint32_t indexCount;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t vertexOffset;
+    uint32_t firstInstance;
+    uint32_t indirect;//Nonzero to draw VkDrawIndexedIndirectCommand indirectIndex of the bindings' indirect buffer instead, the GPU filled in its counts
+    uint32_t indirectIndex;
+} DrawCommand;
+
+typedef struct {
+    uint64_t key;
+    uint32_t command;
+    uint32_t padding;
+} RenderItem;
+
+typedef struct {
+    const VkPipeline *pipelines;
+    VkPipelineLayout pipelineLayout;//Shared by every pipeline in the queue
+    const VkDescriptorSet *descriptorSets;
+    const VkBuffer *meshVertexBuffers;//Per mesh, meshes sub-allocated from one pool share a buffer
+    VkBuffer instanceBuffer;//Bound to binding 1 alongside every mesh
+    VkBuffer indirectBuffer;//Read by indirect draws only
+    VkDeviceSize indirectOffset;//Of the command indirectIndex 0 refers to
+} RenderBindings;
+
+typedef struct {
+    DrawCommand *commands;
+    RenderItem *items;
+    RenderItem *scratch;//Ping-pong target of the radix passes
+    uint32_t count;
+    uint32_t capacity;
+    uint64_t keyAnd;//Bits shared by every key pushed this frame, radix passes over them are skipped
+    uint64_t keyOr;
+
+    JobSystem *pJobs;
+    uint32_t (*chunkHistograms)[256];//One per chunk of the parallel sort
+    uint32_t chunkCapacity;
+
+    uint64_t draws;
+    uint64_t binds[RENDER_BIND_COUNT];//Totals since creation
+    uint64_t skippedBinds[RENDER_BIND_COUNT];//Binds a draw would have needed if every draw rebound its state
+} RenderQueue;
+
+void createRenderQueue(RenderQueue *pQueue, JobSystem *pJobs);
+
+uint64_t renderKey(uint32_t pass, uint32_t pipeline, uint32_t descriptorSet, uint32_t mesh, float depth);
+
+void renderQueueReset(RenderQueue *pQueue);
+
+void renderQueuePush(RenderQueue *pQueue, uint64_t key, const DrawCommand *pCommand);
+
+void renderQueueSort(RenderQueue *pQueue);
+
+void renderQueueRecord(RenderQueue *pQueue, VkCommandBuffer commandBuffer, const RenderBindings *pBindings);
+
+void printRenderQueueStats(const RenderQueue *pQueue);
+
+void destroyRenderQueue(RenderQueue *pQueue);
+
+#endif /* renderQueue_h */
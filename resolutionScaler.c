@@ -0,0 +1,97 @@
+//
+//  resolutionScaler.c
+//  vkProject
+//
+//  Picks the render resolution each frame from the measured GPU frame time, keeping it inside a budget.
+//
+
+#include "resolutionScaler.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void createResolutionScaler(ResolutionScaler *pScaler, float minScale, float maxScale, float budget, uint32_t slotCount)
+{
+    memset(pScaler, 0, sizeof(ResolutionScaler));
+    pScaler->minScale = minScale;
+    pScaler->maxScale = maxScale;
+    pScaler->budget = budget;
+    pScaler->scale = maxScale;//Starts sharp, the first measurements bring it down if needed
+    pScaler->lowestScale = maxScale;
+    pScaler->slotCount = slotCount;
+    pScaler->slotScales = calloc(slotCount, sizeof(float));
+    if(pScaler->slotScales == NULL)
+    {
+        printf("Failed to allocate resolution scaler!\n");
+        exit(1);
+    }
+}
+
+void resolutionScalerUpdate(ResolutionScaler *pScaler, uint32_t slot, double gpuFrame)//Once the slot's timestamps have been read back, gpuFrame is negative when they were unavailable
+{
+    float measuredScale = pScaler->slotScales[slot];
+    pScaler->slotScales[slot] = 0.0f;
+    if(measuredScale <= 0.0f || gpuFrame <= 0.0)
+    {
+        return;
+    }
+
+    pScaler->samples++;
+    pScaler->scaleSum += measuredScale;
+    if(measuredScale < pScaler->lowestScale)
+    {
+        pScaler->lowestScale = measuredScale;
+    }
+
+    //GPU time is taken to grow with the pixel count, so the scale that would have met the budget goes with the square root of the ratio
+    float target = measuredScale * sqrtf(RESOLUTION_HEADROOM * pScaler->budget / (float)gpuFrame);
+    float scale = target < pScaler->scale ? target : pScaler->scale + RESOLUTION_RISE_RATE * (target - pScaler->scale);//Spikes are answered the next frame, recovering slowly avoids oscillating around the budget
+    scale = fminf(fmaxf(scale, pScaler->minScale), pScaler->maxScale);
+    if(fabsf(scale - pScaler->scale) >= RESOLUTION_STEP || scale == pScaler->minScale || scale == pScaler->maxScale)
+    {
+        if(scale != pScaler->scale)
+        {
+            pScaler->changes++;
+        }
+        pScaler->scale = scale;
+    }
+}
+
+VkExtent2D resolutionScalerBeginFrame(ResolutionScaler *pScaler, uint32_t slot, VkExtent2D fullExtent, VkExtent2D maxExtent)//Extent to render the frame in the slot at, never larger than maxExtent
+{
+    pScaler->slotScales[slot] = pScaler->scale;
+    VkExtent2D extent = {
+        (uint32_t)lroundf(fullExtent.width * pScaler->scale),
+        (uint32_t)lroundf(fullExtent.height * pScaler->scale)
+    };
+    extent.width = extent.width < 1 ? 1 : extent.width > maxExtent.width ? maxExtent.width : extent.width;
+    extent.height = extent.height < 1 ? 1 : extent.height > maxExtent.height ? maxExtent.height : extent.height;
+    return extent;
+}
+
+VkExtent2D resolutionScalerMaxExtent(const ResolutionScaler *pScaler, VkExtent2D fullExtent)//Size of a render target that holds every scale
+{
+    VkExtent2D extent = {
+        (uint32_t)ceilf(fullExtent.width * pScaler->maxScale),
+        (uint32_t)ceilf(fullExtent.height * pScaler->maxScale)
+    };
+    extent.width = extent.width < 1 ? 1 : extent.width;
+    extent.height = extent.height < 1 ? 1 : extent.height;
+    return extent;
+}
+
+void printResolutionScaler(ResolutionScaler *pScaler)
+{
+    printf("Dynamic resolution: %.2f ms budget, scale %.2f-%.2f, mean %.3f, lowest %.3f over %llu frames, %llu changes\n",
+           pScaler->budget, pScaler->minScale, pScaler->maxScale,
+           pScaler->samples ? pScaler->scaleSum / pScaler->samples : pScaler->scale, pScaler->lowestScale,
+           (unsigned long long)pScaler->samples, (unsigned long long)pScaler->changes);
+}
+
+void destroyResolutionScaler(ResolutionScaler *pScaler)
+{
+    free(pScaler->slotScales);
+    memset(pScaler, 0, sizeof(ResolutionScaler));
+}
@@ -0,0 +1,44 @@
+//
+//  resolutionScaler.h
+//  vkProject
+//
+//  Picks the render resolution each frame from the measured GPU frame time, keeping it inside a budget.
+//
+
+#ifndef resolutionScaler_h
+#define resolutionScaler_h
+
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+
+#define RESOLUTION_HEADROOM 0.9f//Fraction of the budget aimed for, so noise does not push frames over it
+#define RESOLUTION_RISE_RATE 0.1f//Fraction of the way to a higher scale taken per measured frame, drops are taken at once
+#define RESOLUTION_STEP (1.0f / 64.0f)//Smaller changes are ignored, so the render extent does not jitter
+
+typedef struct {
+    float minScale;//Of each side of the swap chain extent
+    float maxScale;
+    float budget;//Milliseconds of GPU time per frame
+    float scale;//Applied to the frames recorded from now on
+    uint32_t slotCount;
+    float *slotScales;//Per frame in flight, the scale its frame was recorded at, 0 for none
+
+    uint64_t samples;//Totals over the frames measured
+    double scaleSum;
+    float lowestScale;
+    uint64_t changes;
+} ResolutionScaler;
+
+void createResolutionScaler(ResolutionScaler *pScaler, float minScale, float maxScale, float budget, uint32_t slotCount);
+
+void resolutionScalerUpdate(ResolutionScaler *pScaler, uint32_t slot, double gpuFrame);
+
+VkExtent2D resolutionScalerBeginFrame(ResolutionScaler *pScaler, uint32_t slot, VkExtent2D fullExtent, VkExtent2D maxExtent);
+
+VkExtent2D resolutionScalerMaxExtent(const ResolutionScaler *pScaler, VkExtent2D fullExtent);
+
+void printResolutionScaler(ResolutionScaler *pScaler);
+
+void destroyResolutionScaler(ResolutionScaler *pScaler);
+
+#endif /* resolutionScaler_h */
@@ -0,0 +1,34 @@
+#version 450
+
+struct Particle {
+    vec4 position;
+    vec4 velocity;
+};
+
+layout(set = 0, binding = 1) readonly buffer Particles {
+    Particle particles[];
+} current;
+
+layout(push_constant) uniform PushConstants {
+    mat4 view;
+    mat4 proj;
+} pc;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragCorner;
+
+const vec2 corners[6] = vec2[](
+    vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+    vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0)
+);
+
+void main() {
+    Particle particle = current.particles[gl_InstanceIndex];
+    vec2 corner = corners[gl_VertexIndex];
+    vec4 viewPosition = vec4(particle.position.xyz, 1.0) * pc.view;
+    viewPosition.xy += corner * 0.03; // Expanded in view space so the quad always faces the camera
+    gl_Position = viewPosition * pc.proj;
+    float age = 1.0 - particle.position.w / particle.velocity.w;
+    fragColor = mix(vec3(1.0, 0.9, 0.4), vec3(0.8, 0.2, 0.1), age);
+    fragCorner = corner;
+}
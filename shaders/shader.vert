@@ -1,17 +1,34 @@
 #version 450
 
+layout(constant_id = 0) const bool octahedralNormals = false;
+
 layout(binding = 0) uniform UniformBufferObject {
     mat4 model;
     mat4 view;
     mat4 proj;
+    vec4 positionScale;
+    vec4 positionOffset;
 } ubo;
 
-layout(location = 0) in vec2 inPosition;
+layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec3 inNormal;
+layout(location = 3) in vec2 inTexCoord;
+layout(location = 4) in mat4 inModel;
 
 layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragNormal;
+
+vec3 octahedralDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
 
 void main() {
-    gl_Position = vec4(inPosition, 0.0, 1.0) * ubo.model * ubo.view * ubo.proj;
+    vec3 position = inPosition * ubo.positionScale.xyz + ubo.positionOffset.xyz;
+    gl_Position = vec4(position, 1.0) * ubo.model * inModel * ubo.view * ubo.proj;
     fragColor = inColor;
+    fragNormal = octahedralNormals ? octahedralDecode(inNormal.xy) : inNormal;
 }
@@ -0,0 +1,32 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(set = 0, binding = 1) uniform sampler2D textures[];
+layout(set = 0, binding = 1) uniform sampler2DArray textureArrays[];
+
+layout(push_constant) uniform PushConstants {
+    uint uniformIndex;
+    uint textureIndex;
+} pc;
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec3 fragNormal;
+layout(location = 2) in vec2 fragTexCoord;
+layout(location = 3) flat in vec4 fragUvRect;
+layout(location = 4) flat in uvec2 fragTexture;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    vec3 color = fragColor;
+    if (fragTexture.x != 0xFFFFu) {
+        // Wrap inside the atlas rectangle, gradients come from the unwrapped coordinates so the seam keeps its mip level
+        vec2 uv = fragUvRect.xy + fract(fragTexCoord) * fragUvRect.zw;
+        vec2 dx = dFdx(fragTexCoord) * fragUvRect.zw;
+        vec2 dy = dFdy(fragTexCoord) * fragUvRect.zw;
+        color *= textureGrad(textureArrays[nonuniformEXT(fragTexture.x)], vec3(uv, float(fragTexture.y)), dx, dy).rgb;
+    } else if (pc.textureIndex != 0xFFFFFFFFu) {
+        color *= texture(textures[nonuniformEXT(pc.textureIndex)], fragTexCoord).rgb;
+    }
+    outColor = vec4(color, 1.0);
+}
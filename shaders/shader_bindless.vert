@@ -0,0 +1,53 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(constant_id = 0) const bool octahedralNormals = false;
+
+struct Uniforms {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+    vec4 positionScale;
+    vec4 positionOffset;
+};
+
+layout(set = 0, binding = 0) readonly buffer UniformBuffers {
+    Uniforms u;
+} uniformBuffers[];
+
+layout(push_constant) uniform PushConstants {
+    uint uniformIndex;
+    uint textureIndex;
+} pc;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec3 inNormal;
+layout(location = 3) in vec2 inTexCoord;
+layout(location = 4) in mat4 inModel;
+layout(location = 8) in vec4 inUvRect;
+layout(location = 9) in uvec2 inTexture;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragNormal;
+layout(location = 2) out vec2 fragTexCoord;
+layout(location = 3) flat out vec4 fragUvRect;
+layout(location = 4) flat out uvec2 fragTexture;
+
+vec3 octahedralDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+void main() {
+    Uniforms ubo = uniformBuffers[pc.uniformIndex].u;
+    vec3 position = inPosition * ubo.positionScale.xyz + ubo.positionOffset.xyz;
+    gl_Position = vec4(position, 1.0) * ubo.model * inModel * ubo.view * ubo.proj;
+    fragColor = inColor;
+    fragNormal = octahedralNormals ? octahedralDecode(inNormal.xy) : inNormal;
+    fragTexCoord = inTexCoord;
+    fragUvRect = inUvRect;
+    fragTexture = inTexture;
+}
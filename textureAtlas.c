@@ -0,0 +1,601 @@
+//
+//  textureAtlas.c
+//  vkProject
+//
+//  Packs many textures into a few 2D array images so differently textured instances share one draw.
+//
+
+#include "textureAtlas.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    const char **fileNames;
+    ImageData *images;
+    uint32_t *loaded;
+} DecodeBatch;
+
+static void *allocOrExit(size_t size)
+{
+    void *pMemory = malloc(size ? size : 1);
+    if(pMemory == NULL)
+    {
+        printf("Failed to allocate texture pack!\n");
+        exit(1);
+    }
+    return pMemory;
+}
+
+void createSkylinePacker(SkylinePacker *pPacker, uint32_t width, uint32_t height)
+{
+    pPacker->width = width;
+    pPacker->height = height;
+    pPacker->nodeCapacity = 16;
+    pPacker->nodes = allocOrExit(sizeof(SkylineNode) * pPacker->nodeCapacity);
+    pPacker->nodes[0] = (SkylineNode){0, 0, width};
+    pPacker->nodeCount = 1;
+    pPacker->usedArea = 0;
+}
+
+static uint32_t skylineFit(const SkylinePacker *pPacker, uint32_t index, uint32_t width, uint32_t height, uint32_t *pY)//Lowest y a rectangle starting at node index can rest on
+{
+    if(pPacker->nodes[index].x + width > pPacker->width)
+    {
+        return 0;
+    }
+
+    uint32_t y = 0;
+    uint32_t remaining = width;
+    for(uint32_t i = index; remaining > 0; i++)
+    {
+        y = pPacker->nodes[i].y > y ? pPacker->nodes[i].y : y;
+        if(y + height > pPacker->height)
+        {
+            return 0;
+        }
+        remaining -= pPacker->nodes[i].width < remaining ? pPacker->nodes[i].width : remaining;
+    }
+    *pY = y;
+    return 1;
+}
+
+uint32_t skylinePack(SkylinePacker *pPacker, uint32_t width, uint32_t height, uint32_t *pX, uint32_t *pY)//Bottom-left placement, returns 0 when the rectangle does not fit anywhere
+{
+    uint32_t bestIndex = UINT32_MAX;
+    uint32_t bestTop = UINT32_MAX;
+    uint32_t bestWidth = UINT32_MAX;
+    uint32_t bestY = 0;
+    for(uint32_t i = 0; i < pPacker->nodeCount; i++)
+    {
+        uint32_t y;
+        if(skylineFit(pPacker, i, width, height, &y) && (y + height < bestTop || (y + height == bestTop && pPacker->nodes[i].width < bestWidth)))//Lowest top first, then the narrowest ledge to keep wide ones free
+        {
+            bestIndex = i;
+            bestTop = y + height;
+            bestWidth = pPacker->nodes[i].width;
+            bestY = y;
+        }
+    }
+    if(bestIndex == UINT32_MAX)
+    {
+        return 0;
+    }
+
+    if(pPacker->nodeCount == pPacker->nodeCapacity)
+    {
+        pPacker->nodeCapacity *= 2;
+        pPacker->nodes = realloc(pPacker->nodes, sizeof(SkylineNode) * pPacker->nodeCapacity);
+        if(pPacker->nodes == NULL)
+        {
+            printf("Failed to allocate texture pack!\n");
+            exit(1);
+        }
+    }
+
+    SkylineNode *nodes = pPacker->nodes;
+    memmove(&nodes[bestIndex + 1], &nodes[bestIndex], sizeof(SkylineNode) * (pPacker->nodeCount - bestIndex));
+    nodes[bestIndex] = (SkylineNode){nodes[bestIndex + 1].x, bestY + height, width};
+    pPacker->nodeCount++;
+
+    uint32_t x = nodes[bestIndex].x;
+    uint32_t end = x + width;
+    while(bestIndex + 1 < pPacker->nodeCount && nodes[bestIndex + 1].x < end)//The new ledge covers the start of the nodes it rests on
+    {
+        uint32_t covered = end - nodes[bestIndex + 1].x;
+        if(covered < nodes[bestIndex + 1].width)
+        {
+            nodes[bestIndex + 1].x += covered;
+            nodes[bestIndex + 1].width -= covered;
+            break;
+        }
+        memmove(&nodes[bestIndex + 1], &nodes[bestIndex + 2], sizeof(SkylineNode) * (pPacker->nodeCount - bestIndex - 2));
+        pPacker->nodeCount--;
+    }
+
+    for(uint32_t i = 0; i + 1 < pPacker->nodeCount;)//Neighbours at the same height become one ledge
+    {
+        if(nodes[i].y == nodes[i + 1].y)
+        {
+            nodes[i].width += nodes[i + 1].width;
+            memmove(&nodes[i + 1], &nodes[i + 2], sizeof(SkylineNode) * (pPacker->nodeCount - i - 2));
+            pPacker->nodeCount--;
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    pPacker->usedArea += (uint64_t)width * height;
+    *pX = x;//Read before merging, which may move the new node
+    *pY = bestY;
+    return 1;
+}
+
+void destroySkylinePacker(SkylinePacker *pPacker)
+{
+    free(pPacker->nodes);
+}
+
+static void decodeJob(void *pData, uint32_t jobIndex)
+{
+    DecodeBatch *pBatch = pData;
+    pBatch->loaded[jobIndex] = loadImage(pBatch->fileNames[jobIndex], &pBatch->images[jobIndex]);
+}
+
+static TextureArray *addArray(TexturePack *pPack, uint32_t width, uint32_t height, uint32_t srgb, uint32_t atlas)
+{
+    pPack->arrays = realloc(pPack->arrays, sizeof(TextureArray) * (pPack->arrayCount + 1));
+    if(pPack->arrays == NULL)
+    {
+        printf("Failed to allocate texture pack!\n");
+        exit(1);
+    }
+    TextureArray *pArray = &pPack->arrays[pPack->arrayCount++];
+    memset(pArray, 0, sizeof(TextureArray));
+    pArray->width = width;
+    pArray->height = height;
+    pArray->srgb = srgb;
+    pArray->atlas = atlas;
+    pArray->bindlessIndex = BINDLESS_INVALID_INDEX;
+    return pArray;
+}
+
+static ImageData *addLayer(TextureArray *pArray)
+{
+    pArray->layers = realloc(pArray->layers, sizeof(ImageData) * (pArray->layerCount + 1));
+    if(pArray->layers == NULL)
+    {
+        printf("Failed to allocate texture pack!\n");
+        exit(1);
+    }
+    ImageData *pLayer = &pArray->layers[pArray->layerCount++];
+    memset(pLayer, 0, sizeof(ImageData));
+    return pLayer;
+}
+
+static uint32_t isAtlasEntry(const ImageData *pImage)
+{
+    return pImage->width <= ATLAS_MAX_ENTRY_SIZE && pImage->height <= ATLAS_MAX_ENTRY_SIZE;
+}
+
+static const ImageData *sortImages;
+
+static int compareEntryHeight(const void *a, const void *b)//Tallest first keeps the skyline flat, ties by width then input order for a stable layout
+{
+    const ImageData *pA = &sortImages[*(const uint32_t *)a];
+    const ImageData *pB = &sortImages[*(const uint32_t *)b];
+    if(pA->height != pB->height)
+    {
+        return pA->height < pB->height ? 1 : -1;
+    }
+    if(pA->width != pB->width)
+    {
+        return pA->width < pB->width ? 1 : -1;
+    }
+    return (*(const uint32_t *)a > *(const uint32_t *)b) - (*(const uint32_t *)a < *(const uint32_t *)b);
+}
+
+static void copyPadded(ImageData *pPage, const ImageData *pImage, uint32_t x, uint32_t y)//Writes the image at x, y and repeats its edge texels ATLAS_PADDING wide around it
+{
+    int32_t width = (int32_t)pImage->width;
+    int32_t height = (int32_t)pImage->height;
+    for(int32_t row = -ATLAS_PADDING; row < height + ATLAS_PADDING; row++)
+    {
+        int32_t sourceRow = row < 0 ? 0 : (row >= height ? height - 1 : row);
+        uint8_t *destination = pPage->levels[0] + 4 * ((size_t)(y + row) * pPage->width + x);
+        const uint8_t *source = pImage->levels[0] + 4 * (size_t)sourceRow * width;
+        for(int32_t column = -ATLAS_PADDING; column < 0; column++)
+        {
+            memcpy(destination + 4 * column, source, 4);
+        }
+        memcpy(destination, source, 4 * (size_t)width);
+        for(int32_t column = width; column < width + ATLAS_PADDING; column++)
+        {
+            memcpy(destination + 4 * column, source + 4 * (width - 1), 4);
+        }
+    }
+}
+
+static void limitLevels(ImageData *pImage, uint32_t levelCount)
+{
+    for(uint32_t level = levelCount; level < pImage->levelCount; level++)
+    {
+        free(pImage->levels[level]);
+        pImage->levels[level] = NULL;
+    }
+    pImage->levelCount = pImage->levelCount < levelCount ? pImage->levelCount : levelCount;
+}
+
+static void packAtlases(TexturePack *pPack, ImageData *images, const uint32_t *entries, uint32_t entryCount, uint32_t srgb, uint32_t maxLayers)
+{
+    uint32_t *sorted = allocOrExit(sizeof(uint32_t) * entryCount);
+    uint32_t sortedCount = 0;
+    for(uint32_t i = 0; i < entryCount; i++)
+    {
+        if(images[entries[i]].srgb == srgb)
+        {
+            sorted[sortedCount++] = entries[i];
+        }
+    }
+    sortImages = images;
+    qsort(sorted, sortedCount, sizeof(uint32_t), compareEntryHeight);
+
+    SkylinePacker *packers = allocOrExit(sizeof(SkylinePacker) * maxLayers);
+    uint32_t *positions = allocOrExit(sizeof(uint32_t) * 2 * sortedCount);
+    TextureArray *pArray = NULL;
+    uint32_t arrayIndex = 0;
+    uint32_t first = 0;
+    for(uint32_t i = 0; i <= sortedCount; i++)//Pages of an array are filled together, the array is written out once it is full or the entries run out
+    {
+        uint32_t placed = 0;
+        if(i < sortedCount)
+        {
+            const ImageData *pImage = &images[sorted[i]];
+            if(pArray == NULL)
+            {
+                pArray = addArray(pPack, ATLAS_SIZE, ATLAS_SIZE, srgb, 1);
+                arrayIndex = pPack->arrayCount - 1;
+                first = i;
+            }
+            for(uint32_t layer = 0; layer < pArray->layerCount && !placed; layer++)
+            {
+                if(skylinePack(&packers[layer], pImage->width + 2 * ATLAS_PADDING, pImage->height + 2 * ATLAS_PADDING, &positions[2 * i], &positions[2 * i + 1]))
+                {
+                    placed = 1;
+                    pPack->regions[sorted[i]].layer = layer;
+                }
+            }
+            if(!placed && pArray->layerCount < maxLayers)
+            {
+                addLayer(pArray);
+                uint32_t layer = pArray->layerCount - 1;
+                createSkylinePacker(&packers[layer], ATLAS_SIZE, ATLAS_SIZE);
+                skylinePack(&packers[layer], pImage->width + 2 * ATLAS_PADDING, pImage->height + 2 * ATLAS_PADDING, &positions[2 * i], &positions[2 * i + 1]);//Entries are at most ATLAS_MAX_ENTRY_SIZE, they always fit an empty page
+                placed = 1;
+                pPack->regions[sorted[i]].layer = pArray->layerCount - 1;
+            }
+        }
+        if(placed)
+        {
+            continue;
+        }
+        if(pArray == NULL)
+        {
+            break;
+        }
+
+        for(uint32_t layer = 0; layer < pArray->layerCount; layer++)
+        {
+            ImageData *pPage = &pArray->layers[layer];
+            pPage->width = ATLAS_SIZE;
+            pPage->height = ATLAS_SIZE;
+            pPage->srgb = srgb;
+            pPage->levelCount = 1;
+            pPage->levels[0] = calloc(1, (size_t)ATLAS_SIZE * ATLAS_SIZE * 4);
+            if(pPage->levels[0] == NULL)
+            {
+                printf("Failed to allocate texture pack!\n");
+                exit(1);
+            }
+            pPack->atlasArea += (uint64_t)ATLAS_SIZE * ATLAS_SIZE;
+            pPack->atlasUsedArea += packers[layer].usedArea;
+        }
+        for(uint32_t j = first; j < i; j++)
+        {
+            ImageData *pImage = &images[sorted[j]];
+            TextureRegion *pRegion = &pPack->regions[sorted[j]];
+            uint32_t x = positions[2 * j] + ATLAS_PADDING;
+            uint32_t y = positions[2 * j + 1] + ATLAS_PADDING;
+            copyPadded(&pArray->layers[pRegion->layer], pImage, x, y);
+            pRegion->array = arrayIndex;
+            pRegion->uvOffset[0] = (float)x / ATLAS_SIZE;
+            pRegion->uvOffset[1] = (float)y / ATLAS_SIZE;
+            pRegion->uvScale[0] = (float)pImage->width / ATLAS_SIZE;
+            pRegion->uvScale[1] = (float)pImage->height / ATLAS_SIZE;
+            freeImage(pImage);
+        }
+        for(uint32_t layer = 0; layer < pArray->layerCount; layer++)
+        {
+            generateImageLevels(&pArray->layers[layer]);
+            limitLevels(&pArray->layers[layer], ATLAS_LEVELS);
+            destroySkylinePacker(&packers[layer]);
+        }
+        pArray->levelCount = pArray->layers[0].levelCount;
+        pArray = NULL;
+        if(i < sortedCount)
+        {
+            i--;//The entry that did not fit starts the next array
+        }
+    }
+
+    free(positions);
+    free(packers);
+    free(sorted);
+}
+
+void buildTexturePack(TexturePack *pPack, const char **fileNames, uint32_t fileCount, uint32_t maxLayers, JobSystem *pJobs)//Decodes every file in parallel, then sorts them into atlas pages and same size arrays
+{
+    memset(pPack, 0, sizeof(TexturePack));
+    ImageData *images = allocOrExit(sizeof(ImageData) * fileCount);
+    uint32_t *loaded = allocOrExit(sizeof(uint32_t) * fileCount);
+    DecodeBatch batch = {fileNames, images, loaded};
+    jobSystemRun(pJobs, fileCount, decodeJob, &batch);
+    for(uint32_t i = 0; i < fileCount; i++)
+    {
+        if(!loaded[i])
+        {
+            printf("Failed to load texture %s!\n", fileNames[i]);
+            exit(1);
+        }
+    }
+
+    pPack->regionCount = fileCount;
+    pPack->regions = allocOrExit(sizeof(TextureRegion) * fileCount);
+    uint32_t *entries = allocOrExit(sizeof(uint32_t) * fileCount);
+    uint32_t entryCount = 0;
+
+    for(uint32_t i = 0; i < fileCount; i++)//Large images share an array with every image of the same size and encoding
+    {
+        ImageData *pImage = &images[i];
+        if(isAtlasEntry(pImage))
+        {
+            entries[entryCount++] = i;
+            continue;
+        }
+
+        TextureArray *pArray = NULL;
+        for(uint32_t a = 0; a < pPack->arrayCount && pArray == NULL; a++)
+        {
+            TextureArray *pCandidate = &pPack->arrays[a];
+            if(!pCandidate->atlas && pCandidate->width == pImage->width && pCandidate->height == pImage->height && pCandidate->srgb == pImage->srgb && pCandidate->layerCount < maxLayers)
+            {
+                pArray = pCandidate;
+            }
+        }
+        if(pArray == NULL)
+        {
+            pArray = addArray(pPack, pImage->width, pImage->height, pImage->srgb, 0);
+        }
+
+        generateImageLevels(pImage);
+        pArray->levelCount = pImage->levelCount;
+        uint32_t arrayIndex = (uint32_t)(pArray - pPack->arrays);
+        *addLayer(pArray) = *pImage;//Takes over the pixel data
+        pPack->regions[i] = (TextureRegion){arrayIndex, pArray->layerCount - 1, {0.0f, 0.0f}, {1.0f, 1.0f}};
+    }
+
+    for(uint32_t srgb = 0; srgb < 2; srgb++)
+    {
+        packAtlases(pPack, images, entries, entryCount, srgb, maxLayers);
+    }
+
+    free(entries);
+    free(loaded);
+    free(images);
+}
+
+void recordTexturePackUpload(TexturePack *pPack, VkDevice device, MemoryPolicy *pMemoryPolicy, DeletionQueue *pDeletionQueue, BindlessTable *pBindless, VkCommandBuffer commandBuffer, uint64_t uploadValue)//Staging is released once uploadValue has been reached
+{
+    VkSamplerCreateInfo samplerInfo = {
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = VK_FILTER_LINEAR,
+        .minFilter = VK_FILTER_LINEAR,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,//Wrapping is done in the shader, an atlas entry has to repeat within its own rectangle
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .anisotropyEnable = VK_FALSE,
+        .maxAnisotropy = 1.0f,
+        .minLod = 0.0f,
+        .maxLod = 1000.0f
+    };
+
+    if(vkCreateSampler(device, &samplerInfo, NULL, &pPack->sampler) != VK_SUCCESS)
+    {
+        printf("Failed to create texture pack sampler!\n");
+        exit(1);
+    }
+
+    for(uint32_t a = 0; a < pPack->arrayCount; a++)
+    {
+        TextureArray *pArray = &pPack->arrays[a];
+        uint32_t regionCount = pArray->layerCount * pArray->levelCount;
+        VkBufferImageCopy *regions = allocOrExit(sizeof(VkBufferImageCopy) * regionCount);
+        VkDeviceSize size = 0;
+        for(uint32_t layer = 0; layer < pArray->layerCount; layer++)
+        {
+            for(uint32_t level = 0; level < pArray->levelCount; level++)
+            {
+                regions[layer * pArray->levelCount + level] = (VkBufferImageCopy){
+                    .bufferOffset = size,
+                    .imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, layer, 1},
+                    .imageExtent = {imageLevelWidth(&pArray->layers[layer], level), imageLevelHeight(&pArray->layers[layer], level), 1}
+                };
+                size += imageLevelSize(&pArray->layers[layer], level);
+            }
+        }
+
+        VkBufferCreateInfo bufferInfo = {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .size = size,
+            .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE
+        };
+
+        VkBuffer stagingBuffer;
+        if(vkCreateBuffer(device, &bufferInfo, NULL, &stagingBuffer) != VK_SUCCESS)
+        {
+            printf("Failed to create texture pack staging buffer!\n");
+            exit(1);
+        }
+
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements(device, stagingBuffer, &requirements);
+        VkDeviceMemory stagingMemory;
+        uint32_t stagingType;
+        if(memoryPolicyAllocate(pMemoryPolicy, device, &requirements, MEMORY_USAGE_UPLOAD, &stagingMemory, &stagingType) != VK_SUCCESS)
+        {
+            printf("Failed to allocate texture pack staging memory!\n");
+            exit(1);
+        }
+        vkBindBufferMemory(device, stagingBuffer, stagingMemory, 0);
+
+        uint8_t *data;
+        vkMapMemory(device, stagingMemory, 0, size, 0, (void **)&data);
+        for(uint32_t layer = 0; layer < pArray->layerCount; layer++)
+        {
+            for(uint32_t level = 0; level < pArray->levelCount; level++)
+            {
+                memcpy(data + regions[layer * pArray->levelCount + level].bufferOffset, pArray->layers[layer].levels[level], imageLevelSize(&pArray->layers[layer], level));
+            }
+            freeImage(&pArray->layers[layer]);
+        }
+        memoryPolicyFlush(pMemoryPolicy, device, stagingMemory, stagingType, 0, VK_WHOLE_SIZE, VK_WHOLE_SIZE);
+        vkUnmapMemory(device, stagingMemory);
+
+        VkImageCreateInfo imageInfo = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+            .imageType = VK_IMAGE_TYPE_2D,
+            .format = pArray->srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM,
+            .extent = {pArray->width, pArray->height, 1},
+            .mipLevels = pArray->levelCount,
+            .arrayLayers = pArray->layerCount,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .tiling = VK_IMAGE_TILING_OPTIMAL,
+            .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+        };
+
+        if(vkCreateImage(device, &imageInfo, NULL, &pArray->image) != VK_SUCCESS)
+        {
+            printf("Failed to create texture array image!\n");
+            exit(1);
+        }
+
+        VkMemoryRequirements imageRequirements;
+        vkGetImageMemoryRequirements(device, pArray->image, &imageRequirements);
+        uint32_t memoryType;
+        if(memoryPolicyAllocate(pMemoryPolicy, device, &imageRequirements, MEMORY_USAGE_GPU_ONLY, &pArray->memory, &memoryType) != VK_SUCCESS)
+        {
+            printf("Failed to allocate texture array memory!\n");
+            exit(1);
+        }
+        vkBindImageMemory(device, pArray->image, pArray->memory, 0);
+
+        VkImageMemoryBarrier barrier = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask = 0,
+            .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = pArray->image,
+            .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, pArray->levelCount, 0, pArray->layerCount}
+        };
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+
+        vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, pArray->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, regionCount, regions);//Every level of every layer in one copy
+
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+
+        VkImageViewCreateInfo viewInfo = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .image = pArray->image,
+            .viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY,
+            .format = imageInfo.format,
+            .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, pArray->levelCount, 0, pArray->layerCount}
+        };
+
+        if(vkCreateImageView(device, &viewInfo, NULL, &pArray->imageView) != VK_SUCCESS)
+        {
+            printf("Failed to create texture array image view!\n");
+            exit(1);
+        }
+
+        if(pBindless != NULL)
+        {
+            pArray->bindlessIndex = bindlessAddImage(pBindless, device, pArray->imageView, pPack->sampler);
+        }
+
+        deleteBufferLater(pDeletionQueue, stagingBuffer, uploadValue);
+        deleteMemoryLater(pDeletionQueue, stagingMemory, uploadValue);
+        free(regions);
+    }
+}
+
+void printTexturePack(TexturePack *pPack)
+{
+    uint32_t atlasPages = 0;
+    uint32_t arrayLayers = 0;
+    for(uint32_t a = 0; a < pPack->arrayCount; a++)
+    {
+        if(pPack->arrays[a].atlas)
+        {
+            atlasPages += pPack->arrays[a].layerCount;
+        }
+        else
+        {
+            arrayLayers += pPack->arrays[a].layerCount;
+        }
+    }
+    printf("Texture pack: %u textures in %u array images, %u atlas pages %.1f%% filled, %u whole-image layers\n",
+           pPack->regionCount, pPack->arrayCount, atlasPages, pPack->atlasArea ? 100.0 * pPack->atlasUsedArea / pPack->atlasArea : 0.0, arrayLayers);
+}
+
+void destroyTexturePack(TexturePack *pPack, VkDevice device, BindlessTable *pBindless)//Only once the device is idle
+{
+    for(uint32_t a = 0; a < pPack->arrayCount; a++)
+    {
+        TextureArray *pArray = &pPack->arrays[a];
+        if(pBindless != NULL && pArray->bindlessIndex != BINDLESS_INVALID_INDEX)
+        {
+            bindlessReleaseImage(pBindless, pArray->bindlessIndex);
+        }
+        if(pArray->image != VK_NULL_HANDLE)
+        {
+            vkDestroyImageView(device, pArray->imageView, NULL);
+            vkDestroyImage(device, pArray->image, NULL);
+            vkFreeMemory(device, pArray->memory, NULL);
+        }
+        for(uint32_t layer = 0; layer < pArray->layerCount; layer++)
+        {
+            freeImage(&pArray->layers[layer]);
+        }
+        free(pArray->layers);
+    }
+    free(pPack->arrays);
+    free(pPack->regions);
+    if(pPack->sampler != VK_NULL_HANDLE)
+    {
+        vkDestroySampler(device, pPack->sampler, NULL);
+    }
+}
@@ -0,0 +1,84 @@
+//
+//  textureAtlas.h
+//  vkProject
+//
+//  Packs many textures into a few 2D array images so differently textured instances share one draw.
+//
+
+#ifndef textureAtlas_h
+#define textureAtlas_h
+
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "imageLoader.h"
+#include "jobSystem.h"
+#include "memoryPolicy.h"
+#include "deletionQueue.h"
+#include "descriptorAllocator.h"
+
+#define ATLAS_SIZE 2048//Side of every atlas page, pages are the layers of one array image
+#define ATLAS_MAX_ENTRY_SIZE 256//Images with both sides at most this go into atlas pages, larger ones into arrays of their own size
+#define ATLAS_PADDING 4//Texels of replicated edge around every entry
+#define ATLAS_LEVELS 3//Atlas mips kept, each halves the padding so further ones would blend neighbouring entries
+
+typedef struct {
+    uint32_t x;
+    uint32_t y;//Height of the skyline from x to the next node
+    uint32_t width;
+} SkylineNode;
+
+typedef struct {
+    uint32_t width;
+    uint32_t height;
+    SkylineNode *nodes;//Left to right, together they span the whole width
+    uint32_t nodeCount;
+    uint32_t nodeCapacity;
+    uint64_t usedArea;
+} SkylinePacker;
+
+typedef struct {
+    uint32_t array;//Index into TexturePack.arrays
+    uint32_t layer;
+    float uvOffset[2];//Texture coordinates in [0, 1] map to uvOffset + uv * uvScale within the layer
+    float uvScale[2];
+} TextureRegion;
+
+typedef struct {
+    uint32_t width;
+    uint32_t height;
+    uint32_t srgb;
+    uint32_t atlas;//Layers are atlas pages rather than whole images
+    uint32_t layerCount;
+    uint32_t levelCount;
+    ImageData *layers;//CPU copies, freed once recorded for upload
+    VkImage image;
+    VkDeviceMemory memory;
+    VkImageView imageView;
+    uint32_t bindlessIndex;
+} TextureArray;
+
+typedef struct {
+    TextureArray *arrays;
+    uint32_t arrayCount;
+    TextureRegion *regions;//One per packed image, in the order they were given
+    uint32_t regionCount;
+    VkSampler sampler;
+    uint64_t atlasArea;//Texels of all atlas pages and how many of them hold images, for the fill ratio
+    uint64_t atlasUsedArea;
+} TexturePack;
+
+void createSkylinePacker(SkylinePacker *pPacker, uint32_t width, uint32_t height);
+
+uint32_t skylinePack(SkylinePacker *pPacker, uint32_t width, uint32_t height, uint32_t *pX, uint32_t *pY);
+
+void destroySkylinePacker(SkylinePacker *pPacker);
+
+void buildTexturePack(TexturePack *pPack, const char **fileNames, uint32_t fileCount, uint32_t maxLayers, JobSystem *pJobs);
+
+void recordTexturePackUpload(TexturePack *pPack, VkDevice device, MemoryPolicy *pMemoryPolicy, DeletionQueue *pDeletionQueue, BindlessTable *pBindless, VkCommandBuffer commandBuffer, uint64_t uploadValue);
+
+void printTexturePack(TexturePack *pPack);
+
+void destroyTexturePack(TexturePack *pPack, VkDevice device, BindlessTable *pBindless);
+
+#endif /* textureAtlas_h */
@@ -0,0 +1,477 @@
+//
+//  textureStreamer.c
+//  vkProject
+//
+//  Decodes textures on loader threads and streams their mip levels to the GPU within a memory budget.
+//
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "textureStreamer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    BindlessTable *pBindless;
+    uint32_t index;
+} BindlessRelease;
+
+static void *allocOrExit(size_t size)
+{
+    void *pMemory = malloc(size ? size : 1);
+    if(pMemory == NULL)
+    {
+        printf("Failed to allocate texture streamer!\n");
+        exit(1);
+    }
+    return pMemory;
+}
+
+static void *loaderMain(void *pArgument)//Decodes queued textures in order, the CPU mip chain is built here so the render thread only copies
+{
+    TextureStreamer *pStreamer = pArgument;
+
+    pthread_mutex_lock(&pStreamer->mutex);
+    while(1)
+    {
+        while(!pStreamer->shutdown && pStreamer->nextToDecode == pStreamer->textureCount)
+        {
+            pthread_cond_wait(&pStreamer->workAvailable, &pStreamer->mutex);
+        }
+        if(pStreamer->shutdown)
+        {
+            break;
+        }
+
+        uint32_t texture = pStreamer->nextToDecode++;
+        const char *fileName = pStreamer->textures[texture].fileName;//The array may be reallocated while unlocked, the string is not
+        pthread_mutex_unlock(&pStreamer->mutex);
+
+        ImageData image;
+        uint32_t loaded = loadImage(fileName, &image);
+        if(loaded)
+        {
+            generateImageLevels(&image);
+        }
+
+        pthread_mutex_lock(&pStreamer->mutex);
+        Texture *pTexture = &pStreamer->textures[texture];
+        if(loaded)
+        {
+            pTexture->source = image;
+            pTexture->width = image.width;
+            pTexture->height = image.height;
+            pTexture->levelCount = image.levelCount;
+            pTexture->residentLevel = image.levelCount;
+            pTexture->state = TEXTURE_DECODED;
+        }
+        else
+        {
+            pTexture->state = TEXTURE_FAILED;
+        }
+    }
+    pthread_mutex_unlock(&pStreamer->mutex);
+    return NULL;
+}
+
+static void createMappedBuffer(TextureStreamer *pStreamer, VkDeviceSize size, VkBuffer *pBuffer, VkDeviceMemory *pMemory, void **ppMapped, uint32_t *pMemoryType)
+{
+    VkBufferCreateInfo bufferInfo = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = size,
+        .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE
+    };
+
+    if(vkCreateBuffer(pStreamer->device, &bufferInfo, NULL, pBuffer) != VK_SUCCESS)
+    {
+        printf("Failed to create texture staging buffer!\n");
+        exit(1);
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(pStreamer->device, *pBuffer, &requirements);
+    if(memoryPolicyAllocate(pStreamer->pMemoryPolicy, pStreamer->device, &requirements, MEMORY_USAGE_UPLOAD, pMemory, pMemoryType) != VK_SUCCESS)
+    {
+        printf("Failed to allocate texture staging memory!\n");
+        exit(1);
+    }
+    vkBindBufferMemory(pStreamer->device, *pBuffer, *pMemory, 0);
+    vkMapMemory(pStreamer->device, *pMemory, 0, size, 0, ppMapped);
+}
+
+void createTextureStreamer(TextureStreamer *pStreamer, VkDevice device, MemoryPolicy *pMemoryPolicy, DeletionQueue *pDeletionQueue, BindlessTable *pBindless, uint32_t frameCount, VkDeviceSize budget)
+{
+    memset(pStreamer, 0, sizeof(TextureStreamer));
+    pStreamer->device = device;
+    pStreamer->pMemoryPolicy = pMemoryPolicy;
+    pStreamer->pDeletionQueue = pDeletionQueue;
+    pStreamer->pBindless = pBindless;
+    pStreamer->frameCount = frameCount;
+    pStreamer->budget = budget;
+
+    pStreamer->stagingBuffers = allocOrExit(sizeof(VkBuffer) * frameCount);
+    pStreamer->stagingMemory = allocOrExit(sizeof(VkDeviceMemory) * frameCount);
+    pStreamer->stagingMapped = allocOrExit(sizeof(void *) * frameCount);
+    for(uint32_t i = 0; i < frameCount; i++)
+    {
+        createMappedBuffer(pStreamer, TEXTURE_STAGING_SIZE, &pStreamer->stagingBuffers[i], &pStreamer->stagingMemory[i], &pStreamer->stagingMapped[i], &pStreamer->stagingMemoryType);
+    }
+
+    VkSamplerCreateInfo samplerInfo = {
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = VK_FILTER_LINEAR,
+        .minFilter = VK_FILTER_LINEAR,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+        .anisotropyEnable = VK_FALSE,
+        .maxAnisotropy = 1.0f,
+        .minLod = 0.0f,
+        .maxLod = 1000.0f//Every level the image view exposes
+    };
+
+    if(vkCreateSampler(device, &samplerInfo, NULL, &pStreamer->sampler) != VK_SUCCESS)
+    {
+        printf("Failed to create texture sampler!\n");
+        exit(1);
+    }
+
+    pthread_mutex_init(&pStreamer->mutex, NULL);
+    pthread_cond_init(&pStreamer->workAvailable, NULL);
+    for(uint32_t i = 0; i < TEXTURE_LOADER_THREADS; i++)
+    {
+        if(pthread_create(&pStreamer->threads[i], NULL, loaderMain, pStreamer) != 0)
+        {
+            printf("Failed to create texture loader thread!\n");
+            exit(1);
+        }
+    }
+}
+
+uint32_t textureStreamerLoad(TextureStreamer *pStreamer, const char *fileName)//Returns immediately with the texture index, nothing is sampleable until a later update
+{
+    pthread_mutex_lock(&pStreamer->mutex);
+    if(pStreamer->textureCount == pStreamer->textureCapacity)
+    {
+        pStreamer->textureCapacity = pStreamer->textureCapacity ? 2 * pStreamer->textureCapacity : 16;
+        pStreamer->textures = realloc(pStreamer->textures, sizeof(Texture) * pStreamer->textureCapacity);
+        if(pStreamer->textures == NULL)
+        {
+            printf("Failed to allocate texture list!\n");
+            exit(1);
+        }
+    }
+
+    uint32_t texture = pStreamer->textureCount++;
+    Texture *pTexture = &pStreamer->textures[texture];
+    memset(pTexture, 0, sizeof(Texture));
+    pTexture->fileName = strdup(fileName);
+    pTexture->state = TEXTURE_QUEUED;
+    pTexture->bindlessIndex = BINDLESS_INVALID_INDEX;
+
+    pthread_cond_signal(&pStreamer->workAvailable);
+    pthread_mutex_unlock(&pStreamer->mutex);
+    return texture;
+}
+
+static void releaseBindlessSlot(VkDevice device, void *pData)
+{
+    BindlessRelease *pRelease = pData;
+    bindlessReleaseImage(pRelease->pBindless, pRelease->index);
+    free(pRelease);
+}
+
+static uint32_t initialLevel(const Texture *pTexture)
+{
+    uint32_t level = 0;
+    while(level + 1 < pTexture->levelCount && ((pTexture->width >> level) > TEXTURE_INITIAL_SIZE || (pTexture->height >> level) > TEXTURE_INITIAL_SIZE))
+    {
+        level++;
+    }
+    return level;
+}
+
+static VkDeviceSize chainSize(const Texture *pTexture, uint32_t firstLevel)//Texel bytes of an image holding firstLevel and everything coarser
+{
+    VkDeviceSize size = 0;
+    for(uint32_t level = firstLevel; level < pTexture->levelCount; level++)
+    {
+        size += imageLevelSize(&pTexture->source, level);
+    }
+    return size;
+}
+
+static void imageBarrier(VkCommandBuffer commandBuffer, VkImage image, uint32_t baseLevel, uint32_t levelCount, VkImageLayout oldLayout, VkImageLayout newLayout,
+                         VkAccessFlags srcAccess, VkAccessFlags dstAccess, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage)
+{
+    VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = srcAccess,
+        .dstAccessMask = dstAccess,
+        .oldLayout = oldLayout,
+        .newLayout = newLayout,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image,
+        .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, baseLevel, levelCount, 0, 1}
+    };
+
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, NULL, 0, NULL, 1, &barrier);
+}
+
+static void uploadLevel(TextureStreamer *pStreamer, Texture *pTexture, uint32_t level, VkCommandBuffer commandBuffer, VkBuffer staging, VkDeviceSize stagingOffset, uint64_t previousValue, uint64_t frameValue)//Replaces the resident image by one whose mip 0 is level, the coarser mips are blitted from it on the GPU
+{
+    uint32_t width = imageLevelWidth(&pTexture->source, level);
+    uint32_t height = imageLevelHeight(&pTexture->source, level);
+    uint32_t mipCount = pTexture->levelCount - level;
+
+    VkImageCreateInfo imageInfo = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = pTexture->source.srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM,//Blits with linear filtering are mandatory for both
+        .extent = {width, height, 1},
+        .mipLevels = mipCount,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+    };
+
+    VkImage image;
+    if(vkCreateImage(pStreamer->device, &imageInfo, NULL, &image) != VK_SUCCESS)
+    {
+        printf("Failed to create texture image!\n");
+        exit(1);
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(pStreamer->device, image, &requirements);
+    VkDeviceMemory memory;
+    uint32_t memoryType;
+    if(memoryPolicyAllocate(pStreamer->pMemoryPolicy, pStreamer->device, &requirements, MEMORY_USAGE_GPU_ONLY, &memory, &memoryType) != VK_SUCCESS)
+    {
+        printf("Failed to allocate texture memory!\n");
+        exit(1);
+    }
+    vkBindImageMemory(pStreamer->device, image, memory, 0);
+
+    imageBarrier(commandBuffer, image, 0, mipCount, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    VkBufferImageCopy region = {
+        .bufferOffset = stagingOffset,
+        .bufferRowLength = 0,//Tightly packed
+        .bufferImageHeight = 0,
+        .imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+        .imageOffset = {0, 0, 0},
+        .imageExtent = {width, height, 1}
+    };
+    vkCmdCopyBufferToImage(commandBuffer, staging, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    for(uint32_t mip = 1; mip < mipCount; mip++)//Each mip is read once it has been written, then handed to the fragment shader
+    {
+        imageBarrier(commandBuffer, image, mip - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                     VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+        int32_t sourceWidth = (int32_t)(width >> (mip - 1) ? width >> (mip - 1) : 1);
+        int32_t sourceHeight = (int32_t)(height >> (mip - 1) ? height >> (mip - 1) : 1);
+        VkImageBlit blit = {
+            .srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, mip - 1, 0, 1},
+            .srcOffsets = {{0, 0, 0}, {sourceWidth, sourceHeight, 1}},
+            .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, mip, 0, 1},
+            .dstOffsets = {{0, 0, 0}, {sourceWidth > 1 ? sourceWidth / 2 : 1, sourceHeight > 1 ? sourceHeight / 2 : 1, 1}}
+        };
+        vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+        imageBarrier(commandBuffer, image, mip - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                     VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    }
+    imageBarrier(commandBuffer, image, mipCount - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                 VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+    VkImageViewCreateInfo viewInfo = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = imageInfo.format,
+        .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, mipCount, 0, 1}
+    };
+
+    VkImageView imageView;
+    if(vkCreateImageView(pStreamer->device, &viewInfo, NULL, &imageView) != VK_SUCCESS)
+    {
+        printf("Failed to create texture image view!\n");
+        exit(1);
+    }
+
+    uint64_t retireValue = pTexture->imageValue == frameValue ? frameValue : previousValue;//An image created earlier in this update is still written by the unsubmitted command buffer
+    if(pTexture->image != VK_NULL_HANDLE)//Frames already submitted may still sample the coarser image
+    {
+        deleteImageViewLater(pStreamer->pDeletionQueue, pTexture->imageView, retireValue);
+        deleteImageLater(pStreamer->pDeletionQueue, pTexture->image, retireValue);
+        deleteMemoryLater(pStreamer->pDeletionQueue, pTexture->memory, retireValue);
+        pStreamer->residentBytes -= pTexture->bytes;
+    }
+
+    if(pStreamer->pBindless != NULL)//A slot can not be rewritten while pending frames read it, so each upgrade takes a new one
+    {
+        if(pTexture->bindlessIndex != BINDLESS_INVALID_INDEX)
+        {
+            BindlessRelease *pRelease = allocOrExit(sizeof(BindlessRelease));
+            pRelease->pBindless = pStreamer->pBindless;
+            pRelease->index = pTexture->bindlessIndex;
+            deleteLater(pStreamer->pDeletionQueue, releaseBindlessSlot, pRelease, retireValue);
+        }
+        pTexture->bindlessIndex = bindlessAddImage(pStreamer->pBindless, pStreamer->device, imageView, pStreamer->sampler);
+    }
+
+    pTexture->image = image;
+    pTexture->memory = memory;
+    pTexture->imageView = imageView;
+    pTexture->imageValue = frameValue;
+    pTexture->bytes = requirements.size;
+    pTexture->residentLevel = level;
+    pStreamer->residentBytes += requirements.size;
+    pStreamer->uploadedBytes += imageLevelSize(&pTexture->source, level);
+    pStreamer->upgrades++;
+
+    if(level == 0)
+    {
+        freeImage(&pTexture->source);
+        pTexture->state = TEXTURE_COMPLETE;
+    }
+}
+
+void textureStreamerUpdate(TextureStreamer *pStreamer, VkCommandBuffer commandBuffer, uint32_t frameSlot, uint64_t previousValue, uint64_t frameValue)//Records uploads before the render pass, previousValue is the last submission and frameValue the one this command buffer signals
+{
+    pthread_mutex_lock(&pStreamer->mutex);
+    for(uint32_t i = 0; i < pStreamer->textureCount; i++)
+    {
+        if(pStreamer->textures[i].state == TEXTURE_DECODED)//From here on only this thread touches the texture
+        {
+            pStreamer->textures[i].state = TEXTURE_STREAMING;
+        }
+    }
+    uint32_t textureCount = pStreamer->textureCount;
+
+    VkDeviceSize staged = 0;
+    uint8_t *stagingMapped = pStreamer->stagingMapped[frameSlot];
+    while(1)
+    {
+        Texture *pTexture = NULL;
+        for(uint32_t i = 0; i < textureCount; i++)//Coarsest first, so every texture gets a first level before any gets sharper
+        {
+            Texture *pCandidate = &pStreamer->textures[i];
+            if(pCandidate->state == TEXTURE_STREAMING && (pTexture == NULL || pCandidate->residentLevel > pTexture->residentLevel))
+            {
+                pTexture = pCandidate;
+            }
+        }
+        if(pTexture == NULL)
+        {
+            break;
+        }
+
+        uint32_t firstUpload = pTexture->residentLevel == pTexture->levelCount;
+        uint32_t level = firstUpload ? initialLevel(pTexture) : pTexture->residentLevel - 1;
+        VkDeviceSize growth = chainSize(pTexture, level) - (firstUpload ? 0 : chainSize(pTexture, pTexture->residentLevel));
+        if(!firstUpload && pStreamer->residentBytes + growth > pStreamer->budget)//Finer levels of the others cost at least as much, the first levels are always allowed
+        {
+            break;
+        }
+
+        VkDeviceSize levelSize = imageLevelSize(&pTexture->source, level);
+        if(staged + levelSize <= TEXTURE_STAGING_SIZE)
+        {
+            memcpy(stagingMapped + staged, pTexture->source.levels[level], (size_t)levelSize);
+            memoryPolicyFlush(pStreamer->pMemoryPolicy, pStreamer->device, pStreamer->stagingMemory[frameSlot], pStreamer->stagingMemoryType, staged, levelSize, TEXTURE_STAGING_SIZE);
+            uploadLevel(pStreamer, pTexture, level, commandBuffer, pStreamer->stagingBuffers[frameSlot], staged, previousValue, frameValue);
+            staged += levelSize;
+        }
+        else if(staged == 0)//A level larger than the whole staging buffer gets a buffer of its own, freed once this frame completes
+        {
+            VkBuffer buffer;
+            VkDeviceMemory memory;
+            void *pMapped;
+            uint32_t memoryType;
+            createMappedBuffer(pStreamer, levelSize, &buffer, &memory, &pMapped, &memoryType);
+            memcpy(pMapped, pTexture->source.levels[level], (size_t)levelSize);
+            memoryPolicyFlush(pStreamer->pMemoryPolicy, pStreamer->device, memory, memoryType, 0, VK_WHOLE_SIZE, VK_WHOLE_SIZE);
+            uploadLevel(pStreamer, pTexture, level, commandBuffer, buffer, 0, previousValue, frameValue);
+            deleteBufferLater(pStreamer->pDeletionQueue, buffer, frameValue);
+            deleteMemoryLater(pStreamer->pDeletionQueue, memory, frameValue);
+            break;
+        }
+        else
+        {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&pStreamer->mutex);//Held throughout as the loader threads still write queued entries, they only take it briefly
+}
+
+uint32_t textureStreamerBindlessIndex(TextureStreamer *pStreamer, uint32_t texture)//BINDLESS_INVALID_INDEX until the first level is resident
+{
+    return texture < pStreamer->textureCount ? pStreamer->textures[texture].bindlessIndex : BINDLESS_INVALID_INDEX;
+}
+
+void printTextureStreamerStats(TextureStreamer *pStreamer)
+{
+    uint32_t complete = 0;
+    uint32_t failed = 0;
+    pthread_mutex_lock(&pStreamer->mutex);
+    for(uint32_t i = 0; i < pStreamer->textureCount; i++)
+    {
+        complete += pStreamer->textures[i].state == TEXTURE_COMPLETE;
+        failed += pStreamer->textures[i].state == TEXTURE_FAILED;
+    }
+    pthread_mutex_unlock(&pStreamer->mutex);
+
+    printf("Textures: %u loaded, %u at full resolution, %u failed, %.1f/%.1f MiB resident, %.1f MiB uploaded in %u level uploads\n",
+           pStreamer->textureCount, complete, failed, pStreamer->residentBytes / 1048576.0, pStreamer->budget / 1048576.0, pStreamer->uploadedBytes / 1048576.0, pStreamer->upgrades);
+}
+
+void destroyTextureStreamer(TextureStreamer *pStreamer)//Only once the device is idle and the deletion queue has been flushed
+{
+    pthread_mutex_lock(&pStreamer->mutex);
+    pStreamer->shutdown = 1;
+    pthread_cond_broadcast(&pStreamer->workAvailable);
+    pthread_mutex_unlock(&pStreamer->mutex);
+
+    for(uint32_t i = 0; i < TEXTURE_LOADER_THREADS; i++)
+    {
+        pthread_join(pStreamer->threads[i], NULL);
+    }
+    pthread_cond_destroy(&pStreamer->workAvailable);
+    pthread_mutex_destroy(&pStreamer->mutex);
+
+    for(uint32_t i = 0; i < pStreamer->textureCount; i++)
+    {
+        Texture *pTexture = &pStreamer->textures[i];
+        if(pTexture->image != VK_NULL_HANDLE)
+        {
+            vkDestroyImageView(pStreamer->device, pTexture->imageView, NULL);
+            vkDestroyImage(pStreamer->device, pTexture->image, NULL);
+            vkFreeMemory(pStreamer->device, pTexture->memory, NULL);
+        }
+        freeImage(&pTexture->source);
+        free(pTexture->fileName);
+    }
+    free(pStreamer->textures);
+
+    for(uint32_t i = 0; i < pStreamer->frameCount; i++)
+    {
+        vkDestroyBuffer(pStreamer->device, pStreamer->stagingBuffers[i], NULL);
+        vkFreeMemory(pStreamer->device, pStreamer->stagingMemory[i], NULL);
+    }
+    free(pStreamer->stagingBuffers);
+    free(pStreamer->stagingMemory);
+    free(pStreamer->stagingMapped);
+    vkDestroySampler(pStreamer->device, pStreamer->sampler, NULL);
+}
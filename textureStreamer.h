@@ -0,0 +1,83 @@
+//
+//  textureStreamer.h
+//  vkProject
+//
+//  Decodes textures on loader threads and streams their mip levels to the GPU within a memory budget.
+//
+
+#ifndef textureStreamer_h
+#define textureStreamer_h
+
+#include <stdint.h>
+#include <pthread.h>
+#include <vulkan/vulkan.h>
+#include "imageLoader.h"
+#include "memoryPolicy.h"
+#include "deletionQueue.h"
+#include "descriptorAllocator.h"
+
+#define TEXTURE_LOADER_THREADS 2
+#define TEXTURE_INITIAL_SIZE 64//Largest side of the first level made resident, small enough to show something on the next frame
+#define TEXTURE_STAGING_SIZE (16u << 20)//Per frame in flight, also the most texel data uploaded in one frame
+#define DEFAULT_TEXTURE_BUDGET (256u << 20)
+
+enum textureState{TEXTURE_QUEUED, TEXTURE_DECODED, TEXTURE_STREAMING, TEXTURE_COMPLETE, TEXTURE_FAILED};
+
+typedef struct {
+    char *fileName;
+    uint32_t state;//Written by the loader threads under the streamer mutex until the texture is decoded
+    ImageData source;//CPU mip chain, freed once the finest level is resident
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+    uint32_t residentLevel;//Finest level on the GPU, image mip 0 holds it, levelCount while nothing is resident
+    VkImage image;
+    VkDeviceMemory memory;
+    VkImageView imageView;
+    VkDeviceSize bytes;
+    uint32_t bindlessIndex;//BINDLESS_INVALID_INDEX without a bindless table
+    uint64_t imageValue;//Submission whose command buffer created the resident image
+} Texture;
+
+typedef struct {
+    VkDevice device;
+    MemoryPolicy *pMemoryPolicy;
+    DeletionQueue *pDeletionQueue;
+    BindlessTable *pBindless;//Optional, every resident image gets a slot that is replaced on each upgrade
+
+    Texture *textures;
+    uint32_t textureCount;
+    uint32_t textureCapacity;
+
+    pthread_t threads[TEXTURE_LOADER_THREADS];
+    pthread_mutex_t mutex;
+    pthread_cond_t workAvailable;
+    uint32_t nextToDecode;//Textures before this index have been picked up by a loader thread
+    uint32_t shutdown;
+
+    VkSampler sampler;
+    uint32_t frameCount;
+    VkBuffer *stagingBuffers;//One per frame in flight, reused once that frame's fence has signalled
+    VkDeviceMemory *stagingMemory;
+    void **stagingMapped;
+    uint32_t stagingMemoryType;
+
+    VkDeviceSize budget;
+    VkDeviceSize residentBytes;
+    uint64_t uploadedBytes;
+    uint32_t upgrades;
+} TextureStreamer;
+
+void createTextureStreamer(TextureStreamer *pStreamer, VkDevice device, MemoryPolicy *pMemoryPolicy, DeletionQueue *pDeletionQueue, BindlessTable *pBindless, uint32_t frameCount, VkDeviceSize budget);
+
+uint32_t textureStreamerLoad(TextureStreamer *pStreamer, const char *fileName);
+
+void textureStreamerUpdate(TextureStreamer *pStreamer, VkCommandBuffer commandBuffer, uint32_t frameSlot, uint64_t previousValue, uint64_t frameValue);
+
+uint32_t textureStreamerBindlessIndex(TextureStreamer *pStreamer, uint32_t texture);
+
+void printTextureStreamerStats(TextureStreamer *pStreamer);
+
+void destroyTextureStreamer(TextureStreamer *pStreamer);
+
+#endif /* textureStreamer_h */
@@ -0,0 +1,272 @@
+//
+//  transformStage.c
+//  vkProject
+//
+//  Animates instances on the GPU, a compute shader writes their world matrices straight into the instance buffer.
+//
+
+#include "transformStage.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "vkMath.h"
+#include "utils.h"
+
+#define TRANSFORM_TWO_PI 6.2831853f//Same constant as shaders/transform.comp
+
+static void *allocOrExit(size_t size)
+{
+    void *pMemory = malloc(size ? size : 1);
+    if(pMemory == NULL)
+    {
+        printf("Failed to allocate transform stage!\n");
+        exit(1);
+    }
+    return pMemory;
+}
+
+void animateTransform(float model[4][4], const InstanceAnimation *pAnimation, float time)//CPU reference of shaders/transform.comp, translation * rotation * scale
+{
+    float turns = pAnimation->angularSpeed * time / TRANSFORM_TWO_PI;
+    float angle = (turns - floorf(turns)) * TRANSFORM_TWO_PI;//Wrapped like the shader, sin and cos are only accurate near zero there
+    vector axis = {pAnimation->axis[0], pAnimation->axis[1], pAnimation->axis[2]};
+    quaternion rest = {pAnimation->rotation[0], pAnimation->rotation[1], pAnimation->rotation[2], pAnimation->rotation[3]};
+    quaternion rotation = q_mult(q_angle_vector(angle, axis), rest);
+
+    float matrix[4][4];
+    scalingMatrix(model, (vector){pAnimation->scale, pAnimation->scale, pAnimation->scale});
+    quaternionMatrix(matrix, rotation);
+    matmul(matrix, model);
+    translationMatrix(matrix, (vector){pAnimation->translation[0], pAnimation->translation[1], pAnimation->translation[2]});
+    matmul(matrix, model);
+}
+
+static void createDescriptors(TransformStage *pStage, VkBuffer animationBuffer, const VkBuffer *outputBuffers)
+{
+    VkDescriptorSetLayoutBinding bindings[3];
+    for(uint32_t i = 0; i < 3; i++)
+    {
+        bindings[i] = (VkDescriptorSetLayoutBinding){
+            .binding = i,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT
+        };
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = 3,
+        .pBindings = bindings
+    };
+
+    if(vkCreateDescriptorSetLayout(pStage->device, &layoutInfo, NULL, &pStage->setLayout) != VK_SUCCESS)
+    {
+        printf("Failed to create transform descriptor set layout!\n");
+        exit(1);
+    }
+
+    VkDescriptorPoolSize poolSize = {
+        .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .descriptorCount = 3 * pStage->frameCount
+    };
+
+    VkDescriptorPoolCreateInfo poolInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .maxSets = pStage->frameCount,
+        .poolSizeCount = 1,
+        .pPoolSizes = &poolSize
+    };
+
+    if(vkCreateDescriptorPool(pStage->device, &poolInfo, NULL, &pStage->descriptorPool) != VK_SUCCESS)
+    {
+        printf("Failed to create transform descriptor pool!\n");
+        exit(1);
+    }
+
+    VkDescriptorSetLayout layouts[pStage->frameCount];
+    for(uint32_t i = 0; i < pStage->frameCount; i++)
+    {
+        layouts[i] = pStage->setLayout;
+    }
+    VkDescriptorSetAllocateInfo allocInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = pStage->descriptorPool,
+        .descriptorSetCount = pStage->frameCount,
+        .pSetLayouts = layouts
+    };
+
+    pStage->sets = allocOrExit(sizeof(VkDescriptorSet) * pStage->frameCount);
+    if(vkAllocateDescriptorSets(pStage->device, &allocInfo, pStage->sets) != VK_SUCCESS)
+    {
+        printf("Failed to allocate transform descriptor sets!\n");
+        exit(1);
+    }
+
+    for(uint32_t frame = 0; frame < pStage->frameCount; frame++)
+    {
+        VkDescriptorBufferInfo bufferInfos[3] = {
+            {animationBuffer, 0, VK_WHOLE_SIZE},
+            {pStage->sourceBuffers[frame], 0, VK_WHOLE_SIZE},
+            {outputBuffers[frame], 0, VK_WHOLE_SIZE}
+        };
+        VkWriteDescriptorSet writes[3];
+        for(uint32_t i = 0; i < 3; i++)
+        {
+            writes[i] = (VkWriteDescriptorSet){
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = pStage->sets[frame],
+                .dstBinding = i,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pBufferInfo = &bufferInfos[i]
+            };
+        }
+        vkUpdateDescriptorSets(pStage->device, 3, writes, 0, NULL);
+    }
+}
+
+static void createPipeline(TransformStage *pStage)
+{
+    VkPushConstantRange pushConstantRange = {
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .offset = 0,
+        .size = sizeof(TransformConstants)
+    };
+
+    VkPipelineLayoutCreateInfo layoutInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &pStage->setLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstantRange
+    };
+
+    if(vkCreatePipelineLayout(pStage->device, &layoutInfo, NULL, &pStage->pipelineLayout) != VK_SUCCESS)
+    {
+        printf("Failed to create transform pipeline layout!\n");
+        exit(1);
+    }
+
+    char *binary;
+    size_t codeSize = readFile("shaders/comp_transform.spv", &binary);
+
+    VkShaderModuleCreateInfo moduleInfo = {
+        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        .codeSize = codeSize,
+        .pCode = (uint32_t *)binary
+    };
+
+    VkShaderModule computeModule;
+    if(vkCreateShaderModule(pStage->device, &moduleInfo, NULL, &computeModule) != VK_SUCCESS)
+    {
+        printf("Failed to create transform shader module!\n");
+        exit(1);
+    }
+    free(binary);
+
+    VkComputePipelineCreateInfo pipelineInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = computeModule,
+            .pName = "main"
+        },
+        .layout = pStage->pipelineLayout,
+        .basePipelineIndex = -1
+    };
+
+    if(vkCreateComputePipelines(pStage->device, VK_NULL_HANDLE, 1, &pipelineInfo, NULL, &pStage->pipeline) != VK_SUCCESS)
+    {
+        printf("Failed to create transform pipeline!\n");
+        exit(1);
+    }
+    vkDestroyShaderModule(pStage->device, computeModule, NULL);
+}
+
+void createTransformStage(TransformStage *pStage, VkDevice device, MemoryPolicy *pMemoryPolicy, VkBuffer animationBuffer, uint32_t instanceCount, const VkBuffer *outputBuffers, uint32_t outputStride, uint32_t frameCount)
+{
+    memset(pStage, 0, sizeof(TransformStage));
+    pStage->device = device;
+    pStage->pMemoryPolicy = pMemoryPolicy;
+    pStage->instanceCount = instanceCount;
+    pStage->outputStride = outputStride;
+    pStage->frameCount = frameCount;
+
+    pStage->sourceBuffers = allocOrExit(sizeof(VkBuffer) * frameCount);
+    pStage->sourceMemory = allocOrExit(sizeof(VkDeviceMemory) * frameCount);
+    pStage->sourceMapped = allocOrExit(sizeof(uint32_t *) * frameCount);
+    for(uint32_t i = 0; i < frameCount; i++)
+    {
+        VkBufferCreateInfo bufferInfo = {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .size = sizeof(uint32_t) * (VkDeviceSize)instanceCount,
+            .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE
+        };
+
+        if(vkCreateBuffer(device, &bufferInfo, NULL, &pStage->sourceBuffers[i]) != VK_SUCCESS)
+        {
+            printf("Failed to create transform source buffer!\n");
+            exit(1);
+        }
+
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements(device, pStage->sourceBuffers[i], &requirements);
+        if(memoryPolicyAllocate(pMemoryPolicy, device, &requirements, MEMORY_USAGE_DYNAMIC, &pStage->sourceMemory[i], &pStage->sourceMemoryType) != VK_SUCCESS)
+        {
+            printf("Failed to allocate transform source memory!\n");
+            exit(1);
+        }
+        vkBindBufferMemory(device, pStage->sourceBuffers[i], pStage->sourceMemory[i], 0);
+        vkMapMemory(device, pStage->sourceMemory[i], 0, VK_WHOLE_SIZE, 0, (void **)&pStage->sourceMapped[i]);
+    }
+
+    createDescriptors(pStage, animationBuffer, outputBuffers);
+    createPipeline(pStage);
+}
+
+uint32_t *transformStageSources(TransformStage *pStage, uint32_t frameSlot)//Written by the CPU before the dispatch, output slot i gets the matrix of instance sources[i]
+{
+    return pStage->sourceMapped[frameSlot];
+}
+
+void transformStageDispatch(TransformStage *pStage, VkCommandBuffer commandBuffer, uint32_t frameSlot, uint32_t instanceCount, float time)//Outside the render pass, once the frame slot's fence has signalled, only the first instanceCount sources are transformed. Readers of the output synchronise with the compute stage themselves
+{
+    memoryPolicyFlush(pStage->pMemoryPolicy, pStage->device, pStage->sourceMemory[frameSlot], pStage->sourceMemoryType, 0, VK_WHOLE_SIZE, VK_WHOLE_SIZE);
+
+    TransformConstants constants = {
+        .time = time,
+        .instanceCount = instanceCount,
+        .outputStride = pStage->outputStride
+    };
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pStage->pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pStage->pipelineLayout, 0, 1, &pStage->sets[frameSlot], 0, NULL);
+    vkCmdPushConstants(commandBuffer, pStage->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    vkCmdDispatch(commandBuffer, (instanceCount + TRANSFORM_WORKGROUP_SIZE - 1) / TRANSFORM_WORKGROUP_SIZE, 1, 1);
+
+    pStage->dispatches++;
+}
+
+void destroyTransformStage(TransformStage *pStage)//Only once the device is idle
+{
+    VkDevice device = pStage->device;
+    vkDestroyPipeline(device, pStage->pipeline, NULL);
+    vkDestroyPipelineLayout(device, pStage->pipelineLayout, NULL);
+    vkDestroyDescriptorPool(device, pStage->descriptorPool, NULL);
+    vkDestroyDescriptorSetLayout(device, pStage->setLayout, NULL);
+    free(pStage->sets);
+
+    for(uint32_t i = 0; i < pStage->frameCount; i++)
+    {
+        vkDestroyBuffer(device, pStage->sourceBuffers[i], NULL);
+        vkFreeMemory(device, pStage->sourceMemory[i], NULL);
+    }
+    free(pStage->sourceBuffers);
+    free(pStage->sourceMemory);
+    free(pStage->sourceMapped);
+}
@@ -0,0 +1,65 @@
+//
+//  transformStage.h
+//  vkProject
+//
+//  Animates instances on the GPU, a compute shader writes their world matrices straight into the instance buffer.
+//
+
+#ifndef transformStage_h
+#define transformStage_h
+
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "memoryPolicy.h"
+
+#define TRANSFORM_WORKGROUP_SIZE 64//local_size_x of shaders/transform.comp
+#define TRANSFORM_PAYLOAD_WORDS 4//Words of per-instance data copied after the matrix
+#define TRANSFORM_TOLERANCE 1e-3f//Vulkan only bounds sin and cos to 2^-11 absolute error, so the GPU may differ from vkMath by about this much
+
+typedef struct {
+    float translation[3];
+    float scale;//Uniform
+    float rotation[4];//Rest orientation as a quaternion, r i j k like vkMath
+    float axis[3];//Spin axis, need not be normalised but must not be zero
+    float angularSpeed;//Radians per second about axis, applied after the rest orientation
+    uint32_t payload[TRANSFORM_PAYLOAD_WORDS];//Copied verbatim after the matrix, up to the output stride
+} InstanceAnimation;
+
+typedef struct {
+    float time;
+    uint32_t instanceCount;
+    uint32_t outputStride;//In words, the matrix takes the first 16
+} TransformConstants;
+
+typedef struct {
+    VkDevice device;
+    MemoryPolicy *pMemoryPolicy;
+    uint32_t instanceCount;
+    uint32_t outputStride;
+    uint32_t frameCount;
+
+    VkBuffer *sourceBuffers;//Per frame in flight, the instance animated into each output slot
+    VkDeviceMemory *sourceMemory;
+    uint32_t **sourceMapped;
+    uint32_t sourceMemoryType;
+
+    VkDescriptorSetLayout setLayout;
+    VkDescriptorPool descriptorPool;
+    VkDescriptorSet *sets;//Per frame in flight, binding 0 is the animations, 1 the sources and 2 the output
+    VkPipelineLayout pipelineLayout;
+    VkPipeline pipeline;
+
+    uint64_t dispatches;
+} TransformStage;
+
+void animateTransform(float model[4][4], const InstanceAnimation *pAnimation, float time);
+
+void createTransformStage(TransformStage *pStage, VkDevice device, MemoryPolicy *pMemoryPolicy, VkBuffer animationBuffer, uint32_t instanceCount, const VkBuffer *outputBuffers, uint32_t outputStride, uint32_t frameCount);
+
+uint32_t *transformStageSources(TransformStage *pStage, uint32_t frameSlot);
+
+void transformStageDispatch(TransformStage *pStage, VkCommandBuffer commandBuffer, uint32_t frameSlot, uint32_t instanceCount, float time);
+
+void destroyTransformStage(TransformStage *pStage);
+
+#endif /* transformStage_h */
@@ -0,0 +1,501 @@
+//
+//  vertexLayout.c
+//  vkProject
+//
+//  Packed GPU vertex layouts, their attribute descriptions and the CPU kernels that quantise into them.
+//
+
+#include "vertexLayout.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "profiler.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define VERTEX_PACK_NEON
+#endif
+
+#define PACK_BATCH 256//Vertices staged at a time, keeps the float staging in L1
+
+enum packKind{PACK_FLOAT, PACK_HALF, PACK_SNORM16, PACK_UNORM16, PACK_UNORM8};
+
+typedef struct {
+    uint32_t size;//Bytes in a packed vertex
+    uint32_t components;//Floats staged per vertex
+    uint32_t kind;
+    VkFormat format;
+} FormatInfo;
+
+static const FormatInfo formatInfos[] = {
+    [VERTEX_FORMAT_FLOAT3] = {12, 3, PACK_FLOAT, VK_FORMAT_R32G32B32_SFLOAT},
+    [VERTEX_FORMAT_FLOAT2] = {8, 2, PACK_FLOAT, VK_FORMAT_R32G32_SFLOAT},
+    [VERTEX_FORMAT_HALF4] = {8, 4, PACK_HALF, VK_FORMAT_R16G16B16A16_SFLOAT},//Three component 16-bit formats are optional as vertex input
+    [VERTEX_FORMAT_HALF2] = {4, 2, PACK_HALF, VK_FORMAT_R16G16_SFLOAT},
+    [VERTEX_FORMAT_SNORM16X4] = {8, 4, PACK_SNORM16, VK_FORMAT_R16G16B16A16_SNORM},
+    [VERTEX_FORMAT_UNORM16X4] = {8, 4, PACK_UNORM16, VK_FORMAT_R16G16B16A16_UNORM},
+    [VERTEX_FORMAT_OCTAHEDRAL16] = {4, 2, PACK_SNORM16, VK_FORMAT_R16G16_SNORM},
+    [VERTEX_FORMAT_UNORM8X4] = {4, 4, PACK_UNORM8, VK_FORMAT_R8G8B8A8_UNORM}
+};
+
+typedef struct {
+    uint32_t attribute;
+    const char *name;
+    uint32_t format;
+} FormatOption;
+
+static const FormatOption formatOptions[] = {
+    {VERTEX_ATTRIBUTE_POSITION, "float", VERTEX_FORMAT_FLOAT3},
+    {VERTEX_ATTRIBUTE_POSITION, "half", VERTEX_FORMAT_HALF4},
+    {VERTEX_ATTRIBUTE_POSITION, "snorm16", VERTEX_FORMAT_SNORM16X4},
+    {VERTEX_ATTRIBUTE_POSITION, "unorm16", VERTEX_FORMAT_UNORM16X4},
+    {VERTEX_ATTRIBUTE_NORMAL, "float", VERTEX_FORMAT_FLOAT3},
+    {VERTEX_ATTRIBUTE_NORMAL, "oct16", VERTEX_FORMAT_OCTAHEDRAL16},
+    {VERTEX_ATTRIBUTE_UV, "float", VERTEX_FORMAT_FLOAT2},
+    {VERTEX_ATTRIBUTE_UV, "half", VERTEX_FORMAT_HALF2},
+    {VERTEX_ATTRIBUTE_COLOR, "float", VERTEX_FORMAT_FLOAT3},
+    {VERTEX_ATTRIBUTE_COLOR, "unorm8", VERTEX_FORMAT_UNORM8X4}
+};
+
+static const char *attributeNames[VERTEX_ATTRIBUTE_COUNT] = {"position", "normal", "uv", "color"};
+
+static const uint32_t attributeLocations[VERTEX_ATTRIBUTE_COUNT] = {0, 2, 3, 1};//Shader locations, colour kept at 1 from the original layout
+
+static const uint32_t floatFormats[VERTEX_ATTRIBUTE_COUNT] = {VERTEX_FORMAT_FLOAT3, VERTEX_FORMAT_FLOAT3, VERTEX_FORMAT_FLOAT2, VERTEX_FORMAT_FLOAT3};
+
+static const uint32_t compactFormats[VERTEX_ATTRIBUTE_COUNT] = {VERTEX_FORMAT_SNORM16X4, VERTEX_FORMAT_OCTAHEDRAL16, VERTEX_FORMAT_HALF2, VERTEX_FORMAT_UNORM8X4};
+
+static uint32_t parseFormatOption(const char *option, size_t length, VertexLayout *pLayout)//One attribute=format pair
+{
+    for(uint32_t i = 0; i < sizeof(formatOptions) / sizeof(formatOptions[0]); i++)
+    {
+        const char *attribute = attributeNames[formatOptions[i].attribute];
+        size_t attributeLength = strlen(attribute);
+        size_t nameLength = strlen(formatOptions[i].name);
+        if(length == attributeLength + 1 + nameLength && strncmp(option, attribute, attributeLength) == 0
+           && option[attributeLength] == '=' && strncmp(option + attributeLength + 1, formatOptions[i].name, nameLength) == 0)
+        {
+            pLayout->formats[formatOptions[i].attribute] = formatOptions[i].format;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+uint32_t parseVertexLayout(const char *description, VertexLayout *pLayout)//"float", "compact" or a comma separated list such as "position=snorm16,normal=oct16" applied over float
+{
+    pLayout->name = description;
+    memcpy(pLayout->formats, strcmp(description, "compact") == 0 ? compactFormats : floatFormats, sizeof(pLayout->formats));
+
+    if(strcmp(description, "float") != 0 && strcmp(description, "compact") != 0)
+    {
+        const char *option = description;
+        while(*option != '\0')
+        {
+            size_t length = strcspn(option, ",");
+            if(!parseFormatOption(option, length, pLayout))
+            {
+                return 0;
+            }
+            option += length + (option[length] == ',');
+        }
+    }
+
+    uint32_t offset = 0;
+    for(uint32_t i = 0; i < VERTEX_ATTRIBUTE_COUNT; i++)//Every format is a multiple of four bytes so attributes stay aligned
+    {
+        pLayout->offsets[i] = offset;
+        offset += formatInfos[pLayout->formats[i]].size;
+    }
+    pLayout->stride = offset;
+    return 1;
+}
+
+uint32_t vertexLayoutIsUnpacked(const VertexLayout *pLayout)//Byte for byte a Vertex, so the mesh can be uploaded without packing
+{
+    return memcmp(pLayout->formats, floatFormats, sizeof(floatFormats)) == 0 && pLayout->stride == sizeof(Vertex)
+        && pLayout->offsets[VERTEX_ATTRIBUTE_POSITION] == offsetof(Vertex, position) && pLayout->offsets[VERTEX_ATTRIBUTE_NORMAL] == offsetof(Vertex, normal)
+        && pLayout->offsets[VERTEX_ATTRIBUTE_UV] == offsetof(Vertex, uv) && pLayout->offsets[VERTEX_ATTRIBUTE_COLOR] == offsetof(Vertex, color);
+}
+
+void vertexLayoutAttributes(const VertexLayout *pLayout, uint32_t binding, VkVertexInputAttributeDescription attributes[VERTEX_ATTRIBUTE_COUNT])
+{
+    for(uint32_t i = 0; i < VERTEX_ATTRIBUTE_COUNT; i++)
+    {
+        attributes[i].binding = binding;
+        attributes[i].location = attributeLocations[i];
+        attributes[i].format = formatInfos[pLayout->formats[i]].format;//Normalised and half formats arrive in the shader as floats
+        attributes[i].offset = pLayout->offsets[i];
+    }
+}
+
+void fitVertexDequantization(const VertexLayout *pLayout, const Vertex *vertices, uint32_t vertexCount, VertexDequantization *pDequantization)
+{
+    uint32_t kind = formatInfos[pLayout->formats[VERTEX_ATTRIBUTE_POSITION]].kind;
+    float boundsMin[3] = {0.0f, 0.0f, 0.0f};
+    float boundsMax[3] = {0.0f, 0.0f, 0.0f};
+    for(uint32_t i = 0; i < vertexCount; i++)
+    {
+        const float *p = &vertices[i].position.x;
+        for(uint32_t c = 0; c < 3; c++)
+        {
+            boundsMin[c] = (i == 0 || p[c] < boundsMin[c]) ? p[c] : boundsMin[c];
+            boundsMax[c] = (i == 0 || p[c] > boundsMax[c]) ? p[c] : boundsMax[c];
+        }
+    }
+
+    for(uint32_t c = 0; c < 3; c++)
+    {
+        float extent = boundsMax[c] - boundsMin[c];
+        if(extent <= 0.0f)
+        {
+            extent = 1.0f;//Flat axis, any scale reproduces it exactly
+        }
+        if(kind == PACK_FLOAT)
+        {
+            pDequantization->positionScale[c] = 1.0f;
+            pDequantization->positionOffset[c] = 0.0f;
+        }
+        else if(kind == PACK_UNORM16)
+        {
+            pDequantization->positionScale[c] = extent;//Bounds map onto [0, 1]
+            pDequantization->positionOffset[c] = boundsMin[c];
+        }
+        else
+        {
+            pDequantization->positionScale[c] = 0.5f * extent;//Bounds map onto [-1, 1]
+            pDequantization->positionOffset[c] = 0.5f * (boundsMin[c] + boundsMax[c]);
+        }
+    }
+}
+
+static uint16_t floatToHalf(float value)//Round to nearest even, out of range values become infinity
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t magnitude = bits & 0x7FFFFFFF;
+
+    if(magnitude >= 0x7F800000)
+    {
+        return (uint16_t)(sign | 0x7C00 | (magnitude > 0x7F800000 ? 0x200 : 0));//Infinity stays infinity, NaN stays quiet NaN
+    }
+    if(magnitude >= 0x47800000)
+    {
+        return (uint16_t)(sign | 0x7C00);
+    }
+    if(magnitude < 0x38800000)//Subnormal result, adding 0.5 lines the half mantissa up with the float mantissa and lets the FPU round
+    {
+        float shifted;
+        memcpy(&shifted, &magnitude, sizeof(shifted));
+        shifted += 0.5f;
+        memcpy(&bits, &shifted, sizeof(bits));
+        return (uint16_t)(sign | (bits - 0x3F000000));
+    }
+    uint32_t odd = (magnitude >> 13) & 1;
+    return (uint16_t)(sign | ((magnitude + 0xFFF + odd - (112u << 23)) >> 13));//Rebias the exponent and round on the dropped 13 bits
+}
+
+static float clampUnit(float value, float low)
+{
+    return value < low ? low : (value > 1.0f ? 1.0f : value);
+}
+
+#if defined(__SSE2__)
+
+static __m128i floatToHalfSse2(__m128 value)//floatToHalf on four lanes, returned sign extended to 32 bits so _mm_packs_epi32 narrows it losslessly
+{
+    const __m128i maxNormal = _mm_set1_epi32(0x47800000);
+    const __m128i minNormal = _mm_set1_epi32(0x38800000);
+    const __m128i subnormalMagic = _mm_set1_epi32(0x3F000000);
+    const __m128i normalBias = _mm_set1_epi32(0xFFF - (112 << 23));
+
+    __m128 sign = _mm_and_ps(value, _mm_set1_ps(-0.0f));
+    __m128 absolute = _mm_xor_ps(value, sign);
+    __m128i magnitude = _mm_castps_si128(absolute);
+
+    __m128i nan = _mm_and_si128(_mm_castps_si128(_mm_cmpunord_ps(absolute, absolute)), _mm_set1_epi32(0x200));
+    __m128i special = _mm_or_si128(nan, _mm_set1_epi32(0x7C00));
+    __m128i isRegular = _mm_cmpgt_epi32(maxNormal, magnitude);
+    __m128i isSubnormal = _mm_cmpgt_epi32(minNormal, magnitude);
+
+    __m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absolute, _mm_castsi128_ps(subnormalMagic))), subnormalMagic);
+
+    __m128i odd = _mm_srai_epi32(_mm_slli_epi32(magnitude, 18), 31);//All ones when the kept mantissa is odd
+    __m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(magnitude, normalBias), odd), 13);
+
+    __m128i finite = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+    __m128i result = _mm_or_si128(_mm_and_si128(isRegular, finite), _mm_andnot_si128(isRegular, special));
+    return _mm_or_si128(result, _mm_srai_epi32(_mm_castps_si128(sign), 16));
+}
+
+#endif
+
+static void packHalf(const float *source, uint16_t *destination, uint32_t count)
+{
+    uint32_t i = 0;
+#if defined(__SSE2__)
+    for(; i + 8 <= count; i += 8)
+    {
+        __m128i low = floatToHalfSse2(_mm_loadu_ps(source + i));
+        __m128i high = floatToHalfSse2(_mm_loadu_ps(source + i + 4));
+        _mm_storeu_si128((__m128i *)(destination + i), _mm_packs_epi32(low, high));
+    }
+#elif defined(VERTEX_PACK_NEON)
+    for(; i + 8 <= count; i += 8)
+    {
+        float16x8_t half = vcombine_f16(vcvt_f16_f32(vld1q_f32(source + i)), vcvt_f16_f32(vld1q_f32(source + i + 4)));
+        vst1q_u16(destination + i, vreinterpretq_u16_f16(half));
+    }
+#endif
+    for(; i < count; i++)
+    {
+        destination[i] = floatToHalf(source[i]);
+    }
+}
+
+static void packSnorm16(const float *source, int16_t *destination, uint32_t count)//Rounds to nearest, -1 and 1 map to -32767 and 32767
+{
+    uint32_t i = 0;
+#if defined(__SSE2__)
+    const __m128 low = _mm_set1_ps(-1.0f);
+    const __m128 high = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(32767.0f);
+    for(; i + 8 <= count; i += 8)
+    {
+        __m128i a = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(source + i), low), high), scale));
+        __m128i b = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(source + i + 4), low), high), scale));
+        _mm_storeu_si128((__m128i *)(destination + i), _mm_packs_epi32(a, b));
+    }
+#elif defined(VERTEX_PACK_NEON)
+    for(; i + 8 <= count; i += 8)
+    {
+        int32x4_t a = vcvtnq_s32_f32(vmulq_n_f32(vminq_f32(vmaxq_f32(vld1q_f32(source + i), vdupq_n_f32(-1.0f)), vdupq_n_f32(1.0f)), 32767.0f));
+        int32x4_t b = vcvtnq_s32_f32(vmulq_n_f32(vminq_f32(vmaxq_f32(vld1q_f32(source + i + 4), vdupq_n_f32(-1.0f)), vdupq_n_f32(1.0f)), 32767.0f));
+        vst1q_s16(destination + i, vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+    }
+#endif
+    for(; i < count; i++)
+    {
+        destination[i] = (int16_t)lrintf(clampUnit(source[i], -1.0f) * 32767.0f);
+    }
+}
+
+static void packUnorm16(const float *source, uint16_t *destination, uint32_t count)
+{
+    uint32_t i = 0;
+#if defined(__SSE2__)
+    const __m128 low = _mm_setzero_ps();
+    const __m128 high = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(65535.0f);
+    const __m128i bias = _mm_set1_epi32(32768);
+    for(; i + 8 <= count; i += 8)//SSE2 only packs signed, so shift into the signed range and flip the top bit back
+    {
+        __m128i a = _mm_sub_epi32(_mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(source + i), low), high), scale)), bias);
+        __m128i b = _mm_sub_epi32(_mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(source + i + 4), low), high), scale)), bias);
+        _mm_storeu_si128((__m128i *)(destination + i), _mm_xor_si128(_mm_packs_epi32(a, b), _mm_set1_epi16((short)0x8000)));
+    }
+#elif defined(VERTEX_PACK_NEON)
+    for(; i + 8 <= count; i += 8)
+    {
+        uint32x4_t a = vcvtnq_u32_f32(vmulq_n_f32(vminq_f32(vld1q_f32(source + i), vdupq_n_f32(1.0f)), 65535.0f));//Negative inputs saturate to 0 in the conversion
+        uint32x4_t b = vcvtnq_u32_f32(vmulq_n_f32(vminq_f32(vld1q_f32(source + i + 4), vdupq_n_f32(1.0f)), 65535.0f));
+        vst1q_u16(destination + i, vcombine_u16(vqmovn_u32(a), vqmovn_u32(b)));
+    }
+#endif
+    for(; i < count; i++)
+    {
+        destination[i] = (uint16_t)lrintf(clampUnit(source[i], 0.0f) * 65535.0f);
+    }
+}
+
+static void packUnorm8(const float *source, uint8_t *destination, uint32_t count)
+{
+    uint32_t i = 0;
+#if defined(__SSE2__)
+    const __m128 scale = _mm_set1_ps(255.0f);
+    for(; i + 8 <= count; i += 8)//The saturating packs do the clamping
+    {
+        __m128i a = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(source + i), scale));
+        __m128i b = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(source + i + 4), scale));
+        __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_setzero_si128());
+        _mm_storel_epi64((__m128i *)(destination + i), bytes);
+    }
+#elif defined(VERTEX_PACK_NEON)
+    for(; i + 8 <= count; i += 8)
+    {
+        uint32x4_t a = vcvtnq_u32_f32(vmulq_n_f32(vld1q_f32(source + i), 255.0f));
+        uint32x4_t b = vcvtnq_u32_f32(vmulq_n_f32(vld1q_f32(source + i + 4), 255.0f));
+        vst1_u8(destination + i, vqmovn_u16(vcombine_u16(vqmovn_u32(a), vqmovn_u32(b))));
+    }
+#endif
+    for(; i < count; i++)
+    {
+        destination[i] = (uint8_t)lrintf(clampUnit(source[i], 0.0f) * 255.0f);
+    }
+}
+
+static void octahedralEncode(Vector3 n, float *pEncoded)//Projects onto the octahedron |x|+|y|+|z|=1 and folds the lower half over the diagonals
+{
+    float sum = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+    if(sum == 0.0f)
+    {
+        pEncoded[0] = 0.0f;
+        pEncoded[1] = 0.0f;
+        return;
+    }
+    float x = n.x / sum;
+    float y = n.y / sum;
+    if(n.z < 0.0f)
+    {
+        float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        y = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = foldedX;
+    }
+    pEncoded[0] = x;
+    pEncoded[1] = y;
+}
+
+static void stageAttribute(uint32_t attribute, const VertexDequantization *pDequantization, const Vertex *vertices, uint32_t count, float *staging)//Floats in the order the format stores them, already in its [-1, 1] or [0, 1] range
+{
+    switch(attribute)
+    {
+        case VERTEX_ATTRIBUTE_POSITION:
+        {
+            float inverseScale[3];
+            for(uint32_t c = 0; c < 3; c++)
+            {
+                inverseScale[c] = 1.0f / pDequantization->positionScale[c];
+            }
+            for(uint32_t i = 0; i < count; i++)
+            {
+                const float *p = &vertices[i].position.x;
+                for(uint32_t c = 0; c < 3; c++)
+                {
+                    staging[4 * i + c] = (p[c] - pDequantization->positionOffset[c]) * inverseScale[c];
+                }
+                staging[4 * i + 3] = 0.0f;
+            }
+            break;
+        }
+        case VERTEX_ATTRIBUTE_NORMAL:
+            for(uint32_t i = 0; i < count; i++)
+            {
+                octahedralEncode(vertices[i].normal, staging + 2 * i);
+            }
+            break;
+        case VERTEX_ATTRIBUTE_UV:
+            for(uint32_t i = 0; i < count; i++)
+            {
+                staging[2 * i] = vertices[i].uv.x;
+                staging[2 * i + 1] = vertices[i].uv.y;
+            }
+            break;
+        default:
+            for(uint32_t i = 0; i < count; i++)
+            {
+                staging[4 * i] = vertices[i].color.x;
+                staging[4 * i + 1] = vertices[i].color.y;
+                staging[4 * i + 2] = vertices[i].color.z;
+                staging[4 * i + 3] = 1.0f;
+            }
+            break;
+    }
+}
+
+static const void *attributeSource(uint32_t attribute, const Vertex *pVertex)
+{
+    switch(attribute)
+    {
+        case VERTEX_ATTRIBUTE_POSITION:
+            return &pVertex->position;
+        case VERTEX_ATTRIBUTE_NORMAL:
+            return &pVertex->normal;
+        case VERTEX_ATTRIBUTE_UV:
+            return &pVertex->uv;
+        default:
+            return &pVertex->color;
+    }
+}
+
+static void scatterAttribute(const uint8_t *source, size_t sourceStride, uint32_t size, uint32_t count, uint8_t *destination, size_t destinationStride)//Constant size copies so they compile to plain loads and stores
+{
+    switch(size)
+    {
+        case 4:
+            for(uint32_t i = 0; i < count; i++)
+            {
+                memcpy(destination + i * destinationStride, source + i * sourceStride, 4);
+            }
+            break;
+        case 8:
+            for(uint32_t i = 0; i < count; i++)
+            {
+                memcpy(destination + i * destinationStride, source + i * sourceStride, 8);
+            }
+            break;
+        default:
+            for(uint32_t i = 0; i < count; i++)
+            {
+                memcpy(destination + i * destinationStride, source + i * sourceStride, 12);
+            }
+            break;
+    }
+}
+
+void packVertices(const VertexLayout *pLayout, const VertexDequantization *pDequantization, const Vertex *vertices, uint32_t vertexCount, void *pDestination)//pDestination holds stride * vertexCount bytes
+{
+    uint64_t startTime = profilerTimeNs();
+    float staging[PACK_BATCH * 4];
+    uint8_t packed[PACK_BATCH * 8];
+    uint8_t *destination = pDestination;
+
+    for(uint32_t first = 0; first < vertexCount; first += PACK_BATCH)
+    {
+        uint32_t count = vertexCount - first < PACK_BATCH ? vertexCount - first : PACK_BATCH;
+        const Vertex *batch = vertices + first;
+        uint8_t *batchDestination = destination + (size_t)first * pLayout->stride;
+
+        for(uint32_t a = 0; a < VERTEX_ATTRIBUTE_COUNT; a++)//Convert one attribute of the whole batch at a time so the kernels run over contiguous floats
+        {
+            const FormatInfo *pInfo = &formatInfos[pLayout->formats[a]];
+            uint32_t offset = pLayout->offsets[a];
+            if(pInfo->kind == PACK_FLOAT)
+            {
+                scatterAttribute((const uint8_t *)attributeSource(a, batch), sizeof(Vertex), pInfo->size, count, batchDestination + offset, pLayout->stride);
+                continue;
+            }
+
+            stageAttribute(a, pDequantization, batch, count, staging);
+            uint32_t componentCount = count * pInfo->components;
+            switch(pInfo->kind)
+            {
+                case PACK_HALF:
+                    packHalf(staging, (uint16_t *)packed, componentCount);
+                    break;
+                case PACK_SNORM16:
+                    packSnorm16(staging, (int16_t *)packed, componentCount);
+                    break;
+                case PACK_UNORM16:
+                    packUnorm16(staging, (uint16_t *)packed, componentCount);
+                    break;
+                default:
+                    packUnorm8(staging, packed, componentCount);
+                    break;
+            }
+            scatterAttribute(packed, pInfo->size, pInfo->size, count, batchDestination + offset, pLayout->stride);
+        }
+    }
+
+    double milliseconds = (profilerTimeNs() - startTime) / 1e6;
+    double packedBytes = (double)pLayout->stride * vertexCount;
+    double floatBytes = (double)sizeof(Vertex) * vertexCount;
+    printf("Vertex layout %s: %u bytes per vertex instead of %zu, %.2f MiB instead of %.2f MiB (%.0f%% less vertex fetch), packed %u vertices in %.2f ms (%.0f M/s)\n",
+           pLayout->name, pLayout->stride, sizeof(Vertex), packedBytes / (1024.0 * 1024.0), floatBytes / (1024.0 * 1024.0), 100.0 * (1.0 - packedBytes / floatBytes),
+           vertexCount, milliseconds, milliseconds > 0.0 ? vertexCount / (milliseconds * 1e3) : 0.0);
+}
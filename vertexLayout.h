@@ -0,0 +1,50 @@
+//
+//  vertexLayout.h
+//  vkProject
+//
+//  Packed GPU vertex layouts, their attribute descriptions and the CPU kernels that quantise into them.
+//
+
+#ifndef vertexLayout_h
+#define vertexLayout_h
+
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "mesh.h"
+
+enum vertexAttribute{VERTEX_ATTRIBUTE_POSITION, VERTEX_ATTRIBUTE_NORMAL, VERTEX_ATTRIBUTE_UV, VERTEX_ATTRIBUTE_COLOR, VERTEX_ATTRIBUTE_COUNT};
+
+enum vertexFormat{
+    VERTEX_FORMAT_FLOAT3,
+    VERTEX_FORMAT_FLOAT2,
+    VERTEX_FORMAT_HALF4,//Positions, w is padding
+    VERTEX_FORMAT_HALF2,
+    VERTEX_FORMAT_SNORM16X4,//Positions, w is padding
+    VERTEX_FORMAT_UNORM16X4,
+    VERTEX_FORMAT_OCTAHEDRAL16,//Unit vectors folded onto the octahedron, two SNORM16
+    VERTEX_FORMAT_UNORM8X4
+};
+
+typedef struct {
+    const char *name;//As given to --vertex-format
+    uint32_t formats[VERTEX_ATTRIBUTE_COUNT];
+    uint32_t offsets[VERTEX_ATTRIBUTE_COUNT];
+    uint32_t stride;
+} VertexLayout;
+
+typedef struct {//position = stored * scale + offset, fitted to the mesh bounds
+    float positionScale[3];
+    float positionOffset[3];
+} VertexDequantization;
+
+uint32_t parseVertexLayout(const char *description, VertexLayout *pLayout);
+
+uint32_t vertexLayoutIsUnpacked(const VertexLayout *pLayout);
+
+void vertexLayoutAttributes(const VertexLayout *pLayout, uint32_t binding, VkVertexInputAttributeDescription attributes[VERTEX_ATTRIBUTE_COUNT]);
+
+void fitVertexDequantization(const VertexLayout *pLayout, const Vertex *vertices, uint32_t vertexCount, VertexDequantization *pDequantization);
+
+void packVertices(const VertexLayout *pLayout, const VertexDequantization *pDequantization, const Vertex *vertices, uint32_t vertexCount, void *pDestination);
+
+#endif /* vertexLayout_h */